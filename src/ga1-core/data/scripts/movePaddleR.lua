@@ -1,10 +1,22 @@
+-- Moves the right paddle with I and K, keeping it between the walls.
+paddle_speed = 8.0
+travel = 2.5
+
+state = { offset = 0.0 }
+
 function update (component, frame_params)
+	local step = paddle_speed * frame_params_get_delta_time(frame_params)
+	local move = 0.0
 	if frame_params_get_input_up_R(frame_params) then
-		entity = component_get_entity(component)
-		entity_set_velocity(entity, 0.0, 1.0, 0.0)
+		move = move + step
 	end
 	if frame_params_get_input_down_R(frame_params) then
-		entity = component_get_entity(component)
-		entity_set_velocity(entity, 0.0, -1.0, 0.0)
+		move = move - step
+	end
+
+	local offset = math.max(-travel, math.min(travel, state.offset + move))
+	if offset ~= state.offset then
+		entity_translate(component_get_entity(component), 0.0, offset - state.offset, 0.0)
+		state.offset = offset
 	end
 end
@@ -11,7 +11,18 @@
 
 #include "ga_entity.h"
 
-ga_component::ga_component(ga_entity* ent) : _entity(ent)
+#include "framework/ga_sim.h"
+
+#include <cassert>
+
+static ga_component_batch_funcs_t s_batch_funcs[k_max_component_types];
+
+ga_component::ga_component(ga_entity* ent) : _entity(ent), _type(k_component_type_invalid), _update_requested(false)
+{
+	_entity->add_component(this);
+}
+
+ga_component::ga_component(ga_entity* ent, ga_component_type_t type) : _entity(ent), _type(type), _update_requested(false)
 {
 	_entity->add_component(this);
 }
@@ -20,6 +31,22 @@ ga_component::~ga_component()
 {
 }
 
+void ga_component::set_update_tier(ga_update_tier_t tier)
+{
+	if (tier == _update_tier) return;
+
+	ga_sim* sim = _entity->_sim;
+	if (sim)
+	{
+		sim->on_component_removed(this);
+	}
+	_update_tier = uint8_t(tier);
+	if (sim)
+	{
+		sim->on_component_added(this);
+	}
+}
+
 void ga_component::update(ga_frame_params* params)
 {
 }
@@ -27,3 +54,30 @@ void ga_component::update(ga_frame_params* params)
 void ga_component::late_update(ga_frame_params* params)
 {
 }
+
+void ga_component::save_state(ga_snapshot* snapshot) const
+{
+}
+
+bool ga_component::load_state(ga_snapshot* snapshot)
+{
+	return true;
+}
+
+const ga_component_batch_funcs_t* ga_component::get_batch_funcs(ga_component_type_t type)
+{
+	if (type >= k_max_component_types || !s_batch_funcs[type]._update)
+	{
+		return nullptr;
+	}
+	return &s_batch_funcs[type];
+}
+
+void ga_component::set_batch_funcs(ga_component_type_t type, const ga_component_batch_funcs_t& funcs)
+{
+	assert(type < k_max_component_types);
+	if (type < k_max_component_types)
+	{
+		s_batch_funcs[type] = funcs;
+	}
+}
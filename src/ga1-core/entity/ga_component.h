@@ -9,18 +9,40 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 
+#include "ga_component_type.h"
+
 #include "framework/ga_frame_params.h"
 
+#include <atomic>
+#include <cstdint>
+
+/*
+** Updates a run of components that all share one concrete type.
+*/
+typedef void(*ga_component_batch_func_t)(class ga_component* const* components, uint32_t count, struct ga_frame_params* params);
+
+struct ga_component_batch_funcs_t
+{
+	ga_component_batch_func_t _update;
+	ga_component_batch_func_t _late_update;
+};
+
 /*
 ** Base class component object.
 ** All entity functionality is expected to derive from this object.
+**
+** Derived classes pass their own type id, ga_component_type::get<T>(), to the
+** constructor so they can be found with ga_entity::get_component<T>().
+** Classes that also want batched updates pass ga_component_batched<T>::get_type().
 ** @see ga_entity
+** @see ga_component_batched
 */
 class ga_component
 {
 public:
 	ga_component() = delete;
 	ga_component(class ga_entity* ent);
+	ga_component(class ga_entity* ent, ga_component_type_t type);
 	virtual ~ga_component();
 
 	virtual void update(struct ga_frame_params* params);
@@ -29,6 +51,102 @@ public:
 	const class ga_entity* get_entity() const { return _entity; }
 	class ga_entity* get_entity() { return _entity; }
 
+	ga_component_type_t get_type() const { return _type; }
+
+	/*
+	** Change how often the component is updated. Takes effect next frame.
+	** Must not be called while the sim is updating.
+	*/
+	void set_update_tier(ga_update_tier_t tier);
+	ga_update_tier_t get_update_tier() const { return ga_update_tier_t(_update_tier); }
+
+	/*
+	** Have an on-demand component updated on the next frame.
+	** Safe to call from any thread.
+	*/
+	void request_update() { _update_requested.store(true, std::memory_order_relaxed); }
+
+	/*
+	** Save and load state kept only by the component, for ga_snapshot.
+	** Entity transforms and rigid bodies are captured separately, so most
+	** components have nothing to add. The default saves nothing.
+	*/
+	virtual void save_state(class ga_snapshot* snapshot) const;
+	virtual bool load_state(class ga_snapshot* snapshot);
+
+	/*
+	** Default batch updates, used by batched types that only provide one of
+	** the two. They fall back to the virtual per-component functions.
+	*/
+	template<typename T>
+	static void update_batch(T* const* components, uint32_t count, struct ga_frame_params* params)
+	{
+		for (uint32_t i = 0; i < count; ++i) components[i]->update(params);
+	}
+
+	template<typename T>
+	static void late_update_batch(T* const* components, uint32_t count, struct ga_frame_params* params)
+	{
+		for (uint32_t i = 0; i < count; ++i) components[i]->late_update(params);
+	}
+
+	/*
+	** Get the batch update functions registered for a type.
+	** @returns Null if the type has not opted in to batched updates.
+	*/
+	static const ga_component_batch_funcs_t* get_batch_funcs(ga_component_type_t type);
+	static void set_batch_funcs(ga_component_type_t type, const ga_component_batch_funcs_t& funcs);
+
 private:
 	class ga_entity* _entity;
+	ga_component_type_t _type;
+
+	// Set by the sim when the component joins one of its update buckets.
+	uint8_t _update_tier = k_update_every_frame;
+	uint8_t _update_phase = 0;
+	std::atomic<bool> _update_requested;
+
+	friend class ga_sim;
+};
+
+/*
+** Opts a component class into batched updates by ga_sim.
+**
+** T provides static update_batch and/or late_update_batch functions taking an
+** array of T pointers, and passes ga_component_batched<T>::get_type() to the
+** ga_component constructor. The sim then calls those once per batch of T
+** instead of calling the virtual functions once per component.
+*/
+template<typename T>
+class ga_component_batched
+{
+public:
+	static ga_component_type_t get_type()
+	{
+		static const ga_component_type_t s_type = register_type();
+		return s_type;
+	}
+
+private:
+	static ga_component_type_t register_type()
+	{
+		ga_component_batch_funcs_t funcs;
+		funcs._update = &update;
+		funcs._late_update = &late_update;
+
+		ga_component_type_t type = ga_component_type::get<T>();
+		ga_component::set_batch_funcs(type, funcs);
+		return type;
+	}
+
+	// Batched types derive from ga_component alone, so the pointer arrays are interchangeable.
+	static void update(ga_component* const* components, uint32_t count, ga_frame_params* params)
+	{
+		T::update_batch(reinterpret_cast<T* const*>(components), count, params);
+	}
+
+	static void late_update(ga_component* const* components, uint32_t count, ga_frame_params* params)
+	{
+		T::late_update_batch(reinterpret_cast<T* const*>(components), count, params);
+	}
 };
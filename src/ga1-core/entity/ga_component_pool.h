@@ -0,0 +1,104 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+static const uint32_t k_component_pool_invalid_index = 0xffffffff;
+
+/*
+** Type-erased interface to a component pool.
+** Lets the store remove an entity from every pool without knowing the types.
+*/
+class ga_component_pool_base
+{
+public:
+	virtual ~ga_component_pool_base() {}
+
+	virtual void remove(uint32_t entity) = 0;
+	virtual bool has(uint32_t entity) const = 0;
+
+	uint32_t size() const { return uint32_t(_entities.size()); }
+	const uint32_t* entities() const { return _entities.data(); }
+
+protected:
+	// Dense array of owning entity ids, parallel to the component data.
+	std::vector<uint32_t> _entities;
+
+	// Sparse map from entity id to dense index.
+	std::vector<uint32_t> _sparse;
+};
+
+/*
+** Contiguous storage for all components of a single type.
+**
+** Components are kept densely packed so systems can walk them linearly.
+** Removal swaps the last element into the hole, so the order of components
+** in the pool is not stable across removals.
+*/
+template<typename T>
+class ga_component_pool final : public ga_component_pool_base
+{
+public:
+	T* add(uint32_t entity, const T& value)
+	{
+		if (entity >= _sparse.size())
+		{
+			_sparse.resize(entity + 1, k_component_pool_invalid_index);
+		}
+		assert(_sparse[entity] == k_component_pool_invalid_index);
+
+		_sparse[entity] = uint32_t(_data.size());
+		_entities.push_back(entity);
+		_data.push_back(value);
+		return &_data.back();
+	}
+
+	void remove(uint32_t entity) override
+	{
+		if (!has(entity)) return;
+
+		uint32_t index = _sparse[entity];
+		uint32_t last = uint32_t(_data.size()) - 1;
+		if (index != last)
+		{
+			_data[index] = _data[last];
+			_entities[index] = _entities[last];
+			_sparse[_entities[index]] = index;
+		}
+		_data.pop_back();
+		_entities.pop_back();
+		_sparse[entity] = k_component_pool_invalid_index;
+	}
+
+	bool has(uint32_t entity) const override
+	{
+		return entity < _sparse.size() && _sparse[entity] != k_component_pool_invalid_index;
+	}
+
+	T* get(uint32_t entity)
+	{
+		return has(entity) ? &_data[_sparse[entity]] : nullptr;
+	}
+
+	T* data() { return _data.data(); }
+	const T* data() const { return _data.data(); }
+
+	void reserve(uint32_t count)
+	{
+		_data.reserve(count);
+		_entities.reserve(count);
+	}
+
+private:
+	std::vector<T> _data;
+};
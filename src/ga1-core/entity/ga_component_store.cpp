@@ -0,0 +1,76 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_component_store.h"
+
+#include "jobs/ga_job.h"
+#include "math/ga_math.h"
+
+// Smallest number of components handed to a single system job.
+static const uint32_t k_system_min_batch_size = 256;
+
+// Cap on jobs per system, to stay well within the job queue.
+static const uint32_t k_system_max_batches = 128;
+
+ga_component_store::ga_component_store()
+{
+}
+
+ga_component_store::~ga_component_store()
+{
+	for (auto& p : _pools)
+	{
+		delete p;
+	}
+}
+
+void ga_component_store::remove_entity(uint32_t entity)
+{
+	for (auto& p : _pools)
+	{
+		if (p)
+		{
+			p->remove(entity);
+		}
+	}
+}
+
+void ga_component_store::run_systems(ga_frame_params* params)
+{
+	for (auto& s : _systems)
+	{
+		uint32_t count = s._pool->size();
+		if (count == 0) continue;
+
+		uint32_t batch_size = ga_max(k_system_min_batch_size, (count + k_system_max_batches - 1) / k_system_max_batches);
+		uint32_t batch_count = (count + batch_size - 1) / batch_size;
+		_batch_decls.resize(batch_count);
+		_batch_data.resize(batch_count);
+
+		for (uint32_t i = 0; i < batch_count; ++i)
+		{
+			_batch_data[i]._system = &s;
+			_batch_data[i]._begin = i * batch_size;
+			_batch_data[i]._end = ga_min(count, (i + 1) * batch_size);
+			_batch_data[i]._params = params;
+
+			_batch_decls[i]._data = &_batch_data[i];
+			_batch_decls[i]._entry = [](void* data)
+			{
+				auto batch = static_cast<system_batch_t*>(data);
+				const system_t* system = batch->_system;
+				system->_thunk(system->_func, system->_pool, batch->_begin, batch->_end, batch->_params);
+			};
+		}
+
+		int32_t system_counter;
+		ga_job::run(_batch_decls.data(), int(batch_count), &system_counter);
+		ga_job::wait(&system_counter);
+	}
+}
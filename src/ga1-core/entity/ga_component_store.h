@@ -0,0 +1,129 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_component_pool.h"
+#include "ga_component_type.h"
+
+#include <cstdint>
+#include <vector>
+
+struct ga_frame_params;
+
+/*
+** Data-oriented component storage.
+**
+** Each component type lives in its own pool, indexed by its component type id.
+** Components stored here are plain data, not ga_component objects; their logic
+** lives in systems that are handed one contiguous range of a single type at a time.
+**
+** This sits alongside the virtual ga_component path so that component classes
+** can be moved over one at a time.
+** @see ga_component_pool
+** @see ga_sim
+*/
+class ga_component_store final
+{
+public:
+	/*
+	** Function that processes a contiguous run of components of one type.
+	** The entities array holds the owning entity id of each component.
+	*/
+	template<typename T>
+	using system_func_t = void(*)(T* components, const uint32_t* entities, uint32_t count, ga_frame_params* params);
+
+	ga_component_store();
+	~ga_component_store();
+
+	/*
+	** Get the pool for a component type, creating it if needed.
+	** Pools should be created from the main thread before jobs access them.
+	*/
+	template<typename T>
+	ga_component_pool<T>* get_pool()
+	{
+		ga_component_type_t type = ga_component_type::get<T>();
+		if (type >= _pools.size())
+		{
+			_pools.resize(type + 1, nullptr);
+		}
+		if (!_pools[type])
+		{
+			_pools[type] = new ga_component_pool<T>();
+		}
+		return static_cast<ga_component_pool<T>*>(_pools[type]);
+	}
+
+	template<typename T>
+	T* add(uint32_t entity, const T& value) { return get_pool<T>()->add(entity, value); }
+
+	template<typename T>
+	T* get(uint32_t entity) { return get_pool<T>()->get(entity); }
+
+	template<typename T>
+	void remove(uint32_t entity) { get_pool<T>()->remove(entity); }
+
+	/*
+	** Remove all components owned by an entity, from every pool.
+	*/
+	void remove_entity(uint32_t entity);
+
+	/*
+	** Register a system to run over every component of type T.
+	** Systems run in the order they were added.
+	*/
+	template<typename T>
+	void add_system(system_func_t<T> func)
+	{
+		system_t system;
+		system._pool = get_pool<T>();
+		system._func = reinterpret_cast<void(*)()>(func);
+		system._thunk = &run_system_range<T>;
+		_systems.push_back(system);
+	}
+
+	/*
+	** Run all systems. Each system's pool is split into batches that are
+	** executed in parallel on the job system; systems themselves run in order.
+	*/
+	void run_systems(ga_frame_params* params);
+
+private:
+	typedef void(*system_thunk_t)(void(*func)(), ga_component_pool_base* pool, uint32_t begin, uint32_t end, ga_frame_params* params);
+
+	struct system_t
+	{
+		ga_component_pool_base* _pool;
+		void(*_func)();
+		system_thunk_t _thunk;
+	};
+
+	struct system_batch_t
+	{
+		const system_t* _system;
+		uint32_t _begin;
+		uint32_t _end;
+		ga_frame_params* _params;
+	};
+
+	template<typename T>
+	static void run_system_range(void(*func)(), ga_component_pool_base* pool, uint32_t begin, uint32_t end, ga_frame_params* params)
+	{
+		auto typed_pool = static_cast<ga_component_pool<T>*>(pool);
+		auto typed_func = reinterpret_cast<system_func_t<T>>(func);
+		typed_func(typed_pool->data() + begin, typed_pool->entities() + begin, end - begin, params);
+	}
+
+	std::vector<ga_component_pool_base*> _pools;
+	std::vector<system_t> _systems;
+
+	std::vector<struct ga_job_decl_t> _batch_decls;
+	std::vector<system_batch_t> _batch_data;
+};
@@ -0,0 +1,24 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_component_type.h"
+
+#include <atomic>
+
+static std::atomic<uint32_t> s_component_type_count(0);
+
+uint32_t ga_component_type::get_count()
+{
+	return s_component_type_count.load(std::memory_order_acquire);
+}
+
+ga_component_type_t ga_component_type::next()
+{
+	return s_component_type_count.fetch_add(1, std::memory_order_acq_rel);
+}
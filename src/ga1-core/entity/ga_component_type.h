@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include <cstdint>
+
+typedef uint32_t ga_component_type_t;
+
+static const ga_component_type_t k_component_type_invalid = 0xffffffff;
+
+// Component class types beyond this are not indexed for lookup or batching.
+static const uint32_t k_max_component_types = 64;
+
+/*
+** How often the sim updates a component.
+** Lower tiers are spread evenly over the frames of their period and are given
+** the time accumulated since their last update as the frame's delta time.
+*/
+enum ga_update_tier_t
+{
+	k_update_every_frame,
+	k_update_every_2nd_frame,
+	k_update_every_4th_frame,
+	// Updated only on frames following a call to request_update(), seeing
+	// the time since the component was last updated or added.
+	k_update_on_demand,
+};
+
+/*
+** Assigns small, dense integer ids to component types.
+** Ids are handed out the first time a type is queried and are stable for the
+** life of the process. No RTTI is involved.
+*/
+class ga_component_type
+{
+public:
+	template<typename T>
+	static ga_component_type_t get()
+	{
+		static const ga_component_type_t s_id = next();
+		return s_id;
+	}
+
+	static uint32_t get_count();
+
+private:
+	static ga_component_type_t next();
+};
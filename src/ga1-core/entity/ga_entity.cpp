@@ -9,12 +9,16 @@
 
 #include "ga_entity.h"
 #include "ga_component.h"
-#include <typeinfo>
+
+#include "framework/ga_sim.h"
+
+#include <cassert>
 
 
 ga_entity::ga_entity()
 {
 	_transform.make_identity();
+	_world_transform.make_identity();
 }
 
 ga_entity::~ga_entity()
@@ -24,6 +28,31 @@ ga_entity::~ga_entity()
 void ga_entity::add_component(ga_component* comp)
 {
 	_components.push_back(comp);
+
+	ga_component_type_t type = comp->get_type();
+	assert(type == k_component_type_invalid || type < k_max_component_types);
+
+	if (_sim)
+	{
+		_sim->on_component_added(comp);
+	}
+
+	if (type >= k_max_component_types) return;
+
+	uint64_t bit = uint64_t(1) << type;
+	if (_component_mask & bit) return;
+
+	uint32_t slot = ga_popcount64(_component_mask & (bit - 1));
+	_typed_components.insert(_typed_components.begin() + slot, comp);
+	_component_mask |= bit;
+}
+
+void ga_entity::set_update_tier(ga_update_tier_t tier)
+{
+	for (auto& c : _components)
+	{
+		c->set_update_tier(tier);
+	}
 }
 
 void ga_entity::update(ga_frame_params* params)
@@ -45,6 +74,7 @@ void ga_entity::late_update(ga_frame_params* params)
 void ga_entity::translate(const ga_vec3f& translation)
 {
 	_transform.translate(translation);
+	on_local_transform_changed();
 }
 
 void ga_entity::rotate(const ga_quatf& rotation)
@@ -52,19 +82,53 @@ void ga_entity::rotate(const ga_quatf& rotation)
 	ga_mat4f rotation_m;
 	rotation_m.make_rotation(rotation);
 	_transform = rotation_m * _transform;
+	on_local_transform_changed();
+}
+
+void ga_entity::set_transform(const ga_mat4f& t)
+{
+	_transform = t;
+	on_local_transform_changed();
 }
 
-const ga_component* ga_entity::get_component(const char* name) {
-	for (int i = 0; i < _components.size(); i++) {
-		if (name == typeid(_components[i]).name()) {
-			return _components[i];
-		}
+void ga_entity::set_world_transform(const ga_mat4f& t)
+{
+	if (_parent)
+	{
+		_transform = t * _parent->get_transform().inverse();
 	}
-	return nullptr;
+	else
+	{
+		_transform = t;
+	}
+	on_local_transform_changed();
 }
 
-const ga_physics_component* ga_entity::get_physics_component()
+void ga_entity::set_parent(ga_entity* parent)
 {
-	return physComponent;
+#if !defined(NDEBUG)
+	for (ga_entity* p = parent; p; p = p->_parent)
+	{
+		assert(p != this);
+	}
+#endif
+
+	_parent = parent;
+	on_local_transform_changed();
+
+	if (_sim)
+	{
+		_sim->on_hierarchy_changed();
+	}
 }
 
+void ga_entity::on_local_transform_changed()
+{
+	// Root entities can refresh their world transform immediately.
+	// Children wait for the sim's transform pass, which has the parent chain in order.
+	if (!_parent)
+	{
+		_world_transform = _transform;
+	}
+	_transform_dirty = true;
+}
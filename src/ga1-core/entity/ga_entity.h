@@ -9,10 +9,13 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 
+#include "ga_component_type.h"
+
+#include "math/ga_math.h"
 #include "math/ga_mat4f.h"
 
+#include <cstdint>
 #include <vector>
-#include "physics/ga_physics_component.h"
 
 /*
 ** Entity object.
@@ -28,22 +31,89 @@ public:
 
 	void add_component(class ga_component* comp);
 
+	/*
+	** Set the update tier of all of the entity's components.
+	*/
+	void set_update_tier(ga_update_tier_t tier);
+
 	void update(struct ga_frame_params* params);
 	void late_update(struct ga_frame_params* params);
 
 	void translate(const struct ga_vec3f& translation);
 	void rotate(const struct ga_quatf& rotation);
 
-	const ga_mat4f& get_transform() const { return _transform; };
-	void set_transform(const ga_mat4f& t) { _transform = t; };
-	const ga_component* get_component(const char* name);
-	const ga_physics_component* get_physics_component();
+	/*
+	** Get the cached world transform.
+	** For entities with a parent this is refreshed by the sim's transform pass,
+	** so local changes to a child are visible in world space after the next pass.
+	*/
+	const ga_mat4f& get_transform() const { return _world_transform; };
+
+	/*
+	** Set the transform relative to the parent (or the world, for root entities).
+	*/
+	void set_transform(const ga_mat4f& t);
+	const ga_mat4f& get_local_transform() const { return _transform; };
+
+	/*
+	** Set the transform in world space, converting it into the parent's space.
+	*/
+	void set_world_transform(const ga_mat4f& t);
+
+	/*
+	** Attach this entity to a parent. The local transform is kept as is and
+	** becomes relative to the parent. Pass null to detach.
+	*/
+	void set_parent(ga_entity* parent);
+	ga_entity* get_parent() const { return _parent; }
+
+	/*
+	** Find the component of type T on this entity in constant time.
+	** Only components constructed with their type id can be found.
+	** @returns The first component of type T added, or null if there is none.
+	*/
+	template<typename T>
+	T* get_component() const
+	{
+		ga_component_type_t type = ga_component_type::get<T>();
+		if (type >= k_max_component_types) return nullptr;
+
+		uint64_t bit = uint64_t(1) << type;
+		if ((_component_mask & bit) == 0) return nullptr;
+
+		// Typed components are stored sorted by type, so the slot is the
+		// number of present types below this one.
+		return static_cast<T*>(_typed_components[ga_popcount64(_component_mask & (bit - 1))]);
+	}
+
+	template<typename T>
+	bool has_component() const { return get_component<T>() != nullptr; }
+
+	/*
+	** Id of the entity within its sim. Keys the entity's data-oriented
+	** components in the sim's component store.
+	** Ids of removed entities are reused.
+	*/
+	uint32_t get_id() const { return _id; }
+
 private:
 	std::vector<class ga_component*> _components;
-	class ga_physics_component* physComponent;
+
+	// Bit per component type present, and one component per set bit in type order.
+	uint64_t _component_mask = 0;
+	std::vector<class ga_component*> _typed_components;
 	ga_mat4f _transform;
-	void set_physics_component(ga_physics_component* p) { physComponent = p; };
+	ga_mat4f _world_transform;
+	ga_entity* _parent = nullptr;
+	bool _transform_dirty = false;
+
+	class ga_sim* _sim = nullptr;
+	uint32_t _id = 0xffffffff;
+
+	void on_local_transform_changed();
 
 	friend class ga_component;
-	friend class ga_physics_component;
+	friend class ga_entity_manager;
+	friend class ga_sim;
+	friend class ga_snapshot;
 };
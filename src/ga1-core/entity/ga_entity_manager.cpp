@@ -0,0 +1,139 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_entity_manager.h"
+#include "ga_component.h"
+#include "ga_entity.h"
+
+#include "framework/ga_sim.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+ga_entity_manager::ga_entity_manager(ga_sim* sim, uint32_t capacity) :
+	_sim(sim),
+	_capacity(capacity),
+	_free_slots(int(capacity)),
+	_count(0),
+	// Queues need one node on top of their contents.
+	_spawn_queue(int(capacity) + 1),
+	_despawn_queue(int(capacity) + 1)
+{
+	_entities = new ga_entity[capacity];
+	_generations = new uint32_t[capacity];
+	_despawning = new std::atomic<bool>[capacity];
+	for (uint32_t i = 0; i < capacity; ++i)
+	{
+		_generations[i] = 1;
+		_despawning[i] = false;
+	}
+}
+
+ga_entity_manager::~ga_entity_manager()
+{
+	for (uint32_t i = 0; i < _capacity; ++i)
+	{
+		for (auto c : _entities[i]._components)
+		{
+			delete c;
+		}
+	}
+
+	delete[] _despawning;
+	delete[] _generations;
+	delete[] _entities;
+}
+
+ga_entity_handle_t ga_entity_manager::spawn()
+{
+	// The int pool spins when empty, so guard it with the count.
+	if (_count.fetch_add(1, std::memory_order_acq_rel) >= _capacity)
+	{
+		_count.fetch_sub(1, std::memory_order_acq_rel);
+		return k_invalid_entity_handle;
+	}
+
+	uint32_t index = uint32_t(_free_slots.alloc());
+	_spawn_queue.push(&_entities[index]);
+
+	ga_entity_handle_t handle;
+	handle._index = index;
+	handle._generation = _generations[index];
+	return handle;
+}
+
+void ga_entity_manager::despawn(ga_entity_handle_t handle)
+{
+	if (!get(handle)) return;
+
+	// Only the first despawn of an entity queues it.
+	if (!_despawning[handle._index].exchange(true, std::memory_order_acq_rel))
+	{
+		_despawn_queue.push(&_entities[handle._index]);
+	}
+}
+
+ga_entity* ga_entity_manager::get(ga_entity_handle_t handle) const
+{
+	if (handle._index >= _capacity || _generations[handle._index] != handle._generation)
+	{
+		return nullptr;
+	}
+	return &_entities[handle._index];
+}
+
+void ga_entity_manager::sync()
+{
+	void* data;
+
+	// Add spawned entities in slot order, for a stable update order.
+	_sync_scratch.clear();
+	while (_spawn_queue.pop(&data))
+	{
+		_sync_scratch.push_back(static_cast<ga_entity*>(data));
+	}
+	std::sort(_sync_scratch.begin(), _sync_scratch.end());
+	for (auto ent : _sync_scratch)
+	{
+		_sim->add_entity(ent);
+	}
+
+	// Remove despawned entities from the sim in one pass before recycling them.
+	_sync_scratch.clear();
+	while (_despawn_queue.pop(&data))
+	{
+		_sync_scratch.push_back(static_cast<ga_entity*>(data));
+	}
+	if (_sync_scratch.empty()) return;
+
+	_sim->remove_entities(_sync_scratch.data(), uint32_t(_sync_scratch.size()));
+
+	for (auto ent : _sync_scratch)
+	{
+		uint32_t index = uint32_t(ent - _entities);
+
+		for (auto c : ent->_components)
+		{
+			delete c;
+		}
+		ent->~ga_entity();
+		new (ent) ga_entity();
+
+		_generations[index]++;
+		if (_generations[index] == 0)
+		{
+			_generations[index] = 1;
+		}
+		_despawning[index] = false;
+
+		_free_slots.free(int(index));
+		_count.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
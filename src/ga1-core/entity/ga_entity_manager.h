@@ -0,0 +1,98 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "jobs/ga_intpool.h"
+#include "jobs/ga_queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/*
+** Reference to a pooled entity.
+** The generation is bumped whenever a slot is recycled, so a handle to a
+** despawned entity no longer resolves, even after its slot is reused.
+*/
+struct ga_entity_handle_t
+{
+	uint32_t _index;
+	uint32_t _generation;
+
+	bool operator==(const ga_entity_handle_t& other) const { return _index == other._index && _generation == other._generation; }
+	bool operator!=(const ga_entity_handle_t& other) const { return !(*this == other); }
+};
+
+// Generations start at 1, so a zeroed handle is never valid.
+static const ga_entity_handle_t k_invalid_entity_handle = { 0xffffffff, 0 };
+
+static const uint32_t k_default_pooled_entity_capacity = 1024;
+
+/*
+** Pool of entities that can be created and destroyed at runtime.
+**
+** Spawn and despawn are lock-free and may be called from jobs. Neither takes
+** effect in the sim immediately: both are queued and applied by sync(), which
+** the sim calls at the start of its update. Spawned entities are added to the
+** sim in slot order, so update order does not depend on which job spawned first.
+**
+** Pooled entities own their components. Components added to a pooled entity
+** must be allocated with new; they are deleted when the entity is despawned.
+** @see ga_sim
+*/
+class ga_entity_manager final
+{
+public:
+	ga_entity_manager(class ga_sim* sim, uint32_t capacity);
+	~ga_entity_manager();
+
+	/*
+	** Reserve an entity. It can be given components right away, and joins
+	** the sim at the next sync.
+	** @returns k_invalid_entity_handle if the pool is full.
+	*/
+	ga_entity_handle_t spawn();
+
+	/*
+	** Queue an entity for destruction at the next sync.
+	** Stale handles and repeated despawns are ignored.
+	*/
+	void despawn(ga_entity_handle_t handle);
+
+	/*
+	** Resolve a handle.
+	** @returns Null if the entity has been destroyed.
+	*/
+	class ga_entity* get(ga_entity_handle_t handle) const;
+
+	/*
+	** Apply queued spawns and despawns. Main thread only, outside of updates.
+	*/
+	void sync();
+
+	uint32_t get_capacity() const { return _capacity; }
+	uint32_t get_count() const { return _count.load(std::memory_order_relaxed); }
+
+private:
+	class ga_sim* _sim;
+	uint32_t _capacity;
+
+	class ga_entity* _entities;
+	uint32_t* _generations;
+	std::atomic<bool>* _despawning;
+
+	ga_intpool _free_slots;
+	std::atomic<uint32_t> _count;
+
+	ga_queue _spawn_queue;
+	ga_queue _despawn_queue;
+
+	std::vector<class ga_entity*> _sync_scratch;
+};
@@ -0,0 +1,109 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_entity_manager.tests.h"
+#include "ga_component.h"
+#include "ga_entity.h"
+#include "ga_entity_manager.h"
+
+#include "framework/ga_sim.h"
+
+#include <cassert>
+
+/*
+** Counts how many of its kind have been destroyed.
+*/
+class ga_entity_manager_test_component final : public ga_component
+{
+public:
+	ga_entity_manager_test_component(ga_entity* ent, uint32_t* destroyed) : ga_component(ent), _destroyed(destroyed) {}
+	virtual ~ga_entity_manager_test_component() { (*_destroyed)++; }
+
+private:
+	uint32_t* _destroyed;
+};
+
+static void test_entity_manager_deferred()
+{
+	ga_sim sim(4);
+	ga_entity_manager* manager = sim.get_entity_manager();
+	uint32_t destroyed = 0;
+
+	ga_entity_handle_t handle = manager->spawn();
+	assert(handle != k_invalid_entity_handle);
+	assert(manager->get(handle) != nullptr);
+	assert(manager->get_count() == 1);
+	new ga_entity_manager_test_component(manager->get(handle), &destroyed);
+	manager->sync();
+
+	// Despawning only queues the entity; it lives until the next sync.
+	manager->despawn(handle);
+	manager->despawn(handle);
+	assert(manager->get(handle) != nullptr);
+	assert(destroyed == 0);
+	assert(manager->get_count() == 1);
+
+	manager->sync();
+	assert(manager->get(handle) == nullptr);
+	assert(destroyed == 1);
+	assert(manager->get_count() == 0);
+
+	// Nothing is left queued.
+	manager->sync();
+	assert(destroyed == 1);
+
+	assert(manager->get(k_invalid_entity_handle) == nullptr);
+}
+
+static void test_entity_manager_recycle()
+{
+	// One slot, so every spawn reuses it.
+	ga_sim sim(1);
+	ga_entity_manager* manager = sim.get_entity_manager();
+	uint32_t destroyed = 0;
+
+	ga_entity_handle_t first = manager->spawn();
+	assert(first != k_invalid_entity_handle);
+	assert(manager->spawn() == k_invalid_entity_handle);
+	manager->sync();
+
+	manager->despawn(first);
+	manager->sync();
+
+	ga_entity_handle_t second = manager->spawn();
+	assert(second._index == first._index);
+	assert(second._generation != first._generation);
+	assert(manager->get(first) == nullptr);
+	assert(manager->get(second) != nullptr);
+	new ga_entity_manager_test_component(manager->get(second), &destroyed);
+	manager->sync();
+
+	// A stale handle must not reach the entity now in its slot.
+	manager->despawn(first);
+	manager->sync();
+	assert(manager->get(second) != nullptr);
+	assert(destroyed == 0);
+
+	manager->despawn(second);
+	manager->sync();
+	assert(manager->get(second) == nullptr);
+	assert(destroyed == 1);
+
+	// The slot is free again.
+	ga_entity_handle_t third = manager->spawn();
+	assert(third != k_invalid_entity_handle);
+	assert(manager->get(second) == nullptr);
+	manager->sync();
+}
+
+void ga_entity_manager_unit_tests()
+{
+	test_entity_manager_deferred();
+	test_entity_manager_recycle();
+}
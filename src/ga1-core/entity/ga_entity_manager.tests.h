@@ -0,0 +1,16 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Check handles go stale when their entity is destroyed, even once its
+** slot is reused, and that spawns and despawns wait for sync.
+*/
+void ga_entity_manager_unit_tests();
@@ -9,7 +9,7 @@
 
 #include "ga_hello_component.h"
 
-ga_hello_component::ga_hello_component(ga_entity* ent, const char* name) : ga_component(ent), _name(name)
+ga_hello_component::ga_hello_component(ga_entity* ent, const char* name) : ga_component(ent, ga_component_type::get<ga_hello_component>()), _name(name)
 {
 }
 
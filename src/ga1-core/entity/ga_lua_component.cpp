@@ -11,15 +11,30 @@
 
 #include "entity/ga_entity.h"
 #include "framework/ga_frame_params.h"
+#include "framework/ga_snapshot.h"
+#include "physics/ga_physics_component.h"
 #include "physics/ga_rigid_body.h"
 
 #include <lua.hpp>
 
 #include <cassert>
+#include <chrono>
 #include <iostream>
 #include <string>
 
-ga_lua_component::ga_lua_component(ga_entity* ent, const char* path) : ga_component(ent)
+// Type tags of values saved from a script's state table.
+enum ga_lua_value_t
+{
+	k_lua_value_integer,
+	k_lua_value_number,
+	k_lua_value_boolean,
+	k_lua_value_string,
+};
+
+// Entry count saved when a script has no state table.
+static const uint32_t k_lua_no_state = 0xffffffff;
+
+ga_lua_component::ga_lua_component(ga_entity* ent, const char* path) : ga_component(ent, ga_component_batched<ga_lua_component>::get_type())
 {
 	_lua = luaL_newstate();
 	luaL_openlibs(_lua);
@@ -41,6 +56,7 @@ ga_lua_component::ga_lua_component(ga_entity* ent, const char* path) : ga_compon
 	lua_register(_lua, "frame_params_get_input_down_R", lua_frame_params_get_input_down_R);
 	lua_register(_lua, "frame_params_get_input_up_L", lua_frame_params_get_input_up_L);
 	lua_register(_lua, "frame_params_get_input_down_L", lua_frame_params_get_input_down_L);
+	lua_register(_lua, "frame_params_get_delta_time", lua_frame_params_get_delta_time);
 	lua_register(_lua, "component_get_entity", lua_component_get_entity);
 	lua_register(_lua, "entity_translate", lua_entity_translate);
 	lua_register(_lua, "entity_set_velocity", lua_entity_set_velocity);
@@ -69,6 +85,15 @@ void ga_lua_component::update(ga_frame_params* params)
 	}
 }
 
+void ga_lua_component::update_batch(ga_lua_component* const* components, uint32_t count, ga_frame_params* params)
+{
+	// Each component owns its own Lua state; skip the virtual dispatch.
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		components[i]->ga_lua_component::update(params);
+	}
+}
+
 int ga_lua_component::lua_frame_params_get_input_left(lua_State* state)
 {
 	int arg_count = lua_gettop(state);
@@ -117,6 +142,13 @@ int ga_lua_component::lua_frame_params_get_input_down_L(lua_State* state)
 	return 1;
 }
 
+int ga_lua_component::lua_frame_params_get_delta_time(lua_State* state)
+{
+	ga_frame_params* params = (ga_frame_params*)lua_touserdata(state, 1);
+	lua_pushnumber(state, std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count());
+	return 1;
+}
+
 int ga_lua_component::lua_component_get_entity(lua_State* state)
 {
 	int arg_count = lua_gettop(state);
@@ -127,13 +159,6 @@ int ga_lua_component::lua_component_get_entity(lua_State* state)
 	return 1;
 }
 
-float ga_lua_component::lua_frame_params_get_stick_input_L(lua_State* state) {
-	int arg_count = lua_gettop(state);
-	ga_lua_component* component = (ga_lua_component*)lua_touserdata(state, 1);
-	ga_entity* entity = component->get_entity();
-}
-
-
 int ga_lua_component::lua_entity_translate(lua_State* state)
 {
 	int arg_count = lua_gettop(state);
@@ -160,6 +185,157 @@ int ga_lua_component::lua_entity_set_velocity(lua_State* state) {
 	vec.y = (float)lua_tonumber(state, 3);
 	vec.z = (float)lua_tonumber(state, 4);
 
-	ent->get_physics_component()->get_rigid_body()->set_linear_velocity(vec);
+	ga_physics_component* physics = ent->get_component<ga_physics_component>();
+	if (physics)
+	{
+		physics->get_rigid_body()->set_linear_velocity(vec);
+	}
 	return 0;
-}
\ No newline at end of file
+}
+
+static bool is_saved_entry(lua_State* state)
+{
+	int key_type = lua_type(state, -2);
+	int value_type = lua_type(state, -1);
+	return (key_type == LUA_TNUMBER || key_type == LUA_TSTRING) &&
+		(value_type == LUA_TNUMBER || value_type == LUA_TSTRING || value_type == LUA_TBOOLEAN);
+}
+
+void ga_lua_component::save_state(ga_snapshot* snapshot) const
+{
+	if (!_lua)
+	{
+		snapshot->write(k_lua_no_state);
+		return;
+	}
+
+	lua_getglobal(_lua, "state");
+	if (!lua_istable(_lua, -1))
+	{
+		lua_pop(_lua, 1);
+		snapshot->write(k_lua_no_state);
+		return;
+	}
+
+	uint32_t count = 0;
+	lua_pushnil(_lua);
+	while (lua_next(_lua, -2))
+	{
+		if (is_saved_entry(_lua)) count++;
+		lua_pop(_lua, 1);
+	}
+	snapshot->write(count);
+
+	lua_pushnil(_lua);
+	while (lua_next(_lua, -2))
+	{
+		if (is_saved_entry(_lua))
+		{
+			save_value(_lua, -2, snapshot);
+			save_value(_lua, -1, snapshot);
+		}
+		lua_pop(_lua, 1);
+	}
+	lua_pop(_lua, 1);
+}
+
+bool ga_lua_component::load_state(ga_snapshot* snapshot)
+{
+	uint32_t count;
+	if (!snapshot->read(count)) return false;
+	if (count == k_lua_no_state) return true;
+	if (!_lua) return false;
+
+	lua_createtable(_lua, 0, int(count));
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (!load_value(_lua, snapshot) || !load_value(_lua, snapshot))
+		{
+			lua_settop(_lua, 0);
+			return false;
+		}
+		lua_rawset(_lua, -3);
+	}
+	lua_setglobal(_lua, "state");
+	return true;
+}
+
+bool ga_lua_component::save_value(lua_State* state, int index, ga_snapshot* snapshot)
+{
+	switch (lua_type(state, index))
+	{
+	case LUA_TNUMBER:
+		if (lua_isinteger(state, index))
+		{
+			snapshot->write(uint8_t(k_lua_value_integer));
+			snapshot->write(int64_t(lua_tointeger(state, index)));
+		}
+		else
+		{
+			snapshot->write(uint8_t(k_lua_value_number));
+			snapshot->write(double(lua_tonumber(state, index)));
+		}
+		return true;
+
+	case LUA_TBOOLEAN:
+		snapshot->write(uint8_t(k_lua_value_boolean));
+		snapshot->write(uint8_t(lua_toboolean(state, index) ? 1 : 0));
+		return true;
+
+	case LUA_TSTRING:
+	{
+		size_t length;
+		const char* string = lua_tolstring(state, index, &length);
+		snapshot->write(uint8_t(k_lua_value_string));
+		snapshot->write(uint32_t(length));
+		snapshot->write(string, length);
+		return true;
+	}
+	}
+	return false;
+}
+
+bool ga_lua_component::load_value(lua_State* state, ga_snapshot* snapshot)
+{
+	uint8_t type;
+	if (!snapshot->read(type)) return false;
+
+	switch (type)
+	{
+	case k_lua_value_integer:
+	{
+		int64_t value;
+		if (!snapshot->read(value)) return false;
+		lua_pushinteger(state, lua_Integer(value));
+		return true;
+	}
+
+	case k_lua_value_number:
+	{
+		double value;
+		if (!snapshot->read(value)) return false;
+		lua_pushnumber(state, lua_Number(value));
+		return true;
+	}
+
+	case k_lua_value_boolean:
+	{
+		uint8_t value;
+		if (!snapshot->read(value)) return false;
+		lua_pushboolean(state, value);
+		return true;
+	}
+
+	case k_lua_value_string:
+	{
+		uint32_t length;
+		if (!snapshot->read(length)) return false;
+
+		std::string value(length, '\0');
+		if (length && !snapshot->read(&value[0], length)) return false;
+		lua_pushlstring(state, value.data(), length);
+		return true;
+	}
+	}
+	return false;
+}
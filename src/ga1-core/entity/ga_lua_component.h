@@ -13,6 +13,10 @@
 
 /*
 ** A component whose logic is implemented in LUA.
+**
+** Scripts keep anything that should survive a snapshot and restore in a
+** global table named state. Its string and number keys and its number,
+** boolean and string values are saved; other values are skipped.
 */
 class ga_lua_component : public ga_component
 {
@@ -22,6 +26,11 @@ public:
 
 	virtual void update(struct ga_frame_params* params) override;
 
+	static void update_batch(ga_lua_component* const* components, uint32_t count, struct ga_frame_params* params);
+
+	virtual void save_state(class ga_snapshot* snapshot) const override;
+	virtual bool load_state(class ga_snapshot* snapshot) override;
+
 private:
 	static int lua_frame_params_get_input_left(struct lua_State* state);
 	static int lua_frame_params_get_input_right(struct lua_State* state);
@@ -29,9 +38,13 @@ private:
 	static int lua_frame_params_get_input_up_L(struct lua_State* state);
 	static int lua_frame_params_get_input_down_R(struct lua_State* state);
 	static int lua_frame_params_get_input_down_L(struct lua_State* state);
+	static int lua_frame_params_get_delta_time(struct lua_State* state);
 	static int lua_component_get_entity(struct lua_State* state);
 	static int lua_entity_translate(struct lua_State* state);
 	static int lua_entity_set_velocity(struct lua_State* state);
 
+	static bool save_value(struct lua_State* state, int index, class ga_snapshot* snapshot);
+	static bool load_value(struct lua_State* state, class ga_snapshot* snapshot);
+
 	struct lua_State* _lua;
 };
@@ -1,9 +1,32 @@
-#pragma once
 #include "ga_pong_manager.h"
 
-ga_pong_manager::ga_pong_manager(class ga_entity* ent, ga_entity* left, ga_entity* right, ga_entity* _ball, int maxPoints){
+#include "entity/ga_entity.h"
+#include "framework/ga_snapshot.h"
+#include "math/ga_math.h"
+#include "physics/ga_physics_component.h"
+#include "physics/ga_rigid_body.h"
 
-	ga_component(ent);
+// How far past a paddle the ball must travel before a point is scored.
+static const float k_goal_margin = 2.0f;
+
+// Speed of the ball when it is served after a point.
+static const float k_serve_speed = 10.0f;
+
+// Serves go up or down by turns, this much as fast as across.
+static const float k_serve_slope = 0.5f;
+
+// Each return off a paddle speeds the ball across by this much, up to a limit.
+static const float k_rally_speed_up = 1.05f;
+static const float k_max_ball_speed = 30.0f;
+
+// Half the height of the scene's paddles, and the upward speed added to
+// the ball for hitting a paddle that far above its middle.
+static const float k_paddle_half_height = 4.0f;
+static const float k_paddle_english = 6.0f;
+
+ga_pong_manager::ga_pong_manager(class ga_entity* ent, ga_entity* left, ga_entity* right, ga_entity* _ball, int maxPoints)
+	: ga_component(ent, ga_component_type::get<ga_pong_manager>())
+{
 	left_paddle = left;
 	right_paddle = right;
 	ball = _ball;
@@ -16,11 +39,73 @@ ga_pong_manager::ga_pong_manager(class ga_entity* ent, ga_entity* left, ga_entit
 	}
 	left_score = 0;
 	right_score = 0;
-	
+
+	// Keep whatever velocity the scene gave the ball.
+	ball_velocity = ga_vec3f::zero_vector();
+	ga_physics_component* physics = ball->get_component<ga_physics_component>();
+	if (physics) {
+		ball_velocity = physics->get_rigid_body()->get_linear_velocity();
+	}
 }
 
 ga_pong_manager::~ga_pong_manager() {
-	~ga_component();
+}
+
+void ga_pong_manager::update(ga_frame_params* params)
+{
+	float ball_x = ball->get_transform().get_translation().x;
+
+	if (ball_x > right_paddle->get_transform().get_translation().x + k_goal_margin) {
+		ScorePoint(true);
+		reset_ball(false);
+	}
+	else if (ball_x < left_paddle->get_transform().get_translation().x - k_goal_margin) {
+		ScorePoint(false);
+		reset_ball(true);
+	}
+	else {
+		steer_ball();
+	}
+}
+
+void ga_pong_manager::steer_ball()
+{
+	ga_physics_component* physics = ball->get_component<ga_physics_component>();
+	if (!physics) {
+		return;
+	}
+
+	// The contact solver has turned the ball around since last frame if it
+	// hit something; redo the bounce the way pong would.
+	ga_rigid_body* body = physics->get_rigid_body();
+	ga_vec3f velocity = body->get_linear_velocity();
+	if (velocity.x * ball_velocity.x < 0.0f) {
+		ga_entity* paddle = velocity.x > 0.0f ? left_paddle : right_paddle;
+		float offset = ball->get_transform().get_translation().y - paddle->get_transform().get_translation().y;
+		offset = ga_max(-1.0f, ga_min(offset / k_paddle_half_height, 1.0f));
+
+		float speed = ga_min(ga_absf(ball_velocity.x) * k_rally_speed_up, k_max_ball_speed);
+		ball_velocity.x = velocity.x > 0.0f ? speed : -speed;
+		ball_velocity.y = ga_max(-speed, ga_min(ball_velocity.y + offset * k_paddle_english, speed));
+	}
+	else if (velocity.y * ball_velocity.y < 0.0f) {
+		ball_velocity.y = -ball_velocity.y;
+	}
+	ball_velocity.z = 0.0f;
+
+	body->set_linear_velocity(ball_velocity);
+}
+
+void ga_pong_manager::save_state(ga_snapshot* snapshot) const
+{
+	snapshot->write(left_score);
+	snapshot->write(right_score);
+	snapshot->write(ball_velocity);
+}
+
+bool ga_pong_manager::load_state(ga_snapshot* snapshot)
+{
+	return snapshot->read(left_score) && snapshot->read(right_score) && snapshot->read(ball_velocity);
 }
 
 void ga_pong_manager::ScorePoint(bool left) {
@@ -49,10 +134,20 @@ void ga_pong_manager::end_game()
 
 
 
-void ga_pong_manager::reset_ball() {
-	ga_vec3f position;
-	position.x = 0;
-	position.y = 0;
-	position.z = 0;
-	ball->translate(position);
-}
\ No newline at end of file
+void ga_pong_manager::reset_ball(bool serve_left) {
+	ga_mat4f transform = ball->get_transform();
+	transform.set_translation(ga_vec3f::zero_vector());
+	ball->set_world_transform(transform);
+
+	// Serve toward the player who just lost the point.
+	float slope = (left_score + right_score) % 2 ? k_serve_slope : -k_serve_slope;
+	ball_velocity = { serve_left ? -k_serve_speed : k_serve_speed, slope * k_serve_speed, 0.0f };
+
+	// The body is moved too, or the physics would put the ball back where
+	// it was once the frame is over.
+	ga_physics_component* physics = ball->get_component<ga_physics_component>();
+	if (physics) {
+		physics->get_rigid_body()->set_transform(transform);
+		physics->get_rigid_body()->set_linear_velocity(ball_velocity);
+	}
+}
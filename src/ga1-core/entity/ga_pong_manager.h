@@ -3,6 +3,14 @@
 #include "entity/ga_component.h"
 #include "math/ga_vec3f.h"
 #include "math/ga_mat4f.h"
+
+/*
+** Keeps score and resets the ball when it gets past a paddle.
+**
+** The ball is steered here rather than left to the physics, which only
+** reports its hits: it keeps its speed, bounces cleanly off the walls and
+** comes back off a paddle a little faster, angled by where it hit.
+*/
 class ga_pong_manager : public ga_component {
 
 public:
@@ -10,9 +18,17 @@ public:
 	~ga_pong_manager();
 	void ScorePoint(bool left);
 	void end_game();
-	void reset_ball();
+	void reset_ball(bool serve_left);
+	void steer_ball();
 	virtual void update(struct ga_frame_params* params) override;
 
+	int get_left_score() const { return left_score; }
+	int get_right_score() const { return right_score; }
+	bool is_game_over() const { return left_score >= points_to_win || right_score >= points_to_win; }
+
+	virtual void save_state(class ga_snapshot* snapshot) const override;
+	virtual bool load_state(class ga_snapshot* snapshot) override;
+
 
 
 private:
@@ -23,4 +39,7 @@ private:
 	int left_score;
 	int right_score;
 	int points_to_win;
+
+	// Velocity given to the ball last frame, to spot when it has bounced.
+	ga_vec3f ball_velocity;
 };
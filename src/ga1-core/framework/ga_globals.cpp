@@ -0,0 +1,52 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_globals.h"
+#include "ga_compiler_defines.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <stb_truetype.h>
+
+#include <cstring>
+
+#if defined(GA_MINGW)
+#include <unistd.h>
+#endif
+
+ga_font* g_font = nullptr;
+
+char g_root_path[256];
+void ga_set_root_path(const char* exepath)
+{
+#if defined(GA_MSVC)
+	strcpy_s(g_root_path, sizeof(g_root_path), exepath);
+
+	// Strip the executable file name off the end of the path:
+	char* slash = strrchr(g_root_path, '\\');
+	if (!slash)
+	{
+		slash = strrchr(g_root_path, '/');
+	}
+	if (slash)
+	{
+		slash[1] = '\0';
+	}
+#elif defined(GA_MINGW)
+	char* cwd;
+	char buf[PATH_MAX + 1];
+	cwd = getcwd(buf, PATH_MAX + 1);
+	strcpy_s(g_root_path, sizeof(g_root_path), cwd);
+
+	g_root_path[strlen(cwd)] = '/';
+	g_root_path[strlen(cwd) + 1] = '\0';
+#endif
+}
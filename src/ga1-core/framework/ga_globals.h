@@ -0,0 +1,26 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Process-wide state shared by the game and the headless host.
+** Both are read-only once startup is done.
+*/
+
+// Directory data files are loaded relative to, ending in a separator.
+extern char g_root_path[256];
+
+// Default font, created by the game once it has a window.
+extern class ga_font* g_font;
+
+/*
+** Set the data root from the path of the executable.
+*/
+void ga_set_root_path(const char* exepath);
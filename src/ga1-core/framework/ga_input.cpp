@@ -11,6 +11,7 @@
 #include "ga_compiler_defines.h"
 #include "ga_frame_params.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #if defined(GA_MINGW)
@@ -24,7 +25,49 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 
-ga_input::ga_input() : _paused(false)
+// Events held between being taken from the window and consumed by a frame.
+static const uint32_t k_input_ring_capacity = 1024;
+
+static uint64_t button_of_key(SDL_Keycode key)
+{
+	switch (key)
+	{
+	case SDLK_LEFT: return k_button_left;
+	case SDLK_RIGHT: return k_button_right;
+	case SDLK_UP: return k_button_up;
+	case SDLK_DOWN: return k_button_down;
+	case SDLK_SPACE: return k_button_space;
+	case SDLK_a: return k_button_a;
+	case SDLK_b: return k_button_b;
+	case SDLK_c: return k_button_c;
+	case SDLK_d: return k_button_d;
+	case SDLK_e: return k_button_e;
+	case SDLK_f: return k_button_f;
+	case SDLK_g: return k_button_g;
+	case SDLK_h: return k_button_h;
+	case SDLK_i: return k_button_i;
+	case SDLK_j: return k_button_j;
+	case SDLK_k: return k_button_k;
+	case SDLK_l: return k_button_l;
+	case SDLK_m: return k_button_m;
+	case SDLK_n: return k_button_n;
+	case SDLK_o: return k_button_o;
+	case SDLK_p: return k_button_p;
+	case SDLK_q: return k_button_q;
+	case SDLK_r: return k_button_r;
+	case SDLK_s: return k_button_s;
+	case SDLK_t: return k_button_t;
+	case SDLK_u: return k_button_u;
+	case SDLK_v: return k_button_v;
+	case SDLK_w: return k_button_w;
+	case SDLK_x: return k_button_x;
+	case SDLK_y: return k_button_y;
+	case SDLK_z: return k_button_z;
+	default: return 0;
+	}
+}
+
+ga_input::ga_input() : _events(k_input_ring_capacity), _paused(false), _quit(false)
 {
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_TIMER);
 
@@ -64,10 +107,15 @@ ga_input::ga_input() : _paused(false)
 	}
 
 	_button_mask = 0;
+	_pressed_mask = 0;
+	_unreported_pressed_mask = 0;
+	_unreported_click_mask = 0;
 	_mouse_button_mask = 0;
 	_mouse_x = 0.0f;
 	_mouse_y = 0.0f;
 	_last_time = std::chrono::high_resolution_clock::now();
+	_sdl_epoch = _last_time - std::chrono::milliseconds(SDL_GetTicks());
+	_last_event_time = _sdl_epoch;
 }
 
 ga_input::~ga_input()
@@ -78,125 +126,6 @@ ga_input::~ga_input()
 
 bool ga_input::update(ga_frame_params* params)
 {
-	bool result = true;
-
-	// Save the previous frame's button mask to computed released keys.
-	uint64_t previous_button_mask = _button_mask;
-	params->_mouse_click_mask = 0;
-
-	// Process events. Gather button status.
-	SDL_Event event;
-	while (SDL_PollEvent(&event))
-	{
-		switch (event.type)
-		{
-		case SDL_MOUSEMOTION:
-			_mouse_x = (float)event.motion.x;
-			_mouse_y = (float)event.motion.y;
-			break;
-		case SDL_MOUSEBUTTONDOWN:
-			_mouse_button_mask |= uint64_t(1) << event.button.button;
-			break;
-		case SDL_MOUSEBUTTONUP:
-			_mouse_button_mask &= ~(uint64_t(1) << event.button.button);
-			params->_mouse_click_mask |= uint64_t(1) << event.button.button;
-			break;
-		case SDL_KEYDOWN:
-			switch (event.key.keysym.sym)
-			{
-			case SDLK_LEFT: _button_mask |= k_button_left; break;
-			case SDLK_RIGHT: _button_mask |= k_button_right; break;
-			case SDLK_UP: _button_mask |= k_button_up; break;
-			case SDLK_DOWN: _button_mask |= k_button_down; break;
-			case SDLK_SPACE: _button_mask |= k_button_space; break;
-			case SDLK_a: _button_mask |= k_button_a; break;
-			case SDLK_b: _button_mask |= k_button_b; break;
-			case SDLK_c: _button_mask |= k_button_c; break;
-			case SDLK_d: _button_mask |= k_button_d; break;
-			case SDLK_e: _button_mask |= k_button_e; break;
-			case SDLK_f: _button_mask |= k_button_f; break;
-			case SDLK_g: _button_mask |= k_button_g; break;
-			case SDLK_h: _button_mask |= k_button_h; break;
-			case SDLK_i: _button_mask |= k_button_i; break;
-			case SDLK_j: _button_mask |= k_button_j; break;
-			case SDLK_k: _button_mask |= k_button_k; break;
-			case SDLK_l: _button_mask |= k_button_l; break;
-			case SDLK_m: _button_mask |= k_button_m; break;
-			case SDLK_n: _button_mask |= k_button_n; break;
-			case SDLK_o: _button_mask |= k_button_o; break;
-			case SDLK_p: _button_mask |= k_button_p; break;
-			case SDLK_q: _button_mask |= k_button_q; break;
-			case SDLK_r: _button_mask |= k_button_r; break;
-			case SDLK_s: _button_mask |= k_button_s; break;
-			case SDLK_t: _button_mask |= k_button_t; break;
-			case SDLK_u: _button_mask |= k_button_u; break;
-			case SDLK_v: _button_mask |= k_button_v; break;
-			case SDLK_w: _button_mask |= k_button_w; break;
-			case SDLK_x: _button_mask |= k_button_x; break;
-			case SDLK_y: _button_mask |= k_button_y; break;
-			case SDLK_z: _button_mask |= k_button_z; break;
-			default: break;
-			}
-			break;
-		case SDL_KEYUP:
-			switch (event.key.keysym.sym)
-			{
-			case SDLK_LEFT: _button_mask &= ~k_button_left; break;
-			case SDLK_RIGHT: _button_mask &= ~k_button_right; break;
-			case SDLK_UP: _button_mask &= ~k_button_up; break;
-			case SDLK_DOWN: _button_mask &= ~k_button_down; break;
-			case SDLK_SPACE: _button_mask &= ~k_button_space; break;
-			case SDLK_a: _button_mask &= ~k_button_a; break;
-			case SDLK_b: _button_mask &= ~k_button_b; break;
-			case SDLK_c: _button_mask &= ~k_button_c; break;
-			case SDLK_d: _button_mask &= ~k_button_d; break;
-			case SDLK_e: _button_mask &= ~k_button_e; break;
-			case SDLK_f: _button_mask &= ~k_button_f; break;
-			case SDLK_g: _button_mask &= ~k_button_g; break;
-			case SDLK_h: _button_mask &= ~k_button_h; break;
-			case SDLK_i: _button_mask &= ~k_button_i; break;
-			case SDLK_j: _button_mask &= ~k_button_j; break;
-			case SDLK_k: _button_mask &= ~k_button_k; break;
-			case SDLK_l: _button_mask &= ~k_button_l; break;
-			case SDLK_m: _button_mask &= ~k_button_m; break;
-			case SDLK_n: _button_mask &= ~k_button_n; break;
-			case SDLK_o: _button_mask &= ~k_button_o; break;
-			case SDLK_p: _button_mask &= ~k_button_p; break;
-			case SDLK_q: _button_mask &= ~k_button_q; break;
-			case SDLK_r: _button_mask &= ~k_button_r; break;
-			case SDLK_s: _button_mask &= ~k_button_s; break;
-			case SDLK_t: _button_mask &= ~k_button_t; break;
-			case SDLK_u: _button_mask &= ~k_button_u; break;
-			case SDLK_v: _button_mask &= ~k_button_v; break;
-			case SDLK_w: _button_mask &= ~k_button_w; break;
-			case SDLK_x: _button_mask &= ~k_button_x; break;
-			case SDLK_y: _button_mask &= ~k_button_y; break;
-			case SDLK_z: _button_mask &= ~k_button_z; break;
-			default: break;
-			}
-			break;
-		case SDL_QUIT:
-			result = false;
-			break;
-		default:
-			break;
-		}
-	}
-
-	_pressed_mask = _button_mask & ~previous_button_mask;
-	_released_mask = previous_button_mask & ~_button_mask;
-
-	params->_button_mask = _button_mask;
-	params->_mouse_press_mask = _mouse_button_mask;
-	params->_mouse_x = _mouse_x;
-	params->_mouse_y = _mouse_y;
-
-	// Toggle pause if the p key is pressed.
-	if (_pressed_mask & k_button_p)
-	{
-		_paused = !_paused;
-	}
-
 	// Update time. Cap frame rate at ~60 fps.
 	auto t0 = _last_time;
 	auto t1 = std::chrono::high_resolution_clock::now();
@@ -214,9 +143,22 @@ bool ga_input::update(ga_frame_params* params)
 #endif
 	}
 
+	// Take in everything that happened up to the frame's time.
+	poll();
 	t1 = std::chrono::high_resolution_clock::now();
 	_last_time = t1;
 
+	consume(t1);
+
+	params->_mouse_click_mask = 0;
+	write_params(params);
+
+	// Toggle pause if the p key is pressed.
+	if (_pressed_mask & k_button_p)
+	{
+		_paused = !_paused;
+	}
+
 	params->_current_time = t1;
 	params->_delta_time = t1 - t0;
 	
@@ -238,5 +180,125 @@ bool ga_input::update(ga_frame_params* params)
 		params->_single_step = true;
 	}
 
-	return result;
+	// Presses late_latch() takes in after this are kept for the next frame's
+	// controls, so none are missed.
+	_pressed_mask = 0;
+
+	return !_quit;
+}
+
+void ga_input::late_latch(ga_frame_params* params)
+{
+	poll();
+	consume(std::chrono::high_resolution_clock::now());
+	write_params(params);
+}
+
+void ga_input::poll()
+{
+	auto now = std::chrono::high_resolution_clock::now();
+
+	SDL_Event sdl_event;
+	while (SDL_PollEvent(&sdl_event))
+	{
+		ga_input_event_t event;
+		event._bit = 0;
+		event._x = 0.0f;
+		event._y = 0.0f;
+
+		switch (sdl_event.type)
+		{
+		case SDL_MOUSEMOTION:
+			event._type = k_input_event_mouse_move;
+			event._x = (float)sdl_event.motion.x;
+			event._y = (float)sdl_event.motion.y;
+			break;
+		case SDL_MOUSEBUTTONDOWN:
+			event._type = k_input_event_mouse_down;
+			event._bit = uint64_t(1) << sdl_event.button.button;
+			break;
+		case SDL_MOUSEBUTTONUP:
+			event._type = k_input_event_mouse_up;
+			event._bit = uint64_t(1) << sdl_event.button.button;
+			break;
+		case SDL_KEYDOWN:
+			// Key repeats are not new presses.
+			if (sdl_event.key.repeat) continue;
+			event._type = k_input_event_button_down;
+			event._bit = button_of_key(sdl_event.key.keysym.sym);
+			if (!event._bit) continue;
+			break;
+		case SDL_KEYUP:
+			event._type = k_input_event_button_up;
+			event._bit = button_of_key(sdl_event.key.keysym.sym);
+			if (!event._bit) continue;
+			break;
+		case SDL_QUIT:
+			event._type = k_input_event_quit;
+			break;
+		default:
+			continue;
+		}
+
+		// SDL stamps events in whole milliseconds. Keep them in order and no
+		// later than now, so a frame never misses an event it has polled.
+		auto time = _sdl_epoch + std::chrono::milliseconds(sdl_event.common.timestamp);
+		time = std::max(time, _last_event_time);
+		time = std::min(time, now);
+		_last_event_time = time;
+		event._time = time;
+
+		if (!_events.push(event))
+		{
+			// The ring only fills if nothing consumes it; keep the newest state.
+			consume(now);
+			_events.push(event);
+		}
+	}
+}
+
+void ga_input::consume(std::chrono::high_resolution_clock::time_point deadline)
+{
+	ga_input_event_t event;
+	while (_events.pop(deadline, event))
+	{
+		switch (event._type)
+		{
+		case k_input_event_button_down:
+			_button_mask |= event._bit;
+			_pressed_mask |= event._bit;
+			_unreported_pressed_mask |= event._bit;
+			break;
+		case k_input_event_button_up:
+			_button_mask &= ~event._bit;
+			break;
+		case k_input_event_mouse_down:
+			_mouse_button_mask |= event._bit;
+			break;
+		case k_input_event_mouse_up:
+			_mouse_button_mask &= ~event._bit;
+			_unreported_click_mask |= event._bit;
+			break;
+		case k_input_event_mouse_move:
+			_mouse_x = event._x;
+			_mouse_y = event._y;
+			break;
+		case k_input_event_quit:
+			_quit = true;
+			break;
+		}
+	}
+}
+
+void ga_input::write_params(ga_frame_params* params)
+{
+	// Buttons pressed since the last frame count as down even if already released.
+	params->_button_mask = _button_mask | _unreported_pressed_mask;
+	params->_mouse_click_mask |= _unreported_click_mask;
+	params->_mouse_press_mask = _mouse_button_mask;
+	params->_mouse_x = _mouse_x;
+	params->_mouse_y = _mouse_y;
+
+	_unreported_pressed_mask = 0;
+	_unreported_click_mask = 0;
 }
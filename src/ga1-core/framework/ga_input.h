@@ -9,12 +9,25 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 
+#include "ga_input_ring.h"
+
 #include <chrono>
 #include <cstdint>
 
 /*
 ** Represents the input stage of the frame.
 ** Owns the window, user input devices and clock.
+**
+** Events are queued in a ring with the time SDL gives them, which is only
+** to the millisecond. Each frame consumes the events up to its own time, so
+** a button pressed and released within one frame is still seen as down for
+** that frame.
+**
+** SDL only delivers events on the thread that created the window, so events
+** are gathered on the main thread: once the frame's time is known, and again
+** by late_latch() just before the sim runs. The ring's producer and consumer
+** are therefore the same thread for now; it serves as the queue that holds
+** events back until the frame they belong to.
 */
 class ga_input
 {
@@ -24,21 +37,44 @@ public:
 
 	bool update(struct ga_frame_params* params);
 
+	/*
+	** Fold in input that arrived after update(). Call right before the sim so
+	** it sees the latest state. Time and frame controls are left as they were;
+	** a pause or step pressed now takes effect on the next update().
+	*/
+	void late_latch(struct ga_frame_params* params);
+
 	void* get_window() const { return _window; }
 
 private:
+	void poll();
+	void consume(std::chrono::high_resolution_clock::time_point deadline);
+	void write_params(struct ga_frame_params* params);
+
 	uint64_t _button_mask;
+
+	// Presses since update() last handled the frame controls.
 	uint64_t _pressed_mask;
-	uint64_t _released_mask;
+
+	// Edges not yet handed to a frame, so short taps are reported exactly once.
+	uint64_t _unreported_pressed_mask;
+	uint64_t _unreported_click_mask;
 
 	uint64_t _mouse_button_mask;
 
 	float _mouse_x;
 	float _mouse_y;
 
+	ga_input_ring _events;
+
+	// Time of SDL's tick zero, for converting event timestamps.
+	std::chrono::high_resolution_clock::time_point _sdl_epoch;
+	std::chrono::high_resolution_clock::time_point _last_event_time;
+
 	std::chrono::high_resolution_clock::time_point _last_time;
 
 	void* _window;
 
 	bool _paused;
+	bool _quit;
 };
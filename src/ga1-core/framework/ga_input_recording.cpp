@@ -0,0 +1,245 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_input_recording.h"
+#include "ga_frame_params.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const uint32_t k_input_recording_magic = 0x52494147; // 'GAIR'
+static const uint32_t k_input_recording_version = 1;
+
+// Magic, version and frame count.
+static const size_t k_input_recording_header_size = 12;
+
+// Flags marking which fields of a frame record are present.
+enum ga_input_field_t
+{
+	k_input_field_buttons = 1 << 0,
+	k_input_field_mouse_click = 1 << 1,
+	k_input_field_mouse_press = 1 << 2,
+	k_input_field_mouse_x = 1 << 3,
+	k_input_field_mouse_y = 1 << 4,
+	k_input_field_delta_time = 1 << 5,
+	k_input_field_single_step = 1 << 6,
+};
+
+static void write_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(uint8_t(value));
+}
+
+static bool read_varint(const std::vector<uint8_t>& in, size_t& cursor, uint64_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (cursor >= in.size()) return false;
+
+		uint8_t byte = in[cursor++];
+		value |= uint64_t(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+static void write_u32(uint8_t* out, uint32_t value)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		out[i] = uint8_t(value >> (i * 8));
+	}
+}
+
+static uint32_t read_u32(const uint8_t* in)
+{
+	return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+
+static uint32_t float_bits(float f)
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+static float bits_float(uint32_t bits)
+{
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static void clear_frame(ga_input_frame_t& frame)
+{
+	frame._button_mask = 0;
+	frame._mouse_click_mask = 0;
+	frame._mouse_press_mask = 0;
+	frame._mouse_x = 0.0f;
+	frame._mouse_y = 0.0f;
+	frame._delta_us = 0;
+	frame._single_step = false;
+}
+
+ga_input_recorder::ga_input_recorder(const char* path) : _path(path), _frame_count(0), _closed(false)
+{
+	clear_frame(_previous);
+	_data.resize(k_input_recording_header_size);
+}
+
+ga_input_recorder::~ga_input_recorder()
+{
+	close();
+}
+
+void ga_input_recorder::record(ga_frame_params* params)
+{
+	// Quantize delta time so the recording and its replay agree exactly.
+	auto delta_us = std::chrono::duration_cast<std::chrono::microseconds>(params->_delta_time);
+	params->_delta_time = delta_us;
+
+	ga_input_frame_t frame;
+	frame._button_mask = params->_button_mask;
+	frame._mouse_click_mask = params->_mouse_click_mask;
+	frame._mouse_press_mask = params->_mouse_press_mask;
+	frame._mouse_x = params->_mouse_x;
+	frame._mouse_y = params->_mouse_y;
+	frame._delta_us = uint32_t(delta_us.count());
+	frame._single_step = params->_single_step;
+
+	uint8_t fields = 0;
+	if (frame._button_mask != _previous._button_mask) fields |= k_input_field_buttons;
+	if (frame._mouse_click_mask != _previous._mouse_click_mask) fields |= k_input_field_mouse_click;
+	if (frame._mouse_press_mask != _previous._mouse_press_mask) fields |= k_input_field_mouse_press;
+	if (float_bits(frame._mouse_x) != float_bits(_previous._mouse_x)) fields |= k_input_field_mouse_x;
+	if (float_bits(frame._mouse_y) != float_bits(_previous._mouse_y)) fields |= k_input_field_mouse_y;
+	if (frame._delta_us != _previous._delta_us) fields |= k_input_field_delta_time;
+	if (frame._single_step) fields |= k_input_field_single_step;
+
+	_data.push_back(fields);
+	if (fields & k_input_field_buttons) write_varint(_data, frame._button_mask ^ _previous._button_mask);
+	if (fields & k_input_field_mouse_click) write_varint(_data, frame._mouse_click_mask ^ _previous._mouse_click_mask);
+	if (fields & k_input_field_mouse_press) write_varint(_data, frame._mouse_press_mask ^ _previous._mouse_press_mask);
+	if (fields & k_input_field_mouse_x) write_varint(_data, float_bits(frame._mouse_x) ^ float_bits(_previous._mouse_x));
+	if (fields & k_input_field_mouse_y) write_varint(_data, float_bits(frame._mouse_y) ^ float_bits(_previous._mouse_y));
+	if (fields & k_input_field_delta_time)
+	{
+		int64_t diff = int64_t(frame._delta_us) - int64_t(_previous._delta_us);
+		write_varint(_data, (uint64_t(diff) << 1) ^ uint64_t(diff >> 63));
+	}
+
+	_previous = frame;
+	_frame_count++;
+}
+
+bool ga_input_recorder::close()
+{
+	if (_closed) return true;
+	_closed = true;
+
+	write_u32(&_data[0], k_input_recording_magic);
+	write_u32(&_data[4], k_input_recording_version);
+	write_u32(&_data[8], _frame_count);
+
+	std::ofstream file(_path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(_data.data()), _data.size());
+	if (!file)
+	{
+		std::cerr << "Failed to write input recording " << _path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+ga_input_replay::ga_input_replay() : _cursor(0), _frame_count(0), _frame_index(0)
+{
+	clear_frame(_previous);
+}
+
+ga_input_replay::~ga_input_replay()
+{
+}
+
+bool ga_input_replay::load(const char* path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		std::cerr << "Failed to open input recording " << path << std::endl;
+		return false;
+	}
+
+	_data.resize(size_t(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(_data.data()), _data.size());
+
+	if (_data.size() < k_input_recording_header_size ||
+		read_u32(&_data[0]) != k_input_recording_magic ||
+		read_u32(&_data[4]) != k_input_recording_version)
+	{
+		std::cerr << "Not an input recording: " << path << std::endl;
+		_data.clear();
+		return false;
+	}
+
+	_frame_count = read_u32(&_data[8]);
+	_frame_index = 0;
+	_cursor = k_input_recording_header_size;
+	clear_frame(_previous);
+	_time = std::chrono::high_resolution_clock::time_point();
+	return true;
+}
+
+bool ga_input_replay::update(ga_frame_params* params)
+{
+	if (_frame_index >= _frame_count || _cursor >= _data.size()) return false;
+
+	uint8_t fields = _data[_cursor++];
+	ga_input_frame_t frame = _previous;
+	frame._single_step = (fields & k_input_field_single_step) != 0;
+
+	uint64_t value;
+	bool ok = true;
+	if (ok && (fields & k_input_field_buttons)) { ok = read_varint(_data, _cursor, value); frame._button_mask ^= value; }
+	if (ok && (fields & k_input_field_mouse_click)) { ok = read_varint(_data, _cursor, value); frame._mouse_click_mask ^= value; }
+	if (ok && (fields & k_input_field_mouse_press)) { ok = read_varint(_data, _cursor, value); frame._mouse_press_mask ^= value; }
+	if (ok && (fields & k_input_field_mouse_x)) { ok = read_varint(_data, _cursor, value); frame._mouse_x = bits_float(float_bits(frame._mouse_x) ^ uint32_t(value)); }
+	if (ok && (fields & k_input_field_mouse_y)) { ok = read_varint(_data, _cursor, value); frame._mouse_y = bits_float(float_bits(frame._mouse_y) ^ uint32_t(value)); }
+	if (ok && (fields & k_input_field_delta_time))
+	{
+		ok = read_varint(_data, _cursor, value);
+		int64_t diff = int64_t(value >> 1) ^ -int64_t(value & 1);
+		frame._delta_us = uint32_t(int64_t(frame._delta_us) + diff);
+	}
+	if (!ok) return false;
+
+	_previous = frame;
+	_frame_index++;
+
+	// Time starts at the clock's epoch, so replays are identical run to run.
+	auto delta_time = std::chrono::microseconds(frame._delta_us);
+	_time += delta_time;
+
+	params->_button_mask = frame._button_mask;
+	params->_mouse_click_mask = frame._mouse_click_mask;
+	params->_mouse_press_mask = frame._mouse_press_mask;
+	params->_mouse_x = frame._mouse_x;
+	params->_mouse_y = frame._mouse_y;
+	params->_current_time = _time;
+	params->_delta_time = delta_time;
+	params->_single_step = frame._single_step;
+	return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+** Input state captured for one frame.
+** Delta time is kept in whole microseconds so it survives the round trip exactly.
+*/
+struct ga_input_frame_t
+{
+	uint64_t _button_mask;
+	uint64_t _mouse_click_mask;
+	uint64_t _mouse_press_mask;
+	float _mouse_x;
+	float _mouse_y;
+	uint32_t _delta_us;
+	bool _single_step;
+};
+
+/*
+** Writes the input of every frame to a file.
+**
+** Each frame is stored as a byte of flags marking the fields that changed
+** since the previous frame, followed by only those fields as varints. Masks
+** and mouse coordinates are XORed with their previous value, and delta time
+** is stored as a zigzag difference, so a frame with no new input is a single byte.
+**
+** Recording rounds the frame's delta time to microseconds in place, so the
+** recorded session runs on exactly the times a replay will see.
+** @see ga_input_replay
+*/
+class ga_input_recorder final
+{
+public:
+	ga_input_recorder(const char* path);
+	~ga_input_recorder();
+
+	void record(struct ga_frame_params* params);
+
+	/*
+	** Write the recording out. Called by the destructor if not done before.
+	*/
+	bool close();
+
+private:
+	std::string _path;
+	std::vector<uint8_t> _data;
+	ga_input_frame_t _previous;
+	uint32_t _frame_count;
+	bool _closed;
+};
+
+/*
+** Plays back a recording made by ga_input_recorder.
+** Fills in the input stage's part of the frame params, including time, so the
+** sim sees the same sequence of frames as when it was recorded.
+*/
+class ga_input_replay final
+{
+public:
+	ga_input_replay();
+	~ga_input_replay();
+
+	/*
+	** Load a recording.
+	** @returns False if the file is missing or not a recording.
+	*/
+	bool load(const char* path);
+
+	/*
+	** Fill in the next recorded frame.
+	** @returns False once every frame has been played.
+	*/
+	bool update(struct ga_frame_params* params);
+
+	uint32_t get_frame_count() const { return _frame_count; }
+	uint32_t get_frame_index() const { return _frame_index; }
+
+private:
+	std::vector<uint8_t> _data;
+	size_t _cursor;
+	ga_input_frame_t _previous;
+	uint32_t _frame_count;
+	uint32_t _frame_index;
+
+	std::chrono::high_resolution_clock::time_point _time;
+};
@@ -0,0 +1,192 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_input_recording.tests.h"
+#include "ga_input_recording.h"
+#include "ga_frame_params.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+static const char* k_test_recording_path = "ga_input_recording_test.rec";
+
+static std::vector<uint8_t> read_test_recording()
+{
+	std::ifstream file(k_test_recording_path, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void write_test_recording(const std::vector<uint8_t>& data)
+{
+	std::ofstream file(k_test_recording_path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+static void set_test_frame(ga_frame_params& params, uint64_t buttons, float mouse_x, float mouse_y, std::chrono::nanoseconds delta_time, bool single_step)
+{
+	params._button_mask = buttons;
+	params._mouse_click_mask = buttons >> 3;
+	params._mouse_press_mask = buttons & 0xff;
+	params._mouse_x = mouse_x;
+	params._mouse_y = mouse_y;
+	params._delta_time = delta_time;
+	params._single_step = single_step;
+}
+
+/*
+** Frames exercising each field: no change, small and full 64-bit masks,
+** negative and signed-zero coordinates, delta times going up and down,
+** and single steps.
+*/
+static std::vector<ga_frame_params> make_test_frames()
+{
+	std::vector<ga_frame_params> frames(12);
+	set_test_frame(frames[0], 0, 0.0f, 0.0f, std::chrono::nanoseconds(16666667), false);
+	set_test_frame(frames[1], 0, 0.0f, 0.0f, std::chrono::nanoseconds(16666667), false);
+	set_test_frame(frames[2], k_button_w, 0.0f, 0.0f, std::chrono::microseconds(16667), false);
+	set_test_frame(frames[3], k_button_w | k_button_i, 0.25f, -0.75f, std::chrono::microseconds(33000), false);
+	set_test_frame(frames[4], k_button_i, -0.0f, -0.75f, std::chrono::microseconds(4000), false);
+	set_test_frame(frames[5], 0xffffffffffffffffull, 1e-30f, 123456.0f, std::chrono::microseconds(0), true);
+	set_test_frame(frames[6], 1ull << 63, 1e-30f, 123456.0f, std::chrono::microseconds(0), true);
+	set_test_frame(frames[7], 0, -1.0f, 1.0f, std::chrono::microseconds(1000000), false);
+	set_test_frame(frames[8], 0, -1.0f, 1.0f, std::chrono::microseconds(1), false);
+	set_test_frame(frames[9], k_button_s, -1.0f, 1.0f, std::chrono::microseconds(1), true);
+	set_test_frame(frames[10], k_button_s, -1.0f, 1.0f, std::chrono::microseconds(1), false);
+	set_test_frame(frames[11], 0, 0.0f, 0.0f, std::chrono::microseconds(16667), false);
+	return frames;
+}
+
+static void test_input_recording_round_trip()
+{
+	std::vector<ga_frame_params> frames = make_test_frames();
+	{
+		ga_input_recorder recorder(k_test_recording_path);
+		for (auto& frame : frames)
+		{
+			recorder.record(&frame);
+		}
+		assert(recorder.close());
+	}
+
+	// Recording rounds delta time down to whole microseconds in place.
+	assert(frames[0]._delta_time == std::chrono::microseconds(16666));
+
+	ga_input_replay replay;
+	assert(replay.load(k_test_recording_path));
+	assert(replay.get_frame_count() == frames.size());
+
+	std::chrono::high_resolution_clock::time_point time;
+	for (const auto& frame : frames)
+	{
+		ga_frame_params params;
+		assert(replay.update(&params));
+
+		time += frame._delta_time;
+		assert(params._button_mask == frame._button_mask);
+		assert(params._mouse_click_mask == frame._mouse_click_mask);
+		assert(params._mouse_press_mask == frame._mouse_press_mask);
+		assert(memcmp(&params._mouse_x, &frame._mouse_x, sizeof(float)) == 0);
+		assert(memcmp(&params._mouse_y, &frame._mouse_y, sizeof(float)) == 0);
+		assert(params._delta_time == frame._delta_time);
+		assert(params._current_time == time);
+		assert(params._single_step == frame._single_step);
+	}
+	assert(replay.get_frame_index() == frames.size());
+
+	ga_frame_params params;
+	assert(!replay.update(&params));
+}
+
+static void test_input_recording_size()
+{
+	// A frame with nothing new is one byte.
+	{
+		ga_input_recorder recorder(k_test_recording_path);
+		ga_frame_params params;
+		set_test_frame(params, 0, 0.0f, 0.0f, std::chrono::microseconds(0), false);
+		for (int i = 0; i < 100; ++i)
+		{
+			recorder.record(&params);
+		}
+	}
+	assert(read_test_recording().size() == 12 + 100);
+}
+
+static void test_input_recording_damaged()
+{
+	std::vector<ga_frame_params> frames = make_test_frames();
+	{
+		ga_input_recorder recorder(k_test_recording_path);
+		for (auto& frame : frames)
+		{
+			recorder.record(&frame);
+		}
+	}
+	std::vector<uint8_t> data = read_test_recording();
+
+	// Cut short, the replay plays the frames that are whole and then stops.
+	// The last frame changes every field, so it is longer than any cut.
+	for (size_t cut = 1; cut <= 4; ++cut)
+	{
+		write_test_recording(std::vector<uint8_t>(data.begin(), data.end() - cut));
+
+		ga_input_replay replay;
+		assert(replay.load(k_test_recording_path));
+
+		ga_frame_params params;
+		uint32_t played = 0;
+		while (replay.update(&params))
+		{
+			played++;
+		}
+		assert(played == frames.size() - 1);
+	}
+
+	// A varint that never ends.
+	{
+		std::vector<uint8_t> bad(data.begin(), data.begin() + 12);
+		bad.push_back(1);
+		bad.insert(bad.end(), 11, 0xff);
+		write_test_recording(bad);
+
+		ga_input_replay replay;
+		assert(replay.load(k_test_recording_path));
+		ga_frame_params params;
+		assert(!replay.update(&params));
+	}
+
+	// Not a recording, or too short to be one.
+	{
+		std::vector<uint8_t> bad = data;
+		bad[0] ^= 1;
+		write_test_recording(bad);
+		ga_input_replay replay;
+		assert(!replay.load(k_test_recording_path));
+	}
+	{
+		write_test_recording(std::vector<uint8_t>(data.begin(), data.begin() + 11));
+		ga_input_replay replay;
+		assert(!replay.load(k_test_recording_path));
+	}
+
+	std::remove(k_test_recording_path);
+	ga_input_replay replay;
+	assert(!replay.load(k_test_recording_path));
+}
+
+void ga_input_recording_unit_tests()
+{
+	test_input_recording_round_trip();
+	test_input_recording_size();
+	test_input_recording_damaged();
+	std::remove(k_test_recording_path);
+}
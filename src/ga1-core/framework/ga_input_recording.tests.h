@@ -0,0 +1,17 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Check a recording replays exactly the input it was made from, and that
+** damaged recordings stop playing rather than read past their end. Writes a
+** scratch file to the working directory.
+*/
+void ga_input_recording_unit_tests();
@@ -0,0 +1,60 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_input_ring.h"
+
+ga_input_ring::ga_input_ring(uint32_t capacity) : _head(0), _tail(0)
+{
+	uint32_t size = 1;
+	while (size < capacity)
+	{
+		size <<= 1;
+	}
+	_events = new ga_input_event_t[size];
+	_mask = size - 1;
+}
+
+ga_input_ring::~ga_input_ring()
+{
+	delete[] _events;
+}
+
+bool ga_input_ring::push(const ga_input_event_t& event)
+{
+	uint32_t tail = _tail.load(std::memory_order_relaxed);
+	uint32_t head = _head.load(std::memory_order_acquire);
+	if (tail - head > _mask)
+	{
+		return false;
+	}
+
+	_events[tail & _mask] = event;
+	_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+bool ga_input_ring::pop(std::chrono::high_resolution_clock::time_point deadline, ga_input_event_t& event)
+{
+	uint32_t head = _head.load(std::memory_order_relaxed);
+	uint32_t tail = _tail.load(std::memory_order_acquire);
+	if (head == tail)
+	{
+		return false;
+	}
+
+	const ga_input_event_t& next = _events[head & _mask];
+	if (next._time > deadline)
+	{
+		return false;
+	}
+
+	event = next;
+	_head.store(head + 1, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+enum ga_input_event_type_t
+{
+	k_input_event_button_down,
+	k_input_event_button_up,
+	k_input_event_mouse_down,
+	k_input_event_mouse_up,
+	k_input_event_mouse_move,
+	k_input_event_quit,
+};
+
+/*
+** One input event and when it happened.
+** Buttons and mouse buttons are given as their bit in the frame params masks.
+*/
+struct ga_input_event_t
+{
+	std::chrono::high_resolution_clock::time_point _time;
+	uint64_t _bit;
+	float _x;
+	float _y;
+	uint32_t _type;
+};
+
+/*
+** Fixed size ring of input events with one producer and one consumer.
+**
+** Lock-free: the producer only writes the tail and the consumer only writes
+** the head, so each can run on its own thread without waiting on the other.
+*/
+class ga_input_ring final
+{
+public:
+	/*
+	** @param capacity Rounded up to a power of two.
+	*/
+	ga_input_ring(uint32_t capacity);
+	~ga_input_ring();
+
+	/*
+	** Add an event. Producer only.
+	** @returns False, dropping the event, if the ring is full.
+	*/
+	bool push(const ga_input_event_t& event);
+
+	/*
+	** Remove the oldest event if it happened no later than the deadline. Consumer only.
+	*/
+	bool pop(std::chrono::high_resolution_clock::time_point deadline, ga_input_event_t& event);
+
+private:
+	ga_input_event_t* _events;
+	uint32_t _mask;
+
+	// Padded apart so the two threads do not contend for a cache line.
+	std::atomic<uint32_t> _head;
+	uint8_t _padding[64];
+	std::atomic<uint32_t> _tail;
+};
@@ -0,0 +1,35 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_instance.h"
+
+ga_instance::ga_instance(uint32_t pooled_entity_capacity) : _sim(pooled_entity_capacity)
+{
+}
+
+ga_instance::~ga_instance()
+{
+}
+
+bool ga_instance::load(const void* cooked, size_t size, uint32_t flags)
+{
+	if (!_scene.load_cooked(cooked, size))
+	{
+		return false;
+	}
+	_scene.instantiate(&_sim, &_world, flags);
+	return true;
+}
+
+void ga_instance::update(ga_frame_params* params)
+{
+	_sim.update(params);
+	_world.step(params);
+	_sim.late_update(params);
+}
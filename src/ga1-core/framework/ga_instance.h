@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_scene.h"
+#include "ga_sim.h"
+
+#include "physics/ga_physics_world.h"
+
+/*
+** One independent copy of the game: a sim, a physics world and the scene
+** built into them.
+**
+** Instances share nothing but the job system and read-only tables, so any
+** number of them can be updated at once from different jobs. Each instance
+** must only be updated from one job at a time.
+*/
+class ga_instance final
+{
+public:
+	ga_instance(uint32_t pooled_entity_capacity = k_default_pooled_entity_capacity);
+	~ga_instance();
+
+	/*
+	** Build the instance from a cooked scene. The data is copied.
+	** @param flags Combination of ga_scene_instantiate_flags.
+	*/
+	bool load(const void* cooked, size_t size, uint32_t flags = 0);
+
+	/*
+	** Run one frame of gameplay and physics.
+	*/
+	void update(struct ga_frame_params* params);
+
+	ga_sim* get_sim() { return &_sim; }
+	ga_physics_world* get_physics_world() { return &_world; }
+	const ga_scene* get_scene() const { return &_scene; }
+
+private:
+	// Declared in this order so the scene is torn down before what it was built into.
+	ga_sim _sim;
+	ga_physics_world _world;
+	ga_scene _scene;
+};
@@ -0,0 +1,116 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_scene.benchmarks.h"
+#include "ga_scene.h"
+#include "ga_sim.h"
+
+#include "entity/ga_entity.h"
+
+#include "physics/ga_physics_component.h"
+#include "physics/ga_physics_world.h"
+#include "physics/ga_shape.h"
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+static const uint32_t k_benchmark_scene_entity_count = 100000;
+
+static ga_vec3f benchmark_position(uint32_t i)
+{
+	return { float(i % 100) * 2.0f, float((i / 100) % 100) * 2.0f, float(i / 10000) * 2.0f };
+}
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point t0)
+{
+	auto t1 = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+void ga_scene_benchmarks()
+{
+	// Imperative construction, one object at a time, as main.cpp used to do.
+	{
+		ga_sim sim;
+		ga_physics_world world;
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+
+		std::vector<ga_entity*> entities;
+		std::vector<ga_oobb*> shapes;
+		std::vector<ga_physics_component*> components;
+		for (uint32_t i = 0; i < k_benchmark_scene_entity_count; ++i)
+		{
+			ga_entity* ent = new ga_entity();
+			ent->translate(benchmark_position(i));
+
+			ga_oobb* oobb = new ga_oobb();
+			oobb->_center = ga_vec3f::zero_vector();
+			oobb->_half_vectors[0] = ga_vec3f::x_vector().scale_result(0.5f);
+			oobb->_half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+			oobb->_half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f);
+
+			ga_physics_component* comp = new ga_physics_component(ent, oobb, 1.0f);
+			world.add_rigid_body(comp->get_rigid_body());
+			sim.add_entity(ent);
+
+			entities.push_back(ent);
+			shapes.push_back(oobb);
+			components.push_back(comp);
+		}
+
+		printf("ga_scene imperative: %u entities, %.3f ms\n", k_benchmark_scene_entity_count, elapsed_ms(t0));
+
+		std::vector<ga_rigid_body*> bodies;
+		for (auto c : components)
+		{
+			bodies.push_back(c->get_rigid_body());
+		}
+		world.remove_rigid_bodies(bodies.data(), uint32_t(bodies.size()));
+		sim.remove_entities(entities.data(), uint32_t(entities.size()));
+
+		for (uint32_t i = 0; i < k_benchmark_scene_entity_count; ++i)
+		{
+			delete components[i];
+			delete shapes[i];
+			delete entities[i];
+		}
+	}
+
+	// The same scene from text, cooked once, then loaded and instantiated.
+	{
+		std::ostringstream text;
+		for (uint32_t i = 0; i < k_benchmark_scene_entity_count; ++i)
+		{
+			ga_vec3f p = benchmark_position(i);
+			text << "entity e" << i << "\n";
+			text << "translate " << p.x << " " << p.y << " " << p.z << "\n";
+			text << "oobb 0 0 0  0.5 0 0  0 0.5 0  0 0 0.5\n";
+			text << "body 1\n";
+		}
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		std::vector<uint8_t> cooked;
+		ga_scene_cook(text.str().c_str(), cooked);
+		printf("ga_scene cook text: %u entities, %.3f ms, %u bytes\n", k_benchmark_scene_entity_count, elapsed_ms(t0), uint32_t(cooked.size()));
+
+		ga_sim sim;
+		ga_physics_world world;
+
+		t0 = std::chrono::high_resolution_clock::now();
+		{
+			ga_scene scene;
+			scene.load_cooked(cooked.data(), cooked.size());
+			scene.instantiate(&sim, &world);
+			printf("ga_scene cooked load: %u entities, %.3f ms\n", scene.get_entity_count(), elapsed_ms(t0));
+		}
+	}
+}
@@ -0,0 +1,628 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_scene.h"
+#include "ga_sim.h"
+
+#include "entity/ga_entity.h"
+#include "entity/ga_lua_component.h"
+#include "entity/ga_pong_manager.h"
+
+#include "graphics/ga_ball_component.h"
+#include "graphics/ga_cube_component.h"
+
+#include "physics/ga_physics_component.h"
+#include "physics/ga_physics_world.h"
+#include "physics/ga_rigid_body.h"
+#include "physics/ga_shape.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+static const uint32_t k_scene_no_index = 0xffffffff;
+
+/*
+** Intermediate state while turning scene text into cooked arrays.
+*/
+struct ga_scene_cooker_t
+{
+	std::vector<ga_scene_entity_t> _entities;
+	std::vector<ga_scene_shape_t> _shapes;
+	std::vector<ga_scene_body_t> _bodies;
+	std::vector<ga_scene_render_t> _renders;
+	std::vector<ga_scene_script_t> _scripts;
+	std::vector<ga_scene_pong_t> _pongs;
+	std::string _strings;
+
+	std::unordered_map<std::string, uint32_t> _entity_names;
+
+	// Entity names referenced by each pong record, resolved once every entity is known.
+	std::vector<std::string> _pong_refs;
+	std::vector<int> _pong_lines;
+
+	// Most recent shape and body of the current entity.
+	uint32_t _shape = k_scene_no_index;
+	uint32_t _body = k_scene_no_index;
+
+	uint32_t add_string(const std::string& s)
+	{
+		uint32_t offset = uint32_t(_strings.size());
+		_strings.append(s);
+		_strings.push_back('\0');
+		return offset;
+	}
+};
+
+template<typename T>
+static void append_records(std::vector<uint8_t>& out, const std::vector<T>& records)
+{
+	size_t offset = out.size();
+	out.resize(offset + sizeof(T) * records.size());
+	if (!records.empty())
+	{
+		memcpy(out.data() + offset, records.data(), sizeof(T) * records.size());
+	}
+}
+
+static bool read_floats(std::istringstream& in, float* values, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (!(in >> values[i])) return false;
+	}
+	return true;
+}
+
+bool ga_scene_cook(const char* text, std::vector<uint8_t>& cooked)
+{
+	ga_scene_cooker_t cooker;
+	std::istringstream lines(text);
+	std::string line;
+	int line_number = 0;
+
+	while (std::getline(lines, line))
+	{
+		++line_number;
+
+		std::istringstream in(line);
+		std::string keyword;
+		if (!(in >> keyword) || keyword[0] == '#') continue;
+
+		bool ok = true;
+		if (keyword == "entity")
+		{
+			std::string name;
+			ok = bool(in >> name) && cooker._entity_names.count(name) == 0;
+			if (ok)
+			{
+				ga_scene_entity_t entity;
+				entity._transform.make_identity();
+				entity._name = cooker.add_string(name);
+
+				cooker._entity_names[name] = uint32_t(cooker._entities.size());
+				cooker._entities.push_back(entity);
+				cooker._shape = k_scene_no_index;
+				cooker._body = k_scene_no_index;
+			}
+		}
+		else if (cooker._entities.empty())
+		{
+			ok = false;
+		}
+		else if (keyword == "translate" || keyword == "scale")
+		{
+			ga_vec3f v;
+			ok = read_floats(in, v.axes, 3);
+			if (ok)
+			{
+				ga_mat4f& transform = cooker._entities.back()._transform;
+				if (keyword == "translate")
+				{
+					transform.translate(v);
+				}
+				else
+				{
+					transform.nonuniform_scale(v);
+				}
+			}
+		}
+		else if (keyword == "plane" || keyword == "sphere" || keyword == "aabb" || keyword == "oobb")
+		{
+			ga_scene_shape_t shape = {};
+			int float_count = 0;
+			if (keyword == "plane") { shape._type = k_shape_plane; float_count = 6; }
+			else if (keyword == "sphere") { shape._type = k_shape_sphere; float_count = 4; }
+			else if (keyword == "aabb") { shape._type = k_shape_aabb; float_count = 6; }
+			else { shape._type = k_shape_oobb; float_count = 12; }
+
+			ok = read_floats(in, shape._data, float_count);
+			if (ok)
+			{
+				cooker._shape = uint32_t(cooker._shapes.size());
+				cooker._shapes.push_back(shape);
+			}
+		}
+		else if (keyword == "body")
+		{
+			ga_scene_body_t body;
+			body._entity = uint32_t(cooker._entities.size() - 1);
+			body._shape = cooker._shape;
+			body._flags = 0;
+			body._velocity = ga_vec3f::zero_vector();
+
+			ok = bool(in >> body._mass) && body._shape != k_scene_no_index;
+
+			std::string flag;
+			while (ok && in >> flag)
+			{
+				if (flag == "static") body._flags |= k_static;
+				else if (flag == "weightless") body._flags |= k_weightless;
+				else if (flag == "fast") body._flags |= k_fast;
+				else ok = false;
+			}
+
+			if (ok)
+			{
+				cooker._body = uint32_t(cooker._bodies.size());
+				cooker._bodies.push_back(body);
+			}
+		}
+		else if (keyword == "velocity")
+		{
+			ok = cooker._body != k_scene_no_index && read_floats(in, cooker._bodies[cooker._body]._velocity.axes, 3);
+		}
+		else if (keyword == "cube" || keyword == "ball")
+		{
+			std::string texture;
+			ok = bool(in >> texture);
+			if (ok)
+			{
+				ga_scene_render_t render;
+				render._entity = uint32_t(cooker._entities.size() - 1);
+				render._type = keyword == "cube" ? k_scene_render_cube : k_scene_render_ball;
+				render._texture = cooker.add_string(texture);
+				cooker._renders.push_back(render);
+			}
+		}
+		else if (keyword == "script")
+		{
+			std::string path;
+			ok = bool(in >> path);
+			if (ok)
+			{
+				ga_scene_script_t script;
+				script._entity = uint32_t(cooker._entities.size() - 1);
+				script._path = cooker.add_string(path);
+				cooker._scripts.push_back(script);
+			}
+		}
+		else if (keyword == "pong")
+		{
+			std::string left, right, ball;
+			ga_scene_pong_t pong;
+			ok = bool(in >> left >> right >> ball >> pong._points);
+			if (ok)
+			{
+				pong._entity = uint32_t(cooker._entities.size() - 1);
+				cooker._pongs.push_back(pong);
+				cooker._pong_refs.push_back(left);
+				cooker._pong_refs.push_back(right);
+				cooker._pong_refs.push_back(ball);
+				cooker._pong_lines.push_back(line_number);
+			}
+		}
+		else
+		{
+			ok = false;
+		}
+
+		if (!ok)
+		{
+			std::cerr << "Scene line " << line_number << ": could not parse '" << line << "'" << std::endl;
+			return false;
+		}
+	}
+
+	// Resolve references by name now that all entities are known.
+	for (size_t i = 0; i < cooker._pongs.size(); ++i)
+	{
+		uint32_t* refs[] = { &cooker._pongs[i]._left, &cooker._pongs[i]._right, &cooker._pongs[i]._ball };
+		for (int r = 0; r < 3; ++r)
+		{
+			auto it = cooker._entity_names.find(cooker._pong_refs[i * 3 + r]);
+			if (it == cooker._entity_names.end())
+			{
+				std::cerr << "Scene line " << cooker._pong_lines[i] << ": unknown entity '" << cooker._pong_refs[i * 3 + r] << "'" << std::endl;
+				return false;
+			}
+			*refs[r] = it->second;
+		}
+	}
+
+	// Keep the string table 4-byte aligned so cooked scenes can be concatenated.
+	while (cooker._strings.size() % 4)
+	{
+		cooker._strings.push_back('\0');
+	}
+
+	ga_scene_header_t header;
+	header._magic = k_scene_magic;
+	header._version = k_scene_version;
+	header._entity_count = uint32_t(cooker._entities.size());
+	header._shape_count = uint32_t(cooker._shapes.size());
+	header._body_count = uint32_t(cooker._bodies.size());
+	header._render_count = uint32_t(cooker._renders.size());
+	header._script_count = uint32_t(cooker._scripts.size());
+	header._pong_count = uint32_t(cooker._pongs.size());
+	header._string_size = uint32_t(cooker._strings.size());
+
+	cooked.resize(sizeof(header));
+	memcpy(cooked.data(), &header, sizeof(header));
+	append_records(cooked, cooker._entities);
+	append_records(cooked, cooker._shapes);
+	append_records(cooked, cooker._bodies);
+	append_records(cooked, cooker._renders);
+	append_records(cooked, cooker._scripts);
+	append_records(cooked, cooker._pongs);
+	cooked.insert(cooked.end(), cooker._strings.begin(), cooker._strings.end());
+
+	return true;
+}
+
+bool ga_scene_cook_file(const char* text_path, const char* cooked_path)
+{
+	std::ifstream in(text_path, std::ios::binary);
+	if (!in)
+	{
+		std::cerr << "Failed to open scene " << text_path << std::endl;
+		return false;
+	}
+	std::stringstream text;
+	text << in.rdbuf();
+
+	std::vector<uint8_t> cooked;
+	if (!ga_scene_cook(text.str().c_str(), cooked))
+	{
+		return false;
+	}
+
+	std::ofstream out(cooked_path, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(cooked.data()), cooked.size());
+	return bool(out);
+}
+
+template<typename T>
+static T* allocate_components(uint32_t count)
+{
+	return count ? static_cast<T*>(::operator new(sizeof(T) * count)) : nullptr;
+}
+
+template<typename T>
+static void destroy_components(T* components, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		components[i].~T();
+	}
+	::operator delete(components);
+}
+
+template<typename T>
+static const T* take_records(const uint8_t*& cursor, uint32_t count)
+{
+	const T* records = reinterpret_cast<const T*>(cursor);
+	cursor += sizeof(T) * count;
+	return records;
+}
+
+ga_scene::ga_scene() :
+	_header(nullptr),
+	_sim(nullptr),
+	_world(nullptr),
+	_entities(nullptr),
+	_shapes(nullptr),
+	_planes(nullptr),
+	_spheres(nullptr),
+	_aabbs(nullptr),
+	_oobbs(nullptr),
+	_physics(nullptr),
+	_cubes(nullptr),
+	_balls(nullptr),
+	_scripts(nullptr),
+	_pongs(nullptr),
+	_cube_count(0),
+	_ball_count(0)
+{
+}
+
+ga_scene::~ga_scene()
+{
+	if (!_entities) return;
+
+	std::vector<ga_entity*> entities(_header->_entity_count);
+	for (uint32_t i = 0; i < _header->_entity_count; ++i)
+	{
+		entities[i] = &_entities[i];
+	}
+	_sim->remove_entities(entities.data(), uint32_t(entities.size()));
+
+	std::vector<ga_rigid_body*> bodies(_header->_body_count);
+	for (uint32_t i = 0; i < _header->_body_count; ++i)
+	{
+		bodies[i] = _physics[i].get_rigid_body();
+	}
+	_world->remove_rigid_bodies(bodies.data(), uint32_t(bodies.size()));
+
+	destroy_components(_pongs, _header->_pong_count);
+	destroy_components(_physics, _header->_body_count);
+	destroy_components(_balls, _ball_count);
+	destroy_components(_cubes, _cube_count);
+	destroy_components(_scripts, _header->_script_count);
+
+	delete[] _oobbs;
+	delete[] _aabbs;
+	delete[] _spheres;
+	delete[] _planes;
+	delete[] _shapes;
+	delete[] _entities;
+}
+
+bool ga_scene::load_file(const char* path)
+{
+	extern char g_root_path[256];
+	std::string fullpath = g_root_path;
+	fullpath += path;
+
+	std::ifstream file(fullpath, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		std::cerr << "Failed to open scene " << path << std::endl;
+		return false;
+	}
+
+	// Read the whole file in one go; cooked scenes are used straight from this buffer.
+	std::vector<uint8_t> data(size_t(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+	uint32_t magic = 0;
+	if (data.size() >= sizeof(magic))
+	{
+		memcpy(&magic, data.data(), sizeof(magic));
+	}
+	if (magic == k_scene_magic)
+	{
+		_buffer.swap(data);
+		return load_cooked(nullptr, 0);
+	}
+
+	// Otherwise this is a text scene; cook it on the fly.
+	data.push_back('\0');
+	std::vector<uint8_t> cooked;
+	if (!ga_scene_cook(reinterpret_cast<const char*>(data.data()), cooked))
+	{
+		std::cerr << "Failed to parse scene " << path << std::endl;
+		return false;
+	}
+	_buffer.swap(cooked);
+	return load_cooked(nullptr, 0);
+}
+
+bool ga_scene::load_cooked(const void* data, size_t size)
+{
+	assert(!_entities);
+
+	// A null source means the cooked data is already in the buffer.
+	if (data)
+	{
+		_buffer.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+	}
+	_header = nullptr;
+
+	if (_buffer.size() < sizeof(ga_scene_header_t)) return false;
+
+	const ga_scene_header_t* header = reinterpret_cast<const ga_scene_header_t*>(_buffer.data());
+	if (header->_magic != k_scene_magic || header->_version != k_scene_version) return false;
+
+	size_t expected = sizeof(ga_scene_header_t) +
+		sizeof(ga_scene_entity_t) * size_t(header->_entity_count) +
+		sizeof(ga_scene_shape_t) * size_t(header->_shape_count) +
+		sizeof(ga_scene_body_t) * size_t(header->_body_count) +
+		sizeof(ga_scene_render_t) * size_t(header->_render_count) +
+		sizeof(ga_scene_script_t) * size_t(header->_script_count) +
+		sizeof(ga_scene_pong_t) * size_t(header->_pong_count) +
+		size_t(header->_string_size);
+	if (_buffer.size() != expected) return false;
+
+	const uint8_t* cursor = _buffer.data() + sizeof(ga_scene_header_t);
+	_entity_records = take_records<ga_scene_entity_t>(cursor, header->_entity_count);
+	_shape_records = take_records<ga_scene_shape_t>(cursor, header->_shape_count);
+	_body_records = take_records<ga_scene_body_t>(cursor, header->_body_count);
+	_render_records = take_records<ga_scene_render_t>(cursor, header->_render_count);
+	_script_records = take_records<ga_scene_script_t>(cursor, header->_script_count);
+	_pong_records = take_records<ga_scene_pong_t>(cursor, header->_pong_count);
+	_strings = reinterpret_cast<const char*>(cursor);
+
+	// Check every index and string offset once here, so instantiation can trust them.
+	uint32_t string_size = header->_string_size;
+	if (string_size > 0 && _strings[string_size - 1] != '\0') return false;
+
+	auto valid_string = [string_size](uint32_t offset) { return offset < string_size; };
+	auto valid_entity = [header](uint32_t index) { return index < header->_entity_count; };
+
+	for (uint32_t i = 0; i < header->_entity_count; ++i)
+	{
+		if (!valid_string(_entity_records[i]._name)) return false;
+	}
+	for (uint32_t i = 0; i < header->_shape_count; ++i)
+	{
+		uint32_t type = _shape_records[i]._type;
+		if (type != k_shape_plane && type != k_shape_sphere && type != k_shape_aabb && type != k_shape_oobb) return false;
+	}
+	for (uint32_t i = 0; i < header->_body_count; ++i)
+	{
+		if (!valid_entity(_body_records[i]._entity) || _body_records[i]._shape >= header->_shape_count) return false;
+	}
+	for (uint32_t i = 0; i < header->_render_count; ++i)
+	{
+		if (!valid_entity(_render_records[i]._entity) || !valid_string(_render_records[i]._texture)) return false;
+	}
+	for (uint32_t i = 0; i < header->_script_count; ++i)
+	{
+		if (!valid_entity(_script_records[i]._entity) || !valid_string(_script_records[i]._path)) return false;
+	}
+	for (uint32_t i = 0; i < header->_pong_count; ++i)
+	{
+		const ga_scene_pong_t& p = _pong_records[i];
+		if (!valid_entity(p._entity) || !valid_entity(p._left) || !valid_entity(p._right) || !valid_entity(p._ball)) return false;
+	}
+
+	_header = header;
+	return true;
+}
+
+void ga_scene::instantiate(ga_sim* sim, ga_physics_world* world, uint32_t flags)
+{
+	assert(_header && !_entities);
+
+	_sim = sim;
+	_world = world;
+
+	// Entities:
+	_entities = new ga_entity[_header->_entity_count];
+	for (uint32_t i = 0; i < _header->_entity_count; ++i)
+	{
+		_entities[i].set_transform(_entity_records[i]._transform);
+	}
+
+	// Shapes, one array per shape type:
+	uint32_t shape_counts[k_shape_count] = {};
+	for (uint32_t i = 0; i < _header->_shape_count; ++i)
+	{
+		shape_counts[_shape_records[i]._type]++;
+	}
+	_shapes = new ga_shape*[_header->_shape_count];
+	_planes = new ga_plane[shape_counts[k_shape_plane]];
+	_spheres = new ga_sphere[shape_counts[k_shape_sphere]];
+	_aabbs = new ga_aabb[shape_counts[k_shape_aabb]];
+	_oobbs = new ga_oobb[shape_counts[k_shape_oobb]];
+
+	uint32_t shape_cursors[k_shape_count] = {};
+	for (uint32_t i = 0; i < _header->_shape_count; ++i)
+	{
+		const ga_scene_shape_t& rec = _shape_records[i];
+		const float* d = rec._data;
+		uint32_t slot = shape_cursors[rec._type]++;
+
+		switch (rec._type)
+		{
+		case k_shape_plane:
+			_planes[slot]._point = { d[0], d[1], d[2] };
+			_planes[slot]._normal = { d[3], d[4], d[5] };
+			_shapes[i] = &_planes[slot];
+			break;
+		case k_shape_sphere:
+			_spheres[slot]._center = { d[0], d[1], d[2] };
+			_spheres[slot]._radius = d[3];
+			_shapes[i] = &_spheres[slot];
+			break;
+		case k_shape_aabb:
+			_aabbs[slot]._min = { d[0], d[1], d[2] };
+			_aabbs[slot]._max = { d[3], d[4], d[5] };
+			_shapes[i] = &_aabbs[slot];
+			break;
+		case k_shape_oobb:
+			_oobbs[slot]._center = { d[0], d[1], d[2] };
+			_oobbs[slot]._half_vectors[0] = { d[3], d[4], d[5] };
+			_oobbs[slot]._half_vectors[1] = { d[6], d[7], d[8] };
+			_oobbs[slot]._half_vectors[2] = { d[9], d[10], d[11] };
+			_shapes[i] = &_oobbs[slot];
+			break;
+		}
+	}
+
+	// Components, each class constructed in place in its own block.
+	// Scripts and renderables come first so the sim updates them before physics.
+	_scripts = allocate_components<ga_lua_component>(_header->_script_count);
+	for (uint32_t i = 0; i < _header->_script_count; ++i)
+	{
+		const ga_scene_script_t& rec = _script_records[i];
+		new (&_scripts[i]) ga_lua_component(&_entities[rec._entity], get_string(rec._path));
+	}
+
+	// Render components need a graphics context, so headless instances go without.
+	uint32_t render_count = (flags & k_scene_headless) ? 0 : _header->_render_count;
+	for (uint32_t i = 0; i < render_count; ++i)
+	{
+		if (_render_records[i]._type == k_scene_render_cube) _cube_count++;
+		else _ball_count++;
+	}
+	_cubes = allocate_components<ga_cube_component>(_cube_count);
+	_balls = allocate_components<ga_ball_component>(_ball_count);
+
+	uint32_t cube = 0;
+	uint32_t ball = 0;
+	for (uint32_t i = 0; i < render_count; ++i)
+	{
+		const ga_scene_render_t& rec = _render_records[i];
+		if (rec._type == k_scene_render_cube)
+		{
+			new (&_cubes[cube++]) ga_cube_component(&_entities[rec._entity], get_string(rec._texture));
+		}
+		else
+		{
+			new (&_balls[ball++]) ga_ball_component(&_entities[rec._entity], get_string(rec._texture));
+		}
+	}
+
+	_physics = allocate_components<ga_physics_component>(_header->_body_count);
+	std::vector<ga_rigid_body*> bodies(_header->_body_count);
+	for (uint32_t i = 0; i < _header->_body_count; ++i)
+	{
+		const ga_scene_body_t& rec = _body_records[i];
+		new (&_physics[i]) ga_physics_component(&_entities[rec._entity], _shapes[rec._shape], rec._mass);
+
+		ga_rigid_body* body = _physics[i].get_rigid_body();
+		if (rec._flags & k_static) body->make_static();
+		if (rec._flags & k_weightless) body->make_weightless();
+		if (rec._flags & k_fast) body->make_fast();
+		body->add_linear_velocity(rec._velocity);
+		bodies[i] = body;
+	}
+
+	_pongs = allocate_components<ga_pong_manager>(_header->_pong_count);
+	for (uint32_t i = 0; i < _header->_pong_count; ++i)
+	{
+		const ga_scene_pong_t& rec = _pong_records[i];
+		new (&_pongs[i]) ga_pong_manager(&_entities[rec._entity], &_entities[rec._left], &_entities[rec._right], &_entities[rec._ball], rec._points);
+	}
+
+	world->add_rigid_bodies(bodies.data(), uint32_t(bodies.size()));
+	sim->add_entities(_entities, _header->_entity_count);
+}
+
+ga_entity* ga_scene::find_entity(const char* name) const
+{
+	if (!_entities) return nullptr;
+
+	for (uint32_t i = 0; i < _header->_entity_count; ++i)
+	{
+		if (strcmp(get_string(_entity_records[i]._name), name) == 0)
+		{
+			return &_entities[i];
+		}
+	}
+	return nullptr;
+}
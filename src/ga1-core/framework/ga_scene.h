@@ -0,0 +1,194 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_mat4f.h"
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+** Cooked scene layout.
+**
+** A cooked scene is a header followed by flat arrays of the records below, in
+** header order, then a table of null-terminated strings. Records refer to each
+** other by array index and to strings by byte offset into the string table.
+** Everything is 4-byte aligned so the arrays can be used in place.
+*/
+static const uint32_t k_scene_magic = 0x43534147; // 'GASC'
+static const uint32_t k_scene_version = 1;
+
+struct ga_scene_header_t
+{
+	uint32_t _magic;
+	uint32_t _version;
+	uint32_t _entity_count;
+	uint32_t _shape_count;
+	uint32_t _body_count;
+	uint32_t _render_count;
+	uint32_t _script_count;
+	uint32_t _pong_count;
+	uint32_t _string_size;
+};
+
+struct ga_scene_entity_t
+{
+	ga_mat4f _transform;
+	uint32_t _name;
+};
+
+struct ga_scene_shape_t
+{
+	uint32_t _type;
+
+	// Plane: point, normal. Sphere: center, radius. AABB: min, max.
+	// OOBB: center, then three half vectors.
+	float _data[12];
+};
+
+struct ga_scene_body_t
+{
+	uint32_t _entity;
+	uint32_t _shape;
+	float _mass;
+	uint32_t _flags;
+	ga_vec3f _velocity;
+};
+
+enum ga_scene_render_type
+{
+	k_scene_render_cube,
+	k_scene_render_ball,
+};
+
+struct ga_scene_render_t
+{
+	uint32_t _entity;
+	uint32_t _type;
+	uint32_t _texture;
+};
+
+struct ga_scene_script_t
+{
+	uint32_t _entity;
+	uint32_t _path;
+};
+
+struct ga_scene_pong_t
+{
+	uint32_t _entity;
+	uint32_t _left;
+	uint32_t _right;
+	uint32_t _ball;
+	int32_t _points;
+};
+
+/*
+** Options for instantiating a scene.
+*/
+enum ga_scene_instantiate_flags
+{
+	// Leave out render components, for instances with no window or graphics context.
+	k_scene_headless = 1 << 0,
+};
+
+/*
+** Parse a text scene and produce its cooked form.
+** Errors are reported to stderr with their line number.
+** @returns False if the text could not be parsed.
+*/
+bool ga_scene_cook(const char* text, std::vector<uint8_t>& cooked);
+
+/*
+** Cook a text scene file to a binary scene file. Paths are used as given.
+*/
+bool ga_scene_cook_file(const char* text_path, const char* cooked_path);
+
+/*
+** A scene loaded from disk or memory and the objects built from it.
+**
+** Loading only validates the cooked data and points at its arrays. Instantiating
+** then constructs each kind of object in bulk, into one allocation per kind,
+** and hands the entities and rigid bodies to the sim and world in one call each.
+**
+** The scene owns everything it instantiates. It must be destroyed before the
+** sim and physics world it was instantiated into.
+*/
+class ga_scene final
+{
+public:
+	ga_scene();
+	~ga_scene();
+
+	/*
+	** Load a scene file relative to the data root, text or cooked.
+	** Cooked files are recognized by their header.
+	*/
+	bool load_file(const char* path);
+
+	/*
+	** Load a cooked scene from memory. The data is copied into one buffer.
+	*/
+	bool load_cooked(const void* data, size_t size);
+
+	/*
+	** Build the loaded scene's entities, shapes and components and add them
+	** to the sim and physics world. Can only be done once per scene.
+	** @param flags Combination of ga_scene_instantiate_flags.
+	*/
+	void instantiate(class ga_sim* sim, class ga_physics_world* world, uint32_t flags = 0);
+
+	/*
+	** Find an instantiated entity by the name given to it in the scene.
+	*/
+	class ga_entity* find_entity(const char* name) const;
+
+	uint32_t get_entity_count() const { return _header ? _header->_entity_count : 0; }
+
+	/*
+	** The loaded scene in cooked form, for loading into further scenes.
+	*/
+	const void* get_cooked_data() const { return _buffer.data(); }
+	size_t get_cooked_size() const { return _header ? _buffer.size() : 0; }
+
+private:
+	const char* get_string(uint32_t offset) const { return _strings + offset; }
+
+	std::vector<uint8_t> _buffer;
+
+	const ga_scene_header_t* _header;
+	const ga_scene_entity_t* _entity_records;
+	const ga_scene_shape_t* _shape_records;
+	const ga_scene_body_t* _body_records;
+	const ga_scene_render_t* _render_records;
+	const ga_scene_script_t* _script_records;
+	const ga_scene_pong_t* _pong_records;
+	const char* _strings;
+
+	class ga_sim* _sim;
+	class ga_physics_world* _world;
+
+	class ga_entity* _entities;
+	struct ga_shape** _shapes;
+	struct ga_plane* _planes;
+	struct ga_sphere* _spheres;
+	struct ga_aabb* _aabbs;
+	struct ga_oobb* _oobbs;
+
+	// Components are built in place in raw storage, one block per class.
+	class ga_physics_component* _physics;
+	class ga_cube_component* _cubes;
+	class ga_ball_component* _balls;
+	class ga_lua_component* _scripts;
+	class ga_pong_manager* _pongs;
+	uint32_t _cube_count;
+	uint32_t _ball_count;
+};
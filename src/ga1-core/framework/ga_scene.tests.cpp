@@ -0,0 +1,214 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_scene.tests.h"
+#include "ga_scene.h"
+#include "ga_sim.h"
+
+#include "entity/ga_entity.h"
+
+#include "physics/ga_physics_component.h"
+#include "physics/ga_physics_world.h"
+#include "physics/ga_rigid_body.h"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+static const char* k_test_scene_text =
+	"# Two bodies and a manager.\n"
+	"entity left\n"
+	"\ttranslate -4 0 0\n"
+	"\toobb 0 0 0  1 0 0  0 2 0  0 0 0.5\n"
+	"\tbody 2 weightless static\n"
+	"\n"
+	"entity ball\n"
+	"\ttranslate 1 2 3\n"
+	"\tsphere 0 0 0 0.5\n"
+	"\tbody 1 weightless fast\n"
+	"\tvelocity 3 -1 0\n"
+	"\n"
+	"entity manager\n"
+	"\tpong left left ball 3\n";
+
+// Byte offsets of the records in the test scene once cooked.
+static const size_t k_test_scene_entities = sizeof(ga_scene_header_t);
+static const size_t k_test_scene_shapes = k_test_scene_entities + 3 * sizeof(ga_scene_entity_t);
+static const size_t k_test_scene_bodies = k_test_scene_shapes + 2 * sizeof(ga_scene_shape_t);
+
+static bool load_test_scene(const std::vector<uint8_t>& cooked)
+{
+	ga_scene scene;
+	return scene.load_cooked(cooked.data(), cooked.size());
+}
+
+template<typename T>
+static T* test_scene_record(std::vector<uint8_t>& cooked, size_t offset)
+{
+	return reinterpret_cast<T*>(cooked.data() + offset);
+}
+
+static void test_scene_cook()
+{
+	std::vector<uint8_t> cooked;
+	assert(ga_scene_cook(k_test_scene_text, cooked));
+
+	const ga_scene_header_t* header = test_scene_record<ga_scene_header_t>(cooked, 0);
+	assert(header->_magic == k_scene_magic);
+	assert(header->_version == k_scene_version);
+	assert(header->_entity_count == 3);
+	assert(header->_shape_count == 2);
+	assert(header->_body_count == 2);
+	assert(header->_render_count == 0);
+	assert(header->_script_count == 0);
+	assert(header->_pong_count == 1);
+	assert(header->_string_size % 4 == 0);
+
+	ga_sim sim;
+	ga_physics_world world;
+	{
+		ga_scene scene;
+		assert(scene.load_cooked(cooked.data(), cooked.size()));
+		assert(scene.get_entity_count() == 3);
+		assert(scene.get_cooked_size() == cooked.size());
+		scene.instantiate(&sim, &world, k_scene_headless);
+
+		assert(scene.find_entity("missing") == nullptr);
+		ga_entity* ball = scene.find_entity("ball");
+		assert(ball);
+		ga_vec3f position = ball->get_transform().get_translation();
+		assert(position.x == 1.0f && position.y == 2.0f && position.z == 3.0f);
+
+		ga_rigid_body* body = ball->get_component<ga_physics_component>()->get_rigid_body();
+		ga_vec3f velocity = body->get_linear_velocity();
+		assert(velocity.x == 3.0f && velocity.y == -1.0f && velocity.z == 0.0f);
+		assert((body->get_flags() & (k_fast | k_weightless)) == (k_fast | k_weightless));
+
+		ga_entity* left = scene.find_entity("left");
+		assert(left && (left->get_component<ga_physics_component>()->get_rigid_body()->get_flags() & k_static));
+	}
+}
+
+static void test_scene_cook_errors()
+{
+	// Each of these reports its error to stderr as it fails.
+	const char* bad_scenes[] =
+	{
+		// Something before the first entity.
+		"translate 1 2 3\n",
+		// An unknown keyword.
+		"entity a\n\tteleport 1 2 3\n",
+		// A name used twice.
+		"entity a\nentity a\n",
+		// A body with no shape.
+		"entity a\n\tbody 1\n",
+		// An unknown body flag.
+		"entity a\n\tsphere 0 0 0 1\n\tbody 1 heavy\n",
+		// Velocity with no body.
+		"entity a\n\tvelocity 1 0 0\n",
+		// Too few numbers.
+		"entity a\n\toobb 0 0 0  1 0 0  0 1 0\n",
+		// A manager naming an entity that does not exist.
+		"entity a\n\tpong a a b 3\n",
+	};
+
+	std::vector<uint8_t> cooked;
+	for (const char* text : bad_scenes)
+	{
+		assert(!ga_scene_cook(text, cooked));
+	}
+
+	// Empty scenes are fine.
+	assert(ga_scene_cook("# Nothing here.\n", cooked));
+	assert(load_test_scene(cooked));
+}
+
+static void test_scene_malformed()
+{
+	std::vector<uint8_t> cooked;
+	assert(ga_scene_cook(k_test_scene_text, cooked));
+	assert(load_test_scene(cooked));
+
+	// Cut short anywhere, including inside the header, or with bytes left over.
+	for (size_t size : { size_t(0), sizeof(ga_scene_header_t) - 1, sizeof(ga_scene_header_t), k_test_scene_bodies, cooked.size() - 1 })
+	{
+		std::vector<uint8_t> truncated(cooked.begin(), cooked.begin() + size);
+		assert(!load_test_scene(truncated));
+	}
+	{
+		std::vector<uint8_t> padded = cooked;
+		padded.push_back(0);
+		assert(!load_test_scene(padded));
+	}
+
+	// Not a cooked scene, or a different version of one.
+	{
+		std::vector<uint8_t> bad = cooked;
+		test_scene_record<ga_scene_header_t>(bad, 0)->_magic ^= 1;
+		assert(!load_test_scene(bad));
+	}
+	{
+		std::vector<uint8_t> bad = cooked;
+		test_scene_record<ga_scene_header_t>(bad, 0)->_version++;
+		assert(!load_test_scene(bad));
+	}
+
+	// Counts that do not add up to the size.
+	{
+		std::vector<uint8_t> bad = cooked;
+		test_scene_record<ga_scene_header_t>(bad, 0)->_entity_count++;
+		assert(!load_test_scene(bad));
+	}
+	{
+		std::vector<uint8_t> bad = cooked;
+		test_scene_record<ga_scene_header_t>(bad, 0)->_string_size = 0xfffffff0;
+		assert(!load_test_scene(bad));
+	}
+
+	// Indices and string offsets out of range.
+	{
+		std::vector<uint8_t> bad = cooked;
+		test_scene_record<ga_scene_entity_t>(bad, k_test_scene_entities)->_name = test_scene_record<ga_scene_header_t>(bad, 0)->_string_size;
+		assert(!load_test_scene(bad));
+	}
+	{
+		std::vector<uint8_t> bad = cooked;
+		test_scene_record<ga_scene_shape_t>(bad, k_test_scene_shapes)->_type = 0xff;
+		assert(!load_test_scene(bad));
+	}
+	{
+		std::vector<uint8_t> bad = cooked;
+		test_scene_record<ga_scene_body_t>(bad, k_test_scene_bodies)->_entity = 3;
+		assert(!load_test_scene(bad));
+	}
+	{
+		std::vector<uint8_t> bad = cooked;
+		test_scene_record<ga_scene_body_t>(bad, k_test_scene_bodies + sizeof(ga_scene_body_t))->_shape = 2;
+		assert(!load_test_scene(bad));
+	}
+	{
+		std::vector<uint8_t> bad = cooked;
+		test_scene_record<ga_scene_pong_t>(bad, k_test_scene_bodies + 2 * sizeof(ga_scene_body_t))->_ball = 0xffffffff;
+		assert(!load_test_scene(bad));
+	}
+
+	// A string table that does not end in a terminator.
+	{
+		std::vector<uint8_t> bad = cooked;
+		bad.back() = 'x';
+		assert(!load_test_scene(bad));
+	}
+}
+
+void ga_scene_unit_tests()
+{
+	test_scene_cook();
+	test_scene_cook_errors();
+	test_scene_malformed();
+}
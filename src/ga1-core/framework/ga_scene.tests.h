@@ -0,0 +1,16 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Check text scenes cook and instantiate as written, and that bad text and
+** malformed or truncated cooked data are turned away.
+*/
+void ga_scene_unit_tests();
@@ -0,0 +1,302 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_sim.benchmarks.h"
+#include "ga_frame_params.h"
+#include "ga_sim.h"
+
+#include "entity/ga_component.h"
+#include "entity/ga_entity.h"
+#include "jobs/ga_job.h"
+#include "math/ga_math.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+static const uint32_t k_benchmark_entity_count = 100000;
+static const uint32_t k_benchmark_frame_count = 100;
+
+/*
+** Moves its entity at a constant velocity, through the virtual component path.
+*/
+class ga_benchmark_move_component : public ga_component
+{
+public:
+	ga_benchmark_move_component(ga_entity* ent, const ga_vec3f& velocity) : ga_component(ent), _velocity(velocity) {}
+
+	virtual void update(ga_frame_params* params) override
+	{
+		float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
+		get_entity()->translate(_velocity.scale_result(dt));
+	}
+
+private:
+	ga_vec3f _velocity;
+};
+
+/*
+** The same component, opted in to batched updates.
+*/
+class ga_benchmark_batched_move_component : public ga_component
+{
+public:
+	ga_benchmark_batched_move_component(ga_entity* ent, const ga_vec3f& velocity)
+		: ga_component(ent, ga_component_batched<ga_benchmark_batched_move_component>::get_type()), _velocity(velocity) {}
+
+	static void update_batch(ga_benchmark_batched_move_component* const* components, uint32_t count, ga_frame_params* params)
+	{
+		float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			components[i]->get_entity()->translate(components[i]->_velocity.scale_result(dt));
+		}
+	}
+
+private:
+	ga_vec3f _velocity;
+};
+
+/*
+** The same work as plain data, for the component store path.
+*/
+struct ga_benchmark_move_data
+{
+	ga_mat4f _transform;
+	ga_vec3f _velocity;
+};
+
+static void benchmark_move_system(ga_benchmark_move_data* components, const uint32_t*, uint32_t count, ga_frame_params* params)
+{
+	float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		components[i]._transform.translate(components[i]._velocity.scale_result(dt));
+	}
+}
+
+static ga_vec3f benchmark_velocity(uint32_t i)
+{
+	return { float(i % 7), float(i % 11), float(i % 13) };
+}
+
+static double time_frames(ga_sim& sim)
+{
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < k_benchmark_frame_count; ++frame)
+	{
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(16);
+		sim.update(&params);
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::milli>(t1 - t0).count() / k_benchmark_frame_count;
+}
+
+void ga_sim_component_store_benchmarks()
+{
+	// Virtual components owned by entities, updated through ga_sim.
+	{
+		std::vector<ga_entity> entities(k_benchmark_entity_count);
+		std::vector<ga_benchmark_move_component*> components;
+		components.reserve(k_benchmark_entity_count);
+
+		ga_sim sim;
+		for (uint32_t i = 0; i < k_benchmark_entity_count; ++i)
+		{
+			components.push_back(new ga_benchmark_move_component(&entities[i], benchmark_velocity(i)));
+			sim.add_entity(&entities[i]);
+		}
+
+		double ms = time_frames(sim);
+		printf("ga_sim virtual components: %u entities, %.3f ms/frame\n", k_benchmark_entity_count, ms);
+
+		for (auto c : components)
+		{
+			delete c;
+		}
+	}
+
+	// The same entities as data in the component store.
+	{
+		ga_sim sim;
+		ga_component_store* store = sim.get_component_store();
+		store->get_pool<ga_benchmark_move_data>()->reserve(k_benchmark_entity_count);
+		store->add_system<ga_benchmark_move_data>(benchmark_move_system);
+
+		for (uint32_t i = 0; i < k_benchmark_entity_count; ++i)
+		{
+			ga_benchmark_move_data data;
+			data._transform.make_identity();
+			data._velocity = benchmark_velocity(i);
+			store->add(i, data);
+		}
+
+		double ms = time_frames(sim);
+		printf("ga_sim component store: %u entities, %.3f ms/frame\n", k_benchmark_entity_count, ms);
+	}
+}
+
+struct benchmark_entity_batch_t
+{
+	ga_entity** _entities;
+	uint32_t _count;
+	ga_frame_params* _params;
+};
+
+/*
+** Entity-by-entity update, each job walking a run of entities and calling
+** into each of their components. This is how ga_sim updated before batching.
+** The sim is only used for its transform pass.
+*/
+static double time_entity_jobs(ga_sim& sim, std::vector<ga_entity*>& entities)
+{
+	const uint32_t k_min_per_job = 16;
+	const uint32_t k_max_jobs = 128;
+
+	uint32_t count = uint32_t(entities.size());
+	uint32_t batch_size = ga_max(k_min_per_job, (count + k_max_jobs - 1) / k_max_jobs);
+	uint32_t batch_count = (count + batch_size - 1) / batch_size;
+	std::vector<ga_job_decl_t> decls(batch_count);
+	std::vector<benchmark_entity_batch_t> batches(batch_count);
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < k_benchmark_frame_count; ++frame)
+	{
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(16);
+
+		sim.update_transforms();
+
+		for (uint32_t i = 0; i < batch_count; ++i)
+		{
+			uint32_t begin = i * batch_size;
+			batches[i]._entities = entities.data() + begin;
+			batches[i]._count = ga_min(count - begin, batch_size);
+			batches[i]._params = &params;
+
+			decls[i]._data = &batches[i];
+			decls[i]._entry = [](void* data)
+			{
+				auto batch = static_cast<benchmark_entity_batch_t*>(data);
+				for (uint32_t j = 0; j < batch->_count; ++j)
+				{
+					batch->_entities[j]->update(batch->_params);
+				}
+			};
+		}
+
+		int32_t counter;
+		ga_job::run(decls.data(), int(batch_count), &counter);
+		ga_job::wait(&counter);
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::milli>(t1 - t0).count() / k_benchmark_frame_count;
+}
+
+void ga_sim_component_batch_benchmarks()
+{
+	// Before: per-entity jobs calling each component's virtual update.
+	{
+		std::vector<ga_entity> entities(k_benchmark_entity_count);
+		std::vector<ga_entity*> entity_ptrs;
+		std::vector<ga_benchmark_move_component*> components;
+		components.reserve(k_benchmark_entity_count);
+
+		ga_sim sim;
+		for (uint32_t i = 0; i < k_benchmark_entity_count; ++i)
+		{
+			components.push_back(new ga_benchmark_move_component(&entities[i], benchmark_velocity(i)));
+			sim.add_entity(&entities[i]);
+			entity_ptrs.push_back(&entities[i]);
+		}
+
+		double ms = time_entity_jobs(sim, entity_ptrs);
+		printf("ga_sim per-entity jobs: %u entities, %.3f ms/frame\n", k_benchmark_entity_count, ms);
+
+		for (auto c : components)
+		{
+			delete c;
+		}
+	}
+
+	// After: the sim's type buckets, with the batched component type.
+	{
+		std::vector<ga_entity> entities(k_benchmark_entity_count);
+		std::vector<ga_benchmark_batched_move_component*> components;
+		components.reserve(k_benchmark_entity_count);
+
+		ga_sim sim;
+		for (uint32_t i = 0; i < k_benchmark_entity_count; ++i)
+		{
+			components.push_back(new ga_benchmark_batched_move_component(&entities[i], benchmark_velocity(i)));
+			sim.add_entity(&entities[i]);
+		}
+
+		double ms = time_frames(sim);
+		printf("ga_sim batched components: %u entities, %.3f ms/frame\n", k_benchmark_entity_count, ms);
+
+		for (auto c : components)
+		{
+			delete c;
+		}
+	}
+}
+
+void ga_sim_update_tier_benchmarks()
+{
+	// The same scene with every component updated every frame, then with three
+	// quarters of them moved to the lower tiers. Tiers are given to contiguous
+	// ranges of entities, as when a region of the scene is far from the camera.
+	for (int tiered = 0; tiered < 2; ++tiered)
+	{
+		std::vector<ga_entity> entities(k_benchmark_entity_count);
+		std::vector<ga_benchmark_batched_move_component*> components;
+		components.reserve(k_benchmark_entity_count);
+
+		ga_sim sim;
+		for (uint32_t i = 0; i < k_benchmark_entity_count; ++i)
+		{
+			auto comp = new ga_benchmark_batched_move_component(&entities[i], benchmark_velocity(i));
+			if (tiered)
+			{
+				uint32_t quarter = i * 4 / k_benchmark_entity_count;
+				comp->set_update_tier(quarter == 0 ? k_update_every_frame : quarter == 1 ? k_update_every_2nd_frame : k_update_every_4th_frame);
+			}
+			components.push_back(comp);
+			sim.add_entity(&entities[i]);
+		}
+
+		double total_ms = 0.0;
+		double max_ms = 0.0;
+		for (uint32_t frame = 0; frame < k_benchmark_frame_count; ++frame)
+		{
+			ga_frame_params params;
+			params._delta_time = std::chrono::milliseconds(16);
+
+			auto t0 = std::chrono::high_resolution_clock::now();
+			sim.update(&params);
+			auto t1 = std::chrono::high_resolution_clock::now();
+
+			double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+			total_ms += ms;
+			max_ms = ga_max(max_ms, ms);
+		}
+
+		printf("ga_sim %s: %u entities, %.3f ms/frame average, %.3f ms worst\n",
+			tiered ? "tiered updates" : "every-frame updates", k_benchmark_entity_count, total_ms / k_benchmark_frame_count, max_ms);
+
+		for (auto c : components)
+		{
+			delete c;
+		}
+	}
+}
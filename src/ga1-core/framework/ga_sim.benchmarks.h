@@ -0,0 +1,14 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+void ga_sim_component_store_benchmarks();
+void ga_sim_component_batch_benchmarks();
+void ga_sim_update_tier_benchmarks();
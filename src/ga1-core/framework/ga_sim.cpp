@@ -9,17 +9,58 @@
 
 #include "ga_sim.h"
 
-#include "ga_compiler_defines.h"
-
 #include "entity/ga_entity.h"
-#include "jobs/ga_job.h"
+#include "math/ga_math.h"
+
+#include <algorithm>
+#include <cassert>
+
+// Smallest number of components updated by a single job.
+static const uint32_t k_min_components_per_job = 16;
+
+// Cap on jobs per pass, to stay well within the job queue.
+static const uint32_t k_max_component_jobs = 128;
+
+// Bucket slot for components constructed without a type id.
+static const uint32_t k_untyped_bucket_slot = k_max_component_types;
+
+static const uint32_t k_no_bucket = 0xffffffff;
+
+// Buckets per component type: one for every frame, one per phase of the
+// every 2nd and every 4th frame tiers, and one for on demand.
+static const uint32_t k_bucket_keys_per_slot = 8;
+static const uint32_t k_tier_periods[] = { 1, 2, 4, 1 };
+static const uint32_t k_tier_first_key[] = { 0, 1, 3, 7 };
+
+static uint32_t get_bucket_key(ga_component_type_t type, ga_update_tier_t tier, uint32_t phase)
+{
+	uint32_t slot = type < k_max_component_types ? type : k_untyped_bucket_slot;
+	return slot * k_bucket_keys_per_slot + k_tier_first_key[tier] + phase;
+}
 
-#if defined(GA_MINGW)
-#include <malloc.h>
-#endif
+// Hierarchy levels smaller than this are updated inline rather than in jobs.
+static const uint32_t k_min_transforms_per_job = 256;
 
-ga_sim::ga_sim()
+// Batch functions for types that have not opted in; plain virtual dispatch.
+static void virtual_update(ga_component* const* components, uint32_t count, ga_frame_params* params)
 {
+	for (uint32_t i = 0; i < count; ++i) components[i]->update(params);
+}
+
+static void virtual_late_update(ga_component* const* components, uint32_t count, ga_frame_params* params)
+{
+	for (uint32_t i = 0; i < count; ++i) components[i]->late_update(params);
+}
+
+ga_sim::ga_sim(uint32_t pooled_entity_capacity) :
+	_entity_manager(this, pooled_entity_capacity),
+	_bucket_of_key((k_max_component_types + 1) * k_bucket_keys_per_slot, k_no_bucket)
+{
+	for (auto& dt : _recent_delta_times)
+	{
+		dt = std::chrono::high_resolution_clock::duration::zero();
+	}
+	_sim_time = std::chrono::high_resolution_clock::duration::zero();
 }
 
 ga_sim::~ga_sim()
@@ -28,69 +69,411 @@ ga_sim::~ga_sim()
 
 void ga_sim::add_entity(ga_entity* ent)
 {
+	assert(!ent->_sim);
+
+	// Ids key the component store, so they are recycled to keep it dense.
+	if (!_free_entity_ids.empty())
+	{
+		ent->_id = _free_entity_ids.back();
+		_free_entity_ids.pop_back();
+	}
+	else
+	{
+		ent->_id = _next_entity_id++;
+	}
+	ent->_sim = this;
 	_entities.push_back(ent);
+
+	for (auto c : ent->_components)
+	{
+		on_component_added(c);
+	}
+
+	_transform_order_dirty = true;
 }
 
-void ga_sim::update(ga_frame_params* params)
+void ga_sim::add_entities(ga_entity* ents, uint32_t count)
+{
+	_entities.reserve(_entities.size() + count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		add_entity(&ents[i]);
+	}
+}
+
+void ga_sim::remove_entities(ga_entity* const* ents, uint32_t count)
+{
+	if (count == 0) return;
+
+	// Clearing the sim pointer marks an entity as removed for the passes below.
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		ga_entity* ent = ents[i];
+		assert(ent->_sim == this);
+
+		_store.remove_entity(ent->_id);
+		_free_entity_ids.push_back(ent->_id);
+		ent->_sim = nullptr;
+		ent->_id = 0xffffffff;
+	}
+
+	auto removed = [this](const ga_entity* ent) { return ent->_sim != this; };
+
+	_entities.erase(std::remove_if(_entities.begin(), _entities.end(), removed), _entities.end());
+
+	for (auto& bucket : _buckets)
+	{
+		auto removed_comp = [&removed](const ga_component* c) { return removed(c->get_entity()); };
+		auto& comps = bucket._components;
+		comps.erase(std::remove_if(comps.begin(), comps.end(), removed_comp), comps.end());
+		auto& requested = bucket._requested;
+		requested.erase(std::remove_if(requested.begin(), requested.end(), removed_comp), requested.end());
+	}
+
+	for (auto ent : _entities)
+	{
+		if (ent->_parent && removed(ent->_parent))
+		{
+			ent->_parent = nullptr;
+			ent->_transform = ent->_world_transform;
+			ent->_transform_dirty = true;
+		}
+	}
+
+	_transform_order_dirty = true;
+}
+
+void ga_sim::on_component_added(ga_component* comp)
 {
-	// Create jobs that update all entities in parallel (one job per entity).
-	// There are 2 components:
-	// 1. The job declarations; a function and a pointer to data for that function.
-	// 2. The data for each job; an entity and the frame_params.
+	ga_component_type_t type = comp->get_type();
+	ga_update_tier_t tier = comp->get_update_tier();
 
-	auto decls = static_cast<ga_job_decl_t*>(alloca(sizeof(ga_job_decl_t) * _entities.size()));
+	// Spread lower tiers evenly by joining the least populated phase.
+	uint32_t phase = 0;
+	size_t phase_size = SIZE_MAX;
+	for (uint32_t p = 0; p < k_tier_periods[tier]; ++p)
+	{
+		uint32_t index = _bucket_of_key[get_bucket_key(type, tier, p)];
+		size_t size = index == k_no_bucket ? 0 : _buckets[index]._components.size();
+		if (size < phase_size)
+		{
+			phase = p;
+			phase_size = size;
+		}
+	}
 
-	struct update_data_t
+	uint32_t key = get_bucket_key(type, tier, phase);
+	if (_bucket_of_key[key] == k_no_bucket)
 	{
-		ga_entity* _entity;
-		ga_frame_params* _params;
-	};
-	auto update_data = static_cast<update_data_t*>(alloca(sizeof(update_data_t) * _entities.size()));
+		component_bucket_t bucket;
+		bucket._type = type;
+		bucket._tier = tier;
+		bucket._phase = phase;
+
+		const ga_component_batch_funcs_t* funcs = ga_component::get_batch_funcs(type);
+		if (funcs)
+		{
+			bucket._funcs = *funcs;
+		}
+		else
+		{
+			bucket._funcs._update = virtual_update;
+			bucket._funcs._late_update = virtual_late_update;
+		}
 
-	for (int i = 0; i < _entities.size(); ++i)
+		_bucket_of_key[key] = uint32_t(_buckets.size());
+		_buckets.push_back(bucket);
+	}
+
+	component_bucket_t& bucket = _buckets[_bucket_of_key[key]];
+	bucket._components.push_back(comp);
+	if (tier == k_update_on_demand)
 	{
-		update_data[i]._entity = _entities[i];
-		update_data[i]._params = params;
+		bucket._last_update_times.push_back(_sim_time);
+	}
+	comp->_update_phase = uint8_t(phase);
+}
 
-		decls[i]._data = update_data + i;
-		decls[i]._entry = [](void* data)
+void ga_sim::on_component_removed(ga_component* comp)
+{
+	uint32_t index = _bucket_of_key[get_bucket_key(comp->get_type(), comp->get_update_tier(), comp->_update_phase)];
+	assert(index != k_no_bucket);
+
+	component_bucket_t& bucket = _buckets[index];
+	auto it = std::find(bucket._components.begin(), bucket._components.end(), comp);
+	if (bucket._tier == k_update_on_demand)
+	{
+		bucket._last_update_times.erase(bucket._last_update_times.begin() + (it - bucket._components.begin()));
+
+		auto requested = std::find(bucket._requested.begin(), bucket._requested.end(), comp);
+		if (requested != bucket._requested.end())
 		{
-			auto update_data = static_cast<update_data_t*>(data);
-			update_data->_entity->update(update_data->_params);
-		};
+			bucket._requested_delta_times.erase(bucket._requested_delta_times.begin() + (requested - bucket._requested.begin()));
+			bucket._requested.erase(requested);
+		}
 	}
+	bucket._components.erase(it);
+}
 
-	// Dispatch the jobs:
-	int32_t update_counter;
-	ga_job::run(decls, int(_entities.size()), &update_counter);
-	ga_job::wait(&update_counter);
+void ga_sim::update(ga_frame_params* params)
+{
+	// Frame sync point for entities spawned and despawned during the last frame.
+	_entity_manager.sync();
+
+	_frame_index++;
+	_recent_delta_times[_frame_index % 4] = params->_delta_time;
+	_sim_time += params->_delta_time;
+
+	update_transforms();
+
+	// Update components one type at a time, each type split across jobs.
+	run_component_buckets(params, false);
+
+	// Then run the systems over the data-oriented components.
+	_store.run_systems(params);
 }
 
 void ga_sim::late_update(ga_frame_params* params)
 {
-	auto decls = static_cast<ga_job_decl_t*>(alloca(sizeof(ga_job_decl_t) * _entities.size()));
+	run_component_buckets(params, true);
+
+	update_transforms();
+}
+
+void ga_sim::update_transforms()
+{
+	if (_transform_order_dirty)
+	{
+		build_transform_order();
+	}
+
+	// Walk the hierarchy one depth level at a time. Nodes within a level only
+	// read from the level above, so each level can be split across jobs.
+	for (uint32_t level = 0; level + 1 < _transform_level_offsets.size(); ++level)
+	{
+		uint32_t begin = _transform_level_offsets[level];
+		uint32_t end = _transform_level_offsets[level + 1];
+		uint32_t count = end - begin;
+
+		if (count < k_min_transforms_per_job * 2)
+		{
+			update_transform_range(begin, end);
+			continue;
+		}
+
+		uint32_t batch_size = ga_max(k_min_transforms_per_job, (count + k_max_component_jobs - 1) / k_max_component_jobs);
+		uint32_t batch_count = (count + batch_size - 1) / batch_size;
+		_transform_decls.resize(batch_count);
+		_transform_batches.resize(batch_count);
+
+		for (uint32_t i = 0; i < batch_count; ++i)
+		{
+			_transform_batches[i]._sim = this;
+			_transform_batches[i]._begin = begin + i * batch_size;
+			_transform_batches[i]._end = ga_min(end, begin + (i + 1) * batch_size);
+
+			_transform_decls[i]._data = &_transform_batches[i];
+			_transform_decls[i]._entry = [](void* data)
+			{
+				auto batch = static_cast<transform_batch_t*>(data);
+				batch->_sim->update_transform_range(batch->_begin, batch->_end);
+			};
+		}
+
+		int32_t transform_counter;
+		ga_job::run(_transform_decls.data(), int(batch_count), &transform_counter);
+		ga_job::wait(&transform_counter);
+	}
+}
+
+void ga_sim::build_transform_order()
+{
+	// Assign each entity a depth by walking its parent chain.
+	uint32_t count = uint32_t(_entities.size());
+	std::vector<uint32_t> depths(count);
+	uint32_t max_depth = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t depth = 0;
+		for (ga_entity* p = _entities[i]->_parent; p; p = p->_parent)
+		{
+			assert(p->_sim == this);
+			++depth;
+		}
+		depths[i] = depth;
+		max_depth = ga_max(max_depth, depth);
+	}
+
+	// Counting sort by depth, keeping the sim's entity order within a level.
+	_transform_level_offsets.assign(max_depth + 2, 0);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		_transform_level_offsets[depths[i] + 1]++;
+	}
+	for (uint32_t level = 1; level < _transform_level_offsets.size(); ++level)
+	{
+		_transform_level_offsets[level] += _transform_level_offsets[level - 1];
+	}
+
+	std::vector<uint32_t> cursor(_transform_level_offsets.begin(), _transform_level_offsets.end() - 1);
+	std::vector<int32_t> node_of_entity(_next_entity_id);
+	_transform_nodes.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t node = cursor[depths[i]]++;
+		node_of_entity[_entities[i]->_id] = int32_t(node);
+		_transform_nodes[node]._entity = _entities[i];
+	}
+
+	// Parents are resolved to node indices so the update pass never chases parent pointers.
+	for (uint32_t node = 0; node < count; ++node)
+	{
+		ga_entity* parent = _transform_nodes[node]._entity->_parent;
+		_transform_nodes[node]._parent = parent ? node_of_entity[parent->_id] : -1;
+	}
+
+	// Everything is recomputed once after a change in structure.
+	_transform_changed.assign(count, 1);
+	for (auto& n : _transform_nodes)
+	{
+		n._entity->_transform_dirty = true;
+	}
+
+	_transform_order_dirty = false;
+}
+
+void ga_sim::update_transform_range(uint32_t begin, uint32_t end)
+{
+	for (uint32_t node = begin; node < end; ++node)
+	{
+		const transform_node_t& n = _transform_nodes[node];
+		ga_entity* ent = n._entity;
+
+		bool changed = ent->_transform_dirty;
+		if (n._parent >= 0)
+		{
+			changed = changed || _transform_changed[n._parent];
+			if (changed)
+			{
+				ent->_world_transform = ent->_transform * _transform_nodes[n._parent]._entity->_world_transform;
+			}
+		}
+
+		_transform_changed[node] = changed ? 1 : 0;
+		ent->_transform_dirty = false;
+	}
+}
 
-	struct update_data_t
+void ga_sim::run_component_buckets(ga_frame_params* params, bool late)
+{
+	// Buckets run in order, so components of different types never run at the same time.
+	for (auto& bucket : _buckets)
 	{
-		ga_entity* _entity;
-		ga_frame_params* _params;
-	};
-	auto update_data = static_cast<update_data_t*>(alloca(sizeof(update_data_t) * _entities.size()));
+		ga_component* const* components = bucket._components.data();
+		uint32_t count = uint32_t(bucket._components.size());
+		uint32_t period = k_tier_periods[bucket._tier];
+
+		if (bucket._tier == k_update_on_demand)
+		{
+			run_on_demand_bucket(bucket, params, late);
+			continue;
+		}
 
-	for (int i = 0; i < _entities.size(); ++i)
+		if (_frame_index % period != bucket._phase) continue;
+		if (count == 0) continue;
+
+		// Lower tiers see the time that passed since they last ran.
+		auto frame_delta_time = params->_delta_time;
+		if (period > 1)
+		{
+			params->_delta_time = std::chrono::high_resolution_clock::duration::zero();
+			for (uint32_t i = 0; i < period; ++i)
+			{
+				params->_delta_time += _recent_delta_times[(_frame_index - i) % 4];
+			}
+		}
+
+		run_component_batches(bucket, components, count, params, late);
+
+		params->_delta_time = frame_delta_time;
+	}
+}
+
+void ga_sim::run_on_demand_bucket(component_bucket_t& bucket, ga_frame_params* params, bool late)
+{
+	// Collect requests once per frame; late update sees the same set and
+	// the same times.
+	if (!late)
+	{
+		std::vector<on_demand_request_t>& requests = _on_demand_requests;
+		requests.clear();
+		for (size_t i = 0; i < bucket._components.size(); ++i)
+		{
+			ga_component* c = bucket._components[i];
+			if (c->_update_requested.exchange(false, std::memory_order_relaxed))
+			{
+				requests.push_back({ _sim_time - bucket._last_update_times[i], c });
+				bucket._last_update_times[i] = _sim_time;
+			}
+		}
+
+		// Components requested on the same frames have gone equally long
+		// without an update, so sorting by that time keeps them together.
+		std::stable_sort(requests.begin(), requests.end(), [](const on_demand_request_t& a, const on_demand_request_t& b)
+		{
+			return a._delta_time < b._delta_time;
+		});
+
+		bucket._requested.clear();
+		bucket._requested_delta_times.clear();
+		for (const auto& r : requests)
+		{
+			bucket._requested.push_back(r._component);
+			bucket._requested_delta_times.push_back(r._delta_time);
+		}
+	}
+
+	// Each component sees the time since it was last updated.
+	auto frame_delta_time = params->_delta_time;
+	uint32_t count = uint32_t(bucket._requested.size());
+	for (uint32_t begin = 0; begin < count;)
 	{
-		update_data[i]._entity = _entities[i];
-		update_data[i]._params = params;
+		uint32_t end = begin + 1;
+		while (end < count && bucket._requested_delta_times[end] == bucket._requested_delta_times[begin]) ++end;
 
-		decls[i]._data = update_data + i;
-		decls[i]._entry = [](void* data)
+		params->_delta_time = bucket._requested_delta_times[begin];
+		run_component_batches(bucket, bucket._requested.data() + begin, end - begin, params, late);
+		begin = end;
+	}
+	params->_delta_time = frame_delta_time;
+}
+
+void ga_sim::run_component_batches(const component_bucket_t& bucket, ga_component* const* components, uint32_t count, ga_frame_params* params, bool late)
+{
+	// Create jobs that each update a contiguous run of components.
+	uint32_t batch_size = ga_max(k_min_components_per_job, (count + k_max_component_jobs - 1) / k_max_component_jobs);
+	uint32_t batch_count = (count + batch_size - 1) / batch_size;
+	_component_decls.resize(batch_count);
+	_component_batches.resize(batch_count);
+
+	for (uint32_t i = 0; i < batch_count; ++i)
+	{
+		uint32_t begin = i * batch_size;
+		_component_batches[i]._func = late ? bucket._funcs._late_update : bucket._funcs._update;
+		_component_batches[i]._components = components + begin;
+		_component_batches[i]._count = ga_min(count - begin, batch_size);
+		_component_batches[i]._params = params;
+
+		_component_decls[i]._data = &_component_batches[i];
+		_component_decls[i]._entry = [](void* data)
 		{
-			auto update_data = static_cast<update_data_t*>(data);
-			update_data->_entity->late_update(update_data->_params);
+			auto batch = static_cast<component_batch_t*>(data);
+			batch->_func(batch->_components, batch->_count, batch->_params);
 		};
 	}
 
+	// Dispatch the jobs:
 	int32_t update_counter;
-	ga_job::run(decls, int(_entities.size()), &update_counter);
+	ga_job::run(_component_decls.data(), int(batch_count), &update_counter);
 	ga_job::wait(&update_counter);
 }
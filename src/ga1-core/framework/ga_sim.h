@@ -9,23 +9,153 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 
+#include "entity/ga_component.h"
+#include "entity/ga_component_store.h"
+#include "entity/ga_entity_manager.h"
+#include "jobs/ga_job.h"
+
+#include <chrono>
 #include <vector>
 
 /*
 ** Represents the simulation stage of the frame.
-** Owns the entities.
+** Owns the entities and the data-oriented component store.
+**
+** Components are updated grouped by concrete type rather than entity by entity,
+** using a type's batch functions when it provides them. Components that update
+** less than every frame are split by phase so each frame does a similar share.
+**
+** Entities can either be added directly, in which case the caller owns them,
+** or spawned from the sim's entity manager at runtime.
+** @see ga_component_batched
+** @see ga_entity_manager
 */
 class ga_sim
 {
 public:
-	ga_sim();
+	ga_sim(uint32_t pooled_entity_capacity = k_default_pooled_entity_capacity);
 	~ga_sim();
 
 	void add_entity(class ga_entity* ent);
 
+	/*
+	** Add a contiguous array of entities, in array order.
+	*/
+	void add_entities(class ga_entity* ents, uint32_t count);
+
+	/*
+	** Remove entities from the sim in one pass. Update order of the remaining
+	** entities is unchanged. Children of removed entities are detached and
+	** keep their world transform.
+	** Must not be called while the sim is updating.
+	*/
+	void remove_entities(class ga_entity* const* ents, uint32_t count);
+
 	void update(struct ga_frame_params* params);
 	void late_update(struct ga_frame_params* params);
 
+	ga_component_store* get_component_store() { return &_store; }
+	ga_entity_manager* get_entity_manager() { return &_entity_manager; }
+
+	/*
+	** Recompute world transforms of entities whose local transform, or that of
+	** an ancestor, changed since the last pass.
+	** Runs at the start of update and the end of late_update.
+	*/
+	void update_transforms();
+
 private:
+	/*
+	** Entry in the depth-sorted transform array.
+	** Parents always come before their children.
+	*/
+	struct transform_node_t
+	{
+		class ga_entity* _entity;
+		int32_t _parent;
+	};
+
+	struct transform_batch_t
+	{
+		ga_sim* _sim;
+		uint32_t _begin;
+		uint32_t _end;
+	};
+
+	/*
+	** All components of one concrete type, update tier and phase.
+	*/
+	struct component_bucket_t
+	{
+		ga_component_type_t _type;
+		ga_update_tier_t _tier;
+		uint32_t _phase;
+		ga_component_batch_funcs_t _funcs;
+		std::vector<class ga_component*> _components;
+
+		// For on-demand buckets, the sim time each component last ran or
+		// joined at, indexed like _components. Then the components requested
+		// this frame with the time each has gone without an update, grouped
+		// so that runs of equal times can share a batch.
+		std::vector<std::chrono::high_resolution_clock::duration> _last_update_times;
+		std::vector<class ga_component*> _requested;
+		std::vector<std::chrono::high_resolution_clock::duration> _requested_delta_times;
+	};
+
+	struct on_demand_request_t
+	{
+		std::chrono::high_resolution_clock::duration _delta_time;
+		class ga_component* _component;
+	};
+
+	struct component_batch_t
+	{
+		ga_component_batch_func_t _func;
+		class ga_component* const* _components;
+		uint32_t _count;
+		struct ga_frame_params* _params;
+	};
+
+	void on_component_added(class ga_component* comp);
+	void on_component_removed(class ga_component* comp);
+	void run_component_buckets(struct ga_frame_params* params, bool late);
+	void run_on_demand_bucket(component_bucket_t& bucket, struct ga_frame_params* params, bool late);
+	void run_component_batches(const component_bucket_t& bucket, class ga_component* const* components, uint32_t count, struct ga_frame_params* params, bool late);
+
+	void on_hierarchy_changed() { _transform_order_dirty = true; }
+	void build_transform_order();
+	void update_transform_range(uint32_t begin, uint32_t end);
+
 	std::vector<class ga_entity*> _entities;
+	std::vector<uint32_t> _free_entity_ids;
+	uint32_t _next_entity_id = 0;
+
+	ga_component_store _store;
+	ga_entity_manager _entity_manager;
+
+	std::vector<component_bucket_t> _buckets;
+	std::vector<uint32_t> _bucket_of_key;
+
+	// Frame counter and the delta times of the last few frames, for the update tiers.
+	uint32_t _frame_index = 0;
+	std::chrono::high_resolution_clock::duration _recent_delta_times[4];
+
+	// Total time updated so far, for the on-demand tier.
+	std::chrono::high_resolution_clock::duration _sim_time;
+
+	std::vector<ga_job_decl_t> _component_decls;
+	std::vector<component_batch_t> _component_batches;
+	std::vector<on_demand_request_t> _on_demand_requests;
+
+	std::vector<transform_node_t> _transform_nodes;
+	std::vector<uint8_t> _transform_changed;
+	std::vector<uint32_t> _transform_level_offsets;
+	bool _transform_order_dirty = false;
+
+	std::vector<ga_job_decl_t> _transform_decls;
+	std::vector<transform_batch_t> _transform_batches;
+
+	friend class ga_component;
+	friend class ga_entity;
+	friend class ga_snapshot;
 };
@@ -0,0 +1,107 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_snapshot.benchmarks.h"
+#include "ga_snapshot.h"
+#include "ga_sim.h"
+
+#include "entity/ga_entity.h"
+
+#include "physics/ga_physics_component.h"
+#include "physics/ga_physics_world.h"
+#include "physics/ga_rigid_body.h"
+#include "physics/ga_shape.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+static const uint32_t k_benchmark_snapshot_body_count = 10000;
+static const uint32_t k_benchmark_snapshot_iterations = 100;
+
+void ga_snapshot_benchmarks()
+{
+	ga_sim sim;
+	ga_physics_world world;
+
+	ga_oobb oobb;
+	oobb._center = ga_vec3f::zero_vector();
+	oobb._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.5f);
+	oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+	oobb._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f);
+
+	std::vector<ga_entity*> entities;
+	std::vector<ga_physics_component*> components;
+	std::vector<ga_rigid_body*> bodies;
+	for (uint32_t i = 0; i < k_benchmark_snapshot_body_count; ++i)
+	{
+		ga_entity* ent = new ga_entity();
+		ent->translate({ float(i % 100) * 2.0f, float(i / 100) * 2.0f, 0.0f });
+
+		ga_physics_component* comp = new ga_physics_component(ent, &oobb, 1.0f);
+		comp->get_rigid_body()->set_linear_velocity({ 0.0f, float(i % 7), 0.0f });
+		sim.add_entity(ent);
+
+		entities.push_back(ent);
+		components.push_back(comp);
+		bodies.push_back(comp->get_rigid_body());
+	}
+	world.add_rigid_bodies(bodies.data(), uint32_t(bodies.size()));
+
+	ga_snapshot snapshot;
+
+	// The first capture sizes the buffer; time the ones that reuse it.
+	snapshot.capture(&sim, &world);
+	uint64_t captured_hash = snapshot.get_hash();
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < k_benchmark_snapshot_iterations; ++i)
+	{
+		snapshot.capture(&sim, &world);
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	// Disturb the state so restoring has something to undo.
+	for (auto body : bodies)
+	{
+		body->set_linear_velocity(ga_vec3f::zero_vector());
+	}
+
+	bool ok = true;
+	for (uint32_t i = 0; i < k_benchmark_snapshot_iterations; ++i)
+	{
+		ok = snapshot.restore(&sim, &world) && ok;
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t i = 0; i < k_benchmark_snapshot_iterations; ++i)
+	{
+		ok = snapshot.get_hash() == captured_hash && ok;
+	}
+	auto t3 = std::chrono::high_resolution_clock::now();
+
+	// Restoring then capturing again must reproduce the same bytes.
+	snapshot.capture(&sim, &world);
+	ok = ok && snapshot.get_hash() == captured_hash;
+
+	double scale = 10000.0 / (double(k_benchmark_snapshot_body_count) * k_benchmark_snapshot_iterations);
+	printf("ga_snapshot: %u bodies, %u bytes\n", k_benchmark_snapshot_body_count, uint32_t(snapshot.get_size()));
+	printf("ga_snapshot capture: %.1f us per 10k bodies\n", std::chrono::duration<double, std::micro>(t1 - t0).count() * scale);
+	printf("ga_snapshot restore: %.1f us per 10k bodies\n", std::chrono::duration<double, std::micro>(t2 - t1).count() * scale);
+	printf("ga_snapshot hash: %.1f us per 10k bodies\n", std::chrono::duration<double, std::micro>(t3 - t2).count() * scale);
+	printf("ga_snapshot round trip: %s\n", ok ? "ok" : "MISMATCH");
+
+	world.remove_rigid_bodies(bodies.data(), uint32_t(bodies.size()));
+	sim.remove_entities(entities.data(), uint32_t(entities.size()));
+	for (uint32_t i = 0; i < k_benchmark_snapshot_body_count; ++i)
+	{
+		delete components[i];
+		delete entities[i];
+	}
+}
@@ -0,0 +1,248 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_snapshot.h"
+#include "ga_sim.h"
+
+#include "entity/ga_component.h"
+#include "entity/ga_entity.h"
+
+#include "physics/ga_physics_world.h"
+#include "physics/ga_rigid_body.h"
+
+static const uint32_t k_snapshot_magic = 0x53534147; // 'GASS'
+static const uint32_t k_snapshot_version = 6;
+
+struct ga_snapshot_header_t
+{
+	uint32_t _magic;
+	uint32_t _version;
+	uint32_t _entity_count;
+	uint32_t _body_count;
+};
+
+// Bytes per entity and per body in the fixed size sections.
+static const size_t k_entity_state_size = sizeof(ga_mat4f) * 2 + sizeof(bool);
+static const size_t k_body_state_size = sizeof(ga_mat4f) + sizeof(float) * 16 + sizeof(uint32_t) * 2;
+
+/*
+** Cursor over one packed array per field. Each object is visited once and its
+** fields copied to or from every array, so large worlds are walked only once.
+*/
+template<typename T>
+struct field_array_t
+{
+	uint8_t* _data;
+
+	void put(const T& value) { memcpy(_data, &value, sizeof(T)); _data += sizeof(T); }
+	void get(T& value) { memcpy(&value, _data, sizeof(T)); _data += sizeof(T); }
+};
+
+ga_snapshot::ga_snapshot() : _cursor(0)
+{
+}
+
+ga_snapshot::~ga_snapshot()
+{
+}
+
+void ga_snapshot::capture(const ga_sim* sim, const ga_physics_world* world)
+{
+	ga_entity* const* entities = sim->_entities.data();
+	uint32_t entity_count = uint32_t(sim->_entities.size());
+	uint32_t body_count = uint32_t(world->_bodies.size());
+
+	// Room for the fixed size sections up front, so the arrays stay put while they are filled.
+	_data.clear();
+	_data.reserve(sizeof(ga_snapshot_header_t) + size_t(entity_count) * k_entity_state_size + size_t(body_count) * k_body_state_size);
+
+	ga_snapshot_header_t header;
+	header._magic = k_snapshot_magic;
+	header._version = k_snapshot_version;
+	header._entity_count = entity_count;
+	header._body_count = body_count;
+	write(header);
+
+	// Entities: local and world transforms, and whether the world transform is stale.
+	field_array_t<ga_mat4f> local_transforms = { write_array(sizeof(ga_mat4f), entity_count) };
+	field_array_t<ga_mat4f> world_transforms = { write_array(sizeof(ga_mat4f), entity_count) };
+	field_array_t<bool> dirty = { write_array(sizeof(bool), entity_count) };
+	for (uint32_t i = 0; i < entity_count; ++i)
+	{
+		local_transforms.put(entities[i]->_transform);
+		world_transforms.put(entities[i]->_world_transform);
+		dirty.put(entities[i]->_transform_dirty);
+	}
+
+	// Rigid bodies: everything that changes as they move. Mass, inertia and
+	// shape are fixed at creation. Pending forces are drained each step.
+	// The world already keeps one array per field, so each is copied whole.
+	write_body_array(world->_transforms.data(), sizeof(ga_mat4f), body_count);
+	for (int a = 0; a < 3; ++a) write_body_array(world->_positions[a].data(), sizeof(float), body_count);
+	for (int a = 0; a < 3; ++a) write_body_array(world->_velocities[a].data(), sizeof(float), body_count);
+	for (int a = 0; a < 4; ++a) write_body_array(world->_orientations[a].data(), sizeof(float), body_count);
+	for (int a = 0; a < 3; ++a) write_body_array(world->_angular_momenta[a].data(), sizeof(float), body_count);
+	for (int a = 0; a < 3; ++a) write_body_array(world->_angular_velocities[a].data(), sizeof(float), body_count);
+	write_body_array(world->_flags.data(), sizeof(uint32_t), body_count);
+	write_body_array(world->_rest_frames.data(), sizeof(uint32_t), body_count);
+
+	// Contact manifolds, so the solver starts from the same impulses.
+	uint32_t manifold_count = uint32_t(world->_manifolds.size());
+	write(manifold_count);
+	write_body_array(world->_manifolds.data(), sizeof(ga_contact_manifold_t), manifold_count);
+
+	// Frame time not yet stepped through in deterministic mode, so a replay
+	// runs the same ticks for the same frames.
+	int64_t accumulated = world->_time_accumulator.count();
+	write(accumulated);
+	write(world->_state_hash);
+
+	// Components, in entity order.
+	for (uint32_t i = 0; i < entity_count; ++i)
+	{
+		for (auto comp : entities[i]->_components)
+		{
+			comp->save_state(this);
+		}
+	}
+}
+
+bool ga_snapshot::restore(ga_sim* sim, ga_physics_world* world)
+{
+	ga_entity* const* entities = sim->_entities.data();
+	_cursor = 0;
+
+	ga_snapshot_header_t header;
+	if (!read(header) ||
+		header._magic != k_snapshot_magic ||
+		header._version != k_snapshot_version ||
+		header._entity_count != sim->_entities.size() ||
+		header._body_count != world->_bodies.size())
+	{
+		return false;
+	}
+
+	uint32_t entity_count = header._entity_count;
+	uint32_t body_count = header._body_count;
+	if (_data.size() - _cursor < size_t(entity_count) * k_entity_state_size + size_t(body_count) * k_body_state_size)
+	{
+		return false;
+	}
+
+	field_array_t<ga_mat4f> local_transforms = { read_array(sizeof(ga_mat4f), entity_count) };
+	field_array_t<ga_mat4f> world_transforms = { read_array(sizeof(ga_mat4f), entity_count) };
+	field_array_t<bool> dirty = { read_array(sizeof(bool), entity_count) };
+	for (uint32_t i = 0; i < entity_count; ++i)
+	{
+		local_transforms.get(entities[i]->_transform);
+		world_transforms.get(entities[i]->_world_transform);
+		dirty.get(entities[i]->_transform_dirty);
+	}
+
+	read_body_array(world->_transforms.data(), sizeof(ga_mat4f), body_count);
+	for (int a = 0; a < 3; ++a) read_body_array(world->_positions[a].data(), sizeof(float), body_count);
+	for (int a = 0; a < 3; ++a) read_body_array(world->_velocities[a].data(), sizeof(float), body_count);
+	for (int a = 0; a < 4; ++a) read_body_array(world->_orientations[a].data(), sizeof(float), body_count);
+	for (int a = 0; a < 3; ++a) read_body_array(world->_angular_momenta[a].data(), sizeof(float), body_count);
+	for (int a = 0; a < 3; ++a) read_body_array(world->_angular_velocities[a].data(), sizeof(float), body_count);
+	read_body_array(world->_flags.data(), sizeof(uint32_t), body_count);
+	read_body_array(world->_rest_frames.data(), sizeof(uint32_t), body_count);
+
+	uint32_t manifold_count;
+	if (!read(manifold_count) || _data.size() - _cursor < size_t(manifold_count) * sizeof(ga_contact_manifold_t))
+	{
+		return false;
+	}
+	world->_manifolds.resize(manifold_count);
+	read_body_array(world->_manifolds.data(), sizeof(ga_contact_manifold_t), manifold_count);
+
+	int64_t accumulated;
+	uint64_t state_hash;
+	if (!read(accumulated) || !read(state_hash))
+	{
+		return false;
+	}
+	world->_time_accumulator = std::chrono::high_resolution_clock::duration(accumulated);
+	world->_state_hash = state_hash;
+
+	// Sleeping bodies' bounds are kept from step to step; have them all found again.
+	world->_boxes.clear();
+
+	for (uint32_t i = 0; i < body_count; ++i)
+	{
+		for (int a = 0; a < 3; ++a)
+		{
+			world->_forces[a][i] = 0.0f;
+			world->_torques[a][i] = 0.0f;
+		}
+		world->update_inverse_inertia(i);
+	}
+
+	bool ok = true;
+	for (uint32_t i = 0; ok && i < entity_count; ++i)
+	{
+		for (auto comp : entities[i]->_components)
+		{
+			ok = ok && comp->load_state(this);
+		}
+	}
+	return ok;
+}
+
+uint64_t ga_snapshot::get_hash() const
+{
+	// FNV-1a, taking eight bytes per step rather than one.
+	uint64_t hash = 0xcbf29ce484222325ull;
+	size_t size = _data.size();
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, &_data[i], sizeof(word));
+		hash ^= word;
+		hash *= 0x100000001b3ull;
+	}
+	for (; i < size; ++i)
+	{
+		hash ^= _data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+uint8_t* ga_snapshot::write_array(size_t element_size, uint32_t count)
+{
+	size_t offset = _data.size();
+	_data.resize(offset + element_size * count);
+	return _data.data() + offset;
+}
+
+void ga_snapshot::write_body_array(const void* data, size_t element_size, uint32_t count)
+{
+	if (count > 0)
+	{
+		memcpy(write_array(element_size, count), data, element_size * count);
+	}
+}
+
+void ga_snapshot::read_body_array(void* data, size_t element_size, uint32_t count)
+{
+	uint8_t* source = read_array(element_size, count);
+	if (count > 0)
+	{
+		memcpy(data, source, element_size * count);
+	}
+}
+
+uint8_t* ga_snapshot::read_array(size_t element_size, uint32_t count)
+{
+	uint8_t* data = _data.data() + _cursor;
+	_cursor += element_size * count;
+	return data;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/*
+** A copy of the whole simulation state in one contiguous buffer.
+**
+** The buffer holds the entities' transforms, the rigid bodies' dynamic state,
+** their contact points and any state components choose to save. Transforms
+** and body state are stored as one array per field, so each section is a
+** straight copy in and out.
+**
+** A snapshot can only be restored into the sim and world it was captured from,
+** or one built the same way (the same entities, components and bodies, added
+** in the same order). Capturing again reuses the buffer, so a snapshot kept
+** for rollback does not allocate once it has reached its size.
+** @see ga_component::save_state
+*/
+class ga_snapshot final
+{
+public:
+	ga_snapshot();
+	~ga_snapshot();
+
+	/*
+	** Copy the state of the sim and physics world into the snapshot.
+	** Must not be called while either is updating.
+	*/
+	void capture(const class ga_sim* sim, const class ga_physics_world* world);
+
+	/*
+	** Put the sim and physics world back to the captured state.
+	** @returns False if they do not match the snapshot. Nothing is changed
+	** unless the entity and body counts match.
+	*/
+	bool restore(class ga_sim* sim, class ga_physics_world* world);
+
+	/*
+	** 64-bit hash of the captured state, for comparing runs.
+	*/
+	uint64_t get_hash() const;
+
+	size_t get_size() const { return _data.size(); }
+	const uint8_t* get_data() const { return _data.data(); }
+
+	/*
+	** Append raw bytes. Used by components saving their state.
+	*/
+	void write(const void* data, size_t size)
+	{
+		size_t offset = _data.size();
+		_data.resize(offset + size);
+		if (size) memcpy(&_data[offset], data, size);
+	}
+
+	template<typename T>
+	void write(const T& value) { write(&value, sizeof(T)); }
+
+	/*
+	** Read back bytes in the order they were written. Used by components
+	** loading their state.
+	** @returns False if that would read past the end of the snapshot.
+	*/
+	bool read(void* data, size_t size)
+	{
+		if (size > _data.size() - _cursor) return false;
+		if (size) memcpy(data, &_data[_cursor], size);
+		_cursor += size;
+		return true;
+	}
+
+	template<typename T>
+	bool read(T& value) { return read(&value, sizeof(T)); }
+
+private:
+	/*
+	** Reserve space for an array of count elements and get a pointer to it.
+	*/
+	uint8_t* write_array(size_t element_size, uint32_t count);
+	uint8_t* read_array(size_t element_size, uint32_t count);
+
+	/*
+	** Copy a whole per-body array of the world into or out of the snapshot.
+	*/
+	void write_body_array(const void* data, size_t element_size, uint32_t count);
+	void read_body_array(void* data, size_t element_size, uint32_t count);
+
+	std::vector<uint8_t> _data;
+	size_t _cursor;
+};
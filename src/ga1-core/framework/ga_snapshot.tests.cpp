@@ -0,0 +1,213 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_snapshot.tests.h"
+#include "ga_frame_params.h"
+#include "ga_sim.h"
+#include "ga_snapshot.h"
+
+#include "entity/ga_component.h"
+#include "entity/ga_entity.h"
+
+#include "physics/ga_physics_component.h"
+#include "physics/ga_physics_world.h"
+#include "physics/ga_rigid_body.h"
+#include "physics/ga_shape.h"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+static const uint32_t k_test_snapshot_box_count = 8;
+
+/*
+** Moves its entity along and counts its updates, saving the count.
+*/
+class ga_snapshot_test_component final : public ga_component
+{
+public:
+	ga_snapshot_test_component(ga_entity* ent) : ga_component(ent), _count(0) {}
+
+	virtual void update(ga_frame_params*) override
+	{
+		_count++;
+		get_entity()->translate({ 0.5f, 0.0f, 0.0f });
+	}
+
+	virtual void save_state(ga_snapshot* snapshot) const override { snapshot->write(_count); }
+	virtual bool load_state(ga_snapshot* snapshot) override { return snapshot->read(_count); }
+
+	uint32_t get_count() const { return _count; }
+
+private:
+	uint32_t _count;
+};
+
+/*
+** A floor with boxes tumbling onto it and each other, and an entity with
+** state of its own.
+*/
+struct snapshot_test_world_t
+{
+	ga_sim _sim;
+	ga_physics_world _world;
+	ga_oobb _floor;
+	ga_oobb _box;
+	std::vector<ga_entity*> _entities;
+	std::vector<ga_physics_component*> _physics;
+	std::vector<ga_rigid_body*> _bodies;
+	ga_snapshot_test_component* _counter;
+
+	snapshot_test_world_t(uint32_t box_count)
+	{
+		_floor._center = ga_vec3f::zero_vector();
+		_floor._half_vectors[0] = ga_vec3f::x_vector().scale_result(10.0f);
+		_floor._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+		_floor._half_vectors[2] = ga_vec3f::z_vector().scale_result(10.0f);
+
+		_box._center = ga_vec3f::zero_vector();
+		_box._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.5f);
+		_box._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+		_box._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f);
+
+		for (uint32_t i = 0; i <= box_count; ++i)
+		{
+			ga_entity* ent = new ga_entity();
+			if (i > 0)
+			{
+				ent->translate({ float(i % 3) * 0.6f, 1.0f + float(i) * 1.1f, float(i % 2) * 0.3f });
+			}
+
+			ga_physics_component* physics = new ga_physics_component(ent, i == 0 ? &_floor : &_box, 1.0f);
+			if (i == 0)
+			{
+				physics->get_rigid_body()->make_static();
+			}
+			else
+			{
+				physics->get_rigid_body()->add_angular_momentum({ 0.1f * float(i), 0.0f, 0.2f });
+			}
+			_sim.add_entity(ent);
+
+			_entities.push_back(ent);
+			_physics.push_back(physics);
+			_bodies.push_back(physics->get_rigid_body());
+		}
+		_world.add_rigid_bodies(_bodies.data(), uint32_t(_bodies.size()));
+
+		ga_entity* ent = new ga_entity();
+		_counter = new ga_snapshot_test_component(ent);
+		_sim.add_entity(ent);
+		_entities.push_back(ent);
+	}
+
+	~snapshot_test_world_t()
+	{
+		_world.remove_rigid_bodies(_bodies.data(), uint32_t(_bodies.size()));
+		_sim.remove_entities(_entities.data(), uint32_t(_entities.size()));
+		for (auto physics : _physics)
+		{
+			delete physics;
+		}
+		delete _counter;
+		for (auto ent : _entities)
+		{
+			delete ent;
+		}
+	}
+
+	void step(uint32_t frames)
+	{
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			ga_frame_params params;
+			params._delta_time = std::chrono::milliseconds(16);
+			_sim.update(&params);
+			_world.step(&params);
+			_sim.late_update(&params);
+		}
+	}
+
+	ga_vec3f get_counter_position() const { return _counter->get_entity()->get_transform().get_translation(); }
+
+	uint64_t get_hash() const
+	{
+		ga_snapshot snapshot;
+		snapshot.capture(&_sim, &_world);
+		return snapshot.get_hash();
+	}
+};
+
+static void test_snapshot_round_trip()
+{
+	// Late enough that the boxes have landed and are touching.
+	snapshot_test_world_t test(k_test_snapshot_box_count);
+	test.step(60);
+
+	ga_snapshot snapshot;
+	snapshot.capture(&test._sim, &test._world);
+	uint64_t captured_hash = snapshot.get_hash();
+	std::vector<uint8_t> captured(snapshot.get_data(), snapshot.get_data() + snapshot.get_size());
+
+	// Capturing again into the same buffer does not reallocate it.
+	const uint8_t* data = snapshot.get_data();
+	snapshot.capture(&test._sim, &test._world);
+	assert(snapshot.get_data() == data);
+	assert(snapshot.get_hash() == captured_hash);
+
+	test.step(60);
+	uint64_t stepped_hash = test.get_hash();
+	uint32_t stepped_count = test._counter->get_count();
+	ga_vec3f stepped_position = test.get_counter_position();
+	assert(stepped_hash != captured_hash);
+	assert(stepped_count == 120);
+
+	// Restoring gives back the captured state, byte for byte.
+	assert(snapshot.restore(&test._sim, &test._world));
+	assert(test.get_hash() == captured_hash);
+	assert(test._counter->get_count() == 60);
+	assert(test.get_counter_position().x == 30.0f);
+
+	ga_snapshot recaptured;
+	recaptured.capture(&test._sim, &test._world);
+	assert(recaptured.get_size() == captured.size());
+	assert(memcmp(recaptured.get_data(), captured.data(), captured.size()) == 0);
+
+	// And the same frames played again end in the same place.
+	test.step(60);
+	assert(test.get_hash() == stepped_hash);
+	assert(test._counter->get_count() == stepped_count);
+	assert(test.get_counter_position().x == stepped_position.x);
+}
+
+static void test_snapshot_mismatch()
+{
+	snapshot_test_world_t test(k_test_snapshot_box_count);
+	test.step(10);
+	ga_snapshot snapshot;
+	snapshot.capture(&test._sim, &test._world);
+
+	// A world built with a different number of bodies is left alone.
+	snapshot_test_world_t other(k_test_snapshot_box_count - 1);
+	other.step(10);
+	uint64_t other_hash = other.get_hash();
+	assert(!snapshot.restore(&other._sim, &other._world));
+	assert(other.get_hash() == other_hash);
+	assert(other._counter->get_count() == 10);
+
+	// An empty snapshot matches nothing.
+	ga_snapshot empty;
+	assert(!empty.restore(&test._sim, &test._world));
+}
+
+void ga_snapshot_unit_tests()
+{
+	test_snapshot_round_trip();
+	test_snapshot_mismatch();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Check restoring a snapshot puts the sim and world back exactly, so the
+** frames after it replay the same, and that mismatched worlds are refused.
+** Needs the job system running.
+*/
+void ga_snapshot_unit_tests();
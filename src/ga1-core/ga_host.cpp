@@ -0,0 +1,277 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Headless host: runs many independent matches with no window and reports
+** how many complete per second. Exits with an error if any match fails to
+** load or is still being played when it reaches the frame limit, since the
+** throughput of unfinished matches means nothing.
+**
+** Usage: ga_host [-matches <count>] [-frames <max per match>]
+**                [-scene <path>] [-replay <path>]
+**
+** Paddles are driven by a simple AI that follows the ball, or by a recording
+** when one is given; the AI takes over once the recording runs out.
+*/
+
+#include "entity/ga_entity.h"
+#include "entity/ga_pong_manager.h"
+
+#include "framework/ga_frame_params.h"
+#include "framework/ga_globals.h"
+#include "framework/ga_input_recording.h"
+#include "framework/ga_instance.h"
+#include "jobs/ga_job.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Matches are simulated at a fixed 60 frames per second.
+static const std::chrono::microseconds k_host_frame_time(16667);
+
+// Small entity pool per match; the pong scene spawns nothing at runtime.
+static const uint32_t k_host_pooled_entity_capacity = 16;
+
+// Job system setup, as in the game.
+static const uint32_t k_host_thread_mask = 0xffff;
+
+struct host_settings_t
+{
+	const ga_scene* _scene;
+	const ga_input_replay* _replay;
+	uint32_t _match_count;
+	uint32_t _max_frames;
+	uint32_t _job_count;
+};
+
+struct host_results_t
+{
+	std::atomic<uint32_t> _finished;
+	std::atomic<uint32_t> _left_wins;
+	std::atomic<uint32_t> _right_wins;
+	std::atomic<uint64_t> _frames;
+};
+
+struct host_job_t
+{
+	const host_settings_t* _settings;
+	host_results_t* _results;
+	uint32_t _first_match;
+};
+
+/*
+** Press up or down to bring a paddle level with the ball.
+** Matches differ in how far off the ball may be before the paddle reacts.
+*/
+static uint64_t follow_ball(const ga_entity* paddle, const ga_entity* ball, float dead_zone, uint64_t up, uint64_t down)
+{
+	float offset = ball->get_transform().get_translation().y - paddle->get_transform().get_translation().y;
+	if (offset > dead_zone) return up;
+	if (offset < -dead_zone) return down;
+	return 0;
+}
+
+static void run_match(const host_settings_t* settings, host_results_t* results, uint32_t match)
+{
+	ga_instance instance(k_host_pooled_entity_capacity);
+	if (!instance.load(settings->_scene->get_cooked_data(), settings->_scene->get_cooked_size(), k_scene_headless))
+	{
+		return;
+	}
+
+	const ga_scene* scene = instance.get_scene();
+	ga_entity* left = scene->find_entity("left_paddle");
+	ga_entity* right = scene->find_entity("right_paddle");
+	ga_entity* ball = scene->find_entity("ball");
+	ga_entity* manager_entity = scene->find_entity("manager");
+	ga_pong_manager* manager = manager_entity ? manager_entity->get_component<ga_pong_manager>() : nullptr;
+
+	ga_input_replay replay;
+	bool replaying = false;
+	if (settings->_replay)
+	{
+		replay = *settings->_replay;
+		replaying = true;
+	}
+
+	float dead_zone = 0.25f * float(1 + match % 8);
+
+	std::chrono::high_resolution_clock::time_point time;
+	uint32_t frame = 0;
+	for (; frame < settings->_max_frames; ++frame)
+	{
+		if (manager && manager->is_game_over()) break;
+
+		ga_frame_params params;
+		params._button_mask = 0;
+		params._mouse_click_mask = 0;
+		params._mouse_press_mask = 0;
+		params._mouse_x = 0.0f;
+		params._mouse_y = 0.0f;
+
+		replaying = replaying && replay.update(&params);
+		if (!replaying)
+		{
+			time += k_host_frame_time;
+			params._current_time = time;
+			params._delta_time = k_host_frame_time;
+
+			if (left && right && ball)
+			{
+				params._button_mask |= follow_ball(left, ball, dead_zone, k_button_w, k_button_s);
+				params._button_mask |= follow_ball(right, ball, dead_zone, k_button_i, k_button_k);
+			}
+		}
+		else
+		{
+			time = params._current_time;
+		}
+
+		instance.update(&params);
+	}
+
+	results->_frames.fetch_add(frame, std::memory_order_relaxed);
+	if (manager && manager->is_game_over())
+	{
+		results->_finished.fetch_add(1, std::memory_order_relaxed);
+		if (manager->get_left_score() > manager->get_right_score())
+		{
+			results->_left_wins.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			results->_right_wins.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+/*
+** Each job plays every job_count'th match, one after the other, so only one
+** instance per job is alive at a time.
+*/
+static void run_matches(void* data)
+{
+	host_job_t* job = (host_job_t*)data;
+	const host_settings_t* settings = job->_settings;
+	for (uint32_t match = job->_first_match; match < settings->_match_count; match += settings->_job_count)
+	{
+		run_match(settings, job->_results, match);
+	}
+}
+
+int main(int argc, const char** argv)
+{
+	ga_set_root_path(argv[0]);
+
+	const char* scene_path = "data/scenes/pong.scene";
+	const char* replay_path = nullptr;
+	uint32_t match_count = 1000;
+	uint32_t max_frames = 60 * 60;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-matches") == 0)
+		{
+			match_count = uint32_t(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-frames") == 0)
+		{
+			max_frames = uint32_t(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-scene") == 0)
+		{
+			scene_path = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-replay") == 0)
+		{
+			replay_path = argv[i + 1];
+		}
+	}
+
+	// Every match is built from the same cooked scene and recording, loaded once.
+	ga_scene scene;
+	if (!scene.load_file(scene_path))
+	{
+		return 1;
+	}
+
+	ga_input_replay replay;
+	if (replay_path && !replay.load(replay_path))
+	{
+		return 1;
+	}
+
+	// One job per worker thread, each playing its share of the matches.
+	uint32_t core_count = 0;
+	uint32_t hardware_thread_count = std::thread::hardware_concurrency();
+	for (uint32_t i = 0; i < hardware_thread_count && i < 32; ++i)
+	{
+		if (k_host_thread_mask & (1u << i)) core_count++;
+	}
+	core_count = std::max(core_count, 1u);
+
+	host_settings_t settings;
+	settings._scene = &scene;
+	settings._replay = replay_path ? &replay : nullptr;
+	settings._match_count = match_count;
+	settings._max_frames = max_frames;
+	settings._job_count = std::max(std::min(core_count, match_count), 1u);
+
+	host_results_t results;
+	results._finished = 0;
+	results._left_wins = 0;
+	results._right_wins = 0;
+	results._frames = 0;
+
+	ga_job::startup(k_host_thread_mask, 256, 256);
+
+	std::vector<host_job_t> jobs(settings._job_count);
+	std::vector<ga_job_decl_t> decls(settings._job_count);
+	for (uint32_t i = 0; i < settings._job_count; ++i)
+	{
+		jobs[i]._settings = &settings;
+		jobs[i]._results = &results;
+		jobs[i]._first_match = i;
+
+		decls[i]._entry = run_matches;
+		decls[i]._data = &jobs[i];
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	int32_t counter = 0;
+	ga_job::run(decls.data(), int(decls.size()), &counter);
+	ga_job::wait(&counter);
+
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	ga_job::shutdown();
+
+	double matches_per_second = seconds > 0.0 ? match_count / seconds : 0.0;
+	printf("%u matches on %u cores in %.3f s\n", match_count, core_count, seconds);
+	printf("%u finished (%u left wins, %u right wins), %u hit the %u frame limit\n",
+		results._finished.load(), results._left_wins.load(), results._right_wins.load(),
+		match_count - results._finished.load(), max_frames);
+	printf("%.1f matches per second, %.1f per core\n", matches_per_second, matches_per_second / core_count);
+	printf("%.0f frames per second\n", seconds > 0.0 ? double(results._frames.load()) / seconds : 0.0);
+
+	uint32_t unfinished = match_count - results._finished.load();
+	if (unfinished > 0)
+	{
+		fprintf(stderr, "Error: %u of %u matches did not finish within %u frames.\n", unfinished, match_count, max_frames);
+		return 1;
+	}
+
+	return 0;
+}
@@ -16,7 +16,7 @@
 
 #include <cassert>
 
-ga_animation_component::ga_animation_component(ga_entity* ent, ga_model* model) : ga_component(ent)
+ga_animation_component::ga_animation_component(ga_entity* ent, ga_model* model) : ga_component(ent, ga_component_type::get<ga_animation_component>())
 {
 	_skeleton = model->_skeleton;
 	assert(_skeleton != 0);
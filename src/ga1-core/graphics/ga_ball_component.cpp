@@ -15,7 +15,7 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 
-ga_ball_component::ga_ball_component(ga_entity* ent, const char* texture_file) : ga_component(ent)
+ga_ball_component::ga_ball_component(ga_entity* ent, const char* texture_file) : ga_component(ent, ga_component_type::get<ga_ball_component>())
 {
 	_material = new ga_unlit_texture_material(texture_file);
 	_material->init();
@@ -12,10 +12,12 @@
 
 #include "entity/ga_entity.h"
 
+#include <vector>
+
 #define GLEW_STATIC
 #include <GL/glew.h>
 
-ga_cube_component::ga_cube_component(ga_entity* ent, const char* texture_file) : ga_component(ent)
+ga_cube_component::ga_cube_component(ga_entity* ent, const char* texture_file) : ga_component(ent, ga_component_batched<ga_cube_component>::get_type())
 {
 	_material = new ga_unlit_texture_material(texture_file);
 	_material->init();
@@ -176,11 +178,30 @@ ga_cube_component::~ga_cube_component()
 
 void ga_cube_component::update(ga_frame_params* params)
 {
-	float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
-	ga_quatf axis_angle;
-	axis_angle.make_axis_angle(ga_vec3f::y_vector(), ga_degrees_to_radians(60.0f) * dt);
-	//get_entity()->rotate(axis_angle);
+	ga_static_drawcall draw = make_drawcall();
+
+	while (params->_static_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
+	params->_static_drawcalls.push_back(draw);
+	params->_static_drawcall_lock.clear(std::memory_order_release);
+}
+
+void ga_cube_component::update_batch(ga_cube_component* const* components, uint32_t count, ga_frame_params* params)
+{
+	// Build the drawcalls outside the lock, then publish them all at once.
+	std::vector<ga_static_drawcall> draws;
+	draws.reserve(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		draws.push_back(components[i]->make_drawcall());
+	}
 
+	while (params->_static_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
+	params->_static_drawcalls.insert(params->_static_drawcalls.end(), draws.begin(), draws.end());
+	params->_static_drawcall_lock.clear(std::memory_order_release);
+}
+
+ga_static_drawcall ga_cube_component::make_drawcall() const
+{
 	ga_static_drawcall draw;
 	draw._name = "ga_cube_component";
 	draw._vao = _vao;
@@ -188,8 +209,5 @@ void ga_cube_component::update(ga_frame_params* params)
 	draw._transform = get_entity()->get_transform();
 	draw._draw_mode = GL_TRIANGLES;
 	draw._material = _material;
-
-	while (params->_static_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
-	params->_static_drawcalls.push_back(draw);
-	params->_static_drawcall_lock.clear(std::memory_order_release);
+	return draw;
 }
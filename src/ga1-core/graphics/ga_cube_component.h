@@ -15,6 +15,7 @@
 
 /*
 ** Renderable basic textured cubed.
+** Updated in batches; each batch takes the drawcall lock once.
 */
 class ga_cube_component : public ga_component
 {
@@ -24,7 +25,11 @@ public:
 
 	virtual void update(struct ga_frame_params* params) override;
 
+	static void update_batch(ga_cube_component* const* components, uint32_t count, struct ga_frame_params* params);
+
 private:
+	struct ga_static_drawcall make_drawcall() const;
+
 	class ga_material* _material;
 	uint32_t _vao;
 	uint32_t _vbos[4];
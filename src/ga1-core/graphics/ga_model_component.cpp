@@ -18,7 +18,7 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 
-ga_model_component::ga_model_component(ga_entity* ent, ga_model* model) : ga_component(ent)
+ga_model_component::ga_model_component(ga_entity* ent, ga_model* model) : ga_component(ent, ga_component_type::get<ga_model_component>())
 {
 	_material = new ga_animated_material(model->_skeleton);
 	_material->init();
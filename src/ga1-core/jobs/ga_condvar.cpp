@@ -31,5 +31,10 @@ void ga_condvar::wait_for(int ms)
 
 void ga_condvar::wake_all()
 {
+	// Take the lock so waiters cannot miss a wake between checking their
+	// condition and going to sleep.
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+	}
 	_condvar.notify_all();
 }
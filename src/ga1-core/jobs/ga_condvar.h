@@ -9,6 +9,7 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 
@@ -25,6 +26,28 @@ public:
 	void wait_for(int ms);
 	void wake_all();
 
+	/*
+	** Block until the predicate holds.
+	** The predicate is checked under the lock, so a wake_all issued after the
+	** condition changes cannot be missed.
+	*/
+	template<typename Predicate>
+	void wait_until(Predicate pred)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condvar.wait(lock, pred);
+	}
+
+	/*
+	** Block until the predicate holds or the timeout expires.
+	*/
+	template<typename Predicate>
+	void wait_for(int ms, Predicate pred)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condvar.wait_for(lock, std::chrono::milliseconds(ms), pred);
+	}
+
 private:
 	std::condition_variable _condvar;
 	std::mutex _mutex;
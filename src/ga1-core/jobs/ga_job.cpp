@@ -145,10 +145,10 @@ void ga_job::wait(int32_t* counter)
 		*/
 		else
 		{
-			while (*counter > 0)
+			impl->_work_exhausted.wait_until([counter]()
 			{
-				impl->_work_exhausted.wait();
-			}
+				return reinterpret_cast<std::atomic_int*>(counter)->load() <= 0;
+			});
 		}
 	}
 }
@@ -164,7 +164,10 @@ static int _ga_job_instance_thread_worker(void* data)
 		if (!_ga_job_schedule(impl, &parent_fiber))
 		{
 			impl->_work_exhausted.wake_all();
-			impl->_work_added.wait_for(1000);
+			impl->_work_added.wait_for(1000, [impl]()
+			{
+				return impl->_terminate || impl->_job_queue.get_count() > 0;
+			});
 		}
 	}
 
@@ -7,50 +7,89 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 
+#include "entity/ga_entity_manager.tests.h"
+
 #include "framework/ga_camera.h"
-#include "framework/ga_compiler_defines.h"
+#include "framework/ga_globals.h"
 #include "framework/ga_input.h"
-#include "framework/ga_sim.h"
+#include "framework/ga_input_recording.h"
+#include "framework/ga_input_recording.tests.h"
+#include "framework/ga_instance.h"
+#include "framework/ga_sim.benchmarks.h"
 #include "framework/ga_output.h"
+#include "framework/ga_scene.benchmarks.h"
+#include "framework/ga_scene.tests.h"
+#include "framework/ga_snapshot.benchmarks.h"
+#include "framework/ga_snapshot.tests.h"
 #include "jobs/ga_job.h"
 
-#include "entity/ga_entity.h"
-#include "entity/ga_lua_component.h"
-
-#include "graphics/ga_cube_component.h"
-#include "graphics/ga_ball_component.h"
 #include "graphics/ga_program.h"
 
 #include "gui/ga_font.h"
 
-#include "physics/ga_physics_component.h"
-#include "physics/ga_physics_world.h"
-#include "physics/ga_rigid_body.h"
-#include "physics/ga_shape.h"
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include "physics/ga_intersection.benchmarks.h"
+#include "physics/ga_contact_solver.tests.h"
+#include "physics/ga_intersection.tests.h"
+#include "physics/ga_physics_world.benchmarks.h"
 
-#define STB_TRUETYPE_IMPLEMENTATION
-#include <stb_truetype.h>
-
-#if defined(GA_MINGW)
-#include <unistd.h>
-#endif
-
-ga_font* g_font = nullptr;
-static void set_root_path(const char* exepath);
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 
 int main(int argc, const char** argv)
 {
-	set_root_path(argv[0]);
+	ga_set_root_path(argv[0]);
+
+	// Cook a text scene to its binary form and exit if requested.
+	if (argc > 3 && strcmp(argv[1], "-cook") == 0)
+	{
+		return ga_scene_cook_file(argv[2], argv[3]) ? 0 : 1;
+	}
 
 	ga_job::startup(0xffff, 256, 256);
 
+	// Run the unit tests instead of the game if requested. They assert, so
+	// they check nothing in a release build.
+	if (argc > 1 && strcmp(argv[1], "-test") == 0)
+	{
+		ga_intersection_utility_unit_tests();
+		ga_intersection_unit_tests();
+		ga_contact_solver_unit_tests();
+		ga_entity_manager_unit_tests();
+		ga_scene_unit_tests();
+		ga_input_recording_unit_tests();
+		ga_snapshot_unit_tests();
+		printf("tests passed\n");
+
+		ga_job::shutdown();
+		return 0;
+	}
+
+	// Run the headless benchmarks instead of the game if requested.
+	if (argc > 1 && strcmp(argv[1], "-benchmark") == 0)
+	{
+		ga_sim_component_store_benchmarks();
+		ga_sim_component_batch_benchmarks();
+		ga_sim_update_tier_benchmarks();
+		ga_scene_benchmarks();
+		ga_snapshot_benchmarks();
+		ga_physics_broadphase_benchmarks();
+		ga_physics_narrowphase_benchmarks();
+		ga_physics_integration_benchmarks();
+		ga_physics_sleeping_benchmarks();
+		ga_physics_solver_benchmarks();
+		ga_physics_deterministic_benchmarks();
+		ga_physics_query_benchmarks();
+		ga_intersection_benchmarks();
+
+		ga_job::shutdown();
+		return 0;
+	}
+
 	// Create objects for three phases of the frame: input, sim and output.
+	// The sim phase is one game instance: gameplay, physics and the scene.
 	ga_input* input = new ga_input();
-	ga_sim* sim = new ga_sim();
-	ga_physics_world* world = new ga_physics_world();
+	ga_instance* instance = new ga_instance();
 	ga_output* output = new ga_output(input->get_window());
 
 	// Create the default font:
@@ -64,84 +103,41 @@ int main(int argc, const char** argv)
 	//rotation.make_axis_angle(ga_vec3f::x_vector(), ga_degrees_to_radians(15.0f));
 	//camera->rotate(rotation);
 
-	// Create an entity whose movement is driven by Lua script.
-	//Right Paddle entity
-	ga_entity rPaddle;
-	ga_lua_component lua_move_r(&rPaddle, "data/scripts/movePaddleR.lua");
-	ga_cube_component model_r(&rPaddle, "data/textures/rpi.png");
-	rPaddle.translate({ 12.0f, 0.0f, 0.0f });
-	ga_oobb rPaddle_oobb;
-	rPaddle_oobb._half_vectors[0] = ga_vec3f::x_vector().scale_result(-1.0f);// .scale_result(0.3f);
-	rPaddle_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(4.0f);
-	rPaddle_oobb._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.3f);
-	ga_physics_component rPaddle_collider(&rPaddle, &rPaddle_oobb, 2.0f);
-	rPaddle_collider.get_rigid_body()->make_weightless();
-	rPaddle_collider.get_rigid_body()->make_static();
-	rPaddle.add_component(&rPaddle_collider);
-
-	world->add_rigid_body(rPaddle_collider.get_rigid_body());
-	sim->add_entity(&rPaddle);
-
-	//Left Paddle entity
-	ga_entity lPaddle;
-	ga_lua_component lua_move_l(&lPaddle, "data/scripts/movePaddleL.lua");
-	ga_cube_component model_l(&lPaddle, "data/textures/rpi.png");
-	lPaddle.translate({ -12.0f, 0.0f, 0.0f });
-	ga_oobb lPaddle_oobb;
-	lPaddle_oobb._half_vectors[0] = ga_vec3f::x_vector();// .scale_result(0.3f);
-	lPaddle_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(4.0f);
-	lPaddle_oobb._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.3f);
-	ga_physics_component lPaddle_collider(&lPaddle, &lPaddle_oobb, 2.0f);
-	lPaddle_collider.get_rigid_body()->make_weightless();
-	lPaddle_collider.get_rigid_body()->make_static();
-	lPaddle.add_component(&lPaddle_collider);
-	world->add_rigid_body(lPaddle_collider.get_rigid_body());
-	sim->add_entity(&lPaddle);
-
-	//ball entity
-	ga_entity test_1_box;
-	test_1_box.translate({ 0.0f, 0.0f, 0.0f });
-	ga_ball_component model_b(&test_1_box, "data/textures/rpi.png");
-	ga_oobb test_1_oobb;
-	test_1_oobb._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.3f);
-	test_1_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.3f);
-	test_1_oobb._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.3f);
-
-	ga_physics_component test_1_collider(&test_1_box, &test_1_oobb, 1.0f);
-	test_1_collider.get_rigid_body()->make_weightless();
-	
-	world->add_rigid_body(test_1_collider.get_rigid_body());
-	sim->add_entity(&test_1_box);
-
-	test_1_collider.get_rigid_body()->add_linear_velocity({ 10.0f, 0.0f, 0.0f });
-
-	//floor collider
-	ga_entity floor;
-	ga_plane floor_plane;
-	floor_plane._point = { 0.0f, 0.0f, 0.0f };
-	floor_plane._normal = { 0.0f, 1.0f, 0.0f };
-	floor.translate({ 0.0f, -7.0f, 0.0f });
-	ga_mat4f tempscale3 = floor.get_transform();
-	tempscale3.nonuniform_scale({ 1.3f, 1.0f, 0.1f });
-	floor.set_transform(tempscale3);
-	ga_physics_component floor_collider(&floor, &floor_plane, 0.0f);
-	floor_collider.get_rigid_body()->make_static();
-	//world->add_rigid_body(floor_collider.get_rigid_body());
-	//sim->add_entity(&floor);
-
-	//ceiling collider
-	ga_entity ceil;
-	ga_plane ceil_plane;
-	ceil_plane._point = { 0.0f, 0.0f, 0.0f };
-	ceil_plane._normal = { 0.0f, 1.0f, 0.0f };
-	ceil.translate({ 0.0f, 7.0f, 0.0f });
-	ga_mat4f tempscale4 = ceil.get_transform();
-	tempscale4.nonuniform_scale({ 1.3f, 1.0f, 0.1f });
-	ceil.set_transform(tempscale4);
-	ga_physics_component ceil_collider(&ceil, &ceil_plane, 0.0f);
-	ceil_collider.get_rigid_body()->make_static();
-	//world->add_rigid_body(ceil_collider.get_rigid_body());
-	//sim->add_entity(&ceil);
+	// Optional arguments: -scene <path>, -record <path> and -replay <path>.
+	const char* scene_path = "data/scenes/pong.scene";
+	ga_input_recorder* recorder = nullptr;
+	ga_input_replay* replay = nullptr;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-scene") == 0)
+		{
+			scene_path = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-record") == 0)
+		{
+			recorder = new ga_input_recorder(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-replay") == 0)
+		{
+			replay = new ga_input_replay();
+			if (!replay->load(argv[i + 1]))
+			{
+				delete replay;
+				replay = nullptr;
+			}
+		}
+	}
+
+	// Build the scene from data.
+	ga_scene* scene = new ga_scene();
+	if (scene->load_file(scene_path))
+	{
+		instance->load(scene->get_cooked_data(), scene->get_cooked_size());
+	}
+
+	// Time spent in the sim and physics stages, reported after a replay for comparing runs.
+	std::chrono::high_resolution_clock::duration sim_time = std::chrono::high_resolution_clock::duration::zero();
+	uint32_t frame_count = 0;
 
 	// Main loop:
 	while (true)
@@ -155,28 +151,48 @@ int main(int argc, const char** argv)
 			break;
 		}
 
+		// A replay replaces the live input, which is still gathered to service the window.
+		if (replay && !replay->update(&params))
+		{
+			break;
+		}
+
 		// Update the camera.
 		camera->update(&params);
 
-		// Run gameplay.
-		sim->update(&params);
+		// Pick up any input that arrived since the frame began, right before the sim.
+		if (!replay)
+		{
+			input->late_latch(&params);
+		}
+		if (recorder)
+		{
+			recorder->record(&params);
+		}
+
+		auto sim_start = std::chrono::high_resolution_clock::now();
 
-		// Step the physics world.
-		world->step(&params);
+		// Run gameplay, step the physics world and perform the late update.
+		instance->update(&params);
 
-		// Perform the late update.
-		sim->late_update(&params);
+		sim_time += std::chrono::high_resolution_clock::now() - sim_start;
+		++frame_count;
 
 		// Draw to screen.
 		output->update(&params);
 	}
 
-	//world->remove_rigid_body(floor_collider.get_rigid_body());
-	world->remove_rigid_body(rPaddle_collider.get_rigid_body());
-	//world->remove_rigid_body(ceil_collider.get_rigid_body());
+	if (replay)
+	{
+		double ms = std::chrono::duration<double, std::milli>(sim_time).count();
+		printf("Replayed %u frames: %.3f ms sim and physics per frame\n", frame_count, frame_count ? ms / frame_count : 0.0);
+	}
 
+	delete replay;
+	delete recorder;
+	delete scene;
 	delete output;
-	delete sim;
+	delete instance;
 	delete input;
 	delete camera;
 
@@ -184,30 +200,3 @@ int main(int argc, const char** argv)
 
 	return 0;
 }
-
-char g_root_path[256];
-static void set_root_path(const char* exepath)
-{
-#if defined(GA_MSVC)
-	strcpy_s(g_root_path, sizeof(g_root_path), exepath);
-
-	// Strip the executable file name off the end of the path:
-	char* slash = strrchr(g_root_path, '\\');
-	if (!slash)
-	{
-		slash = strrchr(g_root_path, '/');
-	}
-	if (slash)
-	{
-		slash[1] = '\0';
-	}
-#elif defined(GA_MINGW)
-	char* cwd;
-	char buf[PATH_MAX + 1];
-	cwd = getcwd(buf, PATH_MAX + 1);
-	strcpy_s(g_root_path, sizeof(g_root_path), cwd);
-
-	g_root_path[strlen(cwd)] = '/';
-	g_root_path[strlen(cwd) + 1] = '\0';
-#endif
-}
@@ -12,6 +12,7 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <algorithm>
+#include <cstdint>
 
 #define ga_absf fabsf
 #define ga_cosf cosf
@@ -40,3 +41,14 @@ inline bool ga_equalf(float a, float b)
 	float diff = ga_absf(a - b);
 	return diff < 0.0000005f || diff < ga_absf(a * 0.0000005f) || diff < ga_absf(b * 0.0000005f);
 }
+
+/*
+** Count the set bits in a 64 bit value.
+*/
+inline uint32_t ga_popcount64(uint64_t v)
+{
+	v = v - ((v >> 1) & 0x5555555555555555ull);
+	v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+	v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return uint32_t((v * 0x0101010101010101ull) >> 56);
+}
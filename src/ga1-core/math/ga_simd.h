@@ -0,0 +1,114 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Thin wrapper over the SIMD instruction sets kernels are built for.
+**
+** GA_AVX is set by the build (see CMakeLists.txt) and gives 8 lanes of AVX2.
+** Otherwise GA_SSE gives 4 lanes of SSE2 wherever the compiler targets it,
+** which is every x64 build. Define GA_NO_SIMD to build neither, in which case
+** k_simd_width is 1 and kernels fall back to their scalar loops.
+**
+** Only plain IEEE add, subtract, multiply, divide and square root are
+** wrapped, so every lane rounds exactly as the scalar code would. Min and
+** max are a < b ? a : b and a > b ? a : b, which give b when either is NaN.
+*/
+
+#include <cstdint>
+
+#if !defined(GA_NO_SIMD)
+#if defined(GA_AVX)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GA_SSE 1
+#include <emmintrin.h>
+#endif
+#endif
+
+#if defined(GA_AVX)
+
+typedef __m256 ga_simd_float;
+static const uint32_t k_simd_width = 8;
+
+inline ga_simd_float ga_simd_load(const float* p) { return _mm256_loadu_ps(p); }
+inline void ga_simd_store(float* p, ga_simd_float a) { _mm256_storeu_ps(p, a); }
+inline ga_simd_float ga_simd_set(float a) { return _mm256_set1_ps(a); }
+inline ga_simd_float ga_simd_add(ga_simd_float a, ga_simd_float b) { return _mm256_add_ps(a, b); }
+inline ga_simd_float ga_simd_sub(ga_simd_float a, ga_simd_float b) { return _mm256_sub_ps(a, b); }
+inline ga_simd_float ga_simd_mul(ga_simd_float a, ga_simd_float b) { return _mm256_mul_ps(a, b); }
+inline ga_simd_float ga_simd_div(ga_simd_float a, ga_simd_float b) { return _mm256_div_ps(a, b); }
+inline ga_simd_float ga_simd_sqrt(ga_simd_float a) { return _mm256_sqrt_ps(a); }
+inline ga_simd_float ga_simd_min(ga_simd_float a, ga_simd_float b) { return _mm256_min_ps(a, b); }
+inline ga_simd_float ga_simd_max(ga_simd_float a, ga_simd_float b) { return _mm256_max_ps(a, b); }
+
+/*
+** All bits set in the lanes where a <= b.
+*/
+inline ga_simd_float ga_simd_less_equal(ga_simd_float a, ga_simd_float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+
+/*
+** One bit per lane, lane 0 lowest, set where the mask is.
+*/
+inline uint32_t ga_simd_mask_bits(ga_simd_float mask) { return uint32_t(_mm256_movemask_ps(mask)); }
+
+/*
+** All bits set in the lanes whose flags have none of the given bits set.
+*/
+inline ga_simd_float ga_simd_flags_clear(const uint32_t* flags, uint32_t bits)
+{
+	__m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(flags));
+	__m256i set = _mm256_and_si256(f, _mm256_set1_epi32(int(bits)));
+	return _mm256_castsi256_ps(_mm256_cmpeq_epi32(set, _mm256_setzero_si256()));
+}
+
+/*
+** a in the lanes where mask is set, b elsewhere.
+*/
+inline ga_simd_float ga_simd_select(ga_simd_float mask, ga_simd_float a, ga_simd_float b)
+{
+	return _mm256_or_ps(_mm256_and_ps(mask, a), _mm256_andnot_ps(mask, b));
+}
+
+#elif defined(GA_SSE)
+
+typedef __m128 ga_simd_float;
+static const uint32_t k_simd_width = 4;
+
+inline ga_simd_float ga_simd_load(const float* p) { return _mm_loadu_ps(p); }
+inline void ga_simd_store(float* p, ga_simd_float a) { _mm_storeu_ps(p, a); }
+inline ga_simd_float ga_simd_set(float a) { return _mm_set1_ps(a); }
+inline ga_simd_float ga_simd_add(ga_simd_float a, ga_simd_float b) { return _mm_add_ps(a, b); }
+inline ga_simd_float ga_simd_sub(ga_simd_float a, ga_simd_float b) { return _mm_sub_ps(a, b); }
+inline ga_simd_float ga_simd_mul(ga_simd_float a, ga_simd_float b) { return _mm_mul_ps(a, b); }
+inline ga_simd_float ga_simd_div(ga_simd_float a, ga_simd_float b) { return _mm_div_ps(a, b); }
+inline ga_simd_float ga_simd_sqrt(ga_simd_float a) { return _mm_sqrt_ps(a); }
+inline ga_simd_float ga_simd_min(ga_simd_float a, ga_simd_float b) { return _mm_min_ps(a, b); }
+inline ga_simd_float ga_simd_max(ga_simd_float a, ga_simd_float b) { return _mm_max_ps(a, b); }
+inline ga_simd_float ga_simd_less_equal(ga_simd_float a, ga_simd_float b) { return _mm_cmple_ps(a, b); }
+inline uint32_t ga_simd_mask_bits(ga_simd_float mask) { return uint32_t(_mm_movemask_ps(mask)); }
+
+inline ga_simd_float ga_simd_flags_clear(const uint32_t* flags, uint32_t bits)
+{
+	__m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(flags));
+	__m128i set = _mm_and_si128(f, _mm_set1_epi32(int(bits)));
+	return _mm_castsi128_ps(_mm_cmpeq_epi32(set, _mm_setzero_si128()));
+}
+
+inline ga_simd_float ga_simd_select(ga_simd_float mask, ga_simd_float a, ga_simd_float b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+#else
+
+static const uint32_t k_simd_width = 1;
+
+#endif
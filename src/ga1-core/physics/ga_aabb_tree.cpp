@@ -0,0 +1,521 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_aabb_tree.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// How far a moving body's fat box reaches past its bounds on every side.
+static const float k_aabb_tree_fat_margin = 0.1f;
+
+// A body that left its fat box is given room for this many more steps of
+// the same motion, so fast bodies are not reinserted every step. The extra
+// room is never more than the body's own size, so a body flung far in one
+// step does not leave a huge box that every query has to look inside.
+static const float k_aabb_tree_displacement_multiplier = 4.0f;
+
+static bool is_unbounded(const ga_broadphase_box_t& box)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		if (box._min.axes[a] <= -FLT_MAX || box._max.axes[a] >= FLT_MAX) return true;
+	}
+	return false;
+}
+
+static bool overlaps(const ga_vec3f& min_a, const ga_vec3f& max_a, const ga_vec3f& min_b, const ga_vec3f& max_b)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		if (min_a.axes[a] > max_b.axes[a] || min_b.axes[a] > max_a.axes[a]) return false;
+	}
+	return true;
+}
+
+static bool contains(const ga_vec3f& outer_min, const ga_vec3f& outer_max, const ga_vec3f& min, const ga_vec3f& max)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		if (min.axes[a] < outer_min.axes[a] || max.axes[a] > outer_max.axes[a]) return false;
+	}
+	return true;
+}
+
+static void combine(const ga_vec3f& min_a, const ga_vec3f& max_a, const ga_vec3f& min_b, const ga_vec3f& max_b, ga_vec3f& min, ga_vec3f& max)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		min.axes[a] = std::min(min_a.axes[a], min_b.axes[a]);
+		max.axes[a] = std::max(max_a.axes[a], max_b.axes[a]);
+	}
+}
+
+static float surface_area(const ga_vec3f& min, const ga_vec3f& max)
+{
+	float x = max.x - min.x;
+	float y = max.y - min.y;
+	float z = max.z - min.z;
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+static float combined_area(const ga_vec3f& min_a, const ga_vec3f& max_a, const ga_vec3f& min_b, const ga_vec3f& max_b)
+{
+	ga_vec3f min, max;
+	combine(min_a, max_a, min_b, max_b, min, max);
+	return surface_area(min, max);
+}
+
+ga_aabb_tree::ga_aabb_tree() : _root(k_null_node), _free_list(k_null_node), _reinsert_count(0)
+{
+}
+
+ga_aabb_tree::~ga_aabb_tree()
+{
+}
+
+void ga_aabb_tree::reset()
+{
+	_nodes.clear();
+	_root = k_null_node;
+	_free_list = k_null_node;
+	_leaf_of_body.clear();
+	_last_min.clear();
+}
+
+void ga_aabb_tree::find_pairs(const ga_broadphase_box_t* boxes, uint32_t count, std::vector<ga_body_pair_t>& pairs)
+{
+	pairs.clear();
+	_rejections = {};
+
+	if (_leaf_of_body.size() != count)
+	{
+		reset();
+		_leaf_of_body.resize(count, int32_t(k_null_node));
+		_last_min.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			_last_min[i] = boxes[i]._min;
+		}
+	}
+
+	// Put back any body that has left its fat box.
+	_reinsert_count = 0;
+	_unbounded.clear();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const ga_broadphase_box_t& box = boxes[i];
+		int32_t leaf = _leaf_of_body[i];
+
+		if (is_unbounded(box))
+		{
+			if (leaf != k_null_node)
+			{
+				remove_leaf(leaf);
+				free_node(leaf);
+				_leaf_of_body[i] = k_null_node;
+			}
+			_unbounded.push_back(i);
+			continue;
+		}
+
+		if (leaf != k_null_node)
+		{
+			if (contains(_nodes[leaf]._min, _nodes[leaf]._max, box._min, box._max))
+			{
+				_last_min[i] = box._min;
+				continue;
+			}
+			remove_leaf(leaf);
+			_reinsert_count++;
+		}
+		else
+		{
+			leaf = allocate_node();
+			_nodes[leaf]._body = i;
+			_leaf_of_body[i] = leaf;
+		}
+
+		// Static bodies are given no slack; they do not move.
+		node_t& node = _nodes[leaf];
+		node._min = box._min;
+		node._max = box._max;
+		if (!box._static)
+		{
+			for (int a = 0; a < 3; ++a)
+			{
+				float size = box._max.axes[a] - box._min.axes[a];
+				float displacement = k_aabb_tree_displacement_multiplier * (box._min.axes[a] - _last_min[i].axes[a]);
+				displacement = std::max(std::min(displacement, size), -size);
+				node._min.axes[a] -= k_aabb_tree_fat_margin - std::min(displacement, 0.0f);
+				node._max.axes[a] += k_aabb_tree_fat_margin + std::max(displacement, 0.0f);
+			}
+		}
+		_last_min[i] = box._min;
+
+		insert_leaf(leaf);
+	}
+
+	// Walk the tree against itself. Each entry on the stack is two subtrees
+	// whose leaves have not yet been paired; a node paired with itself stands
+	// for all pairs within it.
+	if (_root != k_null_node)
+	{
+		_stack.clear();
+		_stack.push_back(_root);
+		_stack.push_back(_root);
+	}
+	while (!_stack.empty())
+	{
+		int32_t index_b = _stack.back();
+		_stack.pop_back();
+		int32_t index_a = _stack.back();
+		_stack.pop_back();
+
+		const node_t& node_a = _nodes[index_a];
+		const node_t& node_b = _nodes[index_b];
+
+		if (index_a == index_b)
+		{
+			if (!node_a.is_leaf())
+			{
+				push_pair(node_a._children[0], node_a._children[0]);
+				push_pair(node_a._children[1], node_a._children[1]);
+				push_pair(node_a._children[0], node_a._children[1]);
+			}
+			continue;
+		}
+
+		if (!overlaps(node_a._min, node_a._max, node_b._min, node_b._max)) continue;
+
+		if (node_a.is_leaf() && node_b.is_leaf())
+		{
+			const ga_broadphase_box_t& box_a = boxes[node_a._body];
+			const ga_broadphase_box_t& box_b = boxes[node_b._body];
+			if (!overlaps(box_a._min, box_a._max, box_b._min, box_b._max)) continue;
+			if (!ga_broadphase_accept_pair(box_a, box_b, _rejections)) continue;
+
+			ga_body_pair_t pair;
+			pair._a = std::min(node_a._body, node_b._body);
+			pair._b = std::max(node_a._body, node_b._body);
+			pairs.push_back(pair);
+			continue;
+		}
+
+		// Open the larger of the two.
+		if (node_b.is_leaf() || (!node_a.is_leaf() && surface_area(node_a._min, node_a._max) > surface_area(node_b._min, node_b._max)))
+		{
+			push_pair(node_a._children[0], index_b);
+			push_pair(node_a._children[1], index_b);
+		}
+		else
+		{
+			push_pair(index_a, node_b._children[0]);
+			push_pair(index_a, node_b._children[1]);
+		}
+	}
+
+	// Unbounded bodies against everything.
+	for (uint32_t u : _unbounded)
+	{
+		const ga_broadphase_box_t& box = boxes[u];
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const ga_broadphase_box_t& other_box = boxes[i];
+			if (i == u || (i < u && _leaf_of_body[i] == k_null_node)) continue;
+			if (!overlaps(box._min, box._max, other_box._min, other_box._max)) continue;
+			if (!ga_broadphase_accept_pair(box, other_box, _rejections)) continue;
+
+			ga_body_pair_t pair;
+			pair._a = std::min(i, u);
+			pair._b = std::max(i, u);
+			pairs.push_back(pair);
+		}
+	}
+
+	sort_pairs(pairs);
+}
+
+void ga_aabb_tree::query_box(const ga_broadphase_box_t* boxes, uint32_t count, const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const
+{
+	if (_leaf_of_body.size() != count)
+	{
+		ga_broadphase::query_box(boxes, count, min, max, bodies);
+		return;
+	}
+
+	if (_root != k_null_node)
+	{
+		query_box_node(_root, boxes, min, max, bodies);
+	}
+	for (uint32_t u : _unbounded)
+	{
+		if (overlaps(boxes[u]._min, boxes[u]._max, min, max)) bodies.push_back(u);
+	}
+}
+
+void ga_aabb_tree::query_rays(const ga_broadphase_box_t* boxes, uint32_t count, ga_ray_packet_t& packet, float margin, ga_ray_visitor& visitor) const
+{
+	if (_leaf_of_body.size() != count)
+	{
+		ga_broadphase::query_rays(boxes, count, packet, margin, visitor);
+		return;
+	}
+
+	if (_root != k_null_node)
+	{
+		query_rays_node(_root, boxes, packet, margin, visitor);
+	}
+	for (uint32_t u : _unbounded)
+	{
+		uint32_t lanes = ray_packet_lanes(packet, boxes[u]._min, boxes[u]._max, margin);
+		if (lanes) visitor.visit(u, lanes, packet);
+	}
+}
+
+void ga_aabb_tree::query_box_node(int32_t index, const ga_broadphase_box_t* boxes, const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const
+{
+	// Leaves are fattened, so test the body's own box once there.
+	const node_t& node = _nodes[index];
+	if (!overlaps(node._min, node._max, min, max)) return;
+
+	if (node.is_leaf())
+	{
+		const ga_broadphase_box_t& box = boxes[node._body];
+		if (overlaps(box._min, box._max, min, max)) bodies.push_back(node._body);
+		return;
+	}
+
+	query_box_node(node._children[0], boxes, min, max, bodies);
+	query_box_node(node._children[1], boxes, min, max, bodies);
+}
+
+void ga_aabb_tree::query_rays_node(int32_t index, const ga_broadphase_box_t* boxes, ga_ray_packet_t& packet, float margin, ga_ray_visitor& visitor) const
+{
+	const node_t& node = _nodes[index];
+	uint32_t lanes = ray_packet_lanes(packet, node._min, node._max, margin);
+	if (!lanes) return;
+
+	if (node.is_leaf())
+	{
+		const ga_broadphase_box_t& box = boxes[node._body];
+		lanes = ray_packet_lanes(packet, box._min, box._max, margin);
+		if (lanes) visitor.visit(node._body, lanes, packet);
+		return;
+	}
+
+	// Split the children along the axis their centers differ most on, and
+	// take first the one the rays come to first.
+	const node_t& child_0 = _nodes[node._children[0]];
+	const node_t& child_1 = _nodes[node._children[1]];
+	int axis = 0;
+	float widest = 0.0f;
+	for (int a = 0; a < 3; ++a)
+	{
+		float apart = std::abs(child_1._min.axes[a] + child_1._max.axes[a] - child_0._min.axes[a] - child_0._max.axes[a]);
+		if (apart > widest)
+		{
+			widest = apart;
+			axis = a;
+		}
+	}
+
+	uint32_t lane = 0;
+	while (!(lanes & (1u << lane))) ++lane;
+	bool child_1_first = (child_1._min.axes[axis] + child_1._max.axes[axis] < child_0._min.axes[axis] + child_0._max.axes[axis]) == (packet._inverse_direction[axis][lane] > 0.0f);
+
+	query_rays_node(node._children[child_1_first ? 1 : 0], boxes, packet, margin, visitor);
+	query_rays_node(node._children[child_1_first ? 0 : 1], boxes, packet, margin, visitor);
+}
+
+int32_t ga_aabb_tree::allocate_node()
+{
+	int32_t index;
+	if (_free_list != k_null_node)
+	{
+		index = _free_list;
+		_free_list = _nodes[index]._parent;
+	}
+	else
+	{
+		index = int32_t(_nodes.size());
+		_nodes.push_back(node_t());
+	}
+
+	node_t& node = _nodes[index];
+	node._parent = k_null_node;
+	node._children[0] = k_null_node;
+	node._children[1] = k_null_node;
+	node._body = 0;
+	return index;
+}
+
+void ga_aabb_tree::free_node(int32_t index)
+{
+	_nodes[index]._parent = _free_list;
+	_free_list = index;
+}
+
+void ga_aabb_tree::insert_leaf(int32_t leaf)
+{
+	if (_root == k_null_node)
+	{
+		_root = leaf;
+		_nodes[leaf]._parent = k_null_node;
+		return;
+	}
+
+	// Walk down towards the cheapest sibling. Every node above it grows to
+	// take in the new leaf, so that growth is charged on the way down.
+	ga_vec3f leaf_min = _nodes[leaf]._min;
+	ga_vec3f leaf_max = _nodes[leaf]._max;
+	int32_t index = _root;
+	while (!_nodes[index].is_leaf())
+	{
+		const node_t& node = _nodes[index];
+		float area = surface_area(node._min, node._max);
+		float combined = combined_area(node._min, node._max, leaf_min, leaf_max);
+
+		// Cost of making the leaf and this node siblings under a new parent.
+		float cost = 2.0f * combined;
+
+		// Cost of pushing the leaf further down.
+		float inheritance_cost = 2.0f * (combined - area);
+		float child_cost[2];
+		for (int c = 0; c < 2; ++c)
+		{
+			const node_t& child = _nodes[node._children[c]];
+			child_cost[c] = combined_area(child._min, child._max, leaf_min, leaf_max) + inheritance_cost;
+			if (!child.is_leaf())
+			{
+				child_cost[c] -= surface_area(child._min, child._max);
+			}
+		}
+
+		if (cost < child_cost[0] && cost < child_cost[1]) break;
+
+		index = child_cost[0] < child_cost[1] ? node._children[0] : node._children[1];
+	}
+
+	int32_t sibling = index;
+	int32_t old_parent = _nodes[sibling]._parent;
+	int32_t new_parent = allocate_node();
+
+	node_t& parent = _nodes[new_parent];
+	parent._parent = old_parent;
+	parent._children[0] = sibling;
+	parent._children[1] = leaf;
+	combine(leaf_min, leaf_max, _nodes[sibling]._min, _nodes[sibling]._max, parent._min, parent._max);
+
+	if (old_parent != k_null_node)
+	{
+		node_t& grandparent = _nodes[old_parent];
+		grandparent._children[grandparent._children[0] == sibling ? 0 : 1] = new_parent;
+	}
+	else
+	{
+		_root = new_parent;
+	}
+	_nodes[sibling]._parent = new_parent;
+	_nodes[leaf]._parent = new_parent;
+
+	refit(old_parent, true);
+}
+
+void ga_aabb_tree::remove_leaf(int32_t leaf)
+{
+	if (leaf == _root)
+	{
+		_root = k_null_node;
+		return;
+	}
+
+	int32_t parent = _nodes[leaf]._parent;
+	int32_t grandparent = _nodes[parent]._parent;
+	int32_t sibling = _nodes[parent]._children[_nodes[parent]._children[0] == leaf ? 1 : 0];
+
+	// The sibling takes the parent's place.
+	if (grandparent != k_null_node)
+	{
+		node_t& node = _nodes[grandparent];
+		node._children[node._children[0] == parent ? 0 : 1] = sibling;
+		_nodes[sibling]._parent = grandparent;
+		free_node(parent);
+		refit(grandparent, false);
+	}
+	else
+	{
+		_root = sibling;
+		_nodes[sibling]._parent = k_null_node;
+		free_node(parent);
+	}
+}
+
+void ga_aabb_tree::refit(int32_t index, bool rotate_nodes)
+{
+	while (index != k_null_node)
+	{
+		node_t& node = _nodes[index];
+		const node_t& child_0 = _nodes[node._children[0]];
+		const node_t& child_1 = _nodes[node._children[1]];
+		combine(child_0._min, child_0._max, child_1._min, child_1._max, node._min, node._max);
+
+		if (rotate_nodes) rotate(index);
+		index = node._parent;
+	}
+}
+
+void ga_aabb_tree::rotate(int32_t index)
+{
+	// Consider swapping either child with one of the other child's children.
+	// The node's own bounds stay the same; only the child that takes in the
+	// swapped node changes, so pick the swap that shrinks it most.
+	int32_t children[2] = { _nodes[index]._children[0], _nodes[index]._children[1] };
+
+	float best_gain = 0.0f;
+	int32_t best_child = k_null_node;
+	int32_t best_grandchild = k_null_node;
+	for (int c = 0; c < 2; ++c)
+	{
+		const node_t& child = _nodes[children[c]];
+		if (child.is_leaf()) continue;
+
+		const node_t& other = _nodes[children[1 - c]];
+		float area = surface_area(child._min, child._max);
+		for (int g = 0; g < 2; ++g)
+		{
+			// The grandchild that stays behind is paired with the other child.
+			const node_t& kept = _nodes[child._children[1 - g]];
+			float gain = area - combined_area(kept._min, kept._max, other._min, other._max);
+			if (gain > best_gain)
+			{
+				best_gain = gain;
+				best_child = children[c];
+				best_grandchild = child._children[g];
+			}
+		}
+	}
+
+	if (best_child == k_null_node) return;
+
+	int32_t swapped = children[0] == best_child ? children[1] : children[0];
+
+	node_t& node = _nodes[index];
+	node._children[node._children[0] == swapped ? 0 : 1] = best_grandchild;
+	_nodes[best_grandchild]._parent = index;
+
+	node_t& child = _nodes[best_child];
+	child._children[child._children[0] == best_grandchild ? 0 : 1] = swapped;
+	_nodes[swapped]._parent = best_child;
+
+	const node_t& child_0 = _nodes[child._children[0]];
+	const node_t& child_1 = _nodes[child._children[1]];
+	combine(child_0._min, child_0._max, child_1._min, child_1._max, child._min, child._max);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_broadphase.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+** Dynamic bounding volume tree broadphase.
+**
+** Each body is a leaf holding a fattened copy of its bounds. A body is only
+** taken out and put back into the tree when it leaves its fat box, so bodies
+** that jiggle in place cost nothing to update. New leaves go next to the
+** sibling that grows the tree's surface area least, and the nodes above are
+** rotated whenever swapping a child with a grandchild shrinks them.
+**
+** Unlike sweep-and-prune, which only sorts along one axis, large or fast
+** bodies do not drag long runs of unrelated boxes into each test.
+**
+** Bodies with unbounded boxes, such as planes, are kept out of the tree and
+** tested against everything.
+*/
+class ga_aabb_tree final : public ga_broadphase
+{
+public:
+	ga_aabb_tree();
+	virtual ~ga_aabb_tree();
+
+	virtual void find_pairs(const ga_broadphase_box_t* boxes, uint32_t count, std::vector<ga_body_pair_t>& pairs) override;
+
+	/*
+	** Throw the tree away. It is rebuilt on the next find_pairs.
+	*/
+	virtual void reset() override;
+
+	virtual void query_box(const ga_broadphase_box_t* boxes, uint32_t count, const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const override;
+	/*
+	** Nearer children are visited first, judged by the direction of the
+	** packet's first ray.
+	*/
+	virtual void query_rays(const ga_broadphase_box_t* boxes, uint32_t count, ga_ray_packet_t& packet, float margin, ga_ray_visitor& visitor) const override;
+
+	/*
+	** Number of leaves taken out and put back in the last find_pairs.
+	*/
+	uint32_t get_reinsert_count() const { return _reinsert_count; }
+
+private:
+	static const int32_t k_null_node = -1;
+
+	struct node_t
+	{
+		ga_vec3f _min;
+		ga_vec3f _max;
+
+		// Next free node when on the free list.
+		int32_t _parent;
+		int32_t _children[2];
+
+		// Body index, for leaves.
+		uint32_t _body;
+
+		bool is_leaf() const { return _children[0] == k_null_node; }
+	};
+
+	int32_t allocate_node();
+	void free_node(int32_t index);
+
+	void insert_leaf(int32_t leaf);
+	void remove_leaf(int32_t leaf);
+
+	/*
+	** Refit the bounds of every node from index up to the root, optionally
+	** rotating each one on the way.
+	*/
+	void refit(int32_t index, bool rotate_nodes);
+	void rotate(int32_t index);
+
+	void query_box_node(int32_t index, const ga_broadphase_box_t* boxes, const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const;
+	void query_rays_node(int32_t index, const ga_broadphase_box_t* boxes, ga_ray_packet_t& packet, float margin, ga_ray_visitor& visitor) const;
+
+	void push_pair(int32_t a, int32_t b) { _stack.push_back(a); _stack.push_back(b); }
+
+	std::vector<node_t> _nodes;
+	int32_t _root;
+	int32_t _free_list;
+
+	// Leaf of each body, or k_null_node for bodies not in the tree.
+	std::vector<int32_t> _leaf_of_body;
+
+	// Bounds' min corner of each body at the last step, to tell how fast it moves.
+	std::vector<ga_vec3f> _last_min;
+
+	std::vector<uint32_t> _unbounded;
+
+	// Pairs of nodes still to visit, two entries each.
+	std::vector<int32_t> _stack;
+	uint32_t _reinsert_count;
+};
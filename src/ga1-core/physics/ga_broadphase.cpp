@@ -0,0 +1,52 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_broadphase.h"
+
+#include <algorithm>
+
+bool ga_broadphase::boxes_overlap(const ga_vec3f& min_a, const ga_vec3f& max_a, const ga_vec3f& min_b, const ga_vec3f& max_b)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		if (min_a.axes[a] > max_b.axes[a] || min_b.axes[a] > max_a.axes[a]) return false;
+	}
+	return true;
+}
+
+uint32_t ga_broadphase::ray_packet_lanes(const ga_ray_packet_t& packet, const ga_vec3f& min, const ga_vec3f& max, float margin)
+{
+	ga_vec3f grow = { margin, margin, margin };
+	return ray_packet_vs_box(packet, min - grow, max + grow);
+}
+
+void ga_broadphase::sort_pairs(std::vector<ga_body_pair_t>& pairs)
+{
+	std::sort(pairs.begin(), pairs.end(), [](const ga_body_pair_t& a, const ga_body_pair_t& b)
+	{
+		return a._a < b._a || (a._a == b._a && a._b < b._b);
+	});
+}
+
+void ga_broadphase::query_box(const ga_broadphase_box_t* boxes, uint32_t count, const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (boxes_overlap(boxes[i]._min, boxes[i]._max, min, max)) bodies.push_back(i);
+	}
+}
+
+void ga_broadphase::query_rays(const ga_broadphase_box_t* boxes, uint32_t count, ga_ray_packet_t& packet, float margin, ga_ray_visitor& visitor) const
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t lanes = ray_packet_lanes(packet, boxes[i]._min, boxes[i]._max, margin);
+		if (lanes) visitor.visit(i, lanes, packet);
+	}
+}
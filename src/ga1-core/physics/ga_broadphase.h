@@ -0,0 +1,168 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_scene_query.h"
+
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+** How the world finds the pairs of bodies to test for collision.
+*/
+enum ga_broadphase_type_t
+{
+	// Test every pair of bodies.
+	k_broadphase_brute_force,
+	k_broadphase_sweep_and_prune,
+	k_broadphase_aabb_tree,
+};
+
+/*
+** World space bounds of one body, as given to the broadphase.
+*/
+struct ga_broadphase_box_t
+{
+	ga_vec3f _min;
+	ga_vec3f _max;
+
+	// Static or asleep; two such bodies have nothing to resolve.
+	bool _static;
+
+	// Collision layers the body is in, and the layers it collides with.
+	uint32_t _layers;
+	uint32_t _mask;
+
+	// A bit for the body's shape type, and a bit for each shape type there
+	// is an intersection test against.
+	uint32_t _shape_bit;
+	uint32_t _kernels;
+};
+
+/*
+** Pairs of overlapping boxes passed over before the narrowphase, by reason.
+*/
+struct ga_pair_rejections_t
+{
+	// Both static or asleep.
+	uint32_t _static;
+
+	// One is in none of the layers the other collides with.
+	uint32_t _layer;
+
+	// No intersection test for the two shapes.
+	uint32_t _kernel;
+};
+
+/*
+** Whether a pair of boxes should reach the narrowphase. If not, the reason
+** is counted.
+*/
+inline bool ga_broadphase_accept_pair(const ga_broadphase_box_t& a, const ga_broadphase_box_t& b, ga_pair_rejections_t& rejections)
+{
+	if (a._static && b._static)
+	{
+		rejections._static++;
+		return false;
+	}
+	if ((a._layers & b._mask) == 0 || (b._layers & a._mask) == 0)
+	{
+		rejections._layer++;
+		return false;
+	}
+	if ((a._kernels & b._shape_bit) == 0)
+	{
+		rejections._kernel++;
+		return false;
+	}
+	return true;
+}
+
+/*
+** Two bodies whose bounds overlap, by index, lower index first.
+*/
+struct ga_body_pair_t
+{
+	uint32_t _a;
+	uint32_t _b;
+};
+
+/*
+** Told of each body whose bounds some rays of a packet pass through, with a
+** bit set for each lane that does. It may shorten those rays as it goes;
+** bodies beyond the new ends are then passed over.
+*/
+class ga_ray_visitor
+{
+public:
+	virtual void visit(uint32_t body, uint32_t lanes, ga_ray_packet_t& packet) = 0;
+};
+
+/*
+** Finds the bodies whose bounds overlap, so only those reach the narrowphase.
+**
+** The world hands over the bounds of every body each step, always in the same
+** order, and calls reset whenever bodies are added or removed. Broadphases may
+** keep whatever they like between steps as long as the pairs they report are
+** the same as comparing every pair of boxes would give.
+*/
+class ga_broadphase
+{
+public:
+	virtual ~ga_broadphase() {}
+
+	/*
+	** Find every pair of overlapping boxes that ga_broadphase_accept_pair
+	** lets through, counting those it does not. Pairs are returned in
+	** ascending order.
+	*/
+	virtual void find_pairs(const ga_broadphase_box_t* boxes, uint32_t count, std::vector<ga_body_pair_t>& pairs) = 0;
+
+	/*
+	** Overlapping pairs passed over in the last find_pairs.
+	*/
+	const ga_pair_rejections_t& get_rejections() const { return _rejections; }
+
+	/*
+	** Forget anything kept from earlier steps.
+	*/
+	virtual void reset() = 0;
+
+	/*
+	** Find every box overlapping the given bounds, appended in no particular
+	** order. The boxes are those of the last find_pairs; broadphases that kept
+	** nothing from it test every box.
+	*/
+	virtual void query_box(const ga_broadphase_box_t* boxes, uint32_t count, const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const;
+
+	/*
+	** Visit every box some ray of a packet passes through once grown by
+	** margin on every side, in no particular order, though broadphases that
+	** can should try nearer boxes first. Boxes as for query_box.
+	*/
+	virtual void query_rays(const ga_broadphase_box_t* boxes, uint32_t count, ga_ray_packet_t& packet, float margin, ga_ray_visitor& visitor) const;
+
+protected:
+	ga_pair_rejections_t _rejections = {};
+
+	/*
+	** Put pairs in the order a pairwise loop over the bodies would test them.
+	*/
+	static void sort_pairs(std::vector<ga_body_pair_t>& pairs);
+
+	/*
+	** Which rays of a packet pass through a box grown by margin on every side.
+	*/
+	static uint32_t ray_packet_lanes(const ga_ray_packet_t& packet, const ga_vec3f& min, const ga_vec3f& max, float margin);
+
+	static bool boxes_overlap(const ga_vec3f& min_a, const ga_vec3f& max_a, const ga_vec3f& min_b, const ga_vec3f& max_b);
+};
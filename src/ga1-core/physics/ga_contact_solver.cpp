@@ -0,0 +1,556 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_contact_solver.h"
+#include "ga_intersection.h"
+#include "ga_rigid_body.h"
+
+#include "math/ga_math.h"
+
+// A point whose bodies have come this far apart along the normal is dropped.
+static const float k_contact_breaking_distance = 0.02f;
+
+// A point whose bodies have slid this far across each other is dropped, and
+// a new point this close to an old one replaces it.
+static const float k_contact_slide_distance = 0.05f;
+
+// If the normal turns further than this (as a cosine), the old points are
+// from a different way of touching and are all dropped.
+static const float k_contact_normal_cosine = 0.95f;
+
+// Overlap left alone, so resting contacts don't flicker in and out.
+static const float k_penetration_slop = 0.005f;
+
+// Fraction of the remaining overlap pushed out per step.
+static const float k_push_fraction = 0.5f;
+
+// Slower than this and bodies stop bouncing, so resting contacts settle.
+static const float k_restitution_threshold = 0.5f;
+
+// Smallest number of constraints solved by a single job, and the most jobs
+// one color is split into.
+static const uint32_t k_min_constraints_per_job = 64;
+static const uint32_t k_max_solver_jobs = 64;
+
+/*
+** Area of four points, roughly: the largest of the cross products between
+** the diagonals of the three ways they can be paired up.
+*/
+static float quad_area(const ga_vec3f& p0, const ga_vec3f& p1, const ga_vec3f& p2, const ga_vec3f& p3)
+{
+	float a = ga_vec3f_cross(p0 - p1, p2 - p3).mag2();
+	float b = ga_vec3f_cross(p0 - p2, p1 - p3).mag2();
+	float c = ga_vec3f_cross(p0 - p3, p1 - p2).mag2();
+	return ga_max(a, ga_max(b, c));
+}
+
+/*
+** Add a point found this step. One matching a point already there takes its
+** place and keeps its impulses; otherwise, if the manifold is full, the
+** deepest point stays and of the rest whichever leaves the others covering
+** the most area goes.
+*/
+static void add_contact_point(ga_contact_manifold_t& manifold, const ga_mat4f& inverse_a, const ga_mat4f& inverse_b, const ga_vec3f& normal, const ga_vec3f& position, float penetration, uint32_t feature)
+{
+	// The new point's copy on a is the part of a deepest inside b, and the
+	// other way around.
+	ga_vec3f half_depth = normal.scale_result(0.5f * penetration);
+	ga_contact_point_t added;
+	added._local_a = inverse_a.transform_point(position + half_depth);
+	added._local_b = inverse_b.transform_point(position - half_depth);
+	added._position = position;
+	added._penetration = penetration;
+	added._feature = feature;
+	added._normal_impulse = 0.0f;
+	added._tangent_impulse[0] = 0.0f;
+	added._tangent_impulse[1] = 0.0f;
+
+	ga_vec3f points[k_max_manifold_points + 1];
+	for (uint32_t i = 0; i < manifold._point_count; ++i)
+	{
+		const ga_contact_point_t& point = manifold._points[i];
+		points[i] = point._position;
+
+		if (point._feature == feature && points[i].dist2(position) < k_contact_slide_distance * k_contact_slide_distance)
+		{
+			added._normal_impulse = point._normal_impulse;
+			added._tangent_impulse[0] = point._tangent_impulse[0];
+			added._tangent_impulse[1] = point._tangent_impulse[1];
+			manifold._points[i] = added;
+			return;
+		}
+	}
+
+	if (manifold._point_count < k_max_manifold_points)
+	{
+		manifold._points[manifold._point_count++] = added;
+		return;
+	}
+
+	points[k_max_manifold_points] = position;
+	uint32_t deepest = k_max_manifold_points;
+	for (uint32_t i = 0; i < k_max_manifold_points; ++i)
+	{
+		float deepest_penetration = deepest < k_max_manifold_points ? manifold._points[deepest]._penetration : penetration;
+		if (manifold._points[i]._penetration > deepest_penetration) deepest = i;
+	}
+
+	uint32_t dropped = deepest == 0 ? 1 : 0;
+	float best_area = -1.0f;
+	for (uint32_t i = 0; i <= k_max_manifold_points; ++i)
+	{
+		if (i == deepest) continue;
+
+		ga_vec3f kept[k_max_manifold_points];
+		uint32_t kept_count = 0;
+		for (uint32_t j = 0; j <= k_max_manifold_points; ++j)
+		{
+			if (j != i) kept[kept_count++] = points[j];
+		}
+
+		float area = quad_area(kept[0], kept[1], kept[2], kept[3]);
+		if (area > best_area)
+		{
+			best_area = area;
+			dropped = i;
+		}
+	}
+
+	if (dropped < k_max_manifold_points)
+	{
+		manifold._points[dropped] = added;
+	}
+}
+
+void ga_update_contact_manifold(ga_contact_manifold_t& manifold, const ga_mat4f& transform_a, const ga_mat4f& transform_b, const ga_vec3f& normal, const ga_collision_info& info)
+{
+	if (manifold._point_count > 0 && manifold._normal.dot(normal) < k_contact_normal_cosine)
+	{
+		manifold._point_count = 0;
+	}
+	manifold._normal = normal;
+
+	// Follow the old points: each is remembered on both bodies, and how far
+	// the two copies have drifted apart says how it has changed.
+	for (uint32_t i = manifold._point_count; i-- > 0;)
+	{
+		ga_contact_point_t& point = manifold._points[i];
+		ga_vec3f point_a = transform_a.transform_point(point._local_a);
+		ga_vec3f point_b = transform_b.transform_point(point._local_b);
+		ga_vec3f drift = point_a - point_b;
+		float penetration = drift.dot(normal);
+		ga_vec3f slide = drift - normal.scale_result(penetration);
+
+		if (penetration < -k_contact_breaking_distance || slide.mag2() > k_contact_slide_distance * k_contact_slide_distance)
+		{
+			point = manifold._points[--manifold._point_count];
+		}
+		else
+		{
+			point._position = (point_a + point_b).scale_result(0.5f);
+			point._penetration = penetration;
+		}
+	}
+
+	ga_mat4f inverse_a = transform_a.inverse();
+	ga_mat4f inverse_b = transform_b.inverse();
+	if (info._area_point_count > 0)
+	{
+		for (uint32_t i = 0; i < info._area_point_count; ++i)
+		{
+			add_contact_point(manifold, inverse_a, inverse_b, normal, info._area_points[i], info._area_penetrations[i], info._area_features[i]);
+		}
+	}
+	else
+	{
+		add_contact_point(manifold, inverse_a, inverse_b, normal, info._point, info._penetration, info._feature);
+	}
+}
+
+/*
+** Move a body along a velocity and turn it by an angular velocity, for dt.
+*/
+static void move_body(const ga_solver_bodies_t& bodies, uint32_t index, const ga_vec3f& velocity, const ga_vec3f& angular_velocity, float dt)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		bodies._position[a][index] += velocity.axes[a] * dt;
+	}
+
+	// q += 0.5 * (w, 0) * q * dt, as the integrator turns bodies.
+	float wx = angular_velocity.x;
+	float wy = angular_velocity.y;
+	float wz = angular_velocity.z;
+	float qx = bodies._orientation[0][index];
+	float qy = bodies._orientation[1][index];
+	float qz = bodies._orientation[2][index];
+	float qw = bodies._orientation[3][index];
+
+	float h = 0.5f * dt;
+	float x = qx + (wy * qz - wz * qy + qw * wx) * h;
+	float y = qy + (wz * qx - wx * qz + qw * wy) * h;
+	float z = qz + (wx * qy - wy * qx + qw * wz) * h;
+	float w = qw - (wx * qx + wy * qy + wz * qz) * h;
+
+	float length = ga_sqrtf(x * x + y * y + z * z + w * w);
+	bodies._orientation[0][index] = x / length;
+	bodies._orientation[1][index] = y / length;
+	bodies._orientation[2][index] = z / length;
+	bodies._orientation[3][index] = w / length;
+}
+
+float ga_contact_solver::relative_speed(const constraint_t& constraint, int direction) const
+{
+	const body_t& a = _bodies[constraint._a];
+	const body_t& b = _bodies[constraint._b];
+	return constraint._directions[direction].dot(b._velocity - a._velocity) +
+		b._angular_velocity.dot(constraint._angular_b[direction]) -
+		a._angular_velocity.dot(constraint._angular_a[direction]);
+}
+
+void ga_contact_solver::apply_impulse(const constraint_t& constraint, int direction, float impulse)
+{
+	body_t& a = _bodies[constraint._a];
+	body_t& b = _bodies[constraint._b];
+	const ga_vec3f& d = constraint._directions[direction];
+
+	if (a._moving)
+	{
+		a._velocity -= d.scale_result(impulse * a._inverse_mass);
+		a._angular_momentum -= constraint._angular_a[direction].scale_result(impulse);
+		a._angular_velocity -= constraint._response_a[direction].scale_result(impulse);
+	}
+
+	if (b._moving)
+	{
+		b._velocity += d.scale_result(impulse * b._inverse_mass);
+		b._angular_momentum += constraint._angular_b[direction].scale_result(impulse);
+		b._angular_velocity += constraint._response_b[direction].scale_result(impulse);
+	}
+}
+
+float ga_contact_solver::relative_push_speed(const constraint_t& constraint) const
+{
+	const body_t& a = _bodies[constraint._a];
+	const body_t& b = _bodies[constraint._b];
+	return constraint._directions[0].dot(b._push_velocity - a._push_velocity) +
+		b._push_angular_velocity.dot(constraint._angular_b[0]) -
+		a._push_angular_velocity.dot(constraint._angular_a[0]);
+}
+
+void ga_contact_solver::apply_push_impulse(const constraint_t& constraint, float impulse)
+{
+	body_t& a = _bodies[constraint._a];
+	body_t& b = _bodies[constraint._b];
+	const ga_vec3f& d = constraint._directions[0];
+
+	if (a._moving)
+	{
+		a._push_velocity -= d.scale_result(impulse * a._inverse_mass);
+		a._push_angular_velocity -= constraint._response_a[0].scale_result(impulse);
+	}
+
+	if (b._moving)
+	{
+		b._push_velocity += d.scale_result(impulse * b._inverse_mass);
+		b._push_angular_velocity += constraint._response_b[0].scale_result(impulse);
+	}
+}
+
+void ga_contact_solver::color_constraints(uint32_t body_count)
+{
+	if (_body_colors.size() < body_count)
+	{
+		_body_colors.resize(body_count);
+	}
+
+	uint32_t manifold_count = uint32_t(_manifold_starts.size()) - 1;
+	for (uint32_t m = 0; m < manifold_count; ++m)
+	{
+		const constraint_t& constraint = _constraints[_manifold_starts[m]];
+		_body_colors[constraint._a] = 0;
+		_body_colors[constraint._b] = 0;
+	}
+
+	// Give each manifold the lowest color neither of its moving bodies has.
+	uint32_t counts[k_max_colors + 1] = {};
+	_manifold_colors.resize(manifold_count);
+	for (uint32_t m = 0; m < manifold_count; ++m)
+	{
+		uint32_t begin = _manifold_starts[m];
+		const constraint_t& constraint = _constraints[begin];
+		bool moving_a = _bodies[constraint._a]._moving;
+		bool moving_b = _bodies[constraint._b]._moving;
+
+		uint64_t used = (moving_a ? _body_colors[constraint._a] : 0) | (moving_b ? _body_colors[constraint._b] : 0);
+		uint32_t color = 0;
+		while (color < k_max_colors && (used & (uint64_t(1) << color))) ++color;
+
+		if (color < k_max_colors)
+		{
+			if (moving_a) _body_colors[constraint._a] |= uint64_t(1) << color;
+			if (moving_b) _body_colors[constraint._b] |= uint64_t(1) << color;
+		}
+		_manifold_colors[m] = color;
+		counts[color] += _manifold_starts[m + 1] - begin;
+	}
+
+	_color_starts[0] = 0;
+	for (uint32_t c = 0; c <= k_max_colors; ++c)
+	{
+		_color_starts[c + 1] = _color_starts[c] + counts[c];
+		counts[c] = _color_starts[c];
+	}
+
+	_sorted_constraints.resize(_constraints.size());
+	for (uint32_t m = 0; m < manifold_count; ++m)
+	{
+		uint32_t& next = counts[_manifold_colors[m]];
+		for (uint32_t i = _manifold_starts[m]; i < _manifold_starts[m + 1]; ++i)
+		{
+			_sorted_constraints[next++] = _constraints[i];
+		}
+	}
+	_constraints.swap(_sorted_constraints);
+}
+
+void ga_contact_solver::solve_range(pass_t pass, uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		constraint_t& constraint = _constraints[i];
+		ga_contact_point_t& point = *constraint._point;
+
+		if (pass == k_pass_warm_start)
+		{
+			// Start from last step's impulses.
+			apply_impulse(constraint, 0, point._normal_impulse);
+			apply_impulse(constraint, 1, point._tangent_impulse[0]);
+			apply_impulse(constraint, 2, point._tangent_impulse[1]);
+		}
+		else if (pass == k_pass_velocity)
+		{
+			// Friction can hold back as much as the normal impulse allows.
+			float limit = constraint._friction * point._normal_impulse;
+			for (int t = 0; t < 2; ++t)
+			{
+				float impulse = -constraint._mass[t + 1] * relative_speed(constraint, t + 1);
+				float total = ga_max(-limit, ga_min(point._tangent_impulse[t] + impulse, limit));
+				apply_impulse(constraint, t + 1, total - point._tangent_impulse[t]);
+				point._tangent_impulse[t] = total;
+			}
+
+			float impulse = constraint._mass[0] * (constraint._target_speed - relative_speed(constraint, 0));
+			float total = ga_max(point._normal_impulse + impulse, 0.0f);
+			apply_impulse(constraint, 0, total - point._normal_impulse);
+			point._normal_impulse = total;
+		}
+		else
+		{
+			if (constraint._push_speed <= 0.0f && constraint._push_impulse <= 0.0f) continue;
+
+			float impulse = constraint._mass[0] * (constraint._push_speed - relative_push_speed(constraint));
+			float total = ga_max(constraint._push_impulse + impulse, 0.0f);
+			apply_push_impulse(constraint, total - constraint._push_impulse);
+			constraint._push_impulse = total;
+		}
+	}
+}
+
+void ga_contact_solver::run_pass(pass_t pass)
+{
+	if (!_colored)
+	{
+		solve_range(pass, 0, uint32_t(_constraints.size()));
+		return;
+	}
+
+	for (uint32_t color = 0; color <= k_max_colors; ++color)
+	{
+		uint32_t begin = _color_starts[color];
+		uint32_t end = _color_starts[color + 1];
+		uint32_t count = end - begin;
+		if (count == 0) continue;
+
+		// The last color may share bodies within itself.
+		if (color == k_max_colors || !_parallel || count < k_min_constraints_per_job * 2)
+		{
+			solve_range(pass, begin, end);
+			continue;
+		}
+
+		// Batches are stretched to the end of the manifold they stop in, so
+		// there may be fewer than planned but never more.
+		uint32_t batch_size = ga_max(k_min_constraints_per_job, (count + k_max_solver_jobs - 1) / k_max_solver_jobs);
+		_batches.resize((count + batch_size - 1) / batch_size);
+		_batch_decls.resize(_batches.size());
+		uint32_t batch_count = 0;
+		for (uint32_t batch_begin = begin; batch_begin < end; ++batch_count)
+		{
+			uint32_t batch_end = ga_min(end, batch_begin + batch_size);
+			while (batch_end < end && !_constraints[batch_end]._first) ++batch_end;
+
+			uint32_t i = batch_count;
+			_batches[i]._solver = this;
+			_batches[i]._pass = pass;
+			_batches[i]._begin = batch_begin;
+			_batches[i]._end = batch_end;
+			batch_begin = batch_end;
+			_batch_decls[i]._data = &_batches[i];
+			_batch_decls[i]._entry = [](void* data)
+			{
+				auto batch = static_cast<batch_t*>(data);
+				batch->_solver->solve_range(batch->_pass, batch->_begin, batch->_end);
+			};
+		}
+
+		int32_t counter;
+		ga_job::run(_batch_decls.data(), int(batch_count), &counter);
+		ga_job::wait(&counter);
+	}
+}
+
+void ga_contact_solver::solve(ga_contact_manifold_t* manifolds, uint32_t count, const ga_solver_bodies_t& bodies, uint32_t body_count, float dt)
+{
+	if (_bodies.size() < body_count)
+	{
+		_bodies.resize(body_count);
+	}
+
+	// Gather the bodies in contact. Static bodies keep their velocity, so
+	// they can still carry what touches them, but nothing moves them. Sleeping
+	// bodies are held still the same way.
+	for (uint32_t m = 0; m < count; ++m)
+	{
+		uint32_t pair[] = { manifolds[m]._a, manifolds[m]._b };
+		for (uint32_t index : pair)
+		{
+			body_t& body = _bodies[index];
+			bool moving = (bodies._flags[index] & (k_static | k_sleeping)) == 0;
+			body._inverse_mass = moving ? bodies._inverse_mass[index] : 0.0f;
+			body._moving = moving;
+			for (int a = 0; a < 3; ++a)
+			{
+				body._velocity.axes[a] = bodies._velocity[a][index];
+				body._angular_momentum.axes[a] = bodies._angular_momentum[a][index];
+			}
+			body._angular_velocity = moving ? bodies._inverse_inertia[index].transform(body._angular_momentum) : ga_vec3f::zero_vector();
+			body._push_velocity = ga_vec3f::zero_vector();
+			body._push_angular_velocity = ga_vec3f::zero_vector();
+		}
+	}
+
+	_constraints.clear();
+	_manifold_starts.clear();
+	for (uint32_t m = 0; m < count; ++m)
+	{
+		ga_contact_manifold_t& manifold = manifolds[m];
+		uint32_t a = manifold._a;
+		uint32_t b = manifold._b;
+		bool moving_a = (bodies._flags[a] & (k_static | k_sleeping)) == 0;
+		bool moving_b = (bodies._flags[b] & (k_static | k_sleeping)) == 0;
+
+		// A pair left asleep keeps its impulses for when it wakes.
+		if (!moving_a && !moving_b) continue;
+		if (manifold._point_count == 0) continue;
+
+		_manifold_starts.push_back(uint32_t(_constraints.size()));
+
+		ga_vec3f position_a = { bodies._position[0][a], bodies._position[1][a], bodies._position[2][a] };
+		ga_vec3f position_b = { bodies._position[0][b], bodies._position[1][b], bodies._position[2][b] };
+
+		// Two directions across the normal for friction.
+		const ga_vec3f& normal = manifold._normal;
+		ga_vec3f axis = ga_absf(normal.x) < 0.57735f ? ga_vec3f::x_vector() : (ga_absf(normal.y) < 0.57735f ? ga_vec3f::y_vector() : ga_vec3f::z_vector());
+		ga_vec3f tangent_1 = ga_vec3f_cross(normal, axis).normal();
+		ga_vec3f tangent_2 = ga_vec3f_cross(normal, tangent_1);
+
+		for (uint32_t p = 0; p < manifold._point_count; ++p)
+		{
+			ga_contact_point_t& point = manifold._points[p];
+
+			constraint_t constraint;
+			constraint._a = a;
+			constraint._b = b;
+			constraint._point = &point;
+			constraint._directions[0] = normal;
+			constraint._directions[1] = tangent_1;
+			constraint._directions[2] = tangent_2;
+			constraint._friction = manifold._friction;
+
+			ga_vec3f r_a = point._position - position_a;
+			ga_vec3f r_b = point._position - position_b;
+
+			for (int d = 0; d < 3; ++d)
+			{
+				const ga_vec3f& direction = constraint._directions[d];
+				constraint._angular_a[d] = ga_vec3f_cross(r_a, direction);
+				constraint._angular_b[d] = ga_vec3f_cross(r_b, direction);
+				constraint._response_a[d] = moving_a ? bodies._inverse_inertia[a].transform(constraint._angular_a[d]) : ga_vec3f::zero_vector();
+				constraint._response_b[d] = moving_b ? bodies._inverse_inertia[b].transform(constraint._angular_b[d]) : ga_vec3f::zero_vector();
+
+				float k = _bodies[a]._inverse_mass + _bodies[b]._inverse_mass +
+					constraint._angular_a[d].dot(constraint._response_a[d]) +
+					constraint._angular_b[d].dot(constraint._response_b[d]);
+				constraint._mass[d] = k > 0.0f ? 1.0f / k : 0.0f;
+			}
+
+			// Bounce off fast approaches, and ease any overlap out over a few
+			// steps instead of all at once.
+			float approach = relative_speed(constraint, 0);
+			constraint._target_speed = approach < -k_restitution_threshold ? -manifold._restitution * approach : 0.0f;
+			constraint._push_speed = dt > 0.0f ? k_push_fraction / dt * ga_max(point._penetration - k_penetration_slop, 0.0f) : 0.0f;
+			constraint._push_impulse = 0.0f;
+			constraint._first = p == 0;
+
+			_constraints.push_back(constraint);
+		}
+	}
+
+	_manifold_starts.push_back(uint32_t(_constraints.size()));
+
+	// Small scenes are not worth coloring unless the order has to match.
+	_colored = _deterministic || (_parallel && _constraints.size() >= k_min_constraints_per_job * 2);
+	if (_colored)
+	{
+		color_constraints(body_count);
+	}
+
+	run_pass(k_pass_warm_start);
+	for (uint32_t iteration = 0; iteration < _iterations; ++iteration)
+	{
+		run_pass(k_pass_velocity);
+	}
+	for (uint32_t iteration = 0; iteration < _iterations; ++iteration)
+	{
+		run_pass(k_pass_push);
+	}
+
+	for (const auto& constraint : _constraints)
+	{
+		uint32_t pair[] = { constraint._a, constraint._b };
+		for (uint32_t index : pair)
+		{
+			if (bodies._flags[index] & (k_static | k_sleeping)) continue;
+
+			body_t& body = _bodies[index];
+			for (int a = 0; a < 3; ++a)
+			{
+				bodies._velocity[a][index] = body._velocity.axes[a];
+				bodies._angular_momentum[a][index] = body._angular_momentum.axes[a];
+			}
+
+			move_body(bodies, index, body._push_velocity, body._push_angular_velocity, dt);
+
+			// Only moved once, however many constraints it is in.
+			body._push_velocity = ga_vec3f::zero_vector();
+			body._push_angular_velocity = ga_vec3f::zero_vector();
+		}
+	}
+}
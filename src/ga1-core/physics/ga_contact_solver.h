@@ -0,0 +1,232 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "jobs/ga_job.h"
+#include "math/ga_mat3f.h"
+#include "math/ga_mat4f.h"
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <vector>
+
+struct ga_collision_info;
+
+// Points kept per touching pair; enough to hold a box flat on a face.
+static const uint32_t k_max_manifold_points = 4;
+
+/*
+** One point where two bodies touch, remembered in both bodies' frames so it
+** can be followed as they move, with the impulses last applied there.
+*/
+struct ga_contact_point_t
+{
+	ga_vec3f _local_a;
+	ga_vec3f _local_b;
+
+	// Halfway between the two, in the world, and how deep, as of the last update.
+	ga_vec3f _position;
+	float _penetration;
+
+	// Which features of the shapes touch here. Only points from the same
+	// pair of features are taken to be the same point.
+	uint32_t _feature;
+
+	float _normal_impulse;
+	float _tangent_impulse[2];
+};
+
+/*
+** The points where a pair of bodies touch, kept from step to step.
+** The normal points from a toward b.
+*/
+struct ga_contact_manifold_t
+{
+	uint32_t _a;
+	uint32_t _b;
+	ga_vec3f _normal;
+	float _restitution;
+	float _friction;
+	uint32_t _point_count;
+	ga_contact_point_t _points[k_max_manifold_points];
+};
+
+/*
+** Bring a manifold up to date with where its bodies are now, dropping
+** points that have come apart or slid away, then add the points the
+** narrowphase found this step. A point matching one already there takes
+** its place and keeps its impulses.
+*/
+void ga_update_contact_manifold(ga_contact_manifold_t& manifold, const ga_mat4f& transform_a, const ga_mat4f& transform_b, const ga_vec3f& normal, const ga_collision_info& info);
+
+/*
+** Pointers into the world's per-body arrays for the solver.
+*/
+struct ga_solver_bodies_t
+{
+	float* _velocity[3];
+	float* _angular_momentum[3];
+	float* _position[3];
+	float* _orientation[4];
+	const float* _inverse_mass;
+	const ga_mat3f* _inverse_inertia;
+	const uint32_t* _flags;
+};
+
+/*
+** Sequential impulse contact solver.
+**
+** Each step the solver pushes apart every point of every manifold in turn,
+** several times over, keeping a running total of the impulse at each point.
+** Totals are clamped rather than each push, so a later pass can take back
+** part of an earlier one. The totals are saved in the manifolds and applied
+** up front on the next step, which starts the solver close to the answer.
+**
+** Overlap is worked out the same way but with velocities of its own, which
+** move the bodies apart and are then thrown away. Pushing bodies apart with
+** their real velocities would leave them moving once they were clear.
+**
+** With enough contacts, manifolds are sorted into colors so that no two in
+** a color share a moving body, and each color is split across jobs. Static
+** bodies are only read, so any number of manifolds in a color may share
+** one. Colors are solved one after another, and a body is pushed by at most
+** one manifold per color, so each body sees the same pushes in the same
+** order however the jobs are scheduled.
+*/
+class ga_contact_solver final
+{
+public:
+	/*
+	** How many passes are made over the contacts each step.
+	*/
+	void set_iterations(uint32_t iterations) { _iterations = iterations; }
+	uint32_t get_iterations() const { return _iterations; }
+
+	/*
+	** Split each color across jobs. On by default, in which case the job
+	** system must be running once there are enough contacts to split.
+	*/
+	void set_parallel(bool parallel) { _parallel = parallel; }
+
+	/*
+	** Solve in color order however few contacts there are, so results are the
+	** same bit for bit with or without jobs and with any number of workers.
+	** Off by default, when scenes too small to split are solved in manifold
+	** order instead.
+	*/
+	void set_deterministic(bool deterministic) { _deterministic = deterministic; }
+	bool get_deterministic() const { return _deterministic; }
+
+	/*
+	** Change body velocities and angular momenta so no manifold point is
+	** moving further in, and move bodies so overlaps are eased back out over
+	** a few steps.
+	*/
+	void solve(ga_contact_manifold_t* manifolds, uint32_t count, const ga_solver_bodies_t& bodies, uint32_t body_count, float dt);
+
+private:
+	struct constraint_t
+	{
+		uint32_t _a;
+		uint32_t _b;
+		ga_contact_point_t* _point;
+
+		// Normal, then the two tangents.
+		ga_vec3f _directions[3];
+
+		// r x d for each direction, and that turned by the inverse inertia.
+		ga_vec3f _angular_a[3];
+		ga_vec3f _angular_b[3];
+		ga_vec3f _response_a[3];
+		ga_vec3f _response_b[3];
+
+		float _mass[3];
+		float _target_speed;
+		float _friction;
+
+		// How fast to move apart to clear the overlap, and the impulse so far.
+		float _push_speed;
+		float _push_impulse;
+
+		// The first of its manifold's points. The points of a manifold push
+		// the same bodies, so a job's batch only ever ends before one.
+		bool _first;
+	};
+
+	struct body_t
+	{
+		ga_vec3f _velocity;
+		ga_vec3f _angular_velocity;
+		ga_vec3f _angular_momentum;
+		ga_vec3f _push_velocity;
+		ga_vec3f _push_angular_velocity;
+		float _inverse_mass;
+
+		// Only moving bodies are written to; static ones can be shared by a color.
+		bool _moving;
+	};
+
+	enum pass_t
+	{
+		k_pass_warm_start,
+		k_pass_velocity,
+		k_pass_push,
+	};
+
+	/*
+	** A run of whole manifolds' constraints from one color, solved by one job.
+	*/
+	struct batch_t
+	{
+		ga_contact_solver* _solver;
+		pass_t _pass;
+		uint32_t _begin;
+		uint32_t _end;
+	};
+
+	// Colors fit in a 64-bit mask per body. Manifolds that find no free color
+	// go in one more, which is solved on one thread.
+	static const uint32_t k_max_colors = 64;
+
+	// How fast b moves away from a at the constraint's point, along one of its directions.
+	float relative_speed(const constraint_t& constraint, int direction) const;
+	void apply_impulse(const constraint_t& constraint, int direction, float impulse);
+
+	// The same for the velocities that clear overlap.
+	float relative_push_speed(const constraint_t& constraint) const;
+	void apply_push_impulse(const constraint_t& constraint, float impulse);
+
+	// Sort the constraints by color, keeping manifold order within each.
+	void color_constraints(uint32_t body_count);
+
+	// One pass over some constraints, and one over them all, by color.
+	void solve_range(pass_t pass, uint32_t begin, uint32_t end);
+	void run_pass(pass_t pass);
+
+	uint32_t _iterations = 8;
+	bool _parallel = true;
+	bool _deterministic = false;
+	std::vector<constraint_t> _constraints;
+	std::vector<body_t> _bodies;
+
+	// Where each manifold's constraints start, then the end.
+	std::vector<uint32_t> _manifold_starts;
+
+	// Colors used so far by each body, the color of each manifold, and where
+	// each color's constraints start once sorted, then the end.
+	bool _colored = false;
+	std::vector<uint64_t> _body_colors;
+	std::vector<uint32_t> _manifold_colors;
+	uint32_t _color_starts[k_max_colors + 2];
+	std::vector<constraint_t> _sorted_constraints;
+
+	std::vector<batch_t> _batches;
+	std::vector<ga_job_decl_t> _batch_decls;
+};
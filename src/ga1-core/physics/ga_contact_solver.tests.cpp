@@ -0,0 +1,142 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_contact_solver.tests.h"
+#include "ga_contact_solver.h"
+
+#include <cassert>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/*
+** Per-body arrays for the solver, laid out as the world keeps them.
+*/
+struct solver_test_bodies_t
+{
+	std::vector<float> _velocity[3];
+	std::vector<float> _angular_momentum[3];
+	std::vector<float> _position[3];
+	std::vector<float> _orientation[4];
+	std::vector<float> _inverse_mass;
+	std::vector<ga_mat3f> _inverse_inertia;
+	std::vector<uint32_t> _flags;
+
+	ga_solver_bodies_t get()
+	{
+		ga_solver_bodies_t bodies;
+		for (int a = 0; a < 3; ++a)
+		{
+			bodies._velocity[a] = _velocity[a].data();
+			bodies._angular_momentum[a] = _angular_momentum[a].data();
+			bodies._position[a] = _position[a].data();
+		}
+		for (int a = 0; a < 4; ++a)
+		{
+			bodies._orientation[a] = _orientation[a].data();
+		}
+		bodies._inverse_mass = _inverse_mass.data();
+		bodies._inverse_inertia = _inverse_inertia.data();
+		bodies._flags = _flags.data();
+		return bodies;
+	}
+};
+
+/*
+** A row of bodies, each touching the next with one to four points, so
+** manifolds of every size sit side by side in each color.
+*/
+static void build_solver_test(uint32_t body_count, solver_test_bodies_t& bodies, std::vector<ga_contact_manifold_t>& manifolds)
+{
+	std::mt19937 rng(body_count);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	for (int a = 0; a < 3; ++a)
+	{
+		bodies._velocity[a].resize(body_count);
+		bodies._angular_momentum[a].resize(body_count);
+		bodies._position[a].resize(body_count);
+	}
+	for (int a = 0; a < 4; ++a)
+	{
+		bodies._orientation[a].assign(body_count, a == 3 ? 1.0f : 0.0f);
+	}
+	bodies._inverse_mass.assign(body_count, 1.0f);
+	bodies._inverse_inertia.resize(body_count);
+	bodies._flags.assign(body_count, 0);
+
+	for (uint32_t i = 0; i < body_count; ++i)
+	{
+		for (int a = 0; a < 3; ++a)
+		{
+			bodies._velocity[a][i] = unit(rng);
+			bodies._angular_momentum[a][i] = 0.1f * unit(rng);
+		}
+		bodies._position[0][i] = 0.9f * float(i);
+		bodies._inverse_inertia[i].make_identity();
+	}
+
+	manifolds.clear();
+	for (uint32_t i = 0; i + 1 < body_count; ++i)
+	{
+		ga_contact_manifold_t manifold = {};
+		manifold._a = i;
+		manifold._b = i + 1;
+		manifold._normal = ga_vec3f::x_vector();
+		manifold._restitution = 0.5f;
+		manifold._friction = 0.3f;
+		manifold._point_count = 1 + (i * 7) % k_max_manifold_points;
+		for (uint32_t p = 0; p < manifold._point_count; ++p)
+		{
+			ga_contact_point_t& point = manifold._points[p];
+			point._position = { 0.9f * float(i) + 0.45f, 0.4f * unit(rng), 0.4f * unit(rng) };
+			point._penetration = 0.05f * (unit(rng) + 1.0f);
+			point._normal_impulse = 0.1f * (unit(rng) + 1.0f);
+		}
+		manifolds.push_back(manifold);
+	}
+}
+
+void ga_contact_solver_unit_tests()
+{
+	const uint32_t k_body_count = 1000;
+
+	solver_test_bodies_t serial_bodies, parallel_bodies;
+	std::vector<ga_contact_manifold_t> serial_manifolds, parallel_manifolds;
+	build_solver_test(k_body_count, serial_bodies, serial_manifolds);
+	build_solver_test(k_body_count, parallel_bodies, parallel_manifolds);
+
+	ga_contact_solver serial;
+	serial.set_parallel(false);
+	serial.set_deterministic(true);
+
+	ga_contact_solver parallel;
+	parallel.set_parallel(true);
+	parallel.set_deterministic(true);
+
+	for (int step = 0; step < 4; ++step)
+	{
+		serial.solve(serial_manifolds.data(), uint32_t(serial_manifolds.size()), serial_bodies.get(), k_body_count, 1.0f / 60.0f);
+		parallel.solve(parallel_manifolds.data(), uint32_t(parallel_manifolds.size()), parallel_bodies.get(), k_body_count, 1.0f / 60.0f);
+	}
+
+	for (int a = 0; a < 3; ++a)
+	{
+		assert(memcmp(serial_bodies._velocity[a].data(), parallel_bodies._velocity[a].data(), k_body_count * sizeof(float)) == 0);
+		assert(memcmp(serial_bodies._angular_momentum[a].data(), parallel_bodies._angular_momentum[a].data(), k_body_count * sizeof(float)) == 0);
+		assert(memcmp(serial_bodies._position[a].data(), parallel_bodies._position[a].data(), k_body_count * sizeof(float)) == 0);
+	}
+	for (size_t m = 0; m < serial_manifolds.size(); ++m)
+	{
+		for (uint32_t p = 0; p < serial_manifolds[m]._point_count; ++p)
+		{
+			assert(serial_manifolds[m]._points[p]._normal_impulse == parallel_manifolds[m]._points[p]._normal_impulse);
+		}
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Check the solver gives the same results split across jobs as on one
+** thread. Needs the job system running.
+*/
+void ga_contact_solver_unit_tests();
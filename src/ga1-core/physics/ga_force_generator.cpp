@@ -0,0 +1,21 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_force_generator.h"
+#include "ga_rigid_body.h"
+
+void ga_drag_force::update_force(ga_rigid_body* body, float)
+{
+	ga_vec3f velocity = body->get_linear_velocity();
+	float speed = velocity.mag();
+	if (speed <= 0.0f) return;
+
+	float drag = _linear * speed + _quadratic * speed * speed;
+	body->add_force(velocity.scale_result(-drag / speed));
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+class ga_rigid_body;
+
+/*
+** Applies a force to a body every step for as long as it is registered with
+** the world, e.g. drag or a spring. Gravity is applied by the world itself.
+** @see ga_physics_world::add_force_generator
+*/
+class ga_force_generator
+{
+public:
+	virtual ~ga_force_generator() {}
+
+	/*
+	** Add this step's force and torque to the body's accumulators.
+	*/
+	virtual void update_force(ga_rigid_body* body, float dt) = 0;
+};
+
+/*
+** Slows a body down: linear and quadratic drag against its velocity.
+*/
+class ga_drag_force final : public ga_force_generator
+{
+public:
+	ga_drag_force(float linear, float quadratic) : _linear(linear), _quadratic(quadratic) {}
+
+	void update_force(ga_rigid_body* body, float dt) override;
+
+private:
+	float _linear;
+	float _quadratic;
+};
@@ -0,0 +1,176 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_integrator.h"
+#include "ga_rigid_body.h"
+
+#include "math/ga_math.h"
+#include "math/ga_simd.h"
+
+/*
+** The scalar loops below handle whatever is left over after the SIMD loops,
+** and everything when there is no SIMD. They do the same operations in the
+** same order, so a body ends up in the same place whichever loop it lands in.
+*/
+
+static void integrate_euler(const ga_body_arrays_t& arrays, uint32_t i, const ga_vec3f& gravity, float dt)
+{
+	if (arrays._flags[i] & (k_static | k_sleeping)) return;
+
+	bool weighted = (arrays._flags[i] & k_weightless) == 0;
+	for (int a = 0; a < 3; ++a)
+	{
+		float acceleration = arrays._acceleration[a][i] + (weighted ? gravity.axes[a] : 0.0f);
+		float velocity = arrays._velocity[a][i] + acceleration * dt;
+		arrays._velocity[a][i] = velocity;
+		arrays._position[a][i] = arrays._position[a][i] + velocity * dt;
+	}
+}
+
+static void integrate_rk4(const ga_body_arrays_t& arrays, uint32_t i, const ga_vec3f& gravity, float dt)
+{
+	if (arrays._flags[i] & (k_static | k_sleeping)) return;
+
+	// Acceleration is held over the step, so the two middle stages agree and
+	// the velocity stages are the start, middle and end velocities.
+	bool weighted = (arrays._flags[i] & k_weightless) == 0;
+	for (int a = 0; a < 3; ++a)
+	{
+		float acceleration = arrays._acceleration[a][i] + (weighted ? gravity.axes[a] : 0.0f);
+		float velocity = arrays._velocity[a][i];
+		float velocity_mid = velocity + acceleration * (0.5f * dt);
+		float velocity_end = velocity + acceleration * dt;
+		float sum = velocity + velocity_mid * 4.0f + velocity_end;
+		arrays._velocity[a][i] = velocity_end;
+		arrays._position[a][i] = arrays._position[a][i] + sum * (dt / 6.0f);
+	}
+}
+
+static void integrate_orientation(const ga_body_arrays_t& arrays, uint32_t i, float dt)
+{
+	if (arrays._flags[i] & (k_static | k_sleeping)) return;
+
+	float wx = arrays._angular_velocity[0][i];
+	float wy = arrays._angular_velocity[1][i];
+	float wz = arrays._angular_velocity[2][i];
+	float qx = arrays._orientation[0][i];
+	float qy = arrays._orientation[1][i];
+	float qz = arrays._orientation[2][i];
+	float qw = arrays._orientation[3][i];
+
+	// q += 0.5 * (w, 0) * q * dt
+	float h = 0.5f * dt;
+	float x = qx + (wy * qz - wz * qy + qw * wx) * h;
+	float y = qy + (wz * qx - wx * qz + qw * wy) * h;
+	float z = qz + (wx * qy - wy * qx + qw * wz) * h;
+	float w = qw - (wx * qx + wy * qy + wz * qz) * h;
+
+	float length = ga_sqrtf(x * x + y * y + z * z + w * w);
+	arrays._orientation[0][i] = x / length;
+	arrays._orientation[1][i] = y / length;
+	arrays._orientation[2][i] = z / length;
+	arrays._orientation[3][i] = w / length;
+}
+
+void ga_integrate_linear(ga_integrator_t integrator, const ga_body_arrays_t& arrays, uint32_t begin, uint32_t end, const ga_vec3f& gravity, float dt)
+{
+	uint32_t i = begin;
+
+#if defined(GA_AVX) || defined(GA_SSE)
+	ga_simd_float dt_v = ga_simd_set(dt);
+	ga_simd_float half_dt_v = ga_simd_set(0.5f * dt);
+	ga_simd_float sixth_dt_v = ga_simd_set(dt / 6.0f);
+	ga_simd_float four_v = ga_simd_set(4.0f);
+	ga_simd_float zero_v = ga_simd_set(0.0f);
+	ga_simd_float gravity_v[3] = { ga_simd_set(gravity.x), ga_simd_set(gravity.y), ga_simd_set(gravity.z) };
+
+	for (; i + k_simd_width <= end; i += k_simd_width)
+	{
+		ga_simd_float moving = ga_simd_flags_clear(arrays._flags + i, k_static | k_sleeping);
+		ga_simd_float weighted = ga_simd_flags_clear(arrays._flags + i, k_weightless);
+
+		for (int a = 0; a < 3; ++a)
+		{
+			ga_simd_float acceleration = ga_simd_add(ga_simd_load(arrays._acceleration[a] + i), ga_simd_select(weighted, gravity_v[a], zero_v));
+			ga_simd_float velocity = ga_simd_load(arrays._velocity[a] + i);
+			ga_simd_float position = ga_simd_load(arrays._position[a] + i);
+
+			ga_simd_float new_velocity;
+			ga_simd_float new_position;
+			if (integrator == k_integrator_rk4)
+			{
+				ga_simd_float velocity_mid = ga_simd_add(velocity, ga_simd_mul(acceleration, half_dt_v));
+				new_velocity = ga_simd_add(velocity, ga_simd_mul(acceleration, dt_v));
+				ga_simd_float sum = ga_simd_add(ga_simd_add(velocity, ga_simd_mul(velocity_mid, four_v)), new_velocity);
+				new_position = ga_simd_add(position, ga_simd_mul(sum, sixth_dt_v));
+			}
+			else
+			{
+				new_velocity = ga_simd_add(velocity, ga_simd_mul(acceleration, dt_v));
+				new_position = ga_simd_add(position, ga_simd_mul(new_velocity, dt_v));
+			}
+
+			ga_simd_store(arrays._velocity[a] + i, ga_simd_select(moving, new_velocity, velocity));
+			ga_simd_store(arrays._position[a] + i, ga_simd_select(moving, new_position, position));
+		}
+	}
+#endif
+
+	for (; i < end; ++i)
+	{
+		if (integrator == k_integrator_rk4)
+		{
+			integrate_rk4(arrays, i, gravity, dt);
+		}
+		else
+		{
+			integrate_euler(arrays, i, gravity, dt);
+		}
+	}
+}
+
+void ga_integrate_orientation(const ga_body_arrays_t& arrays, uint32_t begin, uint32_t end, float dt)
+{
+	uint32_t i = begin;
+
+#if defined(GA_AVX) || defined(GA_SSE)
+	ga_simd_float h = ga_simd_set(0.5f * dt);
+
+	for (; i + k_simd_width <= end; i += k_simd_width)
+	{
+		ga_simd_float moving = ga_simd_flags_clear(arrays._flags + i, k_static | k_sleeping);
+
+		ga_simd_float wx = ga_simd_load(arrays._angular_velocity[0] + i);
+		ga_simd_float wy = ga_simd_load(arrays._angular_velocity[1] + i);
+		ga_simd_float wz = ga_simd_load(arrays._angular_velocity[2] + i);
+		ga_simd_float qx = ga_simd_load(arrays._orientation[0] + i);
+		ga_simd_float qy = ga_simd_load(arrays._orientation[1] + i);
+		ga_simd_float qz = ga_simd_load(arrays._orientation[2] + i);
+		ga_simd_float qw = ga_simd_load(arrays._orientation[3] + i);
+
+		ga_simd_float x = ga_simd_add(qx, ga_simd_mul(ga_simd_add(ga_simd_sub(ga_simd_mul(wy, qz), ga_simd_mul(wz, qy)), ga_simd_mul(qw, wx)), h));
+		ga_simd_float y = ga_simd_add(qy, ga_simd_mul(ga_simd_add(ga_simd_sub(ga_simd_mul(wz, qx), ga_simd_mul(wx, qz)), ga_simd_mul(qw, wy)), h));
+		ga_simd_float z = ga_simd_add(qz, ga_simd_mul(ga_simd_add(ga_simd_sub(ga_simd_mul(wx, qy), ga_simd_mul(wy, qx)), ga_simd_mul(qw, wz)), h));
+		ga_simd_float w = ga_simd_sub(qw, ga_simd_mul(ga_simd_add(ga_simd_add(ga_simd_mul(wx, qx), ga_simd_mul(wy, qy)), ga_simd_mul(wz, qz)), h));
+
+		ga_simd_float length2 = ga_simd_add(ga_simd_add(ga_simd_add(ga_simd_mul(x, x), ga_simd_mul(y, y)), ga_simd_mul(z, z)), ga_simd_mul(w, w));
+		ga_simd_float length = ga_simd_sqrt(length2);
+
+		ga_simd_store(arrays._orientation[0] + i, ga_simd_select(moving, ga_simd_div(x, length), qx));
+		ga_simd_store(arrays._orientation[1] + i, ga_simd_select(moving, ga_simd_div(y, length), qy));
+		ga_simd_store(arrays._orientation[2] + i, ga_simd_select(moving, ga_simd_div(z, length), qz));
+		ga_simd_store(arrays._orientation[3] + i, ga_simd_select(moving, ga_simd_div(w, length), qw));
+	}
+#endif
+
+	for (; i < end; ++i)
+	{
+		integrate_orientation(arrays, i, dt);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+
+/*
+** How the world advances body positions each step.
+*/
+enum ga_integrator_t
+{
+	// Velocity first, then position from the new velocity. Cheap and stable.
+	k_integrator_semi_implicit_euler,
+
+	// Fourth order Runge-Kutta, for reference.
+	k_integrator_rk4,
+};
+
+/*
+** Pointers into the world's per-body arrays, one array per component.
+*/
+struct ga_body_arrays_t
+{
+	float* _position[3];
+	float* _velocity[3];
+	float* _orientation[4];
+	const float* _angular_velocity[3];
+
+	// Acceleration from forces other than gravity, for this step.
+	const float* _acceleration[3];
+
+	const uint32_t* _flags;
+};
+
+/*
+** Advance the velocities and positions of bodies [begin, end).
+** Static bodies are left alone; weightless ones get no gravity.
+** Built for as many bodies per instruction as the target allows.
+** @see ga_simd.h
+*/
+void ga_integrate_linear(ga_integrator_t integrator, const ga_body_arrays_t& arrays, uint32_t begin, uint32_t end, const ga_vec3f& gravity, float dt);
+
+/*
+** Advance the orientations of bodies [begin, end) by their angular velocities.
+*/
+void ga_integrate_orientation(const ga_body_arrays_t& arrays, uint32_t begin, uint32_t end, float dt);
@@ -0,0 +1,159 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_intersection.benchmarks.h"
+#include "ga_intersection.h"
+#include "ga_shape.h"
+
+#include "math/ga_math.h"
+#include "math/ga_quatf.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const uint32_t k_benchmark_sat_pairs = 100000;
+static const uint32_t k_benchmark_gjk_pairs = 2000;
+static const uint32_t k_benchmark_gjk_frames = 16;
+static const uint32_t k_benchmark_hull_points = 512;
+
+/*
+** Random pairs of unit-ish boxes, close enough that about half of them touch.
+*/
+struct sat_benchmark_pair_t
+{
+	ga_mat4f _transform_a;
+	ga_mat4f _transform_b;
+};
+
+typedef bool (*sat_func_t)(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
+
+static void run_sat_benchmark(const ga_oobb& box, const std::vector<sat_benchmark_pair_t>& pairs, sat_func_t func, const char* name)
+{
+	uint32_t hits = 0;
+	float total_penetration = 0.0f;
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (const auto& pair : pairs)
+	{
+		ga_collision_info info;
+		if (func(&box, pair._transform_a, &box, pair._transform_b, &info))
+		{
+			++hits;
+			total_penetration += info._penetration;
+		}
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / pairs.size();
+	printf("ga_intersection %s: %u pairs, %u touching, %.3f total penetration, %.1f ns per pair\n",
+		name, uint32_t(pairs.size()), hits, total_penetration, ns);
+}
+
+/*
+** Runs GJK over the pairs for a number of frames, nudging each pair closer
+** every frame, either starting fresh or from each pair's last direction.
+*/
+static void run_gjk_benchmark(const ga_convex_hull& hull, const std::vector<sat_benchmark_pair_t>& pairs, bool cached, const char* name)
+{
+	std::vector<ga_vec3f> directions(pairs.size());
+	for (size_t i = 0; i < pairs.size(); ++i)
+	{
+		directions[i] = pairs[i]._transform_b.get_translation() - pairs[i]._transform_a.get_translation();
+	}
+
+	uint32_t hits = 0;
+	float total_penetration = 0.0f;
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < k_benchmark_gjk_frames; ++frame)
+	{
+		for (size_t i = 0; i < pairs.size(); ++i)
+		{
+			ga_mat4f transform_b = pairs[i]._transform_b;
+			ga_vec3f offset = pairs[i]._transform_a.get_translation() - transform_b.get_translation();
+			transform_b.translate(offset.scale_result(0.02f * frame));
+
+			ga_vec3f direction = directions[i];
+			ga_collision_info info;
+			if (gjk(&hull, pairs[i]._transform_a, &hull, transform_b, &info, direction))
+			{
+				++hits;
+				total_penetration += info._penetration;
+			}
+			if (cached) directions[i] = direction;
+		}
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (pairs.size() * k_benchmark_gjk_frames);
+	printf("ga_intersection %s: %u pairs, %u frames, %u touching, %.3f total penetration, %.1f ns per pair\n",
+		name, uint32_t(pairs.size()), k_benchmark_gjk_frames, hits, total_penetration, ns);
+}
+
+void ga_intersection_benchmarks()
+{
+	std::mt19937 rng(k_benchmark_sat_pairs);
+	std::uniform_real_distribution<float> position(-1.5f, 1.5f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+	ga_oobb box;
+	box._center = ga_vec3f::zero_vector();
+	box._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.5f);
+	box._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+	box._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f);
+
+	std::vector<sat_benchmark_pair_t> pairs(k_benchmark_sat_pairs);
+	for (auto& pair : pairs)
+	{
+		ga_mat4f* transforms[] = { &pair._transform_a, &pair._transform_b };
+		for (ga_mat4f* transform : transforms)
+		{
+			ga_vec3f axis = { unit(rng), unit(rng), unit(rng) };
+			if (axis.mag2() < 0.01f) axis = ga_vec3f::y_vector();
+			axis.normalize();
+
+			ga_quatf rotation;
+			rotation.make_axis_angle(axis, angle(rng));
+			transform->make_rotation(rotation);
+			transform->set_translation({ position(rng), position(rng), position(rng) });
+		}
+	}
+
+	run_sat_benchmark(box, pairs, separating_axis_test_reference, "separating axis reference");
+	run_sat_benchmark(box, pairs, separating_axis_test, "separating axis");
+
+	// A round hull with plenty of points, the case edge walking is for.
+	ga_convex_hull scan_hull;
+	for (uint32_t i = 0; i < k_benchmark_hull_points; ++i)
+	{
+		float y = 1.0f - 2.0f * (i + 0.5f) / k_benchmark_hull_points;
+		float r = ga_sqrtf(1.0f - y * y);
+		float phi = 2.3999632f * i;
+		scan_hull._positions.push_back({ r * cosf(phi), y, r * sinf(phi) });
+	}
+	ga_convex_hull climb_hull = scan_hull;
+	climb_hull.build_neighbors();
+
+	std::uniform_real_distribution<float> hull_position(-2.5f, 2.5f);
+	pairs.resize(k_benchmark_gjk_pairs);
+	for (auto& pair : pairs)
+	{
+		pair._transform_a.make_identity();
+		pair._transform_b.make_identity();
+		pair._transform_b.set_translation({ hull_position(rng), hull_position(rng), hull_position(rng) });
+	}
+
+	run_gjk_benchmark(scan_hull, pairs, false, "gjk all points");
+	run_gjk_benchmark(climb_hull, pairs, false, "gjk hill climbing");
+	run_gjk_benchmark(climb_hull, pairs, true, "gjk hill climbing, cached directions");
+}
@@ -12,6 +12,7 @@
 #include "ga_shape.h"
 
 #include <cassert>
+#include <climits>
 #include <float.h>
 #include <vector>
 
@@ -59,11 +60,16 @@ bool closest_points_on_lines(
 }
 
 ga_vec3f farthest_along_vector(const std::vector<ga_vec3f>& points, const ga_vec3f& vector)
+{
+	return farthest_along_vector(points.data(), uint32_t(points.size()), vector);
+}
+
+ga_vec3f farthest_along_vector(const ga_vec3f* points, uint32_t count, const ga_vec3f& vector)
 {
 	float max_dot = -FLT_MAX;
 	ga_vec3f best;
 
-	for (uint32_t i = 0; i < points.size(); ++i)
+	for (uint32_t i = 0; i < count; ++i)
 	{
 		ga_vec3f point = points[i];
 		if (point.dot(vector) > max_dot)
@@ -107,7 +113,43 @@ bool sphere_vs_plane(const ga_shape* a, const ga_mat4f& transform_a, const ga_sh
 
 	float distance = distance_to_plane(sphere._center, &plane);
 
-	return distance < sphere._radius;
+	bool collision = distance < sphere._radius;
+	if (collision)
+	{
+		info->_normal = plane._normal;
+		info->_penetration = sphere._radius - distance;
+		info->_point = sphere._center - plane._normal.scale_result(distance);
+	}
+
+	return collision;
+}
+
+// Area features are told apart from single point features by this bit.
+static const uint32_t k_area_feature = 0x100;
+
+/*
+** Add a point to the area a contact covers, keeping the deepest four.
+*/
+static void add_area_point(ga_collision_info* info, const ga_vec3f& point, float penetration, uint32_t feature)
+{
+	uint32_t slot = info->_area_point_count;
+	if (slot == 4)
+	{
+		slot = 0;
+		for (uint32_t i = 1; i < 4; ++i)
+		{
+			if (info->_area_penetrations[i] < info->_area_penetrations[slot]) slot = i;
+		}
+		if (info->_area_penetrations[slot] >= penetration) return;
+	}
+	else
+	{
+		++info->_area_point_count;
+	}
+
+	info->_area_points[slot] = point;
+	info->_area_penetrations[slot] = penetration;
+	info->_area_features[slot] = feature;
 }
 
 bool oobb_vs_plane(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
@@ -198,6 +240,16 @@ bool oobb_vs_plane(const ga_shape* a, const ga_mat4f& transform_a, const ga_shap
 		average.scale(1.0f / static_cast<float>(max_corners.size()));
 
 		info->_point = average + info->_normal.scale_result(info->_penetration);
+
+		// Every corner below the plane holds the box up, halfway out to the surface.
+		info->_area_point_count = 0;
+		for (int i = 0; i < k_num_corners; ++i)
+		{
+			if (pens[i] < 0.0f)
+			{
+				add_area_point(info, corners[i] - info->_normal.scale_result(0.5f * pens[i]), -pens[i], k_area_feature | i);
+			}
+		}
 	}
 
 	return collision;
@@ -212,7 +264,17 @@ bool sphere_vs_sphere(const ga_shape* a, const ga_mat4f& transform_a, const ga_s
 	ga_vec3f center_b = sphere_b->_center + transform_b.get_translation();
 
 	float radii2 = powf(sphere_a->_radius + sphere_b->_radius, 2.0f);
-	return center_a.dist2(center_b) < radii2;
+	bool collision = center_a.dist2(center_b) < radii2;
+	if (collision)
+	{
+		ga_vec3f offset = center_b - center_a;
+		float distance = offset.mag();
+		info->_normal = distance > 0.0f ? offset.scale_result(1.0f / distance) : ga_vec3f::y_vector();
+		info->_penetration = sphere_a->_radius + sphere_b->_radius - distance;
+		info->_point = center_a + info->_normal.scale_result(sphere_a->_radius - 0.5f * info->_penetration);
+	}
+
+	return collision;
 }
 
 bool capsule_vs_capsule(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
@@ -237,35 +299,52 @@ bool aabb_vs_aabb(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape
 	return collide;
 }
 
+/*
+** Take the point farthest along a vector out of a list, as erasing it would.
+*/
+static ga_vec3f remove_farthest_along_vector(ga_vec3f* points, uint32_t& count, const ga_vec3f& vector)
+{
+	ga_vec3f best = farthest_along_vector(points, count, vector);
+
+	uint32_t i = 0;
+	while (i < count && !(points[i] == best)) ++i;
+	if (i < count)
+	{
+		for (; i + 1 < count; ++i)
+		{
+			points[i] = points[i + 1];
+		}
+		--count;
+	}
+
+	return best;
+}
+
 ga_vec3f separating_axis_point_of_collision(const ga_oobb* oobb_a, const ga_oobb* oobb_b, uint32_t min_penetration_index)
 {
 	// This is not the ideal way of doing this, but it should arrive at the correct result.
 	ga_vec3f point_of_intersection;
 
-	std::vector<ga_vec3f> corners_a;
-	std::vector<ga_vec3f> corners_b;
+	ga_vec3f corners_a[8];
+	ga_vec3f corners_b[8];
+	uint32_t count_a = 8;
+	uint32_t count_b = 8;
 	oobb_a->get_corners(corners_a);
 	oobb_b->get_corners(corners_b);
 		
 	ga_vec3f a_to_b = oobb_b->_center - oobb_a->_center;
 
 	// Find the two points of a closest to b.
-	ga_vec3f primary_a = farthest_along_vector(corners_a, a_to_b);
-	corners_a.erase(std::find(corners_a.begin(), corners_a.end(), primary_a));
-	ga_vec3f secondary_a = farthest_along_vector(corners_a, a_to_b);
-	corners_a.erase(std::find(corners_a.begin(), corners_a.end(), secondary_a));
-	ga_vec3f tertiary_a = farthest_along_vector(corners_a, a_to_b);
-	corners_a.erase(std::find(corners_a.begin(), corners_a.end(), tertiary_a));
-	ga_vec3f quarternary_a = farthest_along_vector(corners_a, a_to_b);
+	ga_vec3f primary_a = remove_farthest_along_vector(corners_a, count_a, a_to_b);
+	ga_vec3f secondary_a = remove_farthest_along_vector(corners_a, count_a, a_to_b);
+	ga_vec3f tertiary_a = remove_farthest_along_vector(corners_a, count_a, a_to_b);
+	ga_vec3f quarternary_a = farthest_along_vector(corners_a, count_a, a_to_b);
 
 	// Find the two points of b closest to a.
-	ga_vec3f primary_b = farthest_along_vector(corners_b, -a_to_b);
-	corners_b.erase(std::find(corners_b.begin(), corners_b.end(), primary_b));
-	ga_vec3f secondary_b = farthest_along_vector(corners_b, -a_to_b);
-	corners_b.erase(std::find(corners_b.begin(), corners_b.end(), secondary_b));
-	ga_vec3f tertiary_b = farthest_along_vector(corners_b, -a_to_b);
-	corners_b.erase(std::find(corners_b.begin(), corners_b.end(), tertiary_b));
-	ga_vec3f quarternary_b = farthest_along_vector(corners_b, -a_to_b);
+	ga_vec3f primary_b = remove_farthest_along_vector(corners_b, count_b, -a_to_b);
+	ga_vec3f secondary_b = remove_farthest_along_vector(corners_b, count_b, -a_to_b);
+	ga_vec3f tertiary_b = remove_farthest_along_vector(corners_b, count_b, -a_to_b);
+	ga_vec3f quarternary_b = farthest_along_vector(corners_b, count_b, -a_to_b);
 
 	// If the normal is one of the boxes' axes, use the closest point from the other box.
 	if (min_penetration_index < 3)
@@ -349,7 +428,193 @@ ga_vec3f separating_axis_point_of_collision(const ga_oobb* oobb_a, const ga_oobb
 	return point_of_intersection;
 }
 
+// Edge axes whose two edges are closer to parallel than this are skipped;
+// the face axes already cover them. Compared against the squared sine.
+static const float k_sat_parallel_epsilon = 1e-6f;
+
+// How much deeper a later axis may be and still lose to an earlier one.
+static const float k_sat_axis_bias = 2.5e-4f;
+
+// Corners this close above the face count as touching it too, so boxes
+// resting flat keep all four even when rounding lifts some clear.
+static const float k_face_point_tolerance = 0.005f;
+
+/*
+** Where a face of the reference box is what touches, the corners of the
+** other box sunk into it, held within the face's edges and taken halfway
+** out to its surface.
+*/
+static void separating_axis_face_points(const ga_oobb* reference, const ga_oobb* incident, uint32_t axis, uint32_t feature, ga_collision_info* info)
+{
+	ga_vec3f normal = reference->_half_vectors[axis].normal();
+	if (normal.dot(incident->_center - reference->_center) < 0.0f)
+	{
+		normal = -normal;
+	}
+	float face = reference->_half_vectors[axis].mag();
+
+	ga_vec3f corners[8];
+	incident->get_corners(corners);
+	for (uint32_t c = 0; c < 8; ++c)
+	{
+		ga_vec3f local = corners[c] - reference->_center;
+		float depth = face - local.dot(normal);
+		if (depth < -k_face_point_tolerance) continue;
+
+		ga_vec3f point = corners[c] + normal.scale_result(0.5f * depth);
+		for (uint32_t e = 1; e < 3; ++e)
+		{
+			const ga_vec3f& edge = reference->_half_vectors[(axis + e) % 3];
+			float along = local.dot(edge) / edge.mag2();
+			float held = ga_max(-1.0f, ga_min(along, 1.0f));
+			point += edge.scale_result(held - along);
+		}
+		add_area_point(info, point, depth, feature | c);
+	}
+}
+
 bool separating_axis_test(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
+{
+	ga_oobb oobb_a, oobb_b;
+
+	oobb_a = *reinterpret_cast<const ga_oobb*>(a);
+	oobb_a._center += transform_a.get_translation();
+	oobb_a._half_vectors[0] = transform_a.transform_vector(oobb_a._half_vectors[0]);
+	oobb_a._half_vectors[1] = transform_a.transform_vector(oobb_a._half_vectors[1]);
+	oobb_a._half_vectors[2] = transform_a.transform_vector(oobb_a._half_vectors[2]);
+
+	oobb_b = *reinterpret_cast<const ga_oobb*>(b);
+	oobb_b._center += transform_b.get_translation();
+	oobb_b._half_vectors[0] = transform_b.transform_vector(oobb_b._half_vectors[0]);
+	oobb_b._half_vectors[1] = transform_b.transform_vector(oobb_b._half_vectors[1]);
+	oobb_b._half_vectors[2] = transform_b.transform_vector(oobb_b._half_vectors[2]);
+
+	// Split each half vector into a unit axis and the box's extent along it.
+	ga_vec3f axes_a[3];
+	ga_vec3f axes_b[3];
+	float extent_a[3];
+	float extent_b[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		extent_a[i] = oobb_a._half_vectors[i].mag();
+		extent_b[i] = oobb_b._half_vectors[i].mag();
+		axes_a[i] = oobb_a._half_vectors[i].normal();
+		axes_b[i] = oobb_b._half_vectors[i].normal();
+	}
+
+	// Work in a's frame: r[i][j] is the cosine between a's axis i and b's
+	// axis j, and t is the offset from a to b along each box's axes. Every
+	// projection onto the fifteen axes is then a few products of these.
+	ga_vec3f offset = oobb_b._center - oobb_a._center;
+	float r[3][3];
+	float abs_r[3][3];
+	float t_a[3];
+	float t_b[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		t_a[i] = offset.dot(axes_a[i]);
+		t_b[i] = offset.dot(axes_b[i]);
+		for (int j = 0; j < 3; ++j)
+		{
+			r[i][j] = axes_a[i].dot(axes_b[j]);
+			abs_r[i][j] = ga_absf(r[i][j]);
+		}
+	}
+
+	// Penetration along each axis, in the reference test's order: a's axes,
+	// b's axes, then a's axis i crossed with b's axis j at 6 + 3i + j.
+	float penetration[15];
+
+	for (int i = 0; i < 3; ++i)
+	{
+		float project_b = extent_b[0] * abs_r[i][0] + extent_b[1] * abs_r[i][1] + extent_b[2] * abs_r[i][2];
+		penetration[i] = extent_a[i] + project_b - ga_absf(t_a[i]);
+	}
+	if (penetration[0] < 0.0f || penetration[1] < 0.0f || penetration[2] < 0.0f) return false;
+
+	for (int j = 0; j < 3; ++j)
+	{
+		float project_a = extent_a[0] * abs_r[0][j] + extent_a[1] * abs_r[1][j] + extent_a[2] * abs_r[2][j];
+		penetration[3 + j] = project_a + extent_b[j] - ga_absf(t_b[j]);
+	}
+	if (penetration[3] < 0.0f || penetration[4] < 0.0f || penetration[5] < 0.0f) return false;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		int i1 = (i + 1) % 3;
+		int i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; ++j)
+		{
+			int j1 = (j + 1) % 3;
+			int j2 = (j + 2) % 3;
+
+			// The axis has length sin(angle); project onto it, then divide
+			// that length out so penetration is in world units.
+			float length2 = r[i1][j] * r[i1][j] + r[i2][j] * r[i2][j];
+			float project_a = extent_a[i1] * abs_r[i2][j] + extent_a[i2] * abs_r[i1][j];
+			float project_b = extent_b[j1] * abs_r[i][j2] + extent_b[j2] * abs_r[i][j1];
+			float distance = ga_absf(t_a[i2] * r[i1][j] - t_a[i1] * r[i2][j]);
+			penetration[6 + 3 * i + j] = length2 < k_sat_parallel_epsilon ? FLT_MAX : (project_a + project_b - distance) / ga_sqrtf(length2);
+		}
+	}
+
+	// Face axes give steadier contacts than edge axes, and a's faces than
+	// b's, so later axes only win by a clear margin. Otherwise two boxes
+	// resting flat flip between near equal axes from one step to the next.
+	float min_penetration = FLT_MAX;
+	float min_biased = FLT_MAX;
+	uint32_t min_penetration_index = INT_MAX;
+	for (uint32_t i = 0; i < 15; ++i)
+	{
+		if (penetration[i] < 0.0f) return false;
+		float biased = penetration[i] + (i < 3 ? 0.0f : (i < 6 ? k_sat_axis_bias : 2.0f * k_sat_axis_bias));
+		if (biased < min_biased)
+		{
+			min_biased = biased;
+			min_penetration = penetration[i];
+			min_penetration_index = i;
+		}
+	}
+
+	if (min_penetration_index < INT_MAX)
+	{
+		// The normal of the collision is the axis of minimum penetration.
+		ga_vec3f normal;
+		if (min_penetration_index < 3)
+		{
+			normal = axes_a[min_penetration_index];
+		}
+		else if (min_penetration_index < 6)
+		{
+			normal = axes_b[min_penetration_index - 3];
+		}
+		else
+		{
+			uint32_t cross_index = min_penetration_index - 6;
+			normal = ga_vec3f_cross(oobb_a._half_vectors[cross_index / 3], oobb_b._half_vectors[cross_index % 3]);
+			normal.normalize();
+		}
+
+		info->_normal = normal;
+		info->_penetration = min_penetration;
+		info->_point = separating_axis_point_of_collision(&oobb_a, &oobb_b, min_penetration_index);
+		info->_feature = uint32_t(min_penetration_index);
+
+		info->_area_point_count = 0;
+		if (min_penetration_index < 3)
+		{
+			separating_axis_face_points(&oobb_a, &oobb_b, min_penetration_index, k_area_feature | (min_penetration_index << 3), info);
+		}
+		else if (min_penetration_index < 6)
+		{
+			separating_axis_face_points(&oobb_b, &oobb_a, min_penetration_index - 3, k_area_feature | (min_penetration_index << 3), info);
+		}
+	}
+
+	return true;
+}
+
+bool separating_axis_test_reference(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
 {
 	//From Viper
 	bool collision = true;
@@ -437,6 +702,7 @@ bool separating_axis_test(const ga_shape* a, const ga_mat4f& transform_a, const
 		info->_normal = min_penetration_axis;
 		info->_penetration = min_penetration;
 		info->_point = separating_axis_point_of_collision(&oobb_a, &oobb_b, min_penetration_index);
+		info->_feature = uint32_t(min_penetration_index);
 	}
 
 	return collision;
@@ -589,100 +855,493 @@ bool separating_axis_test(const ga_shape* a, const ga_mat4f& transform_a, const
 	return true;*/
 }
 
-ga_vec3f gjk_support(const ga_convex_hull* hull, const ga_vec3f& dir)
+/*
+** One hull in a GJK query. Support points are found in the hull's own space,
+** starting the climb from wherever the last one ended.
+*/
+struct gjk_hull_t
 {
-	float max_dot = -FLT_MAX;
-	ga_vec3f best;
+	const ga_convex_hull* _hull;
+	const ga_mat4f* _transform;
+	uint32_t _hint;
+};
+
+/*
+** A point of the Minkowski difference a - b, with the point on a it came from.
+*/
+struct gjk_vertex_t
+{
+	ga_vec3f _w;
+	ga_vec3f _a;
+};
 
-	for (uint32_t i = 0; i < hull->_positions.size(); ++i)
+static ga_vec3f gjk_support(gjk_hull_t& shape, const ga_vec3f& dir)
+{
+	// Points go to the world as p * M, so p . dir is p . (dir * M^T): dot the
+	// direction with each row of the transform to bring it into hull space.
+	const ga_mat4f& m = *shape._transform;
+	ga_vec3f local_dir =
+	{
+		dir.x * m.data[0][0] + dir.y * m.data[0][1] + dir.z * m.data[0][2],
+		dir.x * m.data[1][0] + dir.y * m.data[1][1] + dir.z * m.data[1][2],
+		dir.x * m.data[2][0] + dir.y * m.data[2][1] + dir.z * m.data[2][2],
+	};
+
+	uint32_t index = shape._hull->get_support(local_dir, shape._hint);
+	shape._hint = index;
+	return m.transform_point(shape._hull->_positions[index]);
+}
+
+static gjk_vertex_t gjk_minkowski_support(gjk_hull_t& a, gjk_hull_t& b, const ga_vec3f& dir)
+{
+	gjk_vertex_t vertex;
+	vertex._a = gjk_support(a, dir);
+	vertex._w = vertex._a - gjk_support(b, -dir);
+	return vertex;
+}
+
+static ga_vec3f gjk_triple_cross(const ga_vec3f& a, const ga_vec3f& b, const ga_vec3f& c)
+{
+	return ga_vec3f_cross(ga_vec3f_cross(a, b), c);
+}
+
+/*
+** Reduce the simplex to the part nearest the origin and pick the next
+** direction to search. The newest point is last.
+** @returns True if the simplex holds the origin.
+*/
+static bool gjk_do_simplex(gjk_vertex_t* simplex, uint32_t& count, ga_vec3f& dir)
+{
+	ga_vec3f a = simplex[count - 1]._w;
+	ga_vec3f ao = -a;
+
+	if (count == 2)
 	{
-		ga_vec3f point = hull->_positions[i];
-		if (point.dot(dir) > max_dot)
+		ga_vec3f ab = simplex[0]._w - a;
+		if (ab.dot(ao) > 0.0f)
 		{
-			max_dot = point.dot(dir);
-			best = point;
+			dir = gjk_triple_cross(ab, ao, ab);
+		}
+		else
+		{
+			simplex[0] = simplex[1];
+			count = 1;
+			dir = ao;
 		}
+		return false;
 	}
 
-	return best;
+	if (count == 3)
+	{
+		ga_vec3f b = simplex[1]._w;
+		ga_vec3f c = simplex[0]._w;
+		ga_vec3f ab = b - a;
+		ga_vec3f ac = c - a;
+		ga_vec3f abc = ga_vec3f_cross(ab, ac);
+
+		if (ga_vec3f_cross(abc, ac).dot(ao) > 0.0f)
+		{
+			if (ac.dot(ao) > 0.0f)
+			{
+				// Edge ac.
+				simplex[1] = simplex[2];
+				count = 2;
+				dir = gjk_triple_cross(ac, ao, ac);
+				return false;
+			}
+		}
+		else if (ga_vec3f_cross(ab, abc).dot(ao) <= 0.0f)
+		{
+			// Inside the triangle's prism: above or below it.
+			if (abc.dot(ao) > 0.0f)
+			{
+				dir = abc;
+			}
+			else
+			{
+				gjk_vertex_t tmp = simplex[0];
+				simplex[0] = simplex[1];
+				simplex[1] = tmp;
+				dir = -abc;
+			}
+			return false;
+		}
+
+		// Edge ab, or just a.
+		simplex[0] = simplex[1];
+		simplex[1] = simplex[2];
+		count = 2;
+		if (ab.dot(ao) > 0.0f)
+		{
+			dir = gjk_triple_cross(ab, ao, ab);
+		}
+		else
+		{
+			simplex[0] = simplex[1];
+			count = 1;
+			dir = ao;
+		}
+		return false;
+	}
+
+	// Tetrahedron: the origin is inside unless it is past one of the three
+	// faces that include the newest point.
+	ga_vec3f b = simplex[2]._w;
+	ga_vec3f c = simplex[1]._w;
+	ga_vec3f d = simplex[0]._w;
+	ga_vec3f ab = b - a;
+	ga_vec3f ac = c - a;
+	ga_vec3f ad = d - a;
+
+	if (ga_vec3f_cross(ab, ac).dot(ao) > 0.0f)
+	{
+		simplex[0] = simplex[1];
+		simplex[1] = simplex[2];
+		simplex[2] = simplex[3];
+		count = 3;
+		return gjk_do_simplex(simplex, count, dir);
+	}
+	if (ga_vec3f_cross(ac, ad).dot(ao) > 0.0f)
+	{
+		simplex[2] = simplex[3];
+		count = 3;
+		return gjk_do_simplex(simplex, count, dir);
+	}
+	if (ga_vec3f_cross(ad, ab).dot(ao) > 0.0f)
+	{
+		gjk_vertex_t vertex_b = simplex[2];
+		gjk_vertex_t vertex_d = simplex[0];
+		simplex[0] = vertex_b;
+		simplex[1] = vertex_d;
+		simplex[2] = simplex[3];
+		count = 3;
+		return gjk_do_simplex(simplex, count, dir);
+	}
+	return true;
 }
 
-bool gjk_internal(
-	const ga_convex_hull* a,
-	const ga_convex_hull* b,
-	std::vector<ga_vec3f>& simplex)
+// GJK and EPA give up after this many steps, keeping what they have.
+static const uint32_t k_gjk_max_iterations = 64;
+static const uint32_t k_epa_max_iterations = 128;
+
+// Fixed sizes for the EPA polytope, so a query never allocates. A closed
+// triangle mesh on V points has at most 2V - 4 faces and 3V - 6 edges.
+static const uint32_t k_epa_max_vertices = k_epa_max_iterations + 4;
+static const uint32_t k_epa_max_faces = 2 * k_epa_max_vertices;
+static const uint32_t k_epa_max_edges = 3 * k_epa_max_vertices;
+
+// EPA stops once a new support point is this close to the nearest face.
+static const float k_epa_tolerance = 1e-4f;
+
+// How far in front of a face a new point must be to replace it.
+static const float k_epa_visible_epsilon = 1e-5f;
+
+struct epa_face_t
 {
-	while (true)
+	uint32_t _v[3];
+	ga_vec3f _normal;
+	float _distance;
+};
+
+static bool epa_make_face(const gjk_vertex_t* vertices, uint32_t a, uint32_t b, uint32_t c, epa_face_t& face)
+{
+	ga_vec3f normal = ga_vec3f_cross(vertices[b]._w - vertices[a]._w, vertices[c]._w - vertices[a]._w);
+	float length = normal.mag();
+	if (length < 1e-12f) return false;
+
+	face._v[0] = a;
+	face._v[1] = b;
+	face._v[2] = c;
+	face._normal = normal.scale_result(1.0f / length);
+	face._distance = face._normal.dot(vertices[a]._w);
+	return true;
+}
+
+/*
+** Grow GJK's last simplex into a full tetrahedron around the origin, for
+** shapes that only touch or whose difference GJK met edge on.
+*/
+static bool epa_complete_simplex(gjk_hull_t& a, gjk_hull_t& b, gjk_vertex_t* simplex, uint32_t& count)
+{
+	static const ga_vec3f k_directions[] =
 	{
-		float distance_to_simplex = FLT_MAX;
-		ga_vec3f new_point;
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+	};
 
-		if (simplex.size() == 0)
+	if (count == 1)
+	{
+		for (const ga_vec3f& dir : k_directions)
 		{
-			// Start by picking an arbitrary direction.
-			ga_vec3f dir = ga_vec3f::x_vector();
-			new_point = gjk_support(a, dir) - gjk_support(b, -dir);
-			simplex.push_back(new_point);
+			gjk_vertex_t vertex = gjk_minkowski_support(a, b, dir);
+			if ((vertex._w - simplex[0]._w).mag2() > 1e-8f)
+			{
+				simplex[count++] = vertex;
+				break;
+			}
 		}
-		else if (simplex.size() == 1)
+	}
+	if (count == 2)
+	{
+		ga_vec3f line = simplex[1]._w - simplex[0]._w;
+		for (const ga_vec3f& axis : k_directions)
+		{
+			ga_vec3f dir = ga_vec3f_cross(line, axis);
+			if (dir.mag2() < 1e-8f) continue;
+			gjk_vertex_t vertex = gjk_minkowski_support(a, b, dir);
+			if (ga_vec3f_cross(line, vertex._w - simplex[0]._w).mag2() > 1e-8f)
+			{
+				simplex[count++] = vertex;
+				break;
+			}
+		}
+	}
+	if (count == 3)
+	{
+		// Look first on the side of the triangle the origin is on.
+		ga_vec3f normal = ga_vec3f_cross(simplex[1]._w - simplex[0]._w, simplex[2]._w - simplex[0]._w);
+		if (normal.dot(simplex[0]._w) > 0.0f) normal = -normal;
+		gjk_vertex_t vertex = gjk_minkowski_support(a, b, normal);
+		if (ga_absf(normal.dot(vertex._w - simplex[0]._w)) < 1e-8f)
 		{
-			// Pick the direction from the point to the origin.
-			ga_vec3f dir = -simplex[0];
-			new_point = gjk_support(a, dir) - gjk_support(b, -dir);
-			distance_to_simplex = (simplex[0] - new_point).mag();
+			vertex = gjk_minkowski_support(a, b, -normal);
 		}
-		else if (simplex.size() == 2)
+		if (ga_absf(normal.dot(vertex._w - simplex[0]._w)) < 1e-8f)
 		{
-			float dist_to_line = distance_to_line_segment({0.0f, 0.0f, 0.0f}, simplex[0], simplex[1]);
-			float dist_a = simplex[0].mag();
-			float dist_b = simplex[1].mag();
+			return false;
+		}
+		simplex[count++] = vertex;
+	}
+	return count == 4;
+}
+
+/*
+** Expand the polytope toward the face nearest the origin until it stops
+** growing; that face gives the penetration normal and depth.
+*/
+static void epa(gjk_hull_t& a, gjk_hull_t& b, const gjk_vertex_t* simplex, ga_collision_info* info)
+{
+	gjk_vertex_t vertices[k_epa_max_vertices];
+	epa_face_t faces[k_epa_max_faces];
+	uint32_t edges[k_epa_max_edges][2];
+	uint32_t vertex_count = 4;
+	uint32_t face_count = 0;
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		vertices[i] = simplex[i];
+	}
 
-			if (dist_to_line < dist_a && dist_to_line < dist_b)
+	// Wind the tetrahedron's faces outward.
+	ga_vec3f centroid = (vertices[0]._w + vertices[1]._w + vertices[2]._w + vertices[3]._w).scale_result(0.25f);
+	static const uint32_t k_tetrahedron[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		uint32_t v0 = k_tetrahedron[i][0];
+		uint32_t v1 = k_tetrahedron[i][1];
+		uint32_t v2 = k_tetrahedron[i][2];
+		epa_face_t face;
+		if (!epa_make_face(vertices, v0, v1, v2, face)) continue;
+		if (face._normal.dot(vertices[v0]._w - centroid) < 0.0f)
+		{
+			epa_make_face(vertices, v0, v2, v1, face);
+		}
+		faces[face_count++] = face;
+	}
+
+	uint32_t closest = 0;
+	float depth = 0.0f;
+	bool converged = false;
+	for (uint32_t iteration = 0; face_count > 0; ++iteration)
+	{
+		closest = 0;
+		for (uint32_t i = 1; i < face_count; ++i)
+		{
+			if (faces[i]._distance < faces[closest]._distance) closest = i;
+		}
+
+		// Whether or not the polytope can grow further, the difference is
+		// known to reach this far along the nearest face's normal.
+		gjk_vertex_t vertex = gjk_minkowski_support(a, b, faces[closest]._normal);
+		depth = vertex._w.dot(faces[closest]._normal);
+		converged = depth - faces[closest]._distance < k_epa_tolerance;
+		if (converged || iteration == k_epa_max_iterations || vertex_count == k_epa_max_vertices) break;
+
+		// Remove every face the new point can see, keeping the edges on the
+		// rim between seen and unseen faces. Faces it only just sees are kept,
+		// so points on a flat side of the difference don't tear it apart.
+		uint32_t edge_count = 0;
+		for (uint32_t i = 0; i < face_count;)
+		{
+			if (faces[i]._normal.dot(vertex._w - vertices[faces[i]._v[0]]._w) <= k_epa_visible_epsilon)
 			{
-				// TODO: Direction is perpendicular to line in direction of origin.
+				++i;
+				continue;
 			}
-			else
+
+			for (uint32_t e = 0; e < 3; ++e)
 			{
-				// TODO: The farther point is deleted, then continue.
+				uint32_t from = faces[i]._v[e];
+				uint32_t to = faces[i]._v[(e + 1) % 3];
+
+				// An edge shared with another removed face shows up reversed.
+				uint32_t shared = 0;
+				while (shared < edge_count && !(edges[shared][0] == to && edges[shared][1] == from)) ++shared;
+				if (shared < edge_count)
+				{
+					edges[shared][0] = edges[edge_count - 1][0];
+					edges[shared][1] = edges[edge_count - 1][1];
+					--edge_count;
+				}
+				else if (edge_count < k_epa_max_edges)
+				{
+					edges[edge_count][0] = from;
+					edges[edge_count][1] = to;
+					++edge_count;
+				}
 			}
+
+			faces[i] = faces[--face_count];
 		}
-		else if (simplex.size() == 3)
+
+		uint32_t new_vertex = vertex_count++;
+		vertices[new_vertex] = vertex;
+		for (uint32_t e = 0; e < edge_count && face_count < k_epa_max_faces; ++e)
 		{
-			// TODO: Triangle case.
+			epa_face_t face;
+			if (epa_make_face(vertices, edges[e][0], edges[e][1], new_vertex, face))
+			{
+				faces[face_count++] = face;
+			}
 		}
-		else
+	}
+
+	if (face_count == 0)
+	{
+		info->_normal = ga_vec3f::x_vector();
+		info->_penetration = 0.0f;
+		info->_point = simplex[0]._a;
+		return;
+	}
+
+	const epa_face_t& face = faces[closest];
+
+	// Where the origin projects onto the face, as weights of its corners,
+	// gives matching points on both shapes.
+	ga_vec3f w0 = vertices[face._v[0]]._w;
+	ga_vec3f w1 = vertices[face._v[1]]._w;
+	ga_vec3f w2 = vertices[face._v[2]]._w;
+	ga_vec3f p = face._normal.scale_result(face._distance);
+	ga_vec3f e0 = w1 - w0;
+	ga_vec3f e1 = w2 - w0;
+	ga_vec3f ep = p - w0;
+	float d00 = e0.dot(e0);
+	float d01 = e0.dot(e1);
+	float d11 = e1.dot(e1);
+	float d20 = ep.dot(e0);
+	float d21 = ep.dot(e1);
+	float denominator = d00 * d11 - d01 * d01;
+	float v = denominator != 0.0f ? (d11 * d20 - d01 * d21) / denominator : 0.0f;
+	float w = denominator != 0.0f ? (d00 * d21 - d01 * d20) / denominator : 0.0f;
+	float u = 1.0f - v - w;
+
+	ga_vec3f point_a =
+		vertices[face._v[0]]._a.scale_result(u) +
+		vertices[face._v[1]]._a.scale_result(v) +
+		vertices[face._v[2]]._a.scale_result(w);
+	ga_vec3f point_b = point_a - p;
+
+	info->_normal = face._normal;
+	info->_penetration = converged ? face._distance : depth;
+	info->_point = (point_a + point_b).scale_result(0.5f);
+}
+
+bool gjk(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info, ga_vec3f& direction)
+{
+	gjk_hull_t hull_a = { reinterpret_cast<const ga_convex_hull*>(a), &transform_a, 0 };
+	gjk_hull_t hull_b = { reinterpret_cast<const ga_convex_hull*>(b), &transform_b, 0 };
+	if (hull_a._hull->_positions.empty() || hull_b._hull->_positions.empty()) return false;
+
+	ga_vec3f dir = direction.mag2() > 0.0f ? direction : ga_vec3f::x_vector();
+
+	gjk_vertex_t simplex[4];
+	uint32_t count = 1;
+	simplex[0] = gjk_minkowski_support(hull_a, hull_b, dir);
+
+	// A direction kept from last time often still separates the pair.
+	if (simplex[0]._w.dot(dir) < 0.0f)
+	{
+		direction = dir;
+		return false;
+	}
+	dir = -simplex[0]._w;
+
+	bool collision = false;
+	for (uint32_t iteration = 0; iteration < k_gjk_max_iterations; ++iteration)
+	{
+		// The origin lies on the simplex: the shapes touch.
+		if (dir.mag2() < 1e-12f)
 		{
-			// TODO: Tetrahedron case.
+			collision = true;
+			break;
 		}
 
-		if (new_point.mag() > distance_to_simplex)
+		gjk_vertex_t vertex = gjk_minkowski_support(hull_a, hull_b, dir);
+		if (vertex._w.dot(dir) < 0.0f)
 		{
+			direction = dir;
 			return false;
 		}
-		simplex.push_back(new_point);
+
+		simplex[count++] = vertex;
+		if (gjk_do_simplex(simplex, count, dir))
+		{
+			collision = true;
+			break;
+		}
 	}
 
-	return false;
-}
+	if (!collision)
+	{
+		// Out of iterations without a verdict; treat as apart.
+		direction = dir;
+		return false;
+	}
 
-bool gjk(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
-{
-	ga_convex_hull hull_a = *reinterpret_cast<const ga_convex_hull*>(a);
-	ga_convex_hull hull_b = *reinterpret_cast<const ga_convex_hull*>(b);
+	// A tetrahedron GJK flattened against a face of the difference can pass
+	// its containment tests without holding the origin. Build a real one.
+	if (count == 4)
+	{
+		ga_vec3f ab = simplex[2]._w - simplex[3]._w;
+		ga_vec3f ac = simplex[1]._w - simplex[3]._w;
+		ga_vec3f ad = simplex[0]._w - simplex[3]._w;
+		float volume = ga_absf(ga_vec3f_cross(ab, ac).dot(ad));
+		float scale = ga_max(ab.mag2(), ga_max(ac.mag2(), ad.mag2()));
+		if (volume <= 1e-6f * scale * ga_sqrtf(scale))
+		{
+			count = 3;
+		}
+	}
 
-	// Transform all of the positions into world space.
-	for (uint32_t i = 0; i < hull_a._positions.size(); ++i)
+	if (count == 4 || epa_complete_simplex(hull_a, hull_b, simplex, count))
 	{
-		ga_vec3f point = hull_a._positions[i];
-		hull_a._positions[i] = transform_a.transform_vector(point);
+		epa(hull_a, hull_b, simplex, info);
 	}
-	for (uint32_t i = 0; i < hull_b._positions.size(); ++i)
+	else
 	{
-		ga_vec3f point = hull_b._positions[i];
-		hull_b._positions[i] = transform_b.transform_vector(point);
+		// Flat difference: the shapes only just touch.
+		info->_normal = dir.mag2() > 0.0f ? dir.normal() : ga_vec3f::x_vector();
+		info->_penetration = 0.0f;
+		info->_point = simplex[0]._a;
 	}
 
-	// Create a new simplex structure, empty initially.
-	std::vector<ga_vec3f> simplex;
-	return gjk_internal(&hull_a, &hull_b, simplex);
+	direction = info->_normal;
+	return true;
+}
+
+bool gjk(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
+{
+	ga_vec3f direction = transform_b.get_translation() - transform_a.get_translation();
+	return gjk(a, transform_a, b, transform_b, info, direction);
 }
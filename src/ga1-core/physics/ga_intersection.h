@@ -28,6 +28,18 @@ struct ga_collision_info
 	ga_vec3f _point;
 	ga_vec3f _normal;
 	float _penetration;
+
+	// Which features of the two shapes touch, where the test can tell;
+	// the same number each step while they touch the same way.
+	uint32_t _feature = 0;
+
+	// Where the shapes touch over an area, such as a box lying on a face,
+	// up to four points across it, each with its own depth and feature.
+	// The single point above is still filled in.
+	uint32_t _area_point_count = 0;
+	ga_vec3f _area_points[4];
+	float _area_penetrations[4];
+	uint32_t _area_features[4];
 };
 
 /*
@@ -56,6 +68,7 @@ bool closest_points_on_lines(
 ** Compute the point farthest along a directional vector.
 */
 ga_vec3f farthest_along_vector(const std::vector<ga_vec3f>& points, const ga_vec3f& vector);
+ga_vec3f farthest_along_vector(const ga_vec3f* points, uint32_t count, const ga_vec3f& vector);
 
 /*
 ** Stub function for unimplemented collision algorithms.
@@ -89,10 +102,25 @@ bool aabb_vs_aabb(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape
 
 /*
 ** Check for a collision between two oriented bounding boxes.
+** Boxes are expected to have perpendicular half vectors.
 */
 bool separating_axis_test(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
 
 /*
-** Check for a collision between two arbitrary convex hulls.
+** The original box test, projecting each box onto every axis in turn.
+** Kept to check separating_axis_test against, and to time it.
+*/
+bool separating_axis_test_reference(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
+
+/*
+** Check for a collision between two arbitrary convex hulls with GJK, then
+** find how deep they overlap with EPA. The normal points from a toward b.
 */
 bool gjk(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
+
+/*
+** As above, starting the search along direction. On return direction holds
+** where to start next time for the same pair: the separating direction if
+** apart, the normal if not.
+*/
+bool gjk(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info, ga_vec3f& direction);
@@ -9,10 +9,16 @@
 
 #include "ga_intersection.tests.h"
 #include "ga_intersection.h"
+#include "ga_scene_query.h"
 
 #include "ga_shape.h"
 
+#include "math/ga_math.h"
+
 #include <cassert>
+#include <float.h>
+#include <limits>
+#include <random>
 
 void ga_intersection_utility_unit_tests()
 {
@@ -42,6 +48,58 @@ void ga_intersection_utility_unit_tests()
 
 		assert(ga_equalf(dist, 1.0f));
 	}
+
+	// Test rays against shapes and packets of rays against a box.
+	{
+		ga_sphere sphere;
+		sphere._center = ga_vec3f::zero_vector();
+		sphere._radius = 1.0f;
+
+		ga_oobb box;
+		box._center = ga_vec3f::zero_vector();
+		box._half_vectors[0] = { 0.5f, 0.5f, 0.0f };
+		box._half_vectors[1] = { -0.5f, 0.5f, 0.0f };
+		box._half_vectors[2] = { 0.0f, 0.0f, 1.0f };
+
+		ga_mat4f transform;
+		transform.make_translation({ 5.0f, 0.0f, 0.0f });
+
+		ga_vec3f origin = ga_vec3f::zero_vector();
+		ga_vec3f direction = ga_vec3f::x_vector();
+		float distance;
+		ga_vec3f normal;
+
+		bool hit = ray_vs_shape(&sphere, transform, origin, direction, 10.0f, distance, normal);
+		assert(hit);
+		assert(ga_equalf(distance, 4.0f));
+		assert(normal.equal({ -1.0f, 0.0f, 0.0f }));
+
+		hit = ray_vs_shape(&sphere, transform, origin, direction, 3.0f, distance, normal);
+		assert(!hit);
+
+		// The turned box reaches its corner towards the ray.
+		hit = ray_vs_shape(&box, transform, origin, direction, 10.0f, distance, normal);
+		assert(hit);
+		assert(ga_absf(distance - 4.0f) < 0.0001f);
+		assert(ga_absf(distance_to_shape(&box, transform, origin) - distance) < 0.0001f);
+
+		ga_ray_packet_t packet;
+		for (uint32_t lane = 0; lane < k_ray_packet_width; ++lane)
+		{
+			packet._origin[0][lane] = 0.0f;
+			packet._origin[1][lane] = 0.5f * float(lane * lane);
+			packet._origin[2][lane] = 0.0f;
+			packet._inverse_direction[0][lane] = 1.0f;
+			packet._inverse_direction[1][lane] = std::numeric_limits<float>::infinity();
+			packet._inverse_direction[2][lane] = std::numeric_limits<float>::infinity();
+			packet._length[lane] = 10.0f;
+		}
+		packet._length[0] = 4.0f;
+
+		// Lane 0 stops short; lanes past 1 pass above.
+		uint32_t lanes = ray_packet_vs_box(packet, { 5.0f, -1.0f, -1.0f }, { 6.0f, 1.0f, 1.0f });
+		assert(lanes == (k_ray_packet_width > 1 ? 2u : 0u));
+	}
 }
 
 void ga_intersection_unit_tests()
@@ -127,5 +185,180 @@ void ga_intersection_unit_tests()
 		assert(!collision);
 	}
 
-	// TODO: Test GJK for convex hull collisions.
+	// A box resting flat on a bigger one touches at its four lower corners,
+	// each taken halfway out of the bigger box.
+	{
+		ga_oobb bottom, top;
+		bottom._center = { 0.0f, 0.0f, 0.0f };
+		bottom._half_vectors[0] = { 1.0f, 0.0f, 0.0f };
+		bottom._half_vectors[1] = { 0.0f, 1.0f, 0.0f };
+		bottom._half_vectors[2] = { 0.0f, 0.0f, 1.0f };
+		top._center = { 0.0f, 0.0f, 0.0f };
+		top._half_vectors[0] = { 0.5f, 0.0f, 0.0f };
+		top._half_vectors[1] = { 0.0f, 0.5f, 0.0f };
+		top._half_vectors[2] = { 0.0f, 0.0f, 0.5f };
+
+		ga_mat4f trans_bottom, trans_top;
+		trans_bottom.make_identity();
+		trans_top.make_translation({ 0.0f, 1.45f, 0.0f });
+
+		ga_collision_info info;
+		bool collision = separating_axis_test(&bottom, trans_bottom, &top, trans_top, &info);
+		assert(collision);
+		assert(info._area_point_count == 4);
+		for (uint32_t i = 0; i < info._area_point_count; ++i)
+		{
+			assert(ga_equalf(info._area_penetrations[i], 0.05f));
+			assert(ga_equalf(info._area_points[i].y, 0.975f));
+			assert(ga_equalf(ga_absf(info._area_points[i].x), 0.5f));
+			assert(ga_equalf(ga_absf(info._area_points[i].z), 0.5f));
+		}
+	}
+
+	// Test GJK for convex hull collisions.
+	{
+		ga_convex_hull hull_a, hull_b;
+		for (int i = 0; i < 8; ++i)
+		{
+			ga_vec3f corner = { (i & 1) ? 0.6f : -0.6f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 0.3f : -0.3f };
+			hull_a._positions.push_back(corner);
+			hull_b._positions.push_back(corner.scale_result(2.0f));
+		}
+		hull_a.build_neighbors();
+		hull_b.build_neighbors();
+
+		ga_mat4f trans_a, trans_b;
+		trans_a.make_identity();
+		trans_b.make_translation({ 1.5f, 0.0f, 0.0f });
+
+		ga_collision_info info;
+		bool collision = gjk(&hull_a, trans_a, &hull_b, trans_b, &info);
+		assert(collision);
+		assert(ga_equalf(info._penetration, 0.3f));
+		assert(info._normal.equal({ 1.0f, 0.0f, 0.0f }));
+
+		// The direction handed back separates the pair once they part, and
+		// starting from it finds them apart straight away.
+		ga_vec3f direction = { 1.0f, 0.0f, 0.0f };
+		trans_b.make_translation({ 0.0f, 0.0f, 0.8f });
+		collision = gjk(&hull_a, trans_a, &hull_b, trans_b, &info, direction);
+		assert(collision);
+
+		trans_b.make_translation({ 0.0f, 0.0f, 5.0f });
+		collision = gjk(&hull_a, trans_a, &hull_b, trans_b, &info, direction);
+		assert(!collision);
+		collision = gjk(&hull_a, trans_a, &hull_b, trans_b, &info, direction);
+		assert(!collision);
+	}
+
+	// The box test against its reference on random pairs.
+	ga_intersection_sat_fuzz_tests();
+}
+
+/*
+** Random box for the fuzz test, with its rotation in the transform.
+*/
+static void make_fuzz_box(std::mt19937& rng, ga_oobb& box, ga_mat4f& transform)
+{
+	std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+	std::uniform_real_distribution<float> position(-2.5f, 2.5f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+	box._center = ga_vec3f::zero_vector();
+	box._half_vectors[0] = ga_vec3f::x_vector().scale_result(extent(rng));
+	box._half_vectors[1] = ga_vec3f::y_vector().scale_result(extent(rng));
+	box._half_vectors[2] = ga_vec3f::z_vector().scale_result(extent(rng));
+
+	ga_vec3f axis = { unit(rng), unit(rng), unit(rng) };
+	if (axis.mag2() < 0.01f) axis = ga_vec3f::y_vector();
+	axis.normalize();
+
+	ga_quatf rotation;
+	rotation.make_axis_angle(axis, angle(rng));
+	transform.make_rotation(rotation);
+	transform.set_translation({ position(rng), position(rng), position(rng) });
+}
+
+/*
+** How far two boxes overlap along an axis, from their corners.
+*/
+static float fuzz_overlap_along(const ga_oobb& box_a, const ga_mat4f& trans_a, const ga_oobb& box_b, const ga_mat4f& trans_b, const ga_vec3f& axis)
+{
+	ga_vec3f corners_a[8];
+	ga_vec3f corners_b[8];
+	box_a.get_corners(corners_a);
+	box_b.get_corners(corners_b);
+
+	float min_a = FLT_MAX, max_a = -FLT_MAX, min_b = FLT_MAX, max_b = -FLT_MAX;
+	for (int i = 0; i < 8; ++i)
+	{
+		float project_a = trans_a.transform_point(corners_a[i]).dot(axis);
+		float project_b = trans_b.transform_point(corners_b[i]).dot(axis);
+		min_a = ga_min(min_a, project_a);
+		max_a = ga_max(max_a, project_a);
+		min_b = ga_min(min_b, project_b);
+		max_b = ga_max(max_b, project_b);
+	}
+	return ga_min(max_b - min_a, max_a - min_b);
+}
+
+void ga_intersection_sat_fuzz_tests()
+{
+	const float k_tolerance = 1e-3f;
+
+	// Where both pick the same axis, the penetrations differ only by rounding.
+	const float k_rounding_tolerance = 1e-5f;
+
+	// separating_axis_test lets an earlier axis win over a later one that is
+	// up to twice its axis bias shallower, so contacts between boxes resting
+	// flat stay on a face. Its penetration may be that much deeper.
+	const float k_axis_bias_tolerance = 5e-4f + k_rounding_tolerance;
+
+	std::mt19937 rng(42);
+	for (uint32_t i = 0; i < 100000; ++i)
+	{
+		ga_oobb box_a, box_b;
+		ga_mat4f trans_a, trans_b;
+		make_fuzz_box(rng, box_a, trans_a);
+		make_fuzz_box(rng, box_b, trans_b);
+
+		// Every so often line the boxes up, where edge axes are degenerate.
+		if (i % 8 == 0)
+		{
+			ga_vec3f translation = trans_b.get_translation();
+			trans_b = trans_a;
+			trans_b.set_translation(translation);
+		}
+
+		ga_collision_info info, expected;
+		bool collision = separating_axis_test(&box_a, trans_a, &box_b, trans_b, &info);
+		bool expected_collision = separating_axis_test_reference(&box_a, trans_a, &box_b, trans_b, &expected);
+
+		// The two may only disagree when the boxes are all but touching.
+		if (collision != expected_collision)
+		{
+			float penetration = collision ? info._penetration : expected._penetration;
+			assert(penetration < k_tolerance);
+			continue;
+		}
+		if (!collision) continue;
+
+		if (info._feature == expected._feature)
+		{
+			assert(ga_absf(info._penetration - expected._penetration) < k_rounding_tolerance);
+			assert((info._normal - expected._normal).mag() < k_rounding_tolerance);
+		}
+		else
+		{
+			// Another axis won, through the bias or a near tie. It is no
+			// shallower than the reference's, and the boxes overlap by as
+			// much along its normal.
+			assert(info._penetration > expected._penetration - k_rounding_tolerance);
+			assert(info._penetration < expected._penetration + k_axis_bias_tolerance);
+
+			float overlap = fuzz_overlap_along(box_a, trans_a, box_b, trans_b, info._normal);
+			assert(ga_absf(overlap - info._penetration) < k_tolerance);
+		}
+	}
 }
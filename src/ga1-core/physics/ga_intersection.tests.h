@@ -11,3 +11,8 @@
 
 void ga_intersection_utility_unit_tests();
 void ga_intersection_unit_tests();
+
+/*
+** Compare separating_axis_test against the reference on random box pairs.
+*/
+void ga_intersection_sat_fuzz_tests();
@@ -13,12 +13,13 @@
 
 #include "entity/ga_entity.h"
 
+#include <vector>
+
 ga_physics_component::ga_physics_component(ga_entity* ent, ga_shape* shape, float mass)
-	: ga_component(ent)
+	: ga_component(ent, ga_component_batched<ga_physics_component>::get_type())
 {
 	_body = new ga_rigid_body(shape, mass);
-	_body->_transform = ent->get_transform();
-	ent->set_physics_component(this);
+	_body->set_transform(ent->get_transform());
 }
 
 ga_physics_component::~ga_physics_component()
@@ -29,7 +30,7 @@ ga_physics_component::~ga_physics_component()
 void ga_physics_component::update(ga_frame_params* params)
 {
 	// First, re-sync the rigid body's transform with the entity's.
-	_body->_transform = get_entity()->get_transform();
+	_body->set_transform(get_entity()->get_transform());
 
 #if GA_PHYSICS_DEBUG_DRAW
 	ga_dynamic_drawcall draw;
@@ -44,5 +45,34 @@ void ga_physics_component::update(ga_frame_params* params)
 void ga_physics_component::late_update(ga_frame_params* params)
 {
 	// Sync the entity's transform with the rigid body's.
-	get_entity()->set_transform(_body->_transform);
+	get_entity()->set_world_transform(_body->get_transform());
+}
+
+void ga_physics_component::update_batch(ga_physics_component* const* components, uint32_t count, ga_frame_params* params)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		ga_rigid_body* body = components[i]->_body;
+		body->set_transform(components[i]->get_entity()->get_transform());
+	}
+
+#if GA_PHYSICS_DEBUG_DRAW
+	std::vector<ga_dynamic_drawcall> draws(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		components[i]->_body->get_debug_draw(&draws[i]);
+	}
+
+	while (params->_dynamic_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
+	params->_dynamic_drawcalls.insert(params->_dynamic_drawcalls.end(), draws.begin(), draws.end());
+	params->_dynamic_drawcall_lock.clear(std::memory_order_release);
+#endif
+}
+
+void ga_physics_component::late_update_batch(ga_physics_component* const* components, uint32_t count, ga_frame_params* params)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		components[i]->get_entity()->set_world_transform(components[i]->_body->get_transform());
+	}
 }
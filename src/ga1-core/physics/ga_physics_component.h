@@ -14,6 +14,7 @@
 /*
 ** A component that adds physics simulation to an entity.
 ** Owns a rigid body and synchronizes its transform and that of the entity.
+** Updated in batches by the sim.
 */
 class ga_physics_component : public ga_component
 {
@@ -24,6 +25,9 @@ public:
 	virtual void update(struct ga_frame_params* params) override;
 	virtual void late_update(struct ga_frame_params* params) override;
 
+	static void update_batch(ga_physics_component* const* components, uint32_t count, struct ga_frame_params* params);
+	static void late_update_batch(ga_physics_component* const* components, uint32_t count, struct ga_frame_params* params);
+
 	class ga_rigid_body* get_rigid_body() const { return _body; }
 
 private:
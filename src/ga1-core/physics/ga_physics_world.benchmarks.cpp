@@ -0,0 +1,728 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_physics_world.benchmarks.h"
+#include "ga_integrator.h"
+#include "ga_physics_world.h"
+#include "ga_rigid_body.h"
+#include "ga_scene_query.h"
+#include "ga_shape.h"
+
+#include "framework/ga_frame_params.h"
+#include "jobs/ga_job.h"
+#include "math/ga_quatf.h"
+#include "math/ga_simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const uint32_t k_benchmark_broadphase_counts[] = { 100, 1000, 10000, 50000 };
+static const uint32_t k_benchmark_broadphase_steps = 10;
+
+// The brute force loop is quadratic; beyond this it is not worth waiting for.
+static const uint32_t k_benchmark_brute_force_max_count = 1000;
+
+/*
+** A volume of drifting boxes, sized so each box has about the same room
+** whatever the count, with a static floor under them.
+**
+** Even scenes are all unit boxes moving slowly. Uneven ones mix in a few
+** large boxes and move everything ten times faster.
+*/
+struct benchmark_scene_t
+{
+	std::vector<ga_oobb> _boxes;
+	std::vector<ga_rigid_body*> _bodies;
+	ga_aabb _floor_shape;
+	ga_plane _ground_shape;
+};
+
+static void build_benchmark_scene(benchmark_scene_t& scene, uint32_t count, bool uneven)
+{
+	std::mt19937 rng(count);
+	float side = 3.0f * std::cbrt(float(count));
+	std::uniform_real_distribution<float> position(0.0f, side);
+	float max_speed = uneven ? 10.0f : 1.0f;
+	std::uniform_real_distribution<float> speed(-max_speed, max_speed);
+
+	scene._boxes.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		// One box in fifty is eight times the size.
+		float half = uneven && i % 50 == 0 ? 4.0f : 0.5f;
+
+		ga_oobb& box = scene._boxes[i];
+		box._center = ga_vec3f::zero_vector();
+		box._half_vectors[0] = ga_vec3f::x_vector().scale_result(half);
+		box._half_vectors[1] = ga_vec3f::y_vector().scale_result(half);
+		box._half_vectors[2] = ga_vec3f::z_vector().scale_result(half);
+
+		ga_rigid_body* body = new ga_rigid_body(&box, 1.0f);
+		body->make_weightless();
+		body->set_position({ position(rng), position(rng), position(rng) });
+		body->set_linear_velocity({ speed(rng), speed(rng), speed(rng) });
+		scene._bodies.push_back(body);
+	}
+
+	scene._floor_shape._min = { 0.0f, -1.0f, 0.0f };
+	scene._floor_shape._max = { side, 0.0f, side };
+	ga_rigid_body* floor = new ga_rigid_body(&scene._floor_shape, 0.0f);
+	floor->make_static();
+	scene._bodies.push_back(floor);
+}
+
+static void run_broadphase_benchmark(uint32_t count, bool uneven, ga_broadphase_type_t type, const char* name)
+{
+	benchmark_scene_t scene;
+	build_benchmark_scene(scene, count, uneven);
+
+	ga_physics_world world;
+	world.set_broadphase(type);
+	world.add_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+
+	uint64_t pair_tests = 0;
+	uint64_t rejected = 0;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < k_benchmark_broadphase_steps; ++i)
+	{
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(16);
+		world.step(&params);
+		pair_tests += world.get_pair_test_count();
+
+		const ga_pair_rejections_t& rejections = world.get_pair_rejections();
+		rejected += rejections._static + rejections._layer + rejections._kernel;
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	double ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / k_benchmark_broadphase_steps;
+	printf("ga_physics_world %s, %s: %u bodies, %llu pair tests, %llu pairs rejected, %.3f ms per step\n",
+		name, uneven ? "uneven" : "even", count, (unsigned long long)(pair_tests / k_benchmark_broadphase_steps),
+		(unsigned long long)(rejected / k_benchmark_broadphase_steps), ms);
+
+	world.remove_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+	for (auto body : scene._bodies)
+	{
+		delete body;
+	}
+}
+
+void ga_physics_broadphase_benchmarks()
+{
+	for (int uneven = 0; uneven < 2; ++uneven)
+	{
+		for (uint32_t count : k_benchmark_broadphase_counts)
+		{
+			if (count <= k_benchmark_brute_force_max_count)
+			{
+				run_broadphase_benchmark(count, uneven != 0, k_broadphase_brute_force, "brute force");
+			}
+			run_broadphase_benchmark(count, uneven != 0, k_broadphase_sweep_and_prune, "sweep and prune");
+			run_broadphase_benchmark(count, uneven != 0, k_broadphase_aabb_tree, "aabb tree");
+		}
+	}
+}
+
+static const uint32_t k_benchmark_narrowphase_sides[] = { 10, 20 };
+static const uint32_t k_benchmark_narrowphase_steps = 10;
+
+/*
+** A packed block of unit boxes, each overlapping its neighbors, nudged in
+** random directions so contacts are resolved every step.
+*/
+static void build_packed_scene(benchmark_scene_t& scene, uint32_t side)
+{
+	uint32_t count = side * side * side;
+	std::mt19937 rng(count);
+	std::uniform_real_distribution<float> speed(-0.5f, 0.5f);
+
+	scene._boxes.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		ga_oobb& box = scene._boxes[i];
+		box._center = ga_vec3f::zero_vector();
+		box._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.5f);
+		box._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+		box._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f);
+
+		ga_rigid_body* body = new ga_rigid_body(&box, 1.0f);
+		body->make_weightless();
+		body->set_position({ 0.9f * float(i % side), 0.9f * float((i / side) % side), 0.9f * float(i / (side * side)) });
+		body->set_linear_velocity({ speed(rng), speed(rng), speed(rng) });
+		scene._bodies.push_back(body);
+	}
+}
+
+static void run_narrowphase_benchmark(uint32_t side, bool parallel, std::vector<ga_vec3f>& positions)
+{
+	benchmark_scene_t scene;
+	build_packed_scene(scene, side);
+
+	ga_physics_world world;
+	world.set_broadphase(k_broadphase_aabb_tree);
+	world.set_parallel_narrowphase(parallel);
+	world.add_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+
+	uint64_t contacts = 0;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < k_benchmark_narrowphase_steps; ++i)
+	{
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(16);
+		world.step(&params);
+		contacts += world.get_contact_count();
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	double ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / k_benchmark_narrowphase_steps;
+	printf("ga_physics_world %s narrowphase: %u bodies, %llu contacts, %.3f ms per step\n",
+		parallel ? "parallel" : "serial", uint32_t(scene._bodies.size()),
+		(unsigned long long)(contacts / k_benchmark_narrowphase_steps), ms);
+
+	positions.clear();
+	for (auto body : scene._bodies)
+	{
+		positions.push_back(body->get_position());
+	}
+
+	world.remove_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+	for (auto body : scene._bodies)
+	{
+		delete body;
+	}
+}
+
+void ga_physics_narrowphase_benchmarks()
+{
+	printf("ga_physics_world narrowphase: %u hardware threads\n", std::thread::hardware_concurrency());
+
+	for (uint32_t side : k_benchmark_narrowphase_sides)
+	{
+		std::vector<ga_vec3f> serial_positions;
+		std::vector<ga_vec3f> parallel_positions;
+		run_narrowphase_benchmark(side, false, serial_positions);
+		run_narrowphase_benchmark(side, true, parallel_positions);
+
+		// Contacts are resolved in the same order either way.
+		bool same = memcmp(serial_positions.data(), parallel_positions.data(), serial_positions.size() * sizeof(ga_vec3f)) == 0;
+		printf("ga_physics_world narrowphase results match: %s\n", same ? "yes" : "NO");
+	}
+}
+
+static const uint32_t k_benchmark_integration_count = 100000;
+static const uint32_t k_benchmark_integration_steps = 100;
+
+/*
+** One body's state laid out the way it was before the world kept arrays,
+** integrated one body at a time, for comparison.
+*/
+struct benchmark_body_t
+{
+	ga_vec3f _position;
+	ga_vec3f _velocity;
+	ga_quatf _orientation;
+	ga_vec3f _angular_velocity;
+	uint32_t _flags;
+};
+
+static double time_integration(const std::function<void()>& step)
+{
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < k_benchmark_integration_steps; ++i)
+	{
+		step();
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count() / k_benchmark_integration_steps;
+}
+
+void ga_physics_integration_benchmarks()
+{
+	const uint32_t count = k_benchmark_integration_count;
+	const float dt = 1.0f / 60.0f;
+	const ga_vec3f gravity = { 0.0f, -9.807f, 0.0f };
+
+	std::mt19937 rng(count);
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+	std::vector<benchmark_body_t> bodies(count);
+	std::vector<float> position[3], velocity[3], orientation[4], angular_velocity[3], acceleration[3];
+	std::vector<uint32_t> flags(count);
+	for (int a = 0; a < 3; ++a)
+	{
+		position[a].resize(count);
+		velocity[a].resize(count);
+		angular_velocity[a].resize(count);
+		acceleration[a].assign(count, 0.0f);
+	}
+	for (int a = 0; a < 4; ++a)
+	{
+		orientation[a].resize(count);
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		benchmark_body_t& body = bodies[i];
+		body._position = { value(rng), value(rng), value(rng) };
+		body._velocity = { value(rng), value(rng), value(rng) };
+		body._angular_velocity = { value(rng), value(rng), value(rng) };
+		body._orientation.make_axis_angle(ga_vec3f::y_vector(), value(rng));
+		body._flags = i % 16 == 0 ? k_static : 0;
+
+		for (int a = 0; a < 3; ++a)
+		{
+			position[a][i] = body._position.axes[a];
+			velocity[a][i] = body._velocity.axes[a];
+			angular_velocity[a][i] = body._angular_velocity.axes[a];
+		}
+		for (int a = 0; a < 4; ++a)
+		{
+			orientation[a][i] = body._orientation.axes[a];
+		}
+		flags[i] = body._flags;
+	}
+
+	ga_body_arrays_t arrays;
+	for (int a = 0; a < 3; ++a)
+	{
+		arrays._position[a] = position[a].data();
+		arrays._velocity[a] = velocity[a].data();
+		arrays._angular_velocity[a] = angular_velocity[a].data();
+		arrays._acceleration[a] = acceleration[a].data();
+	}
+	for (int a = 0; a < 4; ++a)
+	{
+		arrays._orientation[a] = orientation[a].data();
+	}
+	arrays._flags = flags.data();
+
+	double per_body_ms = time_integration([&]()
+	{
+		for (auto& body : bodies)
+		{
+			if (body._flags & k_static) continue;
+			body._velocity += gravity.scale_result(dt);
+			body._position += body._velocity.scale_result(dt);
+			ga_quatf w = { body._angular_velocity.x, body._angular_velocity.y, body._angular_velocity.z, 0.0f };
+			body._orientation += (w * body._orientation).scale_result(0.5f * dt);
+			body._orientation.normalize();
+		}
+	});
+	double euler_ms = time_integration([&]()
+	{
+		ga_integrate_linear(k_integrator_semi_implicit_euler, arrays, 0, count, gravity, dt);
+		ga_integrate_orientation(arrays, 0, count, dt);
+	});
+	double rk4_ms = time_integration([&]()
+	{
+		ga_integrate_linear(k_integrator_rk4, arrays, 0, count, gravity, dt);
+		ga_integrate_orientation(arrays, 0, count, dt);
+	});
+
+	printf("ga_physics_world integration: %u bodies, %u per instruction\n", count, k_simd_width);
+	printf("ga_physics_world integration per body: %.3f ms per step\n", per_body_ms);
+	printf("ga_physics_world integration arrays, semi-implicit euler: %.3f ms per step\n", euler_ms);
+	printf("ga_physics_world integration arrays, rk4: %.3f ms per step\n", rk4_ms);
+}
+
+static const uint32_t k_benchmark_sleeping_side = 32;
+static const uint32_t k_benchmark_sleeping_settle_steps = 600;
+static const uint32_t k_benchmark_sleeping_steps = 100;
+
+static double time_world_steps(ga_physics_world& world, uint32_t steps)
+{
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < steps; ++i)
+	{
+		ga_frame_params params;
+		params._delta_time = std::chrono::microseconds(16667);
+		world.step(&params);
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count() / steps;
+}
+
+/*
+** A grid of box stacks on a static plane, each box resting on the one
+** below with a little friction.
+*/
+static void build_stacked_scene(benchmark_scene_t& scene, uint32_t side, uint32_t height)
+{
+	uint32_t count = side * side * height;
+	scene._boxes.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		ga_oobb& box = scene._boxes[i];
+		box._center = ga_vec3f::zero_vector();
+		box._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.5f);
+		box._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+		box._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f);
+
+		uint32_t column = i / height;
+		ga_rigid_body* body = new ga_rigid_body(&box, 1.0f);
+		body->set_friction(0.5f);
+		body->set_position({ 2.0f * float(column % side), 0.5f + float(i % height), 2.0f * float(column / side) });
+		scene._bodies.push_back(body);
+	}
+
+	scene._ground_shape._point = ga_vec3f::zero_vector();
+	scene._ground_shape._normal = ga_vec3f::y_vector();
+	ga_rigid_body* ground = new ga_rigid_body(&scene._ground_shape, 0.0f);
+	ground->make_static();
+	ground->set_friction(0.5f);
+	scene._bodies.push_back(ground);
+}
+
+void ga_physics_sleeping_benchmarks()
+{
+	const uint32_t side = k_benchmark_sleeping_side;
+	benchmark_scene_t scene;
+	build_stacked_scene(scene, side, 2);
+
+	ga_physics_world world;
+	world.set_broadphase(k_broadphase_aabb_tree);
+	world.add_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+
+	uint32_t settle_steps = 0;
+	while (settle_steps < k_benchmark_sleeping_settle_steps)
+	{
+		time_world_steps(world, 1);
+		++settle_steps;
+		if (world.get_awake_body_count() == 0) break;
+	}
+
+	double asleep_ms = time_world_steps(world, k_benchmark_sleeping_steps);
+	world.set_sleeping(false);
+	double awake_ms = time_world_steps(world, k_benchmark_sleeping_steps);
+
+	printf("ga_physics_world sleeping: %u bodies at rest, asleep after %u steps\n", side * side * 2, settle_steps);
+	printf("ga_physics_world sleeping, awake: %.3f ms per step\n", awake_ms);
+	printf("ga_physics_world sleeping, asleep: %.3f ms per step\n", asleep_ms);
+
+	world.remove_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+	for (auto body : scene._bodies)
+	{
+		delete body;
+	}
+}
+
+static const uint32_t k_benchmark_solver_side = 32;
+static const uint32_t k_benchmark_solver_height = 4;
+static const uint32_t k_benchmark_solver_steps = 60;
+static const uint32_t k_benchmark_solver_workers[] = { 1, 2, 4, 8, 16, 32 };
+
+/*
+** Step the stacked scene with sleeping off and the narrowphase on one thread,
+** so only the solver is split across jobs.
+*/
+static double run_solver_benchmark(bool parallel, std::vector<ga_vec3f>& positions)
+{
+	benchmark_scene_t scene;
+	build_stacked_scene(scene, k_benchmark_solver_side, k_benchmark_solver_height);
+
+	ga_physics_world world;
+	world.set_broadphase(k_broadphase_aabb_tree);
+	world.set_parallel_narrowphase(false);
+	world.set_sleeping(false);
+	world.set_parallel_solver(parallel);
+	world.set_deterministic_solver(true);
+	world.add_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+
+	double ms = time_world_steps(world, k_benchmark_solver_steps);
+
+	positions.clear();
+	for (auto body : scene._bodies)
+	{
+		positions.push_back(body->get_position());
+	}
+
+	world.remove_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+	for (auto body : scene._bodies)
+	{
+		delete body;
+	}
+	return ms;
+}
+
+void ga_physics_solver_benchmarks()
+{
+	uint32_t hardware_threads = std::thread::hardware_concurrency();
+	uint32_t count = k_benchmark_solver_side * k_benchmark_solver_side * k_benchmark_solver_height;
+	printf("ga_physics_world solver: %u bodies, %u hardware threads\n", count, hardware_threads);
+
+	std::vector<ga_vec3f> serial_positions;
+	double serial_ms = run_solver_benchmark(false, serial_positions);
+	printf("ga_physics_world solver, serial: %.3f ms per step\n", serial_ms);
+
+	// The job system starts one worker per bit in its thread mask, up to the
+	// number of hardware threads, so restart it with each count in turn.
+	for (uint32_t workers : k_benchmark_solver_workers)
+	{
+		if (workers > hardware_threads)
+		{
+			printf("ga_physics_world solver, %u workers: skipped\n", workers);
+			continue;
+		}
+
+		ga_job::shutdown();
+		ga_job::startup(workers >= 32 ? 0xffffffff : (1u << workers) - 1, 256, 256);
+
+		std::vector<ga_vec3f> parallel_positions;
+		double parallel_ms = run_solver_benchmark(true, parallel_positions);
+
+		bool same = memcmp(serial_positions.data(), parallel_positions.data(), serial_positions.size() * sizeof(ga_vec3f)) == 0;
+		printf("ga_physics_world solver, %u workers: %.3f ms per step, %.2fx, results match: %s\n",
+			workers, parallel_ms, serial_ms / parallel_ms, same ? "yes" : "NO");
+	}
+
+	// Leave the job system as main started it.
+	ga_job::shutdown();
+	ga_job::startup(0xffff, 256, 256);
+}
+
+static const uint32_t k_benchmark_deterministic_steps = 120;
+
+/*
+** Step the stacked scene with everything split across jobs, in
+** deterministic mode or not.
+*/
+static double run_deterministic_benchmark(bool deterministic, uint64_t& hash)
+{
+	benchmark_scene_t scene;
+	build_stacked_scene(scene, k_benchmark_solver_side, k_benchmark_solver_height);
+
+	ga_physics_world world;
+	world.set_broadphase(k_broadphase_aabb_tree);
+	world.set_deterministic(deterministic);
+	world.add_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+
+	double ms = time_world_steps(world, k_benchmark_deterministic_steps);
+	hash = world.get_state_hash();
+
+	world.remove_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+	for (auto body : scene._bodies)
+	{
+		delete body;
+	}
+	return ms;
+}
+
+void ga_physics_deterministic_benchmarks()
+{
+	uint32_t hardware_threads = std::thread::hardware_concurrency();
+	uint32_t count = k_benchmark_solver_side * k_benchmark_solver_side * k_benchmark_solver_height;
+	printf("ga_physics_world deterministic: %u bodies, %u steps\n", count, k_benchmark_deterministic_steps);
+
+	uint64_t hash;
+	double free_ms = run_deterministic_benchmark(false, hash);
+	printf("ga_physics_world deterministic, off: %.3f ms per step\n", free_ms);
+
+	uint64_t first_hash = 0;
+	for (uint32_t workers : k_benchmark_solver_workers)
+	{
+		if (workers > hardware_threads && workers > 1)
+		{
+			printf("ga_physics_world deterministic, %u workers: skipped\n", workers);
+			continue;
+		}
+
+		ga_job::shutdown();
+		ga_job::startup(workers >= 32 ? 0xffffffff : (1u << workers) - 1, 256, 256);
+
+		double ms = run_deterministic_benchmark(true, hash);
+		if (workers == 1)
+		{
+			first_hash = hash;
+		}
+		printf("ga_physics_world deterministic, %u workers: %.3f ms per step, hash %016llx, matches 1 worker: %s\n",
+			workers, ms, (unsigned long long)hash, hash == first_hash ? "yes" : "NO");
+	}
+
+	ga_job::shutdown();
+	ga_job::startup(0xffff, 256, 256);
+}
+
+static const uint32_t k_benchmark_query_count = 10000;
+static const uint32_t k_benchmark_query_rays = 16384;
+static const uint32_t k_benchmark_query_nearest = 8;
+
+// Walking every body for every ray is slow; time this many and scale up.
+static const uint32_t k_benchmark_query_brute_force_rays = 256;
+
+static double time_queries(const std::function<void()>& queries)
+{
+	auto t0 = std::chrono::high_resolution_clock::now();
+	queries();
+	auto t1 = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+static uint32_t count_hits(const std::vector<ga_raycast_hit_t>& hits)
+{
+	uint32_t count = 0;
+	for (const auto& hit : hits)
+	{
+		count += hit._body ? 1 : 0;
+	}
+	return count;
+}
+
+/*
+** Rays, overlaps and nearest bodies in the drifting box scene, against
+** walking every body for each query. Scattered rays start anywhere and point
+** anywhere; a fan of rays leaves one point, as aiming would, and so visits
+** the same boxes in each packet.
+*/
+void ga_physics_query_benchmarks()
+{
+	const uint32_t count = k_benchmark_query_count;
+	benchmark_scene_t scene;
+	build_benchmark_scene(scene, count, false);
+
+	ga_physics_world world;
+	world.set_broadphase(k_broadphase_aabb_tree);
+	world.add_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+	time_world_steps(world, 1);
+
+	std::mt19937 rng(count);
+	float side = 3.0f * std::cbrt(float(count));
+	std::uniform_real_distribution<float> position(0.0f, side);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> fan(-0.2f, 0.2f);
+
+	std::vector<ga_raycast_t> scattered(k_benchmark_query_rays);
+	std::vector<ga_raycast_t> fanned(k_benchmark_query_rays);
+	for (uint32_t i = 0; i < k_benchmark_query_rays; ++i)
+	{
+		scattered[i]._origin = { position(rng), position(rng), position(rng) };
+		scattered[i]._direction = { direction(rng), direction(rng), direction(rng) };
+		scattered[i]._max_distance = side;
+
+		fanned[i]._origin = { -1.0f, 0.5f * side, 0.5f * side };
+		fanned[i]._direction = { 1.0f, fan(rng), fan(rng) };
+		fanned[i]._max_distance = 2.0f * side;
+	}
+
+	std::vector<ga_raycast_hit_t> hits(k_benchmark_query_rays);
+	const std::vector<ga_raycast_t>* ray_sets[] = { &scattered, &fanned };
+	const char* ray_set_names[] = { "scattered", "fanned" };
+	for (int set = 0; set < 2; ++set)
+	{
+		const std::vector<ga_raycast_t>& rays = *ray_sets[set];
+
+		std::vector<ga_rigid_body*> brute_force_bodies(k_benchmark_query_brute_force_rays, nullptr);
+		double brute_force_ms = time_queries([&]()
+		{
+			for (uint32_t i = 0; i < k_benchmark_query_brute_force_rays; ++i)
+			{
+				ga_vec3f unit = rays[i]._direction.normal();
+				float nearest = rays[i]._max_distance;
+				for (uint32_t b = 0; b < scene._bodies.size(); ++b)
+				{
+					const ga_shape* shape = b < count ? static_cast<const ga_shape*>(&scene._boxes[b]) : &scene._floor_shape;
+					float distance;
+					ga_vec3f normal;
+					if (ray_vs_shape(shape, scene._bodies[b]->get_transform(), rays[i]._origin, unit, nearest, distance, normal) &&
+						(!brute_force_bodies[i] || distance < nearest))
+					{
+						nearest = distance;
+						brute_force_bodies[i] = scene._bodies[b];
+					}
+				}
+			}
+		});
+		brute_force_ms *= double(k_benchmark_query_rays) / k_benchmark_query_brute_force_rays;
+
+		double single_ms = time_queries([&]()
+		{
+			for (uint32_t i = 0; i < k_benchmark_query_rays; ++i)
+			{
+				world.raycast(rays[i], hits[i]);
+			}
+		});
+
+		world.set_parallel_queries(false);
+		double batch_ms = time_queries([&]() { world.raycast_batch(rays.data(), k_benchmark_query_rays, hits.data()); });
+		world.set_parallel_queries(true);
+		double parallel_ms = time_queries([&]() { world.raycast_batch(rays.data(), k_benchmark_query_rays, hits.data()); });
+
+		bool same = true;
+		for (uint32_t i = 0; i < k_benchmark_query_brute_force_rays; ++i)
+		{
+			same = same && hits[i]._body == brute_force_bodies[i];
+		}
+
+		printf("ga_physics_world raycast, %s: %u rays, %u bodies, %u hits\n", ray_set_names[set], k_benchmark_query_rays, count, count_hits(hits));
+		printf("ga_physics_world raycast, %s: brute force %.3f ms (estimated), one by one %.3f ms, batch %.3f ms, parallel batch %.3f ms, results match: %s\n",
+			ray_set_names[set], brute_force_ms, single_ms, batch_ms, parallel_ms, same ? "yes" : "NO");
+	}
+
+	std::vector<ga_sphere_query_t> spheres(k_benchmark_query_rays);
+	std::vector<ga_vec3f> points(k_benchmark_query_rays);
+	for (uint32_t i = 0; i < k_benchmark_query_rays; ++i)
+	{
+		spheres[i]._center = { position(rng), position(rng), position(rng) };
+		spheres[i]._radius = 2.0f;
+		points[i] = spheres[i]._center;
+	}
+
+	const uint32_t capacity = k_benchmark_query_nearest;
+	std::vector<ga_rigid_body*> bodies(size_t(k_benchmark_query_rays) * capacity);
+	std::vector<float> distances(size_t(k_benchmark_query_rays) * capacity);
+	std::vector<uint32_t> counts(k_benchmark_query_rays);
+
+	double overlap_ms = time_queries([&]() { world.overlap_sphere_batch(spheres.data(), k_benchmark_query_rays, bodies.data(), capacity, counts.data()); });
+	uint64_t overlaps = 0;
+	for (uint32_t c : counts)
+	{
+		overlaps += c;
+	}
+	printf("ga_physics_world overlap_sphere_batch: %u spheres, %llu bodies found, %.3f ms\n", k_benchmark_query_rays, (unsigned long long)overlaps, overlap_ms);
+
+	// Boxes as big as the spheres, turned about y, checked against the one
+	// at a time query.
+	std::vector<ga_box_query_t> boxes(k_benchmark_query_rays);
+	for (uint32_t i = 0; i < k_benchmark_query_rays; ++i)
+	{
+		ga_quatf turn;
+		turn.make_axis_angle({ 0.0f, 1.0f, 0.0f }, float(i));
+		boxes[i]._transform.make_rotation(turn);
+		boxes[i]._transform.set_translation(spheres[i]._center);
+		boxes[i]._half_extents = { 2.0f, 2.0f, 2.0f };
+	}
+
+	double box_ms = time_queries([&]() { world.overlap_box_batch(boxes.data(), k_benchmark_query_rays, bodies.data(), capacity, counts.data()); });
+	uint64_t box_overlaps = 0;
+	bool box_same = true;
+	std::vector<ga_rigid_body*> single_bodies(capacity);
+	for (uint32_t i = 0; i < k_benchmark_query_rays; ++i)
+	{
+		box_overlaps += counts[i];
+		uint32_t single_count = world.overlap_box(boxes[i]._transform, boxes[i]._half_extents, single_bodies.data(), capacity);
+		uint32_t written = ga_min(single_count, capacity);
+		box_same = box_same && single_count == counts[i] && std::equal(single_bodies.begin(), single_bodies.begin() + written, bodies.begin() + size_t(i) * capacity);
+	}
+	printf("ga_physics_world overlap_box_batch: %u boxes, %llu bodies found, %.3f ms, results match: %s\n", k_benchmark_query_rays, (unsigned long long)box_overlaps, box_ms, box_same ? "yes" : "NO");
+
+	double nearest_ms = time_queries([&]() { world.find_nearest_batch(points.data(), k_benchmark_query_rays, capacity, bodies.data(), distances.data(), counts.data()); });
+	printf("ga_physics_world find_nearest_batch: %u points, %u nearest each, %.3f ms\n", k_benchmark_query_rays, capacity, nearest_ms);
+
+	world.remove_rigid_bodies(scene._bodies.data(), uint32_t(scene._bodies.size()));
+	for (auto body : scene._bodies)
+	{
+		delete body;
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+void ga_physics_broadphase_benchmarks();
+void ga_physics_narrowphase_benchmarks();
+void ga_physics_integration_benchmarks();
+void ga_physics_sleeping_benchmarks();
+void ga_physics_solver_benchmarks();
+void ga_physics_deterministic_benchmarks();
+void ga_physics_query_benchmarks();
@@ -8,322 +8,1655 @@
 */
 
 #include "ga_physics_world.h"
+#include "ga_aabb_tree.h"
+#include "ga_force_generator.h"
 #include "ga_intersection.h"
 #include "ga_rigid_body.h"
 #include "ga_shape.h"
+#include "ga_sweep_and_prune.h"
 
 #include "framework/ga_drawcall.h"
 #include "framework/ga_frame_params.h"
+#include "math/ga_math.h"
 
 #include <algorithm>
 #include <assert.h>
-#include <ctime>
+#include <cmath>
+#include <cstring>
 
 typedef bool (*intersection_func_t)(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
 
-static intersection_func_t k_dispatch_table[k_shape_count][k_shape_count];
-
-ga_physics_world::ga_physics_world()
+/*
+** Intersection function for each pair of shape types.
+** Built once at startup and only read after, so any number of worlds can step at once.
+*/
+struct intersection_dispatch_table_t
 {
-	// Clear the dispatch table.
-	for (int i = 0; i < k_shape_count; ++i)
+	intersection_func_t _funcs[k_shape_count][k_shape_count];
+	uint32_t _kernels[k_shape_count];
+
+	intersection_dispatch_table_t()
 	{
-		for (int j = 0; j < k_shape_count; ++j)
+		for (int i = 0; i < k_shape_count; ++i)
+		{
+			for (int j = 0; j < k_shape_count; ++j)
+			{
+				_funcs[i][j] = intersection_unimplemented;
+			}
+		}
+
+		_funcs[k_shape_sphere][k_shape_sphere] = sphere_vs_sphere;
+		_funcs[k_shape_oobb][k_shape_oobb] = separating_axis_test;
+		_funcs[k_shape_plane][k_shape_oobb] = oobb_vs_plane;
+		_funcs[k_shape_oobb][k_shape_plane] = oobb_vs_plane;
+		_funcs[k_shape_plane][k_shape_sphere] = sphere_vs_plane;
+		_funcs[k_shape_sphere][k_shape_plane] = sphere_vs_plane;
+		_funcs[k_shape_convex_hull][k_shape_convex_hull] = gjk;
+
+		// Which shape types each has a test against, for the broadphase to
+		// pass over the rest.
+		for (int i = 0; i < k_shape_count; ++i)
 		{
-			k_dispatch_table[i][j] = intersection_unimplemented;
+			_kernels[i] = 0;
+			for (int j = 0; j < k_shape_count; ++j)
+			{
+				if (_funcs[i][j] != intersection_unimplemented) _kernels[i] |= 1u << j;
+			}
 		}
 	}
+};
+
+static const intersection_dispatch_table_t k_dispatch_table;
+
+// Smallest number of pairs tested by a single narrowphase job.
+static const uint32_t k_min_pairs_per_job = 64;
+
+// Cap on narrowphase jobs per step, to stay well within the job queue.
+static const uint32_t k_max_narrowphase_jobs = 128;
 
-	k_dispatch_table[k_shape_sphere][k_shape_sphere] = sphere_vs_sphere;
-	k_dispatch_table[k_shape_oobb][k_shape_oobb] = separating_axis_test;
-	k_dispatch_table[k_shape_plane][k_shape_oobb] = oobb_vs_plane;
-	k_dispatch_table[k_shape_oobb][k_shape_plane] = oobb_vs_plane;
-	k_dispatch_table[k_shape_plane][k_shape_sphere] = sphere_vs_plane;
-	k_dispatch_table[k_shape_sphere][k_shape_plane] = sphere_vs_plane;
+// Most poses tested along one sweep before narrowing down on a hit, and how
+// many halvings the narrowing takes.
+static const uint32_t k_max_sweep_samples = 64;
+static const uint32_t k_time_of_impact_iterations = 10;
 
+// Bodies moving slower than this, in m/s and rad/s, count as resting, and
+// an island sleeps once all its bodies have rested this many steps.
+static const float k_sleep_linear_speed = 0.05f;
+static const float k_sleep_angular_speed = 0.05f;
+static const uint32_t k_sleep_frames = 30;
+
+// Smallest number of queries answered by a single job, and the most jobs
+// one batch is split into.
+static const uint32_t k_min_queries_per_job = 64;
+static const uint32_t k_max_query_jobs = 64;
+
+// Half size of the first box searched for nearest bodies; it doubles until
+// enough are found.
+static const float k_nearest_start_radius = 1.0f;
+
+// Bodies further than this outside the box the broadphase last saw, such as
+// ones placed by gameplay, are checked one by one rather than growing every
+// query to reach them.
+static const float k_max_query_margin = 0.5f;
+
+// Most fixed ticks run for one frame in deterministic mode. Frames longer
+// than this drop the rest rather than fall further behind.
+static const uint32_t k_max_fixed_steps = 4;
+
+static uint64_t manifold_key(uint32_t a, uint32_t b)
+{
+	return (uint64_t(a) << 32) | b;
+}
+
+static ga_broadphase* create_broadphase(ga_broadphase_type_t type)
+{
+	switch (type)
+	{
+	case k_broadphase_sweep_and_prune: return new ga_sweep_and_prune();
+	case k_broadphase_aabb_tree: return new ga_aabb_tree();
+	default: return nullptr;
+	}
+}
+
+ga_physics_world::ga_physics_world()
+{
 	// Default gravity to Earth's constant.
 	_gravity = { 0.0f, -9.807f, 0.0f };
+
+	_broadphase_type = k_broadphase_sweep_and_prune;
+	_broadphase = create_broadphase(_broadphase_type);
+
+	_fixed_timestep = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<int64_t, std::ratio<1, 60>>(1));
+	_time_accumulator = std::chrono::high_resolution_clock::duration::zero();
 }
 
 ga_physics_world::~ga_physics_world()
 {
 	assert(_bodies.size() == 0);
+	delete _broadphase;
+}
+
+void ga_physics_world::set_broadphase(ga_broadphase_type_t type)
+{
+	if (type == _broadphase_type) return;
+
+	delete _broadphase;
+	_broadphase_type = type;
+	_broadphase = create_broadphase(type);
 }
 
 void ga_physics_world::add_rigid_body(ga_rigid_body* body)
 {
 	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
-	_bodies.push_back(body);
+	append_body(body);
+	if (_broadphase) _broadphase->reset();
+	_boxes.clear();
+	_gjk_directions.clear();
 	_bodies_lock.clear(std::memory_order_release);
 }
 
 void ga_physics_world::remove_rigid_body(ga_rigid_body* body)
 {
+	std::vector<ga_rigid_body*> removed(1, body);
+
 	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
-	_bodies.erase(std::remove(_bodies.begin(), _bodies.end(), body));
+	remove_bodies(removed);
+	if (_broadphase) _broadphase->reset();
+	_boxes.clear();
+	_gjk_directions.clear();
+	_manifolds.clear();
 	_bodies_lock.clear(std::memory_order_release);
 }
 
-void ga_physics_world::step(ga_frame_params* params)
+void ga_physics_world::add_rigid_bodies(ga_rigid_body* const* bodies, uint32_t count)
+{
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		append_body(bodies[i]);
+	}
+	if (_broadphase) _broadphase->reset();
+	_boxes.clear();
+	_gjk_directions.clear();
+	_bodies_lock.clear(std::memory_order_release);
+}
+
+void ga_physics_world::remove_rigid_bodies(ga_rigid_body* const* bodies, uint32_t count)
 {
+	std::vector<ga_rigid_body*> removed(bodies, bodies + count);
+	std::sort(removed.begin(), removed.end());
+
 	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	remove_bodies(removed);
+	if (_broadphase) _broadphase->reset();
+	_boxes.clear();
+	_gjk_directions.clear();
+	_manifolds.clear();
+	_bodies_lock.clear(std::memory_order_release);
+}
+
+void ga_physics_world::append_body(ga_rigid_body* body)
+{
+	assert(body->_world == nullptr);
+
+	uint32_t index = uint32_t(_bodies.size());
+	resize_bodies(index + 1);
 
-	// Step the physics sim.
-	for (int i = 0; i < _bodies.size(); ++i)
+	const ga_rigid_body_state_t& state = body->_state;
+	_bodies[index] = body;
+	_shapes[index] = body->_shape;
+	_transforms[index] = state._transform;
+	for (int a = 0; a < 3; ++a)
 	{
-		if (_bodies[i]->_flags & k_static) continue;
+		_positions[a][index] = state._transform.data[3][a];
+		_velocities[a][index] = state._velocity.axes[a];
+		_angular_momenta[a][index] = state._angular_momentum.axes[a];
+		_angular_velocities[a][index] = state._angular_velocity.axes[a];
+		_accelerations[a][index] = 0.0f;
+		_forces[a][index] = state._force.axes[a];
+		_torques[a][index] = state._torque.axes[a];
+	}
+	for (int a = 0; a < 4; ++a)
+	{
+		_orientations[a][index] = state._orientation.axes[a];
+	}
+	_inverse_masses[index] = body->_mass > 0.0f ? 1.0f / body->_mass : 0.0f;
+	_flags[index] = state._flags;
+	_rest_frames[index] = 0;
+	update_inverse_inertia(index);
+
+	body->_world = this;
+	body->_index = index;
+}
 
+void ga_physics_world::remove_bodies(const std::vector<ga_rigid_body*>& sorted_bodies)
+{
+	// Compact the arrays in place, keeping the order of the bodies that stay
+	// so that stepping remains deterministic.
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < _bodies.size(); ++i)
+	{
 		ga_rigid_body* body = _bodies[i];
+		if (std::binary_search(sorted_bodies.begin(), sorted_bodies.end(), body))
+		{
+			get_body_state(i, body->_state);
+			body->_state._flags &= ~k_sleeping;
+			body->_world = nullptr;
+			body->_index = 0;
+			continue;
+		}
 
-		if ((_bodies[i]->_flags & k_weightless) == 0)
+		if (kept != i)
 		{
-			body->_forces.push_back(_gravity);
+			move_body(i, kept);
 		}
+		body->_index = kept;
+		++kept;
+	}
+	resize_bodies(kept);
 
-		step_linear_dynamics(params, body);
-		step_angular_dynamics(params, body);
+	// What the removed bodies held up has to find out for itself.
+	for (uint32_t i = 0; i < kept; ++i)
+	{
+		_flags[i] &= ~k_sleeping;
+		_rest_frames[i] = 0;
 	}
 
-	test_intersections(params);
+	_force_generators.erase(std::remove_if(_force_generators.begin(), _force_generators.end(), [&sorted_bodies](const force_registration_t& r)
+	{
+		return std::binary_search(sorted_bodies.begin(), sorted_bodies.end(), r._body);
+	}), _force_generators.end());
+}
+
+void ga_physics_world::resize_bodies(uint32_t count)
+{
+	_bodies.resize(count);
+	_shapes.resize(count);
+	_transforms.resize(count);
+	for (int a = 0; a < 3; ++a)
+	{
+		_positions[a].resize(count);
+		_velocities[a].resize(count);
+		_angular_momenta[a].resize(count);
+		_angular_velocities[a].resize(count);
+		_accelerations[a].resize(count);
+		_forces[a].resize(count);
+		_torques[a].resize(count);
+	}
+	for (int a = 0; a < 4; ++a)
+	{
+		_orientations[a].resize(count);
+	}
+	_inverse_masses.resize(count);
+	_inverse_inertia_tensors.resize(count);
+	_flags.resize(count);
+	_rest_frames.resize(count);
+}
 
-	_bodies_lock.clear(std::memory_order_release);
+void ga_physics_world::move_body(uint32_t from, uint32_t to)
+{
+	_bodies[to] = _bodies[from];
+	_shapes[to] = _shapes[from];
+	_transforms[to] = _transforms[from];
+	for (int a = 0; a < 3; ++a)
+	{
+		_positions[a][to] = _positions[a][from];
+		_velocities[a][to] = _velocities[a][from];
+		_angular_momenta[a][to] = _angular_momenta[a][from];
+		_angular_velocities[a][to] = _angular_velocities[a][from];
+		_accelerations[a][to] = _accelerations[a][from];
+		_forces[a][to] = _forces[a][from];
+		_torques[a][to] = _torques[a][from];
+	}
+	for (int a = 0; a < 4; ++a)
+	{
+		_orientations[a][to] = _orientations[a][from];
+	}
+	_inverse_masses[to] = _inverse_masses[from];
+	_inverse_inertia_tensors[to] = _inverse_inertia_tensors[from];
+	_flags[to] = _flags[from];
+	_rest_frames[to] = _rest_frames[from];
 }
 
-void ga_physics_world::test_intersections(ga_frame_params* params)
+void ga_physics_world::get_body_state(uint32_t index, ga_rigid_body_state_t& state) const
 {
-	// Intersection tests. Naive N^2 comparisons.
-	for (int i = 0; i < _bodies.size(); ++i)
+	state._transform = _transforms[index];
+	for (int a = 0; a < 3; ++a)
 	{
-		for (int j = i + 1; j < _bodies.size(); ++j)
-		{
-			ga_shape* shape_a = _bodies[i]->_shape;
-			ga_shape* shape_b = _bodies[j]->_shape;
-			intersection_func_t func = k_dispatch_table[shape_a->get_type()][shape_b->get_type()];
+		state._velocity.axes[a] = _velocities[a][index];
+		state._angular_momentum.axes[a] = _angular_momenta[a][index];
+		state._angular_velocity.axes[a] = _angular_velocities[a][index];
+		state._force.axes[a] = _forces[a][index];
+		state._torque.axes[a] = _torques[a][index];
+	}
+	for (int a = 0; a < 4; ++a)
+	{
+		state._orientation.axes[a] = _orientations[a][index];
+	}
+	state._flags = _flags[index];
+}
 
-			ga_collision_info info;
-			bool collision = func(shape_a, _bodies[i]->_transform, shape_b, _bodies[j]->_transform, &info);
-			if (collision)
-			{
-				std::time_t time = std::chrono::system_clock::to_time_t(
-					std::chrono::system_clock::now());
+ga_vec3f ga_physics_world::get_body_position(uint32_t index) const
+{
+	return { _positions[0][index], _positions[1][index], _positions[2][index] };
+}
 
-#if defined(GA_PHYSICS_DEBUG_DRAW)
-				ga_dynamic_drawcall collision_draw;
-				collision_draw._positions.push_back(ga_vec3f::zero_vector());
-				collision_draw._positions.push_back(info._normal);
-				collision_draw._indices.push_back(0);
-				collision_draw._indices.push_back(1);
-				collision_draw._color = { 1.0f, 1.0f, 0.0f };
-				collision_draw._draw_mode = GL_LINES;
-				collision_draw._material = nullptr;
-				collision_draw._transform.make_translation(info._point);
+void ga_physics_world::set_body_position(uint32_t index, const ga_vec3f& position)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		_positions[a][index] = position.axes[a];
+	}
+	_transforms[index].set_translation(position);
+	_query_margin_dirty = true;
+	wake_body(index);
+}
 
-				while (params->_dynamic_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
-				params->_dynamic_drawcalls.push_back(collision_draw);
-				params->_dynamic_drawcall_lock.clear(std::memory_order_release);
-#endif
-				// We should not attempt to resolve collisions if we're paused and have not single stepped.
-				bool should_resolve = params->_delta_time > std::chrono::milliseconds(0) || params->_single_step;
+ga_vec3f ga_physics_world::get_body_velocity(uint32_t index) const
+{
+	return { _velocities[0][index], _velocities[1][index], _velocities[2][index] };
+}
 
-				if (should_resolve)
-				{
-					resolve_collision(_bodies[i], _bodies[j], &info);
-				}
-			}
-		}
+void ga_physics_world::set_body_velocity(uint32_t index, const ga_vec3f& velocity)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		_velocities[a][index] = velocity.axes[a];
 	}
+	wake_body(index);
+}
+
+ga_vec3f ga_physics_world::get_body_angular_momentum(uint32_t index) const
+{
+	return { _angular_momenta[0][index], _angular_momenta[1][index], _angular_momenta[2][index] };
 }
 
-void ga_physics_world::step_linear_dynamics(ga_frame_params* params, ga_rigid_body* body)
+void ga_physics_world::set_body_angular_momentum(uint32_t index, const ga_vec3f& momentum)
 {
-	// Linear dynamics.
-	ga_vec3f overall_force = ga_vec3f::zero_vector();
-	while (body->_forces.size() > 0)
+	for (int a = 0; a < 3; ++a)
 	{
-		overall_force += body->_forces.back();
-		body->_forces.pop_back();
+		_angular_momenta[a][index] = momentum.axes[a];
 	}
+	wake_body(index);
+}
+
+void ga_physics_world::set_body_transform(uint32_t index, const ga_mat4f& transform)
+{
+	// Components hand back the transform the body already has every frame;
+	// that must not keep it awake.
+	if (memcmp(&_transforms[index], &transform, sizeof(ga_mat4f)) == 0) return;
 
-	// Integrate using 4th order Runge-Kutta numerical integration.
-	float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
-	ga_vec3f position = body->_transform.get_translation();
-	ga_vec3f p1 = position;
-	ga_vec3f v1 = body->_velocity;
+	_transforms[index] = transform;
+	for (int a = 0; a < 3; ++a)
+	{
+		_positions[a][index] = transform.data[3][a];
+	}
+	update_inverse_inertia(index);
+	_query_margin_dirty = true;
+	wake_body(index);
+}
 
-	ga_vec3f p2 = position + v1.scale_result(0.5f * dt);
-	ga_vec3f v2 = body->_velocity + overall_force.scale_result(0.5f * dt);
+void ga_physics_world::add_body_force(uint32_t index, const ga_vec3f& force)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		_forces[a][index] += force.axes[a];
+	}
+	if (force.mag2() > 0.0f) wake_body(index);
+}
 
-	ga_vec3f p3 = position + v2.scale_result(0.5f * dt);
-	ga_vec3f v3 = body->_velocity + overall_force.scale_result(0.5f * dt);
+void ga_physics_world::add_body_torque(uint32_t index, const ga_vec3f& torque)
+{
+	for (int a = 0; a < 3; ++a)
+	{
+		_torques[a][index] += torque.axes[a];
+	}
+	if (torque.mag2() > 0.0f) wake_body(index);
+}
 
-	ga_vec3f p4 = position + v3.scale_result(0.5f * dt);
-	ga_vec3f v4 = body->_velocity + overall_force.scale_result(0.5f * dt);
+void ga_physics_world::update_inverse_inertia(uint32_t index)
+{
+	// Vectors are rows, so a body frame vector v is v * R in the world, and
+	// the world space inverse tensor is R^T * I^-1 * R.
+	ga_mat3f rotation;
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			rotation.data[i][j] = _transforms[index].data[i][j];
+		}
+	}
+	ga_mat3f rotation_transpose = rotation;
+	rotation_transpose.transpose();
 
-	ga_vec3f new_position = position + (v1 + v2.scale_result(2.0f) + v3.scale_result(2.0f) + v4).scale_result(dt / 6.0f);
-	ga_vec3f new_velocity = body->_velocity + (overall_force.scale_result(6.0f)).scale_result(dt / 6.0f);
+	_inverse_inertia_tensors[index] = rotation_transpose * _bodies[index]->_inverse_inertia_tensor * rotation;
+}
 
-	body->_velocity = new_velocity;
-	body->_transform.set_translation(new_position);
+void ga_physics_world::update_transform(uint32_t index)
+{
+	ga_quatf orientation = { _orientations[0][index], _orientations[1][index], _orientations[2][index], _orientations[3][index] };
+	_transforms[index].make_rotation(orientation);
+	_transforms[index].set_translation(get_body_position(index));
 }
 
-void ga_physics_world::step_angular_dynamics(ga_frame_params* params, ga_rigid_body* body)
+void ga_physics_world::wake_body(uint32_t index)
 {
-	// Save the translation.
-	ga_vec3f translation = body->_transform.get_translation();
+	_flags[index] &= ~k_sleeping;
+	_rest_frames[index] = 0;
 
-	// Angular dynamics.
-	ga_vec3f overall_torque = ga_vec3f::zero_vector();
-	while (body->_torques.size() > 0)
+	// Static bodies are in no island, so wake what they touch directly.
+	if (_flags[index] & k_static)
 	{
-		overall_torque += body->_torques.back();
-		body->_torques.pop_back();
+		wake_touching(index);
 	}
-	
-	float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
-	body->_angular_momentum += overall_torque.scale_result(dt);
-	ga_mat4f inertia_tensor_inv = body->_inertia_tensor;
-	inertia_tensor_inv.invert();
-	body->_angular_velocity = inertia_tensor_inv.transform_vector(body->_angular_momentum);
-	ga_quatf ang_velocity = { body->_angular_velocity.x, body->_angular_velocity.y, body->_angular_velocity.z, 0.0f };
-	body->_orientation += (ang_velocity * body->_orientation).scale_result(0.5f * dt);
-	body->_orientation.normalize();
+}
+
+void ga_physics_world::wake_touching(uint32_t index)
+{
+	_flags[index] &= ~k_sleeping;
+	_rest_frames[index] = 0;
+	for (const auto& manifold : _manifolds)
+	{
+		if (manifold._a != index && manifold._b != index) continue;
 
-	// Assemble the new transform.
-	body->_transform.make_rotation(body->_orientation);
+		uint32_t other = manifold._a == index ? manifold._b : manifold._a;
+		_flags[other] &= ~k_sleeping;
+		_rest_frames[other] = 0;
+	}
+}
 
-	// Restore the translation.
-	body->_transform.set_translation(translation);
+void ga_physics_world::set_sleeping(bool sleeping)
+{
+	_sleeping = sleeping;
+	if (!sleeping)
+	{
+		for (uint32_t i = 0; i < _bodies.size(); ++i)
+		{
+			_flags[i] &= ~k_sleeping;
+			_rest_frames[i] = 0;
+		}
+	}
 }
 
-void ga_physics_world::resolve_collision(ga_rigid_body* body_a, ga_rigid_body* body_b, ga_collision_info* info)
+void ga_physics_world::add_force_generator(ga_rigid_body* body, ga_force_generator* generator)
 {
-	//From Viper
-	/*// Calculate the velocities of A and B at the point of collision.
-	ga_vec3f r_ap = body_a->_shape->get_offset_to_point(body_a->_transform, info->_point);
-	ga_vec3f r_bp = body_b->_shape->get_offset_to_point(body_b->_transform, info->_point);
+	assert(body->_world == this);
+
+	force_registration_t registration;
+	registration._body = body;
+	registration._generator = generator;
+
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	_force_generators.push_back(registration);
+	_bodies_lock.clear(std::memory_order_release);
+}
 
-	ga_vec3f angular_velocity_a = ga_vec3f_cross(body_a->_angular_velocity, r_ap);
-	ga_vec3f angular_velocity_b = ga_vec3f_cross(body_b->_angular_velocity, r_bp);
+void ga_physics_world::remove_force_generator(ga_rigid_body* body, ga_force_generator* generator)
+{
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	_force_generators.erase(std::remove_if(_force_generators.begin(), _force_generators.end(), [body, generator](const force_registration_t& r)
+	{
+		return r._body == body && r._generator == generator;
+	}), _force_generators.end());
+	_bodies_lock.clear(std::memory_order_release);
+}
 
-	ga_vec3f velocity_a = body_a->_velocity + angular_velocity_a;
-	ga_vec3f velocity_b = body_b->_velocity + angular_velocity_b;
-	
-	// First move the objects so they no longer intersect.
-	// Each object will be moved proportionally to their incoming velocities.
-	// If an object is static, it won't be moved.
-	float total_velocity = velocity_a.mag() + velocity_b.mag();
-	float percentage_a = (body_a->_flags & k_static) ? 0.0f : velocity_a.mag() / total_velocity;
-	float percentage_b = (body_b->_flags & k_static) ? 0.0f : velocity_b.mag() / total_velocity;
+void ga_physics_world::step(ga_frame_params* params)
+{
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
 
-	if ((body_a->_flags & k_static) == 0 && velocity_a.mag2() > 0.0f)
+	if (_deterministic)
 	{
-		float pen_a = info->_penetration * percentage_a + 0.001f;
-		body_a->_transform.set_translation(body_a->_transform.get_translation() - velocity_a.normal().scale_result(pen_a));
+		// Whole ticks only, counted in clock ticks so that no rounding
+		// creeps in however the frames happen to be split.
+		_time_accumulator += params->_delta_time;
+		int64_t steps = _time_accumulator / _fixed_timestep;
+		_time_accumulator -= _fixed_timestep * steps;
+		if (steps == 0 && params->_single_step)
+		{
+			// The forced tick covers the time held back, so none of it is
+			// left to tick again once the world runs on.
+			steps = 1;
+			_time_accumulator = std::chrono::high_resolution_clock::duration::zero();
+		}
+		steps = std::min<int64_t>(steps, k_max_fixed_steps);
+
+		float dt = std::chrono::duration_cast<std::chrono::duration<float>>(_fixed_timestep).count();
+		for (int64_t i = 0; i < steps; ++i)
+		{
+			step_once(params, dt);
+		}
 	}
-	if ((body_b->_flags & k_static) == 0 && velocity_b.mag2() > 0.0f)
+	else
 	{
-		float pen_b = info->_penetration * percentage_b + 0.001f;
-		body_b->_transform.set_translation(body_b->_transform.get_translation() - velocity_b.normal().scale_result(pen_b));
+		float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
+		step_once(params, dt);
 	}
 
-	// Average the coefficients of restitution.
-	float cor_average = (body_a->_coefficient_of_restitution + body_b->_coefficient_of_restitution) / 2.0f;
-	float one_over_mass_a = 1.0f / body_a->_mass;
-	float one_over_mass_b = 1.0f / body_b->_mass;
+	_bodies_lock.clear(std::memory_order_release);
+}
+
+void ga_physics_world::set_deterministic(bool deterministic)
+{
+	_deterministic = deterministic;
+	_time_accumulator = std::chrono::high_resolution_clock::duration::zero();
+	if (deterministic)
+	{
+		_solver.set_deterministic(true);
+		_state_hash = hash_state();
+	}
+}
 
-	// Now, calculate impulse j.
-	float j = 0.0f;
-	if (body_a->_flags & k_static)
+void ga_physics_world::step_once(ga_frame_params* params, float dt)
+{
+	// Fast bodies are swept from where they start the step.
+	_fast_bodies.clear();
+	for (uint32_t i = 0; i < _bodies.size(); ++i)
 	{
-		float numerator = -velocity_b.dot(info->_normal) * (1 + cor_average);
-		float denominator = one_over_mass_b + ga_vec3f_cross(body_b->_inertia_tensor.inverse().transform_vector(ga_vec3f_cross(r_bp, info->_normal)), r_bp).dot(info->_normal);
-		j = numerator / denominator;
+		if ((_flags[i] & (k_fast | k_static | k_sleeping)) == k_fast)
+		{
+			fast_body_t fast;
+			fast._index = i;
+			fast._start = get_body_position(i);
+			_fast_bodies.push_back(fast);
+		}
 	}
-	else if (body_b->_flags & k_static)
+
+	integrate(dt);
+	_query_margin_dirty = true;
+
+	// With everything asleep nothing can have started touching.
+	if (_awake_count > 0)
 	{
-		float numerator = -velocity_a.dot(info->_normal) * (1 + cor_average);
-		float denominator = one_over_mass_a + ga_vec3f_cross(body_a->_inertia_tensor.inverse().transform_vector(ga_vec3f_cross(r_ap, info->_normal)), r_ap).dot(info->_normal);
-		j = numerator / denominator;
+		test_intersections(params, dt);
 	}
 	else
 	{
-		ga_vec3f a_ang_denom = body_a->_inertia_tensor.inverse().transform_vector(ga_vec3f_cross(r_ap, info->_normal));
-		a_ang_denom = ga_vec3f_cross(a_ang_denom, r_ap);
-		ga_vec3f b_ang_denom = body_b->_inertia_tensor.inverse().transform_vector(ga_vec3f_cross(r_bp, info->_normal));
-		b_ang_denom = ga_vec3f_cross(b_ang_denom, r_bp);
+		_pair_test_count = 0;
+		_pair_rejections = {};
+		_contact_count = 0;
+	}
+
+	if (_fixed_point_bits > 0)
+	{
+		round_positions();
+	}
+	if (_deterministic)
+	{
+		_state_hash = hash_state();
+	}
+}
+
+void ga_physics_world::integrate(float dt)
+{
+	uint32_t count = uint32_t(_bodies.size());
+
+	for (auto& registration : _force_generators)
+	{
+		registration._generator->update_force(registration._body, dt);
+	}
+
+	// Turn the accumulated force and torque into this step's acceleration and
+	// angular velocity, and clear them. Gravity is added by the integrator.
+	_awake_count = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if ((_flags[i] & (k_static | k_sleeping)) == 0)
+		{
+			++_awake_count;
+
+			float inverse_mass = _inverse_masses[i];
+			ga_vec3f momentum =
+			{
+				_angular_momenta[0][i] + _torques[0][i] * dt,
+				_angular_momenta[1][i] + _torques[1][i] * dt,
+				_angular_momenta[2][i] + _torques[2][i] * dt,
+			};
+			ga_vec3f angular_velocity = _inverse_inertia_tensors[i].transform(momentum);
+
+			for (int a = 0; a < 3; ++a)
+			{
+				_accelerations[a][i] = _forces[a][i] * inverse_mass;
+				_angular_momenta[a][i] = momentum.axes[a];
+				_angular_velocities[a][i] = angular_velocity.axes[a];
+			}
+		}
+
+		for (int a = 0; a < 3; ++a)
+		{
+			_forces[a][i] = 0.0f;
+			_torques[a][i] = 0.0f;
+		}
+	}
+
+	ga_body_arrays_t arrays;
+	for (int a = 0; a < 3; ++a)
+	{
+		arrays._position[a] = _positions[a].data();
+		arrays._velocity[a] = _velocities[a].data();
+		arrays._angular_velocity[a] = _angular_velocities[a].data();
+		arrays._acceleration[a] = _accelerations[a].data();
+	}
+	for (int a = 0; a < 4; ++a)
+	{
+		arrays._orientation[a] = _orientations[a].data();
+	}
+	arrays._flags = _flags.data();
+
+	ga_integrate_linear(_integrator, arrays, 0, count, _gravity, dt);
+	ga_integrate_orientation(arrays, 0, count, dt);
+
+	// Assemble the new transforms.
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (_flags[i] & (k_static | k_sleeping)) continue;
 
-		float denominator = one_over_mass_a + one_over_mass_b + info->_normal.dot(a_ang_denom + b_ang_denom);
-		float numerator = (1 + cor_average) * (velocity_b.dot(info->_normal) - velocity_a.dot(info->_normal));
+		update_transform(i);
 
-		j = numerator / denominator;
+		bool turned = _angular_velocities[0][i] != 0.0f || _angular_velocities[1][i] != 0.0f || _angular_velocities[2][i] != 0.0f;
+		if (turned)
+		{
+			update_inverse_inertia(i);
+		}
 	}
+}
 
-	ga_vec3f impulse = info->_normal.scale_result(j);
+void ga_physics_world::round_positions()
+{
+	assert(_fixed_point_bits < 31);
+
+	// Multiplying by a power of two is exact, so only the rounding itself
+	// changes the position.
+	float scale = float(1u << _fixed_point_bits);
+	float inverse_scale = 1.0f / scale;
+	for (uint32_t i = 0; i < _bodies.size(); ++i)
+	{
+		if (_flags[i] & (k_static | k_sleeping)) continue;
+
+		for (int a = 0; a < 3; ++a)
+		{
+			float position = std::nearbyint(_positions[a][i] * scale) * inverse_scale;
+			_positions[a][i] = position;
+			_transforms[i].data[3][a] = position;
+		}
+	}
+}
 
-	if ((body_a->_flags & k_static) == 0)
+/*
+** FNV-1a over 32-bit words, so that floats are compared bit for bit.
+*/
+static void hash_words(uint64_t& hash, const void* data, size_t count)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < count; ++i)
 	{
-		body_a->_velocity += impulse.scale_result(1.0f / body_a->_mass);
-		body_a->_angular_momentum -= body_a->_inertia_tensor.inverse().transform_vector(ga_vec3f_cross(impulse, r_ap));
+		uint32_t word;
+		memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+		hash ^= word;
+		hash *= 0x100000001b3ull;
 	}
+}
 
-	if ((body_b->_flags & k_static) == 0)
+uint64_t ga_physics_world::hash_state() const
+{
+	size_t count = _bodies.size();
+	uint64_t hash = (0xcbf29ce484222325ull ^ count) * 0x100000001b3ull;
+	for (int a = 0; a < 3; ++a) hash_words(hash, _positions[a].data(), count);
+	for (int a = 0; a < 4; ++a) hash_words(hash, _orientations[a].data(), count);
+	for (int a = 0; a < 3; ++a) hash_words(hash, _velocities[a].data(), count);
+	for (int a = 0; a < 3; ++a) hash_words(hash, _angular_momenta[a].data(), count);
+	for (int a = 0; a < 3; ++a) hash_words(hash, _angular_velocities[a].data(), count);
+	hash_words(hash, _flags.data(), count);
+	return hash;
+}
+
+void ga_physics_world::test_intersections(ga_frame_params* params, float dt)
+{
+	// Sleeping bodies have not moved since their box was last found, so
+	// only their filter is brought up to date. They count as static, so
+	// pairs of them are left out.
+	bool refresh = _boxes.size() != _bodies.size();
+	_boxes.resize(_bodies.size());
+	for (size_t i = 0; i < _bodies.size(); ++i)
 	{
-		body_b->_velocity -= impulse.scale_result(1.0f / body_b->_mass);
-		body_b->_angular_momentum += body_b->_inertia_tensor.inverse().transform_vector(ga_vec3f_cross(impulse, r_bp));
-	}*/
+		ga_broadphase_box_t& box = _boxes[i];
+		box._static = (_flags[i] & (k_static | k_sleeping)) != 0;
 
-	//From HW
-	// First move the objects so they no longer intersect.
-	// Each object will be moved proportionally to their incoming velocities.
-	// If an object is static, it won't be moved.
-	float total_velocity = body_a->_velocity.mag() + body_b->_velocity.mag();
-	float percentage_a = (body_a->_flags & k_static) ? 0.0f : body_a->_velocity.mag() / total_velocity;
-	float percentage_b = (body_b->_flags & k_static) ? 0.0f : body_b->_velocity.mag() / total_velocity;
+		ga_shape_t type = _shapes[i]->get_type();
+		box._layers = _bodies[i]->_collision_layers;
+		box._mask = _bodies[i]->_collision_mask;
+		box._shape_bit = 1u << type;
+		box._kernels = k_dispatch_table._kernels[type];
+		if (!refresh && (_flags[i] & k_sleeping)) continue;
 
-	// To avoid instability, nudge the two objects slightly farther apart.
-	const float k_nudge = 0.001f;
-	if ((body_a->_flags & k_static) == 0 && body_a->_velocity.mag2() > 0.0f)
+		_shapes[i]->get_world_aabb(_transforms[i], box._min, box._max);
+	}
+
+	if (!_broadphase)
 	{
-		float pen_a = info->_penetration * percentage_a + k_nudge;
-		body_a->_transform.set_translation(body_a->_transform.get_translation() - body_a->_velocity.normal().scale_result(pen_a));
+		// Naive N^2 comparisons.
+		_pairs.clear();
+		_pair_rejections = {};
+		for (uint32_t i = 0; i < _bodies.size(); ++i)
+		{
+			for (uint32_t j = i + 1; j < _bodies.size(); ++j)
+			{
+				if (!ga_broadphase_accept_pair(_boxes[i], _boxes[j], _pair_rejections)) continue;
+
+				ga_body_pair_t pair;
+				pair._a = i;
+				pair._b = j;
+				_pairs.push_back(pair);
+			}
+		}
 	}
-	if ((body_b->_flags & k_static) == 0 && body_b->_velocity.mag2() > 0.0f)
+	else
 	{
-		float pen_b = info->_penetration * percentage_b + k_nudge;
-		body_b->_transform.set_translation(body_b->_transform.get_translation() - body_b->_velocity.normal().scale_result(pen_b));
+		// Only bodies whose world bounds overlap reach the narrowphase.
+		// Fast bodies get a box around their whole path for the step.
+		for (const auto& fast : _fast_bodies)
+		{
+			ga_broadphase_box_t& box = _boxes[fast._index];
+			ga_vec3f back = fast._start - get_body_position(fast._index);
+			for (int a = 0; a < 3; ++a)
+			{
+				box._min.axes[a] += ga_min(back.axes[a], 0.0f);
+				box._max.axes[a] += ga_max(back.axes[a], 0.0f);
+			}
+		}
+
+		_broadphase->find_pairs(_boxes.data(), uint32_t(_boxes.size()), _pairs);
+		_pair_rejections = _broadphase->get_rejections();
 	}
 
-	// Average the coefficients of restitution.
-	float cor_average = (body_a->_coefficient_of_restitution + body_b->_coefficient_of_restitution) / 2.0f;
+	sweep_fast_bodies();
+
+	uint32_t count = uint32_t(_pairs.size());
+	_pair_test_count = count;
 
-	// TODO: Homework 5.
-	// First, calculate the impulse j from the collision of body_a and body_b.
-	// The parameter info contains the collision normal.
-	// The rigid bodies' velocities should then be updated to their new values after the impulse is applied.
+	// Narrowphase. Pairs are only read here, so they can be split across jobs,
+	// each keeping the contacts it finds to itself.
+	uint32_t batch_count = 1;
+	uint32_t batch_size = count;
+	if (_parallel_narrowphase && count >= k_min_pairs_per_job * 2)
+	{
+		batch_size = ga_max(k_min_pairs_per_job, (count + k_max_narrowphase_jobs - 1) / k_max_narrowphase_jobs);
+		batch_count = (count + batch_size - 1) / batch_size;
+	}
 
-	ga_vec3f impulse = ga_vec3f::zero_vector();
+	if (_narrowphase_batches.size() < batch_count)
+	{
+		_narrowphase_batches.resize(batch_count);
+	}
 
-	if ((body_a->_flags & k_static) == 1)
+	for (uint32_t i = 0; i < batch_count; ++i)
 	{
-		ga_vec3f v = body_b->_velocity - (info->_normal.scale_result(body_b->_velocity.dot(info->_normal) * (body_b->_coefficient_of_restitution + 1.0f)));
-		body_b->_velocity = v;
+		_narrowphase_batches[i]._world = this;
+		_narrowphase_batches[i]._begin = i * batch_size;
+		_narrowphase_batches[i]._end = ga_min(count, (i + 1) * batch_size);
+		_narrowphase_batches[i]._contacts.clear();
+		_narrowphase_batches[i]._gjk_directions.clear();
 	}
-	else if ((body_b->_flags & k_static) == 1)
+
+	if (batch_count == 1)
 	{
-		ga_vec3f v = body_a->_velocity - (info->_normal.scale_result(body_a->_velocity.dot(info->_normal) * (body_a->_coefficient_of_restitution + 1.0f)));
-		body_a->_velocity = v;
+		test_pair_range(0, count, _narrowphase_batches[0]._contacts, _narrowphase_batches[0]._gjk_directions);
 	}
 	else
 	{
-		float pa = body_a->_velocity.dot(info->_normal) * (cor_average + 1.0f);
-		float pb = body_b->_velocity.dot(info->_normal) * (cor_average + 1.0f);
-		float pm = (1.0f / body_a->_mass) + (1.0f / body_b->_mass);
-		float pHat = (pa - pb) / pm;
+		_narrowphase_decls.resize(batch_count);
+		for (uint32_t i = 0; i < batch_count; ++i)
+		{
+			_narrowphase_decls[i]._data = &_narrowphase_batches[i];
+			_narrowphase_decls[i]._entry = [](void* data)
+			{
+				auto batch = static_cast<narrowphase_batch_t*>(data);
+				batch->_world->test_pair_range(batch->_begin, batch->_end, batch->_contacts, batch->_gjk_directions);
+			};
+		}
+
+		int32_t narrowphase_counter;
+		ga_job::run(_narrowphase_decls.data(), int(batch_count), &narrowphase_counter);
+		ga_job::wait(&narrowphase_counter);
+	}
+
+	// Pairs come out of the broadphase in no particular order, so sort what
+	// the batches found for next step's lookups.
+	_next_gjk_directions.clear();
+	for (uint32_t i = 0; i < batch_count; ++i)
+	{
+		const auto& directions = _narrowphase_batches[i]._gjk_directions;
+		_next_gjk_directions.insert(_next_gjk_directions.end(), directions.begin(), directions.end());
+	}
+	std::sort(_next_gjk_directions.begin(), _next_gjk_directions.end());
+	_gjk_directions.swap(_next_gjk_directions);
 
-		ga_vec3f va = body_a->_velocity + info->_normal.scale_result(pHat / body_a->_mass);
-		ga_vec3f vb = body_b->_velocity - info->_normal.scale_result(pHat / body_b->_mass);
+	resolve_contacts(params, batch_count, dt);
+}
 
-		body_a->_velocity = -va;
-		body_b->_velocity = vb;
+/*
+** How thin a shape is at its thinnest, for spacing the poses a sweep tests.
+*/
+static float get_shape_thickness(const ga_shape* shape, const ga_mat4f& transform)
+{
+	if (shape->get_type() == k_shape_sphere)
+	{
+		return 2.0f * reinterpret_cast<const ga_sphere*>(shape)->_radius;
+	}
+	if (shape->get_type() == k_shape_oobb)
+	{
+		const ga_oobb* oobb = reinterpret_cast<const ga_oobb*>(shape);
+		float thinnest = ga_min(oobb->_half_vectors[0].mag(), ga_min(oobb->_half_vectors[1].mag(), oobb->_half_vectors[2].mag()));
+		return 2.0f * thinnest;
+	}
+
+	ga_vec3f min, max;
+	shape->get_world_aabb(transform, min, max);
+	return ga_min(max.x - min.x, ga_min(max.y - min.y, max.z - min.z));
+}
+
+void ga_physics_world::sweep_fast_bodies()
+{
+	if (_fast_bodies.empty()) return;
+
+	_sweep_candidates.clear();
+	for (const auto& pair : _pairs)
+	{
+		if ((_flags[pair._a] & (k_fast | k_static)) == k_fast)
+		{
+			_sweep_candidates.push_back(pair);
+		}
+		if ((_flags[pair._b] & (k_fast | k_static)) == k_fast)
+		{
+			ga_body_pair_t swapped;
+			swapped._a = pair._b;
+			swapped._b = pair._a;
+			_sweep_candidates.push_back(swapped);
+		}
+	}
+	std::sort(_sweep_candidates.begin(), _sweep_candidates.end(), [](const ga_body_pair_t& x, const ga_body_pair_t& y)
+	{
+		return x._a < y._a || (x._a == y._a && x._b < y._b);
+	});
+
+	auto candidate = _sweep_candidates.begin();
+	for (const auto& fast : _fast_bodies)
+	{
+		uint32_t index = fast._index;
+		while (candidate != _sweep_candidates.end() && candidate->_a < index) ++candidate;
+		auto first = candidate;
+		while (candidate != _sweep_candidates.end() && candidate->_a == index) ++candidate;
+		if (first == candidate) continue;
+
+		// Others are taken to be where they end the step; only the fast
+		// body's own path is swept.
+		ga_vec3f start = fast._start;
+		ga_vec3f end = get_body_position(index);
+		if ((end - start).mag2() == 0.0f) continue;
+
+		float earliest = 1.0f;
+		bool hit = false;
+		for (auto it = first; it != candidate; ++it)
+		{
+			float time;
+			if (find_time_of_impact(index, start, end, it->_b, time) && time < earliest)
+			{
+				earliest = time;
+				hit = true;
+			}
+		}
+
+		// Stop where it first touched. The pair is then found touching like
+		// any other, and the solver bounces it off with friction and spin.
+		// The rest of the step's motion is given up.
+		if (hit)
+		{
+			set_body_position(index, start + (end - start).scale_result(earliest));
+		}
+	}
+}
+
+bool ga_physics_world::find_time_of_impact(uint32_t index, const ga_vec3f& start, const ga_vec3f& end, uint32_t other, float& time) const
+{
+	const ga_shape* shape = _shapes[index];
+	const ga_shape* other_shape = _shapes[other];
+	intersection_func_t func = k_dispatch_table._funcs[shape->get_type()][other_shape->get_type()];
+
+	ga_mat4f transform = _transforms[index];
+	transform.set_translation(start);
+
+	// Touching from the start is left to the discrete test.
+	ga_collision_info ignored;
+	if (func(shape, transform, other_shape, _transforms[other], &ignored)) return false;
+
+	// Test poses close enough together that neither shape fits between two
+	// of them, then narrow down between the last miss and the first hit.
+	ga_vec3f motion = end - start;
+	float spacing = 0.5f * ga_min(get_shape_thickness(shape, transform), get_shape_thickness(other_shape, _transforms[other]));
+	float sample_count = spacing > 0.0f ? ceilf(motion.mag() / spacing) : float(k_max_sweep_samples);
+	uint32_t samples = uint32_t(ga_max(1.0f, ga_min(sample_count, float(k_max_sweep_samples))));
+
+	float before = 0.0f;
+	for (uint32_t s = 1; s <= samples; ++s)
+	{
+		float after = float(s) / samples;
+		transform.set_translation(start + motion.scale_result(after));
+		if (!func(shape, transform, other_shape, _transforms[other], &ignored))
+		{
+			before = after;
+			continue;
+		}
+
+		for (uint32_t i = 0; i < k_time_of_impact_iterations; ++i)
+		{
+			float middle = 0.5f * (before + after);
+			transform.set_translation(start + motion.scale_result(middle));
+			if (func(shape, transform, other_shape, _transforms[other], &ignored)) after = middle;
+			else before = middle;
+		}
+
+		time = after;
+		return true;
+	}
+	return false;
+}
+
+void ga_physics_world::test_pair_range(uint32_t begin, uint32_t end, std::vector<contact_t>& contacts, std::vector<gjk_direction_t>& gjk_directions) const
+{
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		uint32_t a = _pairs[i]._a;
+		uint32_t b = _pairs[i]._b;
+		const ga_shape* shape_a = _shapes[a];
+		const ga_shape* shape_b = _shapes[b];
+
+		contact_t contact;
+		bool touching;
+		if (shape_a->get_type() == k_shape_convex_hull && shape_b->get_type() == k_shape_convex_hull)
+		{
+			// Start GJK where it ended for this pair last step, if it was tested.
+			gjk_direction_t cached;
+			cached._key = (uint64_t(a) << 32) | b;
+			auto it = std::lower_bound(_gjk_directions.begin(), _gjk_directions.end(), cached);
+			if (it != _gjk_directions.end() && it->_key == cached._key)
+			{
+				cached._direction = it->_direction;
+			}
+			else
+			{
+				cached._direction = _transforms[b].get_translation() - _transforms[a].get_translation();
+			}
+
+			touching = gjk(shape_a, _transforms[a], shape_b, _transforms[b], &contact._info, cached._direction);
+			gjk_directions.push_back(cached);
+		}
+		else
+		{
+			intersection_func_t func = k_dispatch_table._funcs[shape_a->get_type()][shape_b->get_type()];
+			touching = func(shape_a, _transforms[a], shape_b, _transforms[b], &contact._info);
+		}
+
+		if (touching)
+		{
+			contact._pair = i;
+			contacts.push_back(contact);
+		}
+	}
+}
+
+void ga_physics_world::resolve_contacts(ga_frame_params* params, uint32_t batch_count, float dt)
+{
+	// Batches hold their contacts in pair order and cover the pairs in order,
+	// so walking them one after the other resolves in the same order however
+	// the jobs were scheduled.
+	_contact_count = 0;
+	for (uint32_t i = 0; i < batch_count; ++i)
+	{
+		_contact_count += uint32_t(_narrowphase_batches[i]._contacts.size());
+	}
+
+#if defined(GA_PHYSICS_DEBUG_DRAW)
+	if (_contact_count > 0)
+	{
+		while (params->_dynamic_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
+		for (uint32_t i = 0; i < batch_count; ++i)
+		{
+			for (const auto& contact : _narrowphase_batches[i]._contacts)
+			{
+				ga_dynamic_drawcall collision_draw;
+				collision_draw._positions.push_back(ga_vec3f::zero_vector());
+				collision_draw._positions.push_back(contact._info._normal);
+				collision_draw._indices.push_back(0);
+				collision_draw._indices.push_back(1);
+				collision_draw._color = { 1.0f, 1.0f, 0.0f };
+				collision_draw._draw_mode = GL_LINES;
+				collision_draw._material = nullptr;
+				collision_draw._transform.make_translation(contact._info._point);
+				params->_dynamic_drawcalls.push_back(collision_draw);
+			}
+		}
+		params->_dynamic_drawcall_lock.clear(std::memory_order_release);
+	}
+#endif
+
+	// We should not attempt to resolve collisions if we're paused and have not single stepped.
+	bool should_resolve = dt > 0.0f || params->_single_step;
+	if (!should_resolve) return;
+
+	// Carry each touching pair's points over from last step and add what
+	// the narrowphase found. Pairs come in no particular order, so the new
+	// manifolds are sorted once they are all built.
+	_next_manifolds.clear();
+	for (uint32_t i = 0; i < batch_count; ++i)
+	{
+		for (const auto& contact : _narrowphase_batches[i]._contacts)
+		{
+			const ga_body_pair_t& pair = _pairs[contact._pair];
+			uint32_t a = ga_min(pair._a, pair._b);
+			uint32_t b = ga_max(pair._a, pair._b);
+
+			// Not every test says which way its normal faces; point it from a to b.
+			ga_vec3f normal = contact._info._normal;
+			if (normal.dot(get_body_position(b) - get_body_position(a)) < 0.0f)
+			{
+				normal = -normal;
+			}
+
+			ga_contact_manifold_t manifold;
+			auto it = std::lower_bound(_manifolds.begin(), _manifolds.end(), manifold_key(a, b), [](const ga_contact_manifold_t& m, uint64_t key)
+			{
+				return manifold_key(m._a, m._b) < key;
+			});
+			if (it != _manifolds.end() && it->_a == a && it->_b == b)
+			{
+				manifold = *it;
+			}
+			else
+			{
+				manifold._a = a;
+				manifold._b = b;
+				manifold._normal = normal;
+				manifold._restitution = 0.5f * (_bodies[a]->_coefficient_of_restitution + _bodies[b]->_coefficient_of_restitution);
+				manifold._friction = sqrtf(_bodies[a]->_coefficient_of_friction * _bodies[b]->_coefficient_of_friction);
+				manifold._point_count = 0;
+			}
+
+			ga_update_contact_manifold(manifold, _transforms[a], _transforms[b], normal, contact._info);
+			_next_manifolds.push_back(manifold);
+		}
+	}
+
+	// Pairs left asleep were not tested; they touch just as they did.
+	for (const auto& manifold : _manifolds)
+	{
+		if ((_flags[manifold._a] & (k_static | k_sleeping)) != 0 && (_flags[manifold._b] & (k_static | k_sleeping)) != 0)
+		{
+			_next_manifolds.push_back(manifold);
+		}
+	}
+	std::sort(_next_manifolds.begin(), _next_manifolds.end(), [](const ga_contact_manifold_t& x, const ga_contact_manifold_t& y)
+	{
+		return manifold_key(x._a, x._b) < manifold_key(y._a, y._b);
+	});
+	_manifolds.swap(_next_manifolds);
+
+	// Anything touching an awake body is woken before it is solved.
+	build_islands();
+
+	ga_solver_bodies_t bodies;
+	for (int a = 0; a < 3; ++a)
+	{
+		bodies._velocity[a] = _velocities[a].data();
+		bodies._angular_momentum[a] = _angular_momenta[a].data();
+		bodies._position[a] = _positions[a].data();
+	}
+	for (int a = 0; a < 4; ++a)
+	{
+		bodies._orientation[a] = _orientations[a].data();
+	}
+	bodies._inverse_mass = _inverse_masses.data();
+	bodies._inverse_inertia = _inverse_inertia_tensors.data();
+	bodies._flags = _flags.data();
+
+	_solver.solve(_manifolds.data(), uint32_t(_manifolds.size()), bodies, uint32_t(_bodies.size()), dt);
+
+	// The solver moves bodies out of each other; bring their transforms along.
+	for (const auto& manifold : _manifolds)
+	{
+		uint32_t pair[] = { manifold._a, manifold._b };
+		for (uint32_t index : pair)
+		{
+			if (_flags[index] & (k_static | k_sleeping)) continue;
+
+			update_transform(index);
+			update_inverse_inertia(index);
+		}
+	}
+
+	sleep_islands();
+}
+
+uint32_t ga_physics_world::find_island(uint32_t index)
+{
+	while (_island_parents[index] != index)
+	{
+		_island_parents[index] = _island_parents[_island_parents[index]];
+		index = _island_parents[index];
+	}
+	return index;
+}
+
+void ga_physics_world::build_islands()
+{
+	if (!_sleeping) return;
+
+	uint32_t count = uint32_t(_bodies.size());
+	_island_parents.resize(count);
+	_island_awake.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		_island_parents[i] = i;
+		_island_awake[i] = 0;
+	}
+
+	// Static bodies join nothing; a whole floor of boxes is not one island.
+	// Roots are always the lowest index, so islands come out the same
+	// whatever order the manifolds are in.
+	for (const auto& manifold : _manifolds)
+	{
+		if ((_flags[manifold._a] | _flags[manifold._b]) & k_static) continue;
+
+		uint32_t root_a = find_island(manifold._a);
+		uint32_t root_b = find_island(manifold._b);
+		if (root_a < root_b) _island_parents[root_b] = root_a;
+		else if (root_b < root_a) _island_parents[root_a] = root_b;
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if ((_flags[i] & (k_static | k_sleeping)) == 0)
+		{
+			_island_awake[find_island(i)] = 1;
+		}
+	}
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if ((_flags[i] & k_sleeping) && _island_awake[find_island(i)])
+		{
+			_flags[i] &= ~k_sleeping;
+			_rest_frames[i] = 0;
+		}
+	}
+}
+
+void ga_physics_world::sleep_islands()
+{
+	if (!_sleeping) return;
+
+	// Count how long each awake body has been still, and keep the shortest
+	// for each island.
+	uint32_t count = uint32_t(_bodies.size());
+	_island_rest_frames.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		_island_rest_frames[i] = k_sleep_frames;
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (_flags[i] & (k_static | k_sleeping)) continue;
+
+		ga_vec3f angular_velocity = _inverse_inertia_tensors[i].transform(get_body_angular_momentum(i));
+		bool resting =
+			get_body_velocity(i).mag2() < k_sleep_linear_speed * k_sleep_linear_speed &&
+			angular_velocity.mag2() < k_sleep_angular_speed * k_sleep_angular_speed;
+		_rest_frames[i] = resting ? ga_min(_rest_frames[i] + 1, k_sleep_frames) : 0;
+
+		uint32_t root = find_island(i);
+		_island_rest_frames[root] = ga_min(_island_rest_frames[root], _rest_frames[i]);
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (_flags[i] & (k_static | k_sleeping)) continue;
+		if (_island_rest_frames[find_island(i)] < k_sleep_frames) continue;
+
+		_flags[i] |= k_sleeping;
+		for (int a = 0; a < 3; ++a)
+		{
+			_velocities[a][i] = 0.0f;
+			_angular_momenta[a][i] = 0.0f;
+			_angular_velocities[a][i] = 0.0f;
+		}
+
+		// Its box is not looked at again until it wakes.
+		if (i < _boxes.size())
+		{
+			_shapes[i]->get_world_aabb(_transforms[i], _boxes[i]._min, _boxes[i]._max);
+			_boxes[i]._static = true;
+		}
+	}
+}
+
+bool ga_physics_world::raycast(const ga_raycast_t& ray, ga_raycast_hit_t& hit, uint32_t ignore_flags)
+{
+	update_query_margin();
+	cast_ray_packet(&ray, 1, &hit, ignore_flags);
+	return hit._body != nullptr;
+}
+
+uint32_t ga_physics_world::overlap_sphere(const ga_vec3f& center, float radius, ga_rigid_body** bodies, uint32_t capacity, uint32_t ignore_flags)
+{
+	update_query_margin();
+	return find_sphere_overlaps(center, radius, bodies, capacity, ignore_flags, _query_scratch);
+}
+
+uint32_t ga_physics_world::overlap_box(const ga_mat4f& transform, const ga_vec3f& half_extents, ga_rigid_body** bodies, uint32_t capacity, uint32_t ignore_flags)
+{
+	update_query_margin();
+	return find_box_overlaps(transform, half_extents, bodies, capacity, ignore_flags, _query_scratch);
+}
+
+uint32_t ga_physics_world::find_nearest(const ga_vec3f& point, uint32_t k, ga_rigid_body** bodies, float* distances, uint32_t ignore_flags)
+{
+	update_query_margin();
+	return find_nearest_bodies(point, k, bodies, distances, ignore_flags, _query_scratch);
+}
+
+void ga_physics_world::raycast_batch(const ga_raycast_t* rays, uint32_t count, ga_raycast_hit_t* hits, uint32_t ignore_flags)
+{
+	query_request_t request = {};
+	request._rays = rays;
+	request._hits = hits;
+	request._ignore_flags = ignore_flags;
+	request._run = [](const ga_physics_world* world, const query_request_t& request, uint32_t begin, uint32_t end, query_scratch_t&)
+	{
+		for (uint32_t i = begin; i < end; i += k_ray_packet_width)
+		{
+			uint32_t packet_count = ga_min(k_ray_packet_width, end - i);
+			world->cast_ray_packet(request._rays + i, packet_count, request._hits + i, request._ignore_flags);
+		}
+	};
+	run_queries(request, count, k_ray_packet_width);
+}
+
+void ga_physics_world::overlap_sphere_batch(const ga_sphere_query_t* queries, uint32_t count, ga_rigid_body** bodies, uint32_t capacity, uint32_t* counts, uint32_t ignore_flags)
+{
+	query_request_t request = {};
+	request._spheres = queries;
+	request._bodies = bodies;
+	request._counts = counts;
+	request._capacity = capacity;
+	request._ignore_flags = ignore_flags;
+	request._run = [](const ga_physics_world* world, const query_request_t& request, uint32_t begin, uint32_t end, query_scratch_t& scratch)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const ga_sphere_query_t& query = request._spheres[i];
+			ga_rigid_body** bodies = request._bodies + size_t(i) * request._capacity;
+			request._counts[i] = world->find_sphere_overlaps(query._center, query._radius, bodies, request._capacity, request._ignore_flags, scratch);
+		}
+	};
+	run_queries(request, count, 1);
+}
+
+void ga_physics_world::overlap_box_batch(const ga_box_query_t* queries, uint32_t count, ga_rigid_body** bodies, uint32_t capacity, uint32_t* counts, uint32_t ignore_flags)
+{
+	query_request_t request = {};
+	request._boxes = queries;
+	request._bodies = bodies;
+	request._counts = counts;
+	request._capacity = capacity;
+	request._ignore_flags = ignore_flags;
+	request._run = [](const ga_physics_world* world, const query_request_t& request, uint32_t begin, uint32_t end, query_scratch_t& scratch)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const ga_box_query_t& query = request._boxes[i];
+			ga_rigid_body** bodies = request._bodies + size_t(i) * request._capacity;
+			request._counts[i] = world->find_box_overlaps(query._transform, query._half_extents, bodies, request._capacity, request._ignore_flags, scratch);
+		}
+	};
+	run_queries(request, count, 1);
+}
+
+void ga_physics_world::find_nearest_batch(const ga_vec3f* points, uint32_t count, uint32_t k, ga_rigid_body** bodies, float* distances, uint32_t* counts, uint32_t ignore_flags)
+{
+	query_request_t request = {};
+	request._points = points;
+	request._bodies = bodies;
+	request._distances = distances;
+	request._counts = counts;
+	request._capacity = k;
+	request._ignore_flags = ignore_flags;
+	request._run = [](const ga_physics_world* world, const query_request_t& request, uint32_t begin, uint32_t end, query_scratch_t& scratch)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			size_t offset = size_t(i) * request._capacity;
+			float* distances = request._distances ? request._distances + offset : nullptr;
+			request._counts[i] = world->find_nearest_bodies(request._points[i], request._capacity, request._bodies + offset, distances, request._ignore_flags, scratch);
+		}
+	};
+	run_queries(request, count, 1);
+}
+
+void ga_physics_world::update_query_margin()
+{
+	if (!_query_margin_dirty) return;
+	_query_margin_dirty = false;
+
+	// Bodies move after their boxes are taken, as contacts push them apart
+	// or gameplay places them. Queries grow by the furthest any has gone,
+	// short of those moved far, which are set aside.
+	_query_margin = 0.0f;
+	_query_moved.clear();
+	if (!_broadphase || _boxes.size() != _bodies.size()) return;
+
+	for (uint32_t i = 0; i < _bodies.size(); ++i)
+	{
+		if (_flags[i] & k_sleeping) continue;
+
+		ga_vec3f min, max;
+		_shapes[i]->get_world_aabb(_transforms[i], min, max);
+		float outside = 0.0f;
+		for (int a = 0; a < 3; ++a)
+		{
+			outside = ga_max(outside, ga_max(_boxes[i]._min.axes[a] - min.axes[a], max.axes[a] - _boxes[i]._max.axes[a]));
+		}
+
+		if (outside > k_max_query_margin)
+		{
+			_query_moved.push_back(i);
+		}
+		else
+		{
+			_query_margin = ga_max(_query_margin, outside);
+		}
+	}
+}
+
+void ga_physics_world::run_queries(const query_request_t& request, uint32_t count, uint32_t granularity)
+{
+	update_query_margin();
+
+	// Batches are cut on whole packets, so only the last one is partly empty.
+	uint32_t batch_count = 1;
+	uint32_t batch_size = count;
+	if (_parallel_queries && count >= k_min_queries_per_job * 2)
+	{
+		batch_size = ga_max(k_min_queries_per_job, (count + k_max_query_jobs - 1) / k_max_query_jobs);
+		batch_size = (batch_size + granularity - 1) / granularity * granularity;
+		batch_count = (count + batch_size - 1) / batch_size;
+	}
+
+	if (batch_count == 1)
+	{
+		request._run(this, request, 0, count, _query_scratch);
+		return;
+	}
+
+	if (_query_batches.size() < batch_count)
+	{
+		_query_batches.resize(batch_count);
+	}
+	_query_decls.resize(batch_count);
+	for (uint32_t i = 0; i < batch_count; ++i)
+	{
+		query_batch_t& batch = _query_batches[i];
+		batch._world = this;
+		batch._request = &request;
+		batch._begin = i * batch_size;
+		batch._end = ga_min(count, (i + 1) * batch_size);
+
+		_query_decls[i]._data = &batch;
+		_query_decls[i]._entry = [](void* data)
+		{
+			auto batch = static_cast<query_batch_t*>(data);
+			batch->_request->_run(batch->_world, *batch->_request, batch->_begin, batch->_end, batch->_scratch);
+		};
+	}
+
+	int32_t query_counter;
+	ga_job::run(_query_decls.data(), int(batch_count), &query_counter);
+	ga_job::wait(&query_counter);
+}
+
+void ga_physics_world::find_query_candidates(const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const
+{
+	if (_broadphase && _boxes.size() == _bodies.size())
+	{
+		size_t first = bodies.size();
+		ga_vec3f grow = { _query_margin, _query_margin, _query_margin };
+		_broadphase->query_box(_boxes.data(), uint32_t(_boxes.size()), min - grow, max + grow, bodies);
+		if (_query_moved.empty()) return;
+
+		// Bodies moved far are looked at where they are now.
+		bodies.erase(std::remove_if(bodies.begin() + first, bodies.end(), [this](uint32_t i)
+		{
+			return std::binary_search(_query_moved.begin(), _query_moved.end(), i);
+		}), bodies.end());
+		for (uint32_t i : _query_moved)
+		{
+			if (body_overlaps(i, min, max)) bodies.push_back(i);
+		}
+		return;
+	}
+
+	// No broadphase, or none since bodies came or went; look at everything.
+	for (uint32_t i = 0; i < _bodies.size(); ++i)
+	{
+		if (body_overlaps(i, min, max)) bodies.push_back(i);
+	}
+}
+
+bool ga_physics_world::body_overlaps(uint32_t index, const ga_vec3f& min, const ga_vec3f& max) const
+{
+	ga_vec3f body_min, body_max;
+	_shapes[index]->get_world_aabb(_transforms[index], body_min, body_max);
+	for (int a = 0; a < 3; ++a)
+	{
+		if (body_min.axes[a] > max.axes[a] || min.axes[a] > body_max.axes[a]) return false;
+	}
+	return true;
+}
+
+/*
+** Tests the bodies the broadphase finds along a packet of rays, keeping the
+** nearest hit on each and cutting the ray short there.
+*/
+struct ga_physics_world::ray_packet_visitor_t final : ga_ray_visitor
+{
+	const ga_physics_world* _world;
+	const ga_raycast_t* _rays;
+	const ga_vec3f* _directions;
+	ga_raycast_hit_t* _hits;
+	uint32_t _nearest[k_ray_packet_width];
+	uint32_t _ignore_flags;
+	bool _skip_moved;
+
+	virtual void visit(uint32_t body, uint32_t lanes, ga_ray_packet_t& packet) override
+	{
+		const ga_physics_world* world = _world;
+		if (world->_flags[body] & _ignore_flags) return;
+
+		// Bodies moved far are tested separately, where they are now.
+		if (_skip_moved && std::binary_search(world->_query_moved.begin(), world->_query_moved.end(), body)) return;
+
+		for (uint32_t lane = 0; lane < k_ray_packet_width; ++lane)
+		{
+			if (!(lanes & (1u << lane))) continue;
+
+			// Ties go to the body added first, whatever order bodies come in.
+			float distance;
+			ga_vec3f normal;
+			if (!ray_vs_shape(world->_shapes[body], world->_transforms[body], _rays[lane]._origin, _directions[lane], packet._length[lane], distance, normal)) continue;
+			if (_hits[lane]._body && distance == packet._length[lane] && body > _nearest[lane]) continue;
+
+			_nearest[lane] = body;
+			_hits[lane]._body = world->_bodies[body];
+			_hits[lane]._normal = normal;
+			_hits[lane]._distance = distance;
+			packet._length[lane] = distance;
+		}
+	}
+};
+
+void ga_physics_world::cast_ray_packet(const ga_raycast_t* rays, uint32_t count, ga_raycast_hit_t* hits, uint32_t ignore_flags) const
+{
+	ga_ray_packet_t packet;
+	ga_vec3f directions[k_ray_packet_width];
+	uint32_t all_lanes = 0;
+	for (uint32_t lane = 0; lane < k_ray_packet_width; ++lane)
+	{
+		float length = -1.0f;
+		ga_vec3f origin = ga_vec3f::zero_vector();
+		directions[lane] = ga_vec3f::zero_vector();
+		if (lane < count)
+		{
+			float direction_length = rays[lane]._direction.mag();
+			if (direction_length > 0.0f && rays[lane]._max_distance >= 0.0f)
+			{
+				length = rays[lane]._max_distance;
+				origin = rays[lane]._origin;
+				directions[lane] = rays[lane]._direction.scale_result(1.0f / direction_length);
+				all_lanes |= 1u << lane;
+			}
+
+			hits[lane]._body = nullptr;
+			hits[lane]._distance = rays[lane]._max_distance;
+		}
+
+		// Rays along an axis divide by zero to an infinity, which the slab
+		// test copes with.
+		for (int a = 0; a < 3; ++a)
+		{
+			packet._origin[a][lane] = origin.axes[a];
+			packet._inverse_direction[a][lane] = 1.0f / directions[lane].axes[a];
+		}
+		packet._length[lane] = length;
+	}
+	if (!all_lanes) return;
+
+	ray_packet_visitor_t visitor;
+	visitor._world = this;
+	visitor._rays = rays;
+	visitor._directions = directions;
+	visitor._hits = hits;
+	visitor._ignore_flags = ignore_flags;
+	visitor._skip_moved = false;
+
+	if (_broadphase && _boxes.size() == _bodies.size())
+	{
+		visitor._skip_moved = !_query_moved.empty();
+		_broadphase->query_rays(_boxes.data(), uint32_t(_boxes.size()), packet, _query_margin, visitor);
+		visitor._skip_moved = false;
+		for (uint32_t i : _query_moved)
+		{
+			visitor.visit(i, all_lanes, packet);
+		}
+	}
+	else
+	{
+		for (uint32_t i = 0; i < _bodies.size(); ++i)
+		{
+			visitor.visit(i, all_lanes, packet);
+		}
+	}
+
+	for (uint32_t lane = 0; lane < count; ++lane)
+	{
+		if (hits[lane]._body)
+		{
+			hits[lane]._point = rays[lane]._origin + directions[lane].scale_result(hits[lane]._distance);
+		}
+	}
+}
+
+uint32_t ga_physics_world::find_sphere_overlaps(const ga_vec3f& center, float radius, ga_rigid_body** bodies, uint32_t capacity, uint32_t ignore_flags, query_scratch_t& scratch) const
+{
+	ga_vec3f reach = { radius, radius, radius };
+	scratch._bodies.clear();
+	find_query_candidates(center - reach, center + reach, scratch._bodies);
+	scratch._bodies.erase(std::remove_if(scratch._bodies.begin(), scratch._bodies.end(), [&](uint32_t i)
+	{
+		return (_flags[i] & ignore_flags) != 0 || distance_to_shape(_shapes[i], _transforms[i], center) > radius;
+	}), scratch._bodies.end());
+	return write_query_bodies(scratch, bodies, capacity);
+}
+
+uint32_t ga_physics_world::find_box_overlaps(const ga_mat4f& transform, const ga_vec3f& half_extents, ga_rigid_body** bodies, uint32_t capacity, uint32_t ignore_flags, query_scratch_t& scratch) const
+{
+	// World bounds of the box, from how far each turned axis reaches.
+	ga_vec3f center = transform.get_translation();
+	ga_vec3f reach = ga_vec3f::zero_vector();
+	for (int i = 0; i < 3; ++i)
+	{
+		ga_vec3f half_vector = ga_vec3f::zero_vector();
+		half_vector.axes[i] = half_extents.axes[i];
+		half_vector = transform.transform_vector(half_vector);
+		for (int a = 0; a < 3; ++a)
+		{
+			reach.axes[a] += ga_absf(half_vector.axes[a]);
+		}
+	}
+
+	scratch._bodies.clear();
+	find_query_candidates(center - reach, center + reach, scratch._bodies);
+	scratch._bodies.erase(std::remove_if(scratch._bodies.begin(), scratch._bodies.end(), [&](uint32_t i)
+	{
+		return (_flags[i] & ignore_flags) != 0 || !box_vs_shape(transform, half_extents, _shapes[i], _transforms[i]);
+	}), scratch._bodies.end());
+	return write_query_bodies(scratch, bodies, capacity);
+}
+
+uint32_t ga_physics_world::find_nearest_bodies(const ga_vec3f& point, uint32_t k, ga_rigid_body** bodies, float* distances, uint32_t ignore_flags, query_scratch_t& scratch) const
+{
+	if (k == 0 || _bodies.empty()) return 0;
+
+	// Search a growing box around the point. Anything outside the box is
+	// further than its half size, so once k bodies lie within that distance,
+	// or the box takes in every body, the nearest are among those found.
+	float radius = k_nearest_start_radius;
+	for (;;)
+	{
+		ga_vec3f reach = { radius, radius, radius };
+		scratch._bodies.clear();
+		find_query_candidates(point - reach, point + reach, scratch._bodies);
+
+		uint32_t within = 0;
+		scratch._nearest.clear();
+		for (uint32_t i : scratch._bodies)
+		{
+			if (_flags[i] & ignore_flags) continue;
+
+			float distance = distance_to_shape(_shapes[i], _transforms[i], point);
+			scratch._nearest.push_back(std::make_pair(distance, i));
+			if (distance <= radius) within++;
+		}
+
+		if (within >= k || scratch._bodies.size() == _bodies.size()) break;
+		radius *= 2.0f;
+	}
+
+	// Nearest first, ties to the body added first.
+	uint32_t found = ga_min(k, uint32_t(scratch._nearest.size()));
+	std::partial_sort(scratch._nearest.begin(), scratch._nearest.begin() + found, scratch._nearest.end());
+	for (uint32_t n = 0; n < found; ++n)
+	{
+		bodies[n] = _bodies[scratch._nearest[n].second];
+		if (distances) distances[n] = scratch._nearest[n].first;
+	}
+	return found;
+}
+
+uint32_t ga_physics_world::write_query_bodies(query_scratch_t& scratch, ga_rigid_body** bodies, uint32_t capacity) const
+{
+	std::sort(scratch._bodies.begin(), scratch._bodies.end());
+	uint32_t written = ga_min(capacity, uint32_t(scratch._bodies.size()));
+	for (uint32_t n = 0; n < written; ++n)
+	{
+		bodies[n] = _bodies[scratch._bodies[n]];
 	}
+	return uint32_t(scratch._bodies.size());
 }
@@ -9,14 +9,26 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 
+#include "ga_broadphase.h"
+#include "ga_contact_solver.h"
+#include "ga_integrator.h"
+#include "ga_intersection.h"
+#include "ga_scene_query.h"
+
+#include "jobs/ga_job.h"
+#include "math/ga_mat3f.h"
+#include "math/ga_mat4f.h"
 #include "math/ga_vec3f.h"
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 #define GA_PHYSICS_DEBUG_DRAW 1
 
-struct ga_collision_info;
+class ga_force_generator;
 class ga_rigid_body;
 struct ga_frame_params;
 
@@ -33,18 +45,411 @@ public:
 	void add_rigid_body(ga_rigid_body* body);
 	void remove_rigid_body(ga_rigid_body* body);
 
+	/*
+	** Add or remove many bodies at once, taking the lock once.
+	*/
+	void add_rigid_bodies(ga_rigid_body* const* bodies, uint32_t count);
+	void remove_rigid_bodies(ga_rigid_body* const* bodies, uint32_t count);
+
 	void step(ga_frame_params* params);
 
+	/*
+	** Have a generator add its force to a body every step. The world does not
+	** own the generator. Registrations are dropped when the body is removed.
+	*/
+	void add_force_generator(ga_rigid_body* body, ga_force_generator* generator);
+	void remove_force_generator(ga_rigid_body* body, ga_force_generator* generator);
+
+	/*
+	** Choose how pairs of bodies are found. Must not be called while stepping.
+	*/
+	void set_broadphase(ga_broadphase_type_t type);
+	ga_broadphase_type_t get_broadphase() const { return _broadphase_type; }
+
+	/*
+	** Number of body pairs handed to the narrowphase in the last step.
+	*/
+	uint32_t get_pair_test_count() const { return _pair_test_count; }
+
+	/*
+	** Pairs of bodies passed over before the narrowphase in the last step,
+	** by reason: both static or asleep, kept apart by their collision
+	** filters, or with no intersection test for their shapes.
+	** @see ga_rigid_body::set_collision_filter
+	*/
+	const ga_pair_rejections_t& get_pair_rejections() const { return _pair_rejections; }
+
+	/*
+	** Number of body pairs found touching in the last step.
+	*/
+	uint32_t get_contact_count() const { return _contact_count; }
+
+	/*
+	** Split the narrowphase across jobs. On by default, in which case the job
+	** system must be running once there are enough pairs to split.
+	*/
+	void set_parallel_narrowphase(bool parallel) { _parallel_narrowphase = parallel; }
+
+	/*
+	** Choose how body positions are advanced. Semi-implicit Euler by default.
+	*/
+	void set_integrator(ga_integrator_t integrator) { _integrator = integrator; }
+	ga_integrator_t get_integrator() const { return _integrator; }
+
+	/*
+	** How many passes the contact solver makes each step. More passes settle
+	** stacks faster; 8 by default.
+	*/
+	void set_solver_iterations(uint32_t iterations) { _solver.set_iterations(iterations); }
+	uint32_t get_solver_iterations() const { return _solver.get_iterations(); }
+
+	/*
+	** Split the contact solver across jobs. On by default, in which case the
+	** job system must be running once there are enough contacts to split.
+	*/
+	void set_parallel_solver(bool parallel) { _solver.set_parallel(parallel); }
+
+	/*
+	** Have the contact solver give the same results whether it is split
+	** across jobs or not, and whatever the number of workers. Off by default.
+	** @see ga_contact_solver::set_deterministic
+	*/
+	void set_deterministic_solver(bool deterministic) { _solver.set_deterministic(deterministic); }
+	bool get_deterministic_solver() const { return _solver.get_deterministic(); }
+
+	/*
+	** Step bit for bit the same way every run, on any number of workers, for
+	** lockstep networking and replays. Off by default.
+	**
+	** Frame time is gathered and the world advances in whole ticks of the
+	** fixed timestep, at most four a frame, the rest dropped.
+	** A single step while paused runs one tick. Turning this on also turns
+	** on the deterministic solver. Bodies must be added in the same order
+	** each run; pairs, contacts and islands then always come in the same
+	** order. Forces added between frames act on the first tick only.
+	*/
+	void set_deterministic(bool deterministic);
+	bool get_deterministic() const { return _deterministic; }
+
+	/*
+	** Length of one tick in deterministic mode; 1/60 s by default.
+	*/
+	void set_fixed_timestep(std::chrono::high_resolution_clock::duration timestep) { _fixed_timestep = timestep; }
+	std::chrono::high_resolution_clock::duration get_fixed_timestep() const { return _fixed_timestep; }
+
+	/*
+	** Round the positions of moving bodies to multiples of 2^-fraction_bits
+	** after each step, so small differences in rounding between builds die
+	** out rather than grow. 0, the default, leaves positions alone. Bodies
+	** must stay within 2^(31 - fraction_bits) of the origin.
+	*/
+	void set_fixed_point_positions(uint32_t fraction_bits) { _fixed_point_bits = fraction_bits; }
+	uint32_t get_fixed_point_positions() const { return _fixed_point_bits; }
+
+	/*
+	** Hash of every body's position, orientation, velocities and flags after
+	** the last tick in deterministic mode. Two runs that agree on it agree
+	** on the whole world, bit for bit.
+	*/
+	uint64_t get_state_hash() const { return _state_hash; }
+
+	/*
+	** Let groups of touching bodies that have stayed still for a while go to
+	** sleep. Sleeping bodies are not moved or tested until something wakes
+	** them. On by default; turning it off wakes everything.
+	*/
+	void set_sleeping(bool sleeping);
+	bool get_sleeping() const { return _sleeping; }
+
+	/*
+	** Number of bodies that were neither static nor asleep in the last step.
+	*/
+	uint32_t get_awake_body_count() const { return _awake_count; }
+
+	/*
+	** Scene queries. Bodies with any of ignore_flags set are left out.
+	**
+	** Queries find candidates through the broadphase as it stood after the
+	** last step, so they cost little more than the bodies they come near.
+	** Bodies moved since, by contacts or by hand, are still found. Queries
+	** must not be called while stepping, nor alongside each other; the batch
+	** forms below split their queries across jobs.
+	*/
+
+	/*
+	** Find the nearest body along a ray. Returns false, with a null body in
+	** hit, if the ray meets nothing within its length.
+	*/
+	bool raycast(const ga_raycast_t& ray, ga_raycast_hit_t& hit, uint32_t ignore_flags = 0);
+
+	/*
+	** Find the bodies touching a sphere or a box, in the order the world
+	** keeps them, so the same query always gives the same list. Up to
+	** capacity of them are written out; the number found is returned either
+	** way. The box is centered on the transform's
+	** translation and turned by its rotation.
+	*/
+	uint32_t overlap_sphere(const ga_vec3f& center, float radius, ga_rigid_body** bodies, uint32_t capacity, uint32_t ignore_flags = 0);
+	uint32_t overlap_box(const ga_mat4f& transform, const ga_vec3f& half_extents, ga_rigid_body** bodies, uint32_t capacity, uint32_t ignore_flags = 0);
+
+	/*
+	** Find the k bodies nearest a point, nearest first, with their distances
+	** if distances is not null. Returns how many were written, fewer than k
+	** only if the world has fewer bodies to give.
+	*/
+	uint32_t find_nearest(const ga_vec3f& point, uint32_t k, ga_rigid_body** bodies, float* distances, uint32_t ignore_flags = 0);
+
+	/*
+	** Batch forms of the queries above, for many queries at once. Results for
+	** query i go to hits[i], or to bodies[i * capacity] (or i * k) onwards
+	** with their number in counts[i]. Rays are tested a SIMD packet at a time.
+	*/
+	void raycast_batch(const ga_raycast_t* rays, uint32_t count, ga_raycast_hit_t* hits, uint32_t ignore_flags = 0);
+	void overlap_sphere_batch(const ga_sphere_query_t* queries, uint32_t count, ga_rigid_body** bodies, uint32_t capacity, uint32_t* counts, uint32_t ignore_flags = 0);
+	void overlap_box_batch(const ga_box_query_t* queries, uint32_t count, ga_rigid_body** bodies, uint32_t capacity, uint32_t* counts, uint32_t ignore_flags = 0);
+	void find_nearest_batch(const ga_vec3f* points, uint32_t count, uint32_t k, ga_rigid_body** bodies, float* distances, uint32_t* counts, uint32_t ignore_flags = 0);
+
+	/*
+	** Split query batches across jobs. On by default, in which case the job
+	** system must be running once a batch is large enough to split.
+	*/
+	void set_parallel_queries(bool parallel) { _parallel_queries = parallel; }
+
 private:
 	std::vector<ga_rigid_body*> _bodies;
 	std::atomic_flag _bodies_lock = ATOMIC_FLAG_INIT;
 
+	// The moving state of each body, one array per component so the
+	// integrators can run over several bodies at once. Indexed like _bodies.
+	std::vector<ga_mat4f> _transforms;
+	std::vector<float> _positions[3];
+	std::vector<float> _velocities[3];
+	std::vector<float> _orientations[4];
+	std::vector<float> _angular_momenta[3];
+	std::vector<float> _angular_velocities[3];
+	std::vector<float> _accelerations[3];
+	std::vector<float> _forces[3];
+	std::vector<float> _torques[3];
+	std::vector<float> _inverse_masses;
+
+	// World space inverse inertia, refreshed whenever a body turns.
+	std::vector<ga_mat3f> _inverse_inertia_tensors;
+	std::vector<uint32_t> _flags;
+	std::vector<struct ga_shape*> _shapes;
+
+	// Steps each body has spent moving slowly enough to sleep.
+	std::vector<uint32_t> _rest_frames;
+
+	ga_integrator_t _integrator = k_integrator_semi_implicit_euler;
+
+	struct force_registration_t
+	{
+		ga_rigid_body* _body;
+		ga_force_generator* _generator;
+	};
+	std::vector<force_registration_t> _force_generators;
+
 	ga_vec3f _gravity;
 
-	void step_linear_dynamics(ga_frame_params* params, ga_rigid_body* body);
-	void step_angular_dynamics(ga_frame_params* params, ga_rigid_body* body);
+	ga_broadphase_type_t _broadphase_type;
+	ga_broadphase* _broadphase;
+	std::vector<ga_broadphase_box_t> _boxes;
+	std::vector<ga_body_pair_t> _pairs;
+	uint32_t _pair_test_count = 0;
+	ga_pair_rejections_t _pair_rejections = {};
+
+	/*
+	** A pair found touching, by its index in _pairs.
+	*/
+	struct contact_t
+	{
+		uint32_t _pair;
+		ga_collision_info _info;
+	};
+
+	/*
+	** Where GJK last ended for a pair of hulls, so the next step can start
+	** there. Keyed by the pair's body indices, a in the high bits.
+	*/
+	struct gjk_direction_t
+	{
+		uint64_t _key;
+		ga_vec3f _direction;
+
+		bool operator<(const gjk_direction_t& other) const { return _key < other._key; }
+	};
+
+	/*
+	** A run of pairs tested by one job, and the contacts it found.
+	*/
+	struct narrowphase_batch_t
+	{
+		const ga_physics_world* _world;
+		uint32_t _begin;
+		uint32_t _end;
+		std::vector<contact_t> _contacts;
+		std::vector<gjk_direction_t> _gjk_directions;
+	};
+
+	bool _parallel_narrowphase = true;
+	std::vector<narrowphase_batch_t> _narrowphase_batches;
+	std::vector<ga_job_decl_t> _narrowphase_decls;
+	uint32_t _contact_count = 0;
+
+	/*
+	** A body flagged k_fast, and where it was when the step began.
+	*/
+	struct fast_body_t
+	{
+		uint32_t _index;
+		ga_vec3f _start;
+	};
+
+	std::vector<fast_body_t> _fast_bodies;
+
+	// Broadphase pairs with a fast body, the fast body first, sorted.
+	std::vector<ga_body_pair_t> _sweep_candidates;
+
+	// Sorted by key; only read during the narrowphase. Each batch records
+	// what it found and the lists are merged into the next step's.
+	std::vector<gjk_direction_t> _gjk_directions;
+	std::vector<gjk_direction_t> _next_gjk_directions;
+
+	// The points each touching pair had last step, sorted by body indices,
+	// and this step's, built in the same order. Pairs are stored with the
+	// lower index as a.
+	std::vector<ga_contact_manifold_t> _manifolds;
+	std::vector<ga_contact_manifold_t> _next_manifolds;
+	ga_contact_solver _solver;
+
+	// Touching bodies are joined into islands, which sleep and wake as one.
+	// Each body points toward the root of its island.
+	bool _sleeping = true;
+	uint32_t _awake_count = 0;
+	std::vector<uint32_t> _island_parents;
+	std::vector<uint32_t> _island_rest_frames;
+	std::vector<uint8_t> _island_awake;
+
+	// Deterministic mode; frame time not yet stepped through, in clock ticks.
+	bool _deterministic = false;
+	std::chrono::high_resolution_clock::duration _fixed_timestep;
+	std::chrono::high_resolution_clock::duration _time_accumulator;
+	uint32_t _fixed_point_bits = 0;
+	uint64_t _state_hash = 0;
+
+	void append_body(ga_rigid_body* body);
+	void remove_bodies(const std::vector<ga_rigid_body*>& sorted_bodies);
+	void resize_bodies(uint32_t count);
+	void move_body(uint32_t from, uint32_t to);
+	void get_body_state(uint32_t index, struct ga_rigid_body_state_t& state) const;
+
+	ga_vec3f get_body_position(uint32_t index) const;
+	void set_body_position(uint32_t index, const ga_vec3f& position);
+	ga_vec3f get_body_velocity(uint32_t index) const;
+	void set_body_velocity(uint32_t index, const ga_vec3f& velocity);
+	ga_vec3f get_body_angular_momentum(uint32_t index) const;
+	void set_body_angular_momentum(uint32_t index, const ga_vec3f& momentum);
+	void set_body_transform(uint32_t index, const ga_mat4f& transform);
+	void add_body_force(uint32_t index, const ga_vec3f& force);
+	void add_body_torque(uint32_t index, const ga_vec3f& torque);
+	void update_inverse_inertia(uint32_t index);
+
+	// Wake a body. A static body wakes whatever it was last touching.
+	void wake_body(uint32_t index);
+
+	// Wake a body and everything it was last touching, islands or not.
+	void wake_touching(uint32_t index);
+	uint32_t find_island(uint32_t index);
+
+	// Join touching bodies into islands and wake any island with a body
+	// awake in it; then, once solved, put islands that have rested to sleep.
+	void build_islands();
+	void sleep_islands();
+
+	// Rebuild a body's transform from its position and orientation.
+	void update_transform(uint32_t index);
+
+	// One step of dt seconds.
+	void step_once(ga_frame_params* params, float dt);
+	void integrate(float dt);
+	void round_positions();
+	uint64_t hash_state() const;
+
+	void test_intersections(ga_frame_params* params, float dt);
+	void sweep_fast_bodies();
+	bool find_time_of_impact(uint32_t index, const ga_vec3f& start, const ga_vec3f& end, uint32_t other, float& time) const;
+	void test_pair_range(uint32_t begin, uint32_t end, std::vector<contact_t>& contacts, std::vector<gjk_direction_t>& gjk_directions) const;
+	void resolve_contacts(ga_frame_params* params, uint32_t batch_count, float dt);
+
+	/*
+	** Working space for queries; each query job has its own.
+	*/
+	struct query_scratch_t
+	{
+		std::vector<uint32_t> _bodies;
+		std::vector<std::pair<float, uint32_t>> _nearest;
+	};
+
+	/*
+	** One batch of queries of a single kind, and where their results go.
+	*/
+	struct query_request_t
+	{
+		const ga_raycast_t* _rays;
+		const ga_sphere_query_t* _spheres;
+		const ga_box_query_t* _boxes;
+		const ga_vec3f* _points;
+		ga_raycast_hit_t* _hits;
+		ga_rigid_body** _bodies;
+		float* _distances;
+		uint32_t* _counts;
+		uint32_t _capacity;
+		uint32_t _ignore_flags;
+
+		void (*_run)(const ga_physics_world* world, const query_request_t& request, uint32_t begin, uint32_t end, query_scratch_t& scratch);
+	};
+
+	/*
+	** A run of queries answered by one job.
+	*/
+	struct query_batch_t
+	{
+		const ga_physics_world* _world;
+		const query_request_t* _request;
+		uint32_t _begin;
+		uint32_t _end;
+		query_scratch_t _scratch;
+	};
+
+	// How far bodies may lie outside the boxes the broadphase last saw,
+	// found before the first query after anything moves, and the bodies
+	// moved too far for that, in order.
+	float _query_margin = 0.0f;
+	bool _query_margin_dirty = true;
+	std::vector<uint32_t> _query_moved;
+
+	bool _parallel_queries = true;
+	query_scratch_t _query_scratch;
+	std::vector<query_batch_t> _query_batches;
+	std::vector<ga_job_decl_t> _query_decls;
+
+	void update_query_margin();
+	void run_queries(const query_request_t& request, uint32_t count, uint32_t granularity);
+
+	// Bodies whose bounds may touch the given box, in no particular order.
+	void find_query_candidates(const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const;
+	bool body_overlaps(uint32_t index, const ga_vec3f& min, const ga_vec3f& max) const;
+
+	// Up to k_ray_packet_width rays at once.
+	struct ray_packet_visitor_t;
+	void cast_ray_packet(const ga_raycast_t* rays, uint32_t count, ga_raycast_hit_t* hits, uint32_t ignore_flags) const;
+	uint32_t find_sphere_overlaps(const ga_vec3f& center, float radius, ga_rigid_body** bodies, uint32_t capacity, uint32_t ignore_flags, query_scratch_t& scratch) const;
+	uint32_t find_box_overlaps(const ga_mat4f& transform, const ga_vec3f& half_extents, ga_rigid_body** bodies, uint32_t capacity, uint32_t ignore_flags, query_scratch_t& scratch) const;
+	uint32_t find_nearest_bodies(const ga_vec3f& point, uint32_t k, ga_rigid_body** bodies, float* distances, uint32_t ignore_flags, query_scratch_t& scratch) const;
 
-	void test_intersections(ga_frame_params* params);
+	// Write out the sorted bodies gathered in scratch, up to capacity.
+	uint32_t write_query_bodies(query_scratch_t& scratch, ga_rigid_body** bodies, uint32_t capacity) const;
 
-	void resolve_collision(ga_rigid_body* body_a, ga_rigid_body* body_b, ga_collision_info* info);
+	friend class ga_rigid_body;
+	friend class ga_snapshot;
 };
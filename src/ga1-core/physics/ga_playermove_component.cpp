@@ -12,7 +12,7 @@
 #include "entity/ga_entity.h"
 
 ga_playermove_component::ga_playermove_component(ga_entity* ent)
-	: ga_component(ent), _move_when_paused(false)
+	: ga_component(ent, ga_component_type::get<ga_playermove_component>()), _move_when_paused(false)
 {
 }
 
@@ -8,14 +8,34 @@
 */
 
 #include "ga_rigid_body.h"
+#include "ga_physics_world.h"
 #include "ga_shape.h"
 
-ga_rigid_body::ga_rigid_body(ga_shape* shape, float mass) : _mass(mass), _shape(shape), _flags(0)
+ga_rigid_body::ga_rigid_body(ga_shape* shape, float mass) : _mass(mass), _shape(shape)
 {
-	_transform.make_identity();
-	_orientation.make_axis_angle(ga_vec3f::y_vector(), 0);
+	_state._transform.make_identity();
+	_state._orientation.make_axis_angle(ga_vec3f::y_vector(), 0);
+	_state._velocity = ga_vec3f::zero_vector();
+	_state._angular_momentum = ga_vec3f::zero_vector();
+	_state._angular_velocity = ga_vec3f::zero_vector();
+	_state._flags = 0;
+	_state._force = ga_vec3f::zero_vector();
+	_state._torque = ga_vec3f::zero_vector();
 
-	_shape->get_inertia_tensor(_inertia_tensor, _mass);
+	// Shapes without a tensor of their own get the identity.
+	ga_mat4f inertia_tensor;
+	inertia_tensor.make_identity();
+	_shape->get_inertia_tensor(inertia_tensor, _mass);
+
+	// Only the inverse is ever used, so invert it once here.
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			_inverse_inertia_tensor.data[i][j] = inertia_tensor.data[i][j];
+		}
+	}
+	_inverse_inertia_tensor.invert();
 }
 
 ga_rigid_body::~ga_rigid_body()
@@ -24,29 +44,99 @@ ga_rigid_body::~ga_rigid_body()
 
 void ga_rigid_body::get_debug_draw(ga_dynamic_drawcall* drawcall)
 {
-	_shape->get_debug_draw(_transform, drawcall);
+	_shape->get_debug_draw(get_transform(), drawcall);
 }
 
 void ga_rigid_body::make_static()
 {
-	_flags |= k_static;
+	if (_world) _world->_flags[_index] |= k_static;
+	else _state._flags |= k_static;
 }
 
 void ga_rigid_body::make_weightless()
 {
-	_flags |= k_weightless;
+	if (_world) _world->_flags[_index] |= k_weightless;
+	else _state._flags |= k_weightless;
+}
+
+void ga_rigid_body::make_fast()
+{
+	if (_world) _world->_flags[_index] |= k_fast;
+	else _state._flags |= k_fast;
+}
+
+void ga_rigid_body::wake()
+{
+	if (_world) _world->wake_body(_index);
+	else _state._flags &= ~k_sleeping;
+}
+
+void ga_rigid_body::set_collision_filter(uint32_t layers, uint32_t mask)
+{
+	_collision_layers = layers;
+	_collision_mask = mask;
+
+	// Bodies resting on this one may no longer be held up by it.
+	if (_world) _world->wake_touching(_index);
 }
 
 void ga_rigid_body::add_linear_velocity(const ga_vec3f& v)
 {
-	_velocity += v;
+	set_linear_velocity(get_linear_velocity() + v);
 }
 
 void ga_rigid_body::add_angular_momentum(const ga_vec3f& v)
 {
-	_angular_momentum += v;
+	if (_world) _world->set_body_angular_momentum(_index, _world->get_body_angular_momentum(_index) + v);
+	else _state._angular_momentum += v;
+}
+
+void ga_rigid_body::set_linear_velocity(const ga_vec3f& v)
+{
+	if (_world) _world->set_body_velocity(_index, v);
+	else _state._velocity = v;
+}
+
+ga_vec3f ga_rigid_body::get_linear_velocity() const
+{
+	return _world ? _world->get_body_velocity(_index) : _state._velocity;
+}
+
+void ga_rigid_body::add_force(const ga_vec3f& f)
+{
+	if (_world) _world->add_body_force(_index, f);
+	else _state._force += f;
+}
+
+void ga_rigid_body::add_torque(const ga_vec3f& t)
+{
+	if (_world) _world->add_body_torque(_index, t);
+	else _state._torque += t;
+}
+
+void ga_rigid_body::set_position(const ga_vec3f& p)
+{
+	if (_world) _world->set_body_position(_index, p);
+	else _state._transform.set_translation(p);
+}
+
+ga_vec3f ga_rigid_body::get_position() const
+{
+	return get_transform().get_translation();
+}
+
+void ga_rigid_body::set_transform(const ga_mat4f& transform)
+{
+	if (_world) _world->set_body_transform(_index, transform);
+	else _state._transform = transform;
 }
 
-void ga_rigid_body::set_linear_velocity(const ga_vec3f& v) {
-	_velocity = v;
+const ga_mat4f& ga_rigid_body::get_transform() const
+{
+	return _world ? _world->_transforms[_index] : _state._transform;
+}
+
+uint32_t ga_rigid_body::get_flags() const
+{
+	return _world ? _world->_flags[_index] : _state._flags;
 }
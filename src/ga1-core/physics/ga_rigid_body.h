@@ -9,21 +9,50 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 
+#include "math/ga_mat3f.h"
 #include "math/ga_mat4f.h"
+#include "math/ga_quatf.h"
 #include "math/ga_vec3f.h"
 
 #include <cstdint>
-#include <vector>
 
 enum ga_rigid_body_flags
 {
 	k_static = 1,
 	k_weightless = 2,
+
+	// Moves far enough in a step to pass through things; swept each step.
+	k_fast = 4,
+
+	// At rest with everything it touches; not moved or tested until woken.
+	k_sleeping = 8,
+};
+
+/*
+** The parts of a body's state that change as it moves.
+*/
+struct ga_rigid_body_state_t
+{
+	ga_mat4f _transform;
+	ga_quatf _orientation;
+	ga_vec3f _velocity;
+	ga_vec3f _angular_momentum;
+	ga_vec3f _angular_velocity;
+	uint32_t _flags;
+
+	// Force and torque gathered for the next step.
+	ga_vec3f _force;
+	ga_vec3f _torque;
 };
 
 /*
 ** Represents a body in the physics simulation.
 ** Static bodies will not move (e.g. the floor).
+**
+** Once added to a world, the body's moving state lives in the world's
+** per-body arrays and this object is a handle to it. Its methods read and
+** write through to the world until the body is removed again, when the
+** state is copied back.
 */
 class ga_rigid_body final
 {
@@ -36,33 +65,87 @@ public:
 	void make_static();
 	void make_weightless();
 
+	/*
+	** Sweep the body along its path each step so it can't pass through
+	** anything between one pose and the next. For small, quick bodies.
+	*/
+	void make_fast();
+
+	/*
+	** Wake the body and everything resting on it. Setting its velocity,
+	** position or momentum, or pushing on it, does the same.
+	*/
+	void wake();
+	bool is_sleeping() const { return (get_flags() & k_sleeping) != 0; }
+
 	void add_linear_velocity(const ga_vec3f& v);
 	void add_angular_momentum(const ga_vec3f& v);
 	void set_linear_velocity(const ga_vec3f& v);
+	ga_vec3f get_linear_velocity() const;
+
+	/*
+	** Apply a force or torque through the center of mass for the next step.
+	** Both are cleared once the world steps.
+	*/
+	void add_force(const ga_vec3f& f);
+	void add_torque(const ga_vec3f& t);
+
+	void set_position(const ga_vec3f& p);
+	ga_vec3f get_position() const;
+
+	/*
+	** Place the body. Only the translation moves it in the world's arrays;
+	** the rotation is kept as given until the body next turns. Placing it
+	** exactly where it already is does nothing, and so does not wake it.
+	*/
+	void set_transform(const ga_mat4f& transform);
+	const ga_mat4f& get_transform() const;
+
+	uint32_t get_flags() const;
+
+	/*
+	** How much the body resists sliding. Two bodies touching use the
+	** geometric mean of theirs, so a frictionless body slides on anything.
+	*/
+	void set_friction(float friction) { _coefficient_of_friction = friction; }
+
+	/*
+	** Put the body in the given collision layers, one per bit, and have it
+	** collide only with bodies in one of the layers in mask. Both bodies of
+	** a pair must accept the other. By default a body is in layer 1 and
+	** collides with every layer. Wakes the body.
+	*/
+	void set_collision_filter(uint32_t layers, uint32_t mask);
+	uint32_t get_collision_layers() const { return _collision_layers; }
+	uint32_t get_collision_mask() const { return _collision_mask; }
+
+	/*
+	** The world the body is in, or null.
+	*/
+	class ga_physics_world* get_world() const { return _world; }
 
 private:
-	ga_mat4f _transform;
-	ga_quatf _orientation = { 0.0f, 0.0f, 0.0f, 0.0f };
+	// State while not in a world.
+	ga_rigid_body_state_t _state;
 
-	ga_vec3f _angular_momentum = ga_vec3f::zero_vector();
-	ga_vec3f _angular_velocity = ga_vec3f::zero_vector();
-	ga_vec3f _velocity = ga_vec3f::zero_vector();
+	class ga_physics_world* _world = nullptr;
+	uint32_t _index = 0;
 
-	ga_mat4f _inertia_tensor;
+	// Inverse of the inertia tensor in the body's own frame.
+	ga_mat3f _inverse_inertia_tensor;
 
 	float _mass;
 
 	// Ordinarily this would live in a collision material structure.
 	// We just include the value here for simplicity.
 	float _coefficient_of_restitution = 0.5f;
+	float _coefficient_of_friction = 0.0f;
 
-	struct ga_shape* _shape;
-
-	std::vector<ga_vec3f> _forces;
-	std::vector<ga_vec3f> _torques;
+	uint32_t _collision_layers = 1;
+	uint32_t _collision_mask = 0xffffffff;
 
-	uint32_t _flags;
+	struct ga_shape* _shape;
 
 	friend class ga_physics_world;
-	friend class ga_physics_component;
+	friend class ga_snapshot;
 };
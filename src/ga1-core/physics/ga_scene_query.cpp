@@ -0,0 +1,296 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_scene_query.h"
+#include "ga_intersection.h"
+#include "ga_shape.h"
+
+#include "math/ga_math.h"
+
+// Below this a ray counts as running parallel to a slab.
+static const float k_ray_parallel_epsilon = 1.0e-8f;
+
+uint32_t ray_packet_vs_box(const ga_ray_packet_t& packet, const ga_vec3f& min, const ga_vec3f& max)
+{
+#if defined(GA_AVX) || defined(GA_SSE)
+	ga_simd_float near_t = ga_simd_set(0.0f);
+	ga_simd_float far_t = ga_simd_load(packet._length);
+	for (int a = 0; a < 3; ++a)
+	{
+		ga_simd_float origin = ga_simd_load(packet._origin[a]);
+		ga_simd_float inverse = ga_simd_load(packet._inverse_direction[a]);
+		ga_simd_float t0 = ga_simd_mul(ga_simd_sub(ga_simd_set(min.axes[a]), origin), inverse);
+		ga_simd_float t1 = ga_simd_mul(ga_simd_sub(ga_simd_set(max.axes[a]), origin), inverse);
+		near_t = ga_simd_max(ga_simd_min(t0, t1), near_t);
+		far_t = ga_simd_min(ga_simd_max(t0, t1), far_t);
+	}
+	return ga_simd_mask_bits(ga_simd_less_equal(near_t, far_t));
+#else
+	uint32_t lanes = 0;
+	for (uint32_t lane = 0; lane < k_ray_packet_width; ++lane)
+	{
+		float near_t = 0.0f;
+		float far_t = packet._length[lane];
+		for (int a = 0; a < 3; ++a)
+		{
+			float t0 = (min.axes[a] - packet._origin[a][lane]) * packet._inverse_direction[a][lane];
+			float t1 = (max.axes[a] - packet._origin[a][lane]) * packet._inverse_direction[a][lane];
+			float low = t0 < t1 ? t0 : t1;
+			float high = t0 > t1 ? t0 : t1;
+			near_t = low > near_t ? low : near_t;
+			far_t = high < far_t ? high : far_t;
+		}
+		if (near_t <= far_t) lanes |= 1u << lane;
+	}
+	return lanes;
+#endif
+}
+
+/*
+** Ray against a box given by its center and three perpendicular half
+** vectors, one slab at a time.
+*/
+static bool ray_vs_box(const ga_vec3f& center, const ga_vec3f half_vectors[3], const ga_vec3f& origin, const ga_vec3f& direction, float length, float& distance, ga_vec3f& normal)
+{
+	float near_t = 0.0f;
+	float far_t = length;
+	ga_vec3f near_normal = -direction;
+	ga_vec3f offset = center - origin;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		float extent = half_vectors[i].mag();
+		if (extent <= 0.0f) continue;
+
+		ga_vec3f axis = half_vectors[i].scale_result(1.0f / extent);
+		float e = axis.dot(offset);
+		float f = axis.dot(direction);
+
+		if (ga_absf(f) < k_ray_parallel_epsilon)
+		{
+			if (-e - extent > 0.0f || -e + extent < 0.0f) return false;
+			continue;
+		}
+
+		float t0 = (e - extent) / f;
+		float t1 = (e + extent) / f;
+		ga_vec3f face = axis.scale_result(f > 0.0f ? -1.0f : 1.0f);
+		if (t0 > t1)
+		{
+			float t = t0;
+			t0 = t1;
+			t1 = t;
+		}
+
+		if (t0 > near_t)
+		{
+			near_t = t0;
+			near_normal = face;
+		}
+		far_t = ga_min(far_t, t1);
+		if (near_t > far_t) return false;
+	}
+
+	distance = near_t;
+	normal = near_normal;
+	return true;
+}
+
+static bool ray_vs_bounds(const ga_vec3f& min, const ga_vec3f& max, const ga_vec3f& origin, const ga_vec3f& direction, float length, float& distance, ga_vec3f& normal)
+{
+	ga_vec3f half_vectors[3] =
+	{
+		ga_vec3f::x_vector().scale_result(0.5f * (max.x - min.x)),
+		ga_vec3f::y_vector().scale_result(0.5f * (max.y - min.y)),
+		ga_vec3f::z_vector().scale_result(0.5f * (max.z - min.z)),
+	};
+	return ray_vs_box((min + max).scale_result(0.5f), half_vectors, origin, direction, length, distance, normal);
+}
+
+bool ray_vs_shape(const ga_shape* shape, const ga_mat4f& transform, const ga_vec3f& origin, const ga_vec3f& direction, float length, float& distance, ga_vec3f& normal)
+{
+	switch (shape->get_type())
+	{
+	case k_shape_sphere:
+	{
+		const ga_sphere* sphere = reinterpret_cast<const ga_sphere*>(shape);
+		ga_vec3f center = sphere->_center + transform.get_translation();
+		ga_vec3f offset = origin - center;
+		float c = offset.mag2() - sphere->_radius * sphere->_radius;
+		if (c <= 0.0f)
+		{
+			distance = 0.0f;
+			normal = -direction;
+			return true;
+		}
+
+		float b = offset.dot(direction);
+		float discriminant = b * b - c;
+		if (b > 0.0f || discriminant < 0.0f) return false;
+
+		distance = -b - ga_sqrtf(discriminant);
+		if (distance > length) return false;
+
+		normal = (origin + direction.scale_result(distance) - center).normal();
+		return true;
+	}
+	case k_shape_plane:
+	{
+		const ga_plane* plane = reinterpret_cast<const ga_plane*>(shape);
+		ga_vec3f plane_normal = transform.transform_vector(plane->_normal);
+		float height = plane_normal.dot(origin - (plane->_point + transform.get_translation()));
+		if (height <= 0.0f)
+		{
+			distance = 0.0f;
+			normal = -direction;
+			return true;
+		}
+
+		float approach = plane_normal.dot(direction);
+		if (approach >= 0.0f) return false;
+
+		distance = -height / approach;
+		if (distance > length) return false;
+
+		normal = plane_normal;
+		return true;
+	}
+	case k_shape_oobb:
+	{
+		const ga_oobb* oobb = reinterpret_cast<const ga_oobb*>(shape);
+		ga_vec3f half_vectors[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			half_vectors[i] = transform.transform_vector(oobb->_half_vectors[i]);
+		}
+		return ray_vs_box(oobb->_center + transform.get_translation(), half_vectors, origin, direction, length, distance, normal);
+	}
+	default:
+	{
+		ga_vec3f min, max;
+		shape->get_world_aabb(transform, min, max);
+		return ray_vs_bounds(min, max, origin, direction, length, distance, normal);
+	}
+	}
+}
+
+/*
+** Distance from a point to a box given by its center and three
+** perpendicular half vectors.
+*/
+static float distance_to_box(const ga_vec3f& center, const ga_vec3f half_vectors[3], const ga_vec3f& point)
+{
+	ga_vec3f offset = point - center;
+	float outside2 = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		float extent = half_vectors[i].mag();
+		if (extent <= 0.0f) continue;
+
+		float along = ga_absf(half_vectors[i].dot(offset) / extent);
+		if (along > extent)
+		{
+			outside2 += (along - extent) * (along - extent);
+		}
+	}
+	return ga_sqrtf(outside2);
+}
+
+float distance_to_shape(const ga_shape* shape, const ga_mat4f& transform, const ga_vec3f& point)
+{
+	switch (shape->get_type())
+	{
+	case k_shape_sphere:
+	{
+		const ga_sphere* sphere = reinterpret_cast<const ga_sphere*>(shape);
+		ga_vec3f center = sphere->_center + transform.get_translation();
+		return ga_max((point - center).mag() - sphere->_radius, 0.0f);
+	}
+	case k_shape_plane:
+	{
+		const ga_plane* plane = reinterpret_cast<const ga_plane*>(shape);
+		ga_plane placed = *plane;
+		placed._normal = transform.transform_vector(plane->_normal);
+		placed._point += transform.get_translation();
+		return ga_max(distance_to_plane(point, &placed), 0.0f);
+	}
+	case k_shape_oobb:
+	{
+		const ga_oobb* oobb = reinterpret_cast<const ga_oobb*>(shape);
+		ga_vec3f half_vectors[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			half_vectors[i] = transform.transform_vector(oobb->_half_vectors[i]);
+		}
+		return distance_to_box(oobb->_center + transform.get_translation(), half_vectors, point);
+	}
+	default:
+	{
+		ga_vec3f min, max;
+		shape->get_world_aabb(transform, min, max);
+		float outside2 = 0.0f;
+		for (int a = 0; a < 3; ++a)
+		{
+			float excess = ga_max(min.axes[a] - point.axes[a], ga_max(point.axes[a] - max.axes[a], 0.0f));
+			outside2 += excess * excess;
+		}
+		return ga_sqrtf(outside2);
+	}
+	}
+}
+
+bool box_vs_shape(const ga_mat4f& box_transform, const ga_vec3f& half_extents, const ga_shape* shape, const ga_mat4f& transform)
+{
+	ga_oobb box;
+	box._center = ga_vec3f::zero_vector();
+	box._half_vectors[0] = ga_vec3f::x_vector().scale_result(half_extents.x);
+	box._half_vectors[1] = ga_vec3f::y_vector().scale_result(half_extents.y);
+	box._half_vectors[2] = ga_vec3f::z_vector().scale_result(half_extents.z);
+
+	ga_collision_info info;
+	switch (shape->get_type())
+	{
+	case k_shape_sphere:
+	{
+		const ga_sphere* sphere = reinterpret_cast<const ga_sphere*>(shape);
+		ga_vec3f half_vectors[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			half_vectors[i] = box_transform.transform_vector(box._half_vectors[i]);
+		}
+		return distance_to_box(box_transform.get_translation(), half_vectors, sphere->_center + transform.get_translation()) <= sphere->_radius;
+	}
+	case k_shape_plane:
+		return oobb_vs_plane(&box, box_transform, shape, transform, &info);
+	case k_shape_oobb:
+		return separating_axis_test(&box, box_transform, shape, transform, &info);
+	case k_shape_aabb:
+	{
+		// Boxes that only move, as the intersection tests treat them.
+		const ga_aabb* aabb = reinterpret_cast<const ga_aabb*>(shape);
+		ga_oobb other;
+		other._center = (aabb->_min + aabb->_max).scale_result(0.5f);
+		other._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.5f * (aabb->_max.x - aabb->_min.x));
+		other._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f * (aabb->_max.y - aabb->_min.y));
+		other._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f * (aabb->_max.z - aabb->_min.z));
+		ga_mat4f translation;
+		translation.make_translation(transform.get_translation());
+		return separating_axis_test(&box, box_transform, &other, translation, &info);
+	}
+	case k_shape_convex_hull:
+	{
+		ga_convex_hull hull;
+		hull._positions.resize(8);
+		box.get_corners(hull._positions.data());
+		return gjk(&hull, box_transform, shape, transform, &info);
+	}
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_mat4f.h"
+#include "math/ga_simd.h"
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+
+struct ga_shape;
+class ga_rigid_body;
+
+/*
+** A ray to cast into a world. The direction need not be unit length;
+** distances are measured in world units along it either way.
+*/
+struct ga_raycast_t
+{
+	ga_vec3f _origin;
+	ga_vec3f _direction;
+	float _max_distance;
+};
+
+/*
+** The first body a ray hit, where, and the surface normal there.
+** The body is null if the ray hit nothing.
+*/
+struct ga_raycast_hit_t
+{
+	ga_rigid_body* _body;
+	ga_vec3f _point;
+	ga_vec3f _normal;
+	float _distance;
+};
+
+/*
+** A sphere to look for bodies in.
+*/
+struct ga_sphere_query_t
+{
+	ga_vec3f _center;
+	float _radius;
+};
+
+/*
+** A box to look for bodies in, placed as for ga_physics_world::overlap_box.
+*/
+struct ga_box_query_t
+{
+	ga_mat4f _transform;
+	ga_vec3f _half_extents;
+};
+
+// Rays tested against one box at a time, one per SIMD lane.
+static const uint32_t k_ray_packet_width = k_simd_width;
+
+/*
+** Up to k_ray_packet_width rays, one array per component, so a box can be
+** tested against all of them at once. Directions are unit length and stored
+** inverted. Unused lanes have a negative length and hit nothing.
+*/
+struct ga_ray_packet_t
+{
+	float _origin[3][k_ray_packet_width];
+	float _inverse_direction[3][k_ray_packet_width];
+	float _length[k_ray_packet_width];
+};
+
+/*
+** Which rays of a packet pass through a box before their length runs out,
+** one bit per lane, lane 0 lowest. Rays starting inside count.
+*/
+uint32_t ray_packet_vs_box(const ga_ray_packet_t& packet, const ga_vec3f& min, const ga_vec3f& max);
+
+/*
+** Where a ray first meets a shape, placed the same way the intersection
+** tests place it. The direction must be unit length. A ray starting inside
+** hits at distance 0, facing back along the ray.
+**
+** Convex hulls are taken to be their bounds.
+*/
+bool ray_vs_shape(const ga_shape* shape, const ga_mat4f& transform, const ga_vec3f& origin, const ga_vec3f& direction, float length, float& distance, ga_vec3f& normal);
+
+/*
+** How far a point is from a shape; 0 if it is inside. Planes bound the half
+** space below them. Convex hulls are taken to be their bounds.
+*/
+float distance_to_shape(const ga_shape* shape, const ga_mat4f& transform, const ga_vec3f& point);
+
+/*
+** Whether a box overlaps a shape. The box is centered on the transform's
+** translation and turned by its rotation, reaching half_extents along each
+** of its axes.
+*/
+bool box_vs_shape(const ga_mat4f& box_transform, const ga_vec3f& half_extents, const ga_shape* shape, const ga_mat4f& transform);
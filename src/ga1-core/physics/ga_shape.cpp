@@ -12,6 +12,8 @@
 #include "graphics/ga_debug_geometry.h"
 #include "math/ga_math.h"
 
+#include <algorithm>
+#include <cfloat>
 #include <vector>
 
 void ga_plane::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* drawcall)
@@ -64,6 +66,12 @@ ga_vec3f ga_plane::get_offset_to_point(const ga_mat4f& transform, const ga_vec3f
 	return ga_vec3f::zero_vector();
 }
 
+void ga_plane::get_world_aabb(const ga_mat4f&, ga_vec3f& min, ga_vec3f& max) const
+{
+	min = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	max = { FLT_MAX, FLT_MAX, FLT_MAX };
+}
+
 void ga_sphere::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* drawcall)
 {
 	draw_debug_sphere(_radius, transform, drawcall);
@@ -80,6 +88,14 @@ ga_vec3f ga_sphere::get_offset_to_point(const ga_mat4f& transform, const ga_vec3
 	return point - center;
 }
 
+void ga_sphere::get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const
+{
+	ga_vec3f center = _center + transform.get_translation();
+	ga_vec3f extent = { _radius, _radius, _radius };
+	min = center - extent;
+	max = center + extent;
+}
+
 void ga_aabb::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* drawcall)
 {
 	drawcall->_positions.push_back({ _min.x, _min.y, _min.z });
@@ -130,20 +146,33 @@ ga_vec3f ga_aabb::get_offset_to_point(const ga_mat4f& transform, const ga_vec3f&
 	return point - center;
 }
 
+void ga_aabb::get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const
+{
+	min = _min + transform.get_translation();
+	max = _max + transform.get_translation();
+}
+
 void ga_oobb::get_corners(std::vector<ga_vec3f>& corners) const
+{
+	ga_vec3f fixed[8];
+	get_corners(fixed);
+	corners.insert(corners.end(), fixed, fixed + 8);
+}
+
+void ga_oobb::get_corners(ga_vec3f corners[8]) const
 {
 	ga_vec3f x_hvec = _half_vectors[0];
 	ga_vec3f y_hvec = _half_vectors[1];
 	ga_vec3f z_hvec = _half_vectors[2];
 
-	corners.push_back(_center - x_hvec - y_hvec - z_hvec);
-	corners.push_back(_center - x_hvec - y_hvec + z_hvec);
-	corners.push_back(_center - x_hvec + y_hvec - z_hvec);
-	corners.push_back(_center - x_hvec + y_hvec + z_hvec);
-	corners.push_back(_center + x_hvec - y_hvec - z_hvec);
-	corners.push_back(_center + x_hvec - y_hvec + z_hvec);
-	corners.push_back(_center + x_hvec + y_hvec - z_hvec);
-	corners.push_back(_center + x_hvec + y_hvec + z_hvec);
+	corners[0] = _center - x_hvec - y_hvec - z_hvec;
+	corners[1] = _center - x_hvec - y_hvec + z_hvec;
+	corners[2] = _center - x_hvec + y_hvec - z_hvec;
+	corners[3] = _center - x_hvec + y_hvec + z_hvec;
+	corners[4] = _center + x_hvec - y_hvec - z_hvec;
+	corners[5] = _center + x_hvec - y_hvec + z_hvec;
+	corners[6] = _center + x_hvec + y_hvec - z_hvec;
+	corners[7] = _center + x_hvec + y_hvec + z_hvec;
 }
 
 void ga_oobb::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* drawcall)
@@ -203,6 +232,21 @@ ga_vec3f ga_oobb::get_offset_to_point(const ga_mat4f& transform, const ga_vec3f&
 	return point - center;
 }
 
+void ga_oobb::get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const
+{
+	ga_vec3f center = _center + transform.get_translation();
+	ga_vec3f extent = ga_vec3f::zero_vector();
+	for (int i = 0; i < 3; ++i)
+	{
+		ga_vec3f half = transform.transform_vector(_half_vectors[i]);
+		extent.x += ga_absf(half.x);
+		extent.y += ga_absf(half.y);
+		extent.z += ga_absf(half.z);
+	}
+	min = center - extent;
+	max = center + extent;
+}
+
 void ga_convex_hull::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* drawcall)
 {
 	// TODO
@@ -218,3 +262,211 @@ ga_vec3f ga_convex_hull::get_offset_to_point(const ga_mat4f& transform, const ga
 	// Unimplemented.
 	return ga_vec3f::zero_vector();
 }
+
+void ga_convex_hull::get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const
+{
+	min = { FLT_MAX, FLT_MAX, FLT_MAX };
+	max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (auto& position : _positions)
+	{
+		ga_vec3f p = transform.transform_point(position);
+		for (int i = 0; i < 3; ++i)
+		{
+			min.axes[i] = p.axes[i] < min.axes[i] ? p.axes[i] : min.axes[i];
+			max.axes[i] = p.axes[i] > max.axes[i] ? p.axes[i] : max.axes[i];
+		}
+	}
+}
+
+// Below this many points, testing them all beats walking the hull.
+static const uint32_t k_hull_climb_min_points = 32;
+
+struct hull_face_t
+{
+	uint32_t _v[3];
+	ga_vec3f _normal;
+	float _distance;
+	bool _alive;
+};
+
+static hull_face_t make_hull_face(const std::vector<ga_vec3f>& positions, uint32_t a, uint32_t b, uint32_t c)
+{
+	hull_face_t face;
+	face._v[0] = a;
+	face._v[1] = b;
+	face._v[2] = c;
+	face._normal = ga_vec3f_cross(positions[b] - positions[a], positions[c] - positions[a]);
+	float length = face._normal.mag();
+	if (length > 0.0f) face._normal.scale(1.0f / length);
+	face._distance = face._normal.dot(positions[a]);
+	face._alive = true;
+	return face;
+}
+
+void ga_convex_hull::build_neighbors()
+{
+	_neighbor_offsets.clear();
+	_neighbors.clear();
+	_support_start = 0;
+
+	uint32_t count = uint32_t(_positions.size());
+	if (count < 4) return;
+
+	// Start from a tetrahedron of points far from each other.
+	uint32_t i0 = 0;
+	for (uint32_t i = 1; i < count; ++i)
+	{
+		if (_positions[i].x < _positions[i0].x) i0 = i;
+	}
+
+	uint32_t i1 = i0;
+	float best = 0.0f;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		float d = (_positions[i] - _positions[i0]).mag2();
+		if (d > best) { best = d; i1 = i; }
+	}
+
+	// Tolerance for coplanar points, relative to the size of the hull.
+	float epsilon = 1e-5f * ga_sqrtf(best);
+	if (i1 == i0 || epsilon <= 0.0f) return;
+
+	ga_vec3f line = (_positions[i1] - _positions[i0]).normal();
+	uint32_t i2 = i0;
+	best = 0.0f;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		float d = ga_vec3f_cross(_positions[i] - _positions[i0], line).mag2();
+		if (d > best) { best = d; i2 = i; }
+	}
+	if (ga_sqrtf(best) <= epsilon) return;
+
+	ga_vec3f plane = ga_vec3f_cross(_positions[i1] - _positions[i0], _positions[i2] - _positions[i0]).normal();
+	uint32_t i3 = i0;
+	best = 0.0f;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		float d = ga_absf(plane.dot(_positions[i] - _positions[i0]));
+		if (d > best) { best = d; i3 = i; }
+	}
+	if (best <= epsilon) return;
+
+	std::vector<hull_face_t> faces;
+	if (plane.dot(_positions[i3] - _positions[i0]) > 0.0f)
+	{
+		std::swap(i1, i2);
+	}
+	faces.push_back(make_hull_face(_positions, i0, i1, i2));
+	faces.push_back(make_hull_face(_positions, i0, i3, i1));
+	faces.push_back(make_hull_face(_positions, i1, i3, i2));
+	faces.push_back(make_hull_face(_positions, i2, i3, i0));
+
+	// Add the remaining points one at a time, replacing the faces each can
+	// see with a fan from the point to the edge of the hole.
+	std::vector<std::pair<uint32_t, uint32_t>> horizon;
+	for (uint32_t p = 0; p < count; ++p)
+	{
+		if (p == i0 || p == i1 || p == i2 || p == i3) continue;
+
+		horizon.clear();
+		for (auto& face : faces)
+		{
+			if (!face._alive || face._normal.dot(_positions[p]) - face._distance <= epsilon) continue;
+
+			face._alive = false;
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t from = face._v[e];
+				uint32_t to = face._v[(e + 1) % 3];
+
+				// An edge between two visible faces is inside the hole.
+				auto shared = std::find(horizon.begin(), horizon.end(), std::make_pair(to, from));
+				if (shared != horizon.end())
+				{
+					*shared = horizon.back();
+					horizon.pop_back();
+				}
+				else
+				{
+					horizon.push_back(std::make_pair(from, to));
+				}
+			}
+		}
+
+		for (auto& edge : horizon)
+		{
+			faces.push_back(make_hull_face(_positions, edge.first, edge.second, p));
+		}
+	}
+
+	std::vector<uint64_t> edges;
+	for (auto& face : faces)
+	{
+		if (!face._alive) continue;
+		for (int e = 0; e < 3; ++e)
+		{
+			uint64_t from = face._v[e];
+			uint64_t to = face._v[(e + 1) % 3];
+			edges.push_back((from << 32) | to);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	// Each edge shows up once from each side, so grouping by the first point
+	// lists every point's neighbors.
+	_neighbor_offsets.assign(count + 1, 0);
+	_neighbors.reserve(edges.size());
+	for (uint64_t edge : edges)
+	{
+		++_neighbor_offsets[uint32_t(edge >> 32) + 1];
+		_neighbors.push_back(uint32_t(edge));
+	}
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		_neighbor_offsets[i + 1] += _neighbor_offsets[i];
+	}
+	_support_start = i0;
+}
+
+uint32_t ga_convex_hull::get_support(const ga_vec3f& dir, uint32_t hint) const
+{
+	uint32_t count = uint32_t(_positions.size());
+	uint32_t best_index = 0;
+
+	if (count < k_hull_climb_min_points || _neighbor_offsets.size() != count + 1)
+	{
+		float best = -FLT_MAX;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			float d = _positions[i].dot(dir);
+			if (d > best)
+			{
+				best = d;
+				best_index = i;
+			}
+		}
+		return best_index;
+	}
+
+	// On a convex hull, a point no neighbor improves on is the farthest.
+	best_index = (hint < count && _neighbor_offsets[hint] != _neighbor_offsets[hint + 1]) ? hint : _support_start;
+	float best = _positions[best_index].dot(dir);
+	bool improved = true;
+	while (improved)
+	{
+		improved = false;
+		uint32_t current = best_index;
+		for (uint32_t n = _neighbor_offsets[current]; n < _neighbor_offsets[current + 1]; ++n)
+		{
+			float d = _positions[_neighbors[n]].dot(dir);
+			if (d > best)
+			{
+				best = d;
+				best_index = _neighbors[n];
+				improved = true;
+			}
+		}
+	}
+	return best_index;
+}
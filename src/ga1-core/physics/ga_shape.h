@@ -61,6 +61,12 @@ struct ga_shape
 	** Returns the vector from the center of mass to the point in space.
 	*/
 	virtual ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const = 0;
+
+	/*
+	** Computes a world space box that contains the shape, placed the same way
+	** the intersection tests place it. Unbounded shapes give an infinite box.
+	*/
+	virtual void get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const = 0;
 };
 
 /*
@@ -75,6 +81,7 @@ struct ga_plane final : ga_shape
 	void get_debug_draw(const ga_mat4f& transform, struct ga_dynamic_drawcall* drawcall) override;
 	void get_inertia_tensor(ga_mat4f& tensor, float mass) override;
 	ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const override;
+	void get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const override;
 };
 
 /*
@@ -89,6 +96,7 @@ struct ga_sphere final : ga_shape
 	void get_debug_draw(const ga_mat4f& transform, struct ga_dynamic_drawcall* drawcall) override;
 	void get_inertia_tensor(ga_mat4f& tensor, float mass) override;
 	ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const override;
+	void get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const override;
 };
 
 /*
@@ -103,6 +111,7 @@ struct ga_aabb final : ga_shape
 	void get_debug_draw(const ga_mat4f& transform, struct ga_dynamic_drawcall* drawcall) override;
 	void get_inertia_tensor(ga_mat4f& tensor, float mass) override;
 	ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const override;
+	void get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const override;
 };
 
 /*
@@ -118,19 +127,47 @@ struct ga_oobb final : ga_shape
 	void get_debug_draw(const ga_mat4f& transform, struct ga_dynamic_drawcall* drawcall) override;
 	void get_inertia_tensor(ga_mat4f& tensor, float mass) override;
 	ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const override;
+	void get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const override;
 
 	void get_corners(std::vector<ga_vec3f>& corners) const;
+	void get_corners(ga_vec3f corners[8]) const;
 };
 
 /*
 ** Defines a collidable arbitrary convex hull made up of individual points.
+**
+** After filling in _positions, call build_neighbors() so support queries on
+** large hulls can walk the hull's edges instead of testing every point.
 */
 struct ga_convex_hull final : ga_shape
 {
 	std::vector<ga_vec3f> _positions;
 
+	// Hull edges: the neighbors of point i are
+	// _neighbors[_neighbor_offsets[i]] up to _neighbors[_neighbor_offsets[i + 1]].
+	// Points inside the hull have none.
+	std::vector<uint32_t> _neighbor_offsets;
+	std::vector<uint32_t> _neighbors;
+
+	// A point on the hull to climb from.
+	uint32_t _support_start = 0;
+
 	ga_shape_t get_type() const override { return k_shape_convex_hull; }
 	void get_debug_draw(const ga_mat4f& transform, struct ga_dynamic_drawcall* drawcall) override;
 	void get_inertia_tensor(ga_mat4f& tensor, float mass) override;
 	ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const override;
+	void get_world_aabb(const ga_mat4f& transform, ga_vec3f& min, ga_vec3f& max) const override;
+
+	/*
+	** Find which points lie on the hull and which of them share an edge.
+	** Flat or tiny hulls are left without neighbors.
+	*/
+	void build_neighbors();
+
+	/*
+	** Returns the index of the point farthest along a local space direction.
+	** Hulls with neighbors climb from hint, which should be the last answer
+	** for this hull; the others test every point.
+	*/
+	uint32_t get_support(const ga_vec3f& dir, uint32_t hint = 0) const;
 };
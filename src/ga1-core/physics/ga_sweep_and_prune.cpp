@@ -0,0 +1,174 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_sweep_and_prune.h"
+
+#include <algorithm>
+#include <cfloat>
+
+// Switch sweep axis only when another is this much more spread out, so the
+// sorted order is not thrown away over small changes.
+static const float k_axis_switch_ratio = 2.0f;
+
+// Min ends sort before max ends at the same value, so touching boxes overlap.
+static bool endpoint_less(float value_a, uint32_t key_a, float value_b, uint32_t key_b)
+{
+	return value_a < value_b || (value_a == value_b && (key_a & 1) < (key_b & 1));
+}
+
+ga_sweep_and_prune::ga_sweep_and_prune() : _axis(0)
+{
+}
+
+ga_sweep_and_prune::~ga_sweep_and_prune()
+{
+}
+
+void ga_sweep_and_prune::choose_axis(const ga_broadphase_box_t* boxes, uint32_t count)
+{
+	// Variance of the box centers along each axis. Unbounded boxes are skipped.
+	float sum[3] = {};
+	float sum2[3] = {};
+	uint32_t n = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const ga_broadphase_box_t& box = boxes[i];
+		if (box._min.x == -FLT_MAX || box._max.x == FLT_MAX) continue;
+
+		for (int a = 0; a < 3; ++a)
+		{
+			float center = 0.5f * (box._min.axes[a] + box._max.axes[a]);
+			sum[a] += center;
+			sum2[a] += center * center;
+		}
+		n++;
+	}
+	if (n == 0) return;
+
+	float variance[3];
+	for (int a = 0; a < 3; ++a)
+	{
+		variance[a] = sum2[a] / n - (sum[a] / n) * (sum[a] / n);
+	}
+
+	int best = _axis;
+	for (int a = 0; a < 3; ++a)
+	{
+		if (variance[a] > variance[best]) best = a;
+	}
+
+	if (_endpoints.empty() || variance[best] > k_axis_switch_ratio * variance[_axis])
+	{
+		if (best != _axis) _endpoints.clear();
+		_axis = best;
+	}
+}
+
+void ga_sweep_and_prune::find_pairs(const ga_broadphase_box_t* boxes, uint32_t count, std::vector<ga_body_pair_t>& pairs)
+{
+	pairs.clear();
+	_rejections = {};
+
+	choose_axis(boxes, count);
+
+	if (_endpoints.size() != size_t(count) * 2)
+	{
+		// Rebuild from scratch.
+		_endpoints.resize(size_t(count) * 2);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			_endpoints[2 * i]._key = i << 1;
+			_endpoints[2 * i + 1]._key = (i << 1) | 1;
+		}
+		for (auto& e : _endpoints)
+		{
+			const ga_broadphase_box_t& box = boxes[e._key >> 1];
+			e._value = (e._key & 1) ? box._max.axes[_axis] : box._min.axes[_axis];
+		}
+		std::sort(_endpoints.begin(), _endpoints.end(), [](const endpoint_t& a, const endpoint_t& b)
+		{
+			return endpoint_less(a._value, a._key, b._value, b._key);
+		});
+	}
+	else
+	{
+		// Refresh the values in place and restore the order with an insertion sort.
+		for (auto& e : _endpoints)
+		{
+			const ga_broadphase_box_t& box = boxes[e._key >> 1];
+			e._value = (e._key & 1) ? box._max.axes[_axis] : box._min.axes[_axis];
+		}
+		for (size_t i = 1; i < _endpoints.size(); ++i)
+		{
+			endpoint_t e = _endpoints[i];
+			size_t j = i;
+			while (j > 0 && endpoint_less(e._value, e._key, _endpoints[j - 1]._value, _endpoints[j - 1]._key))
+			{
+				_endpoints[j] = _endpoints[j - 1];
+				--j;
+			}
+			_endpoints[j] = e;
+		}
+	}
+
+	// Sweep, keeping the set of boxes whose extent along the axis is open.
+	int axis_1 = (_axis + 1) % 3;
+	int axis_2 = (_axis + 2) % 3;
+	_active.clear();
+	_active_slot.resize(count);
+	for (const auto& e : _endpoints)
+	{
+		uint32_t index = e._key >> 1;
+		if (e._key & 1)
+		{
+			uint32_t slot = _active_slot[index];
+			_active[slot] = _active.back();
+			_active_slot[_active[slot]] = slot;
+			_active.pop_back();
+			continue;
+		}
+
+		const ga_broadphase_box_t& box = boxes[index];
+		for (uint32_t other : _active)
+		{
+			const ga_broadphase_box_t& other_box = boxes[other];
+			if (box._min.axes[axis_1] > other_box._max.axes[axis_1] || other_box._min.axes[axis_1] > box._max.axes[axis_1]) continue;
+			if (box._min.axes[axis_2] > other_box._max.axes[axis_2] || other_box._min.axes[axis_2] > box._max.axes[axis_2]) continue;
+			if (!ga_broadphase_accept_pair(box, other_box, _rejections)) continue;
+
+			ga_body_pair_t pair;
+			pair._a = std::min(index, other);
+			pair._b = std::max(index, other);
+			pairs.push_back(pair);
+		}
+
+		_active_slot[index] = uint32_t(_active.size());
+		_active.push_back(index);
+	}
+
+	sort_pairs(pairs);
+}
+
+void ga_sweep_and_prune::query_box(const ga_broadphase_box_t* boxes, uint32_t count, const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const
+{
+	if (_endpoints.size() != size_t(count) * 2)
+	{
+		ga_broadphase::query_box(boxes, count, min, max, bodies);
+		return;
+	}
+
+	for (const auto& e : _endpoints)
+	{
+		if (e._value > max.axes[_axis]) break;
+		if (e._key & 1) continue;
+
+		uint32_t index = e._key >> 1;
+		if (boxes_overlap(boxes[index]._min, boxes[index]._max, min, max)) bodies.push_back(index);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_broadphase.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+** Sweep-and-prune broadphase.
+**
+** The ends of every box along one axis are kept in a single sorted array.
+** Bodies move little from frame to frame, so the array is re-sorted with an
+** insertion sort that does close to linear work. A sweep along the array
+** then only compares boxes whose extents overlap on that axis.
+**
+** The sweep axis is the one along which the bodies are most spread out.
+*/
+class ga_sweep_and_prune final : public ga_broadphase
+{
+public:
+	ga_sweep_and_prune();
+	virtual ~ga_sweep_and_prune();
+
+	virtual void find_pairs(const ga_broadphase_box_t* boxes, uint32_t count, std::vector<ga_body_pair_t>& pairs) override;
+
+	/*
+	** Forget the sorted order.
+	*/
+	virtual void reset() override { _endpoints.clear(); }
+
+	/*
+	** Only boxes starting before the query ends along the sweep axis are
+	** tested.
+	*/
+	virtual void query_box(const ga_broadphase_box_t* boxes, uint32_t count, const ga_vec3f& min, const ga_vec3f& max, std::vector<uint32_t>& bodies) const override;
+
+private:
+	/*
+	** One end of a box along the sweep axis.
+	** The low bit of the key marks a max end; the rest is the box index.
+	*/
+	struct endpoint_t
+	{
+		float _value;
+		uint32_t _key;
+	};
+
+	void choose_axis(const ga_broadphase_box_t* boxes, uint32_t count);
+
+	std::vector<endpoint_t> _endpoints;
+	std::vector<uint32_t> _active;
+	std::vector<uint32_t> _active_slot;
+	int _axis;
+};